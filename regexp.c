@@ -23,8 +23,9 @@
  * regular-expression syntax might require a total rethink.
  *
  * *** NOTE: this code has been altered slightly for use in Tcl. ***
- * *** The only change is to use ckalloc and ckfree instead of   ***
- * *** malloc and free.						 ***
+ * *** It uses ckalloc and ckfree instead of malloc and free,    ***
+ * *** and regcomp sets the reglinear and regnfa fields used by  ***
+ * *** TclExecRegexp in tclNfa.c.				 ***
  *
  * $Id: regexp.c,v 1.1.1.1 2001/04/29 20:34:09 karll Exp $
  */
@@ -39,15 +40,23 @@
  * reganch	is the match anchored (at beginning-of-line only)?
  * regmust	string (pointer into program) that match must include, or NULL
  * regmlen	length of regmust string
+ * regprefix	string (pointer into program) that match must begin with, or NULL
+ * regfirst	ANYOF or ANYBUT node that must match the first char, or NULL
+ * reglinear	does the r.e. use alternation or repetition?  If so, Tcl
+ *		matches it with the NFA in tclNfa.c rather than regexec
+ * regnfa	that NFA, built on first use; NULL until then
  *
  * Regstart and reganch permit very fast decisions on suitable starting points
- * for a match, cutting down the work a lot.  Regmust permits fast rejection
- * of lines that cannot possibly match.  The regmust tests are costly enough
- * that regcomp() supplies a regmust only if the r.e. contains something
- * potentially expensive (at present, the only such thing detected is * or +
- * at the start of the r.e., which can involve a lot of backup).  Regmlen is
- * supplied because the test in regexec() needs it and regcomp() is computing
- * it anyway.
+ * for a match, cutting down the work a lot.  Regprefix and regfirst let
+ * regexec skip to the next suitable starting point with the library's
+ * string scanning routines (strstr, strpbrk, strspn), which are generally
+ * much faster than looking at each character in turn.  Regmust permits fast
+ * rejection of lines that cannot possibly match.  The regmust tests are
+ * costly enough that regcomp() supplies a regmust only if the r.e. contains
+ * something potentially expensive (at present, * or + at the start of the
+ * r.e., which can involve a lot of backup, or anything that Tcl matches
+ * with its NFA).  Regmlen is supplied because the test in regexec() needs
+ * it and regcomp() is computing it anyway.
  */
 
 /*
@@ -203,6 +212,7 @@ char *exp;
 	register regexp *r;
 	register char *scan;
 	register char *longest;
+	register char *first;
 	register int len;
 	int flags;
 
@@ -240,14 +250,38 @@ char *exp;
 	r->reganch = 0;
 	r->regmust = NULL;
 	r->regmlen = 0;
+	r->regprefix = NULL;
+	r->regfirst = NULL;
+	r->reglinear = 0;
+	r->regnfa = NULL;
+
+	/*
+	 * Alternation and repetition are what make backtracking
+	 * expensive.  The nodes are stored in order, with END last.
+	 */
+	for (scan = r->program+1; OP(scan) != END; scan += 3) {
+		if (OP(scan) == STAR || OP(scan) == PLUS || OP(scan) == BACK ||
+		    (OP(scan) == BRANCH && OP(regnext(scan)) == BRANCH))
+			r->reglinear = 1;
+		if (OP(scan) == ANYOF || OP(scan) == ANYBUT ||
+		    OP(scan) == EXACTLY)
+			scan += strlen(OPERAND(scan)) + 1;
+	}
+
 	scan = r->program+1;			/* First BRANCH. */
 	if (OP(regnext(scan)) == END) {		/* Only one top-level choice. */
 		scan = OPERAND(scan);
 
-		/* Starting-point info. */
-		if (OP(scan) == EXACTLY)
-			r->regstart = *OPERAND(scan);
-		else if (OP(scan) == BOL)
+		/* Starting-point info.  OPENs match nothing: look past them. */
+		first = scan;
+		while (OP(first) > OPEN && OP(first) < CLOSE)
+			first = regnext(first);
+		if (OP(first) == EXACTLY) {
+			r->regstart = *OPERAND(first);
+			r->regprefix = OPERAND(first);
+		} else if (OP(first) == ANYOF || OP(first) == ANYBUT)
+			r->regfirst = first;
+		else if (OP(first) == BOL)
 			r->reganch++;
 
 		/*
@@ -257,8 +291,10 @@ char *exp;
 		 * the regstart check works with the beginning of the r.e.
 		 * and avoiding duplication strengthens checking.  Not a
 		 * strong reason, but sufficient in the absence of others.
+		 * Anything matched by the NFA in tclNfa.c counts as
+		 * expensive, unless it is anchored.
 		 */
-		if (flags&SPSTART) {
+		if ((flags&SPSTART) || (r->reglinear && !r->reganch)) {
 			longest = NULL;
 			len = 0;
 			for (; scan != NULL; scan = regnext(scan))
@@ -711,13 +747,28 @@ STATIC char *regprop();
  */
 int
 regexec(prog, string)
+regexp *prog;
+char *string;
+{
+	return(regexecfrom(prog, string, string));
+}
+
+/*
+ - regexecfrom - match a regexp against the part of a string from start on
+ *
+ * A ^ matches only at the beginning of string, so a search resumed
+ * after an earlier match doesn't find the start of the line again.
+ */
+int
+regexecfrom(prog, string, start)
 register regexp *prog;
-register char *string;
+char *string;
+char *start;
 {
 	register char *s;
 
 	/* Be paranoid... */
-	if (prog == NULL || string == NULL) {
+	if (prog == NULL || string == NULL || start == NULL) {
 		regerror("NULL parameter");
 		return(0);
 	}
@@ -728,15 +779,12 @@ register char *string;
 		return(0);
 	}
 
-	/* If there is a "must appear" string, look for it. */
-	if (prog->regmust != NULL) {
-		s = string;
-		while ((s = strchr(s, prog->regmust[0])) != NULL) {
-			if (strncmp(s, prog->regmust, prog->regmlen) == 0)
-				break;	/* Found it. */
-			s++;
-		}
-		if (s == NULL)	/* Not present. */
+	/*
+	 * If there is a "must appear" string, look for it (unless the
+	 * prefix search below will).
+	 */
+	if (prog->regmust != NULL && prog->regmust != prog->regprefix) {
+		if (strstr(start, prog->regmust) == NULL)	/* Not present. */
 			return(0);
 	}
 
@@ -745,17 +793,37 @@ register char *string;
 
 	/* Simplest case:  anchored match need be tried only once. */
 	if (prog->reganch)
-		return(regtry(prog, string));
+		return(start == string && regtry(prog, start));
 
 	/* Messy cases:  unanchored match. */
-	s = string;
-	if (prog->regstart != '\0')
+	s = start;
+	if (prog->regprefix != NULL && prog->regprefix[1] != '\0')
+		/* We know what string it must start with. */
+		while ((s = strstr(s, prog->regprefix)) != NULL) {
+			if (regtry(prog, s))
+				return(1);
+			s++;
+		}
+	else if (prog->regstart != '\0')
 		/* We know what char it must start with. */
 		while ((s = strchr(s, prog->regstart)) != NULL) {
 			if (regtry(prog, s))
 				return(1);
 			s++;
 		}
+	else if (prog->regfirst != NULL)
+		/* We know what chars it can start with. */
+		for (;;) {
+			if (OP(prog->regfirst) == ANYOF)
+				s = strpbrk(s, OPERAND(prog->regfirst));
+			else
+				s += strspn(s, OPERAND(prog->regfirst));
+			if (s == NULL || *s == '\0')
+				break;
+			if (regtry(prog, s))
+				return(1);
+			s++;
+		}
 	else
 		/* We don't -- general case. */
 		do {
@@ -1107,6 +1175,8 @@ regexp *r;
 		printf("start `%c' ", r->regstart);
 	if (r->reganch)
 		printf("anchored ");
+	if (r->regprefix != NULL)
+		printf("prefix \"%s\" ", r->regprefix);
 	if (r->regmust != NULL)
 		printf("must have \"%s\"", r->regmust);
 	printf("\n");
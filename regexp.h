@@ -19,11 +19,17 @@ typedef struct regexp {
 	char reganch;		/* Internal use only. */
 	char *regmust;		/* Internal use only. */
 	int regmlen;		/* Internal use only. */
+	char *regprefix;	/* Internal use only. */
+	char *regfirst;		/* Internal use only. */
+	char reglinear;		/* Internal use only. */
+	struct RegNfa *regnfa;	/* Internal use only. */
 	char program[1];	/* Unwarranted chumminess with compiler. */
 } regexp;
 
 extern regexp *regcomp _ANSI_ARGS_((char *exp));
 extern int regexec _ANSI_ARGS_((regexp *prog, char *string));
+extern int regexecfrom _ANSI_ARGS_((regexp *prog, char *string,
+	char *start));
 extern void regsub _ANSI_ARGS_((regexp *prog, char *source, char *dest));
 extern void regerror _ANSI_ARGS_((char *msg));
 
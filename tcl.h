@@ -228,7 +228,9 @@ typedef char *(Tcl_VarTraceProc) _ANSI_ARGS_((ClientData clientData,
 /*
  * The following declarations either map ckalloc and ckfree to
  * malloc and free, or they map them to procedures with all sorts
- * of debugging hooks defined in tclCkalloc.c.
+ * of debugging hooks defined in tclCkalloc.c, or (if TCL_MEM_POOL
+ * is defined) to a pool allocator, also in tclalloc.c, that keeps
+ * free lists of small blocks by size.
  */
 
 #ifdef TCL_MEM_DEBUG
@@ -248,9 +250,19 @@ EXTERN void		Tcl_ValidateAllMemory _ANSI_ARGS_((char *file,
 
 #else
 
+#ifdef TCL_MEM_POOL
+EXTERN char *		Tcl_PoolAlloc _ANSI_ARGS_((unsigned int size));
+EXTERN void		Tcl_PoolFree _ANSI_ARGS_((char *ptr));
+EXTERN char *		Tcl_PoolRealloc _ANSI_ARGS_((char *ptr,
+			    unsigned int size));
+#  define ckalloc(x) Tcl_PoolAlloc(x)
+#  define ckfree(x)  Tcl_PoolFree((char *) (x))
+#  define ckrealloc(x,y) Tcl_PoolRealloc((char *) (x), (y))
+#else
 #  define ckalloc(x) malloc(x)
 #  define ckfree(x)  free(x)
 #  define ckrealloc(x,y) realloc(x,y)
+#endif /* TCL_MEM_POOL */
 #  define Tcl_DumpActiveMemory(x)
 #  define Tcl_ValidateAllMemory(x,y)
 
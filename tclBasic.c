@@ -79,8 +79,10 @@ static CmdInfo builtInCmds[] = {
     {"string",		Tcl_StringCmd},
     {"trace",		Tcl_TraceCmd},
     {"unset",		Tcl_UnsetCmd},
+    {"update",		Tcl_UpdateCmd},
     {"uplevel",		Tcl_UplevelCmd},
     {"upvar",		Tcl_UpvarCmd},
+    {"vwait",		Tcl_VwaitCmd},
     {"while",		Tcl_WhileCmd},
 
     /*
@@ -88,12 +90,16 @@ static CmdInfo builtInCmds[] = {
      */
 
 #ifndef TCL_GENERIC_ONLY
+    {"after",		Tcl_AfterCmd},
     {"cd",		Tcl_CdCmd},
     {"close",		Tcl_CloseCmd},
     {"eof",		Tcl_EofCmd},
     {"exit",		Tcl_ExitCmd},
+    {"fconfigure",	Tcl_FconfigureCmd},
     {"file",		Tcl_FileCmd},
+    {"fileevent",	Tcl_FileEventCmd},
     {"flush",		Tcl_FlushCmd},
+    {"foreach_line",	Tcl_ForeachLineCmd},
     {"gets",		Tcl_GetsCmd},
     {"open",		Tcl_OpenCmd},
     {"puts",		Tcl_PutsCmd},
@@ -106,6 +112,13 @@ static CmdInfo builtInCmds[] = {
     {NULL,		(Tcl_CmdProc *) NULL}
 };
 
+/*
+ * Procedures used only in this file:
+ */
+
+static void		FlushScripts _ANSI_ARGS_((Interp *iPtr, int all));
+static ByteCode *	LookupScript _ANSI_ARGS_((Interp *iPtr, char *cmd));
+
 /*
  *----------------------------------------------------------------------
  *
@@ -138,11 +151,16 @@ Tcl_CreateInterp()
     iPtr->freeProc = 0;
     iPtr->errorLine = 0;
     Tcl_InitHashTable(&iPtr->commandTable, TCL_STRING_KEYS);
+    iPtr->cmdEpoch = 0;
     Tcl_InitHashTable(&iPtr->globalTable, TCL_STRING_KEYS);
     iPtr->numLevels = 0;
     iPtr->framePtr = NULL;
     iPtr->varFramePtr = NULL;
     iPtr->activeTracePtr = NULL;
+    iPtr->varEpoch = 0;
+    iPtr->argVarPtr = NULL;
+    iPtr->argVarWord = NULL;
+    iPtr->argVarEpoch = 0;
     iPtr->numEvents = 0;
     iPtr->events = NULL;
     iPtr->curEvent = 0;
@@ -156,11 +174,28 @@ Tcl_CreateInterp()
     iPtr->appendUsed = 0;
     iPtr->numFiles = 0;
     iPtr->filePtrArray = NULL;
-    for (i = 0; i < NUM_REGEXPS; i++) {
-	iPtr->patterns[i] = NULL;
-	iPtr->patLengths[i] = -1;
-	iPtr->regexps[i] = NULL;
+    iPtr->timerHeap = NULL;
+    iPtr->numTimers = iPtr->timerSpace = 0;
+    iPtr->idleFirst = iPtr->idleLast = NULL;
+    iPtr->afterId = 0;
+    Tcl_InitHashTable(&iPtr->regexpTable, TCL_STRING_KEYS);
+    iPtr->regexpFirst = iPtr->regexpLast = NULL;
+    iPtr->maxRegexps = DEFAULT_MAX_REGEXPS;
+    iPtr->regexpHits = iPtr->regexpMisses = iPtr->regexpEvictions = 0;
+    Tcl_InitHashTable(&iPtr->scriptTable, TCL_STRING_KEYS);
+    Tcl_InitHashTable(&iPtr->exprTable, TCL_STRING_KEYS);
+    for (i = 0; i < NUM_RECENT_SCRIPTS; i++) {
+	iPtr->recentText[i] = NULL;
+	iPtr->recentExprText[i] = NULL;
+	iPtr->seenExprs[i] = 0;
     }
+    iPtr->execArgv = NULL;
+    iPtr->execLits = NULL;
+    iPtr->execArgc = 0;
+    iPtr->arenaPtr = NULL;
+    iPtr->arenaNext = NULL;
+    iPtr->freeChunkPtr = NULL;
+    iPtr->numFreeChunks = 0;
     iPtr->cmdCount = 0;
     iPtr->noEval = 0;
     iPtr->scriptFile = NULL;
@@ -266,6 +301,7 @@ Tcl_DeleteInterp(interp)
     if (iPtr->appendResult != NULL) {
 	ckfree(iPtr->appendResult);
     }
+    TclDeleteEvents(iPtr);
 #ifndef TCL_GENERIC_ONLY
     if (iPtr->numFiles > 0) {
 	for (i = 0; i < iPtr->numFiles; i++) {
@@ -275,6 +311,7 @@ Tcl_DeleteInterp(interp)
 	    if (filePtr == NULL) {
 		continue;
 	    }
+	    TclReleaseFile(filePtr);
 	    if (i >= 3) {
 		fclose(filePtr->f);
 		if (filePtr->f2 != NULL) {
@@ -290,12 +327,18 @@ Tcl_DeleteInterp(interp)
 	ckfree((char *) iPtr->filePtrArray);
     }
 #endif
-    for (i = 0; i < NUM_REGEXPS; i++) {
-	if (iPtr->patterns[i] == NULL) {
-	    break;
-	}
-	ckfree(iPtr->patterns[i]);
-	ckfree((char *) iPtr->regexps[i]);
+    TclFlushRegexps(iPtr);
+    Tcl_DeleteHashTable(&iPtr->regexpTable);
+    FlushScripts(iPtr, 1);
+    Tcl_DeleteHashTable(&iPtr->scriptTable);
+    TclFlushExprs(iPtr);
+    Tcl_DeleteHashTable(&iPtr->exprTable);
+    TclArenaRelease(iPtr, (char *) NULL);
+    while (iPtr->freeChunkPtr != NULL) {
+	ArenaChunk *nextPtr = iPtr->freeChunkPtr->nextPtr;
+
+	ckfree((char *) iPtr->freeChunkPtr);
+	iPtr->freeChunkPtr = nextPtr;
     }
     while (iPtr->tracePtr != NULL) {
 	Trace *nextPtr = iPtr->tracePtr->nextPtr;
@@ -360,6 +403,7 @@ Tcl_CreateCommand(interp, cmdName, proc, clientData, deleteProc)
     cmdPtr->proc = proc;
     cmdPtr->clientData = clientData;
     cmdPtr->deleteProc = deleteProc;
+    iPtr->cmdEpoch++;
 }
 
 /*
@@ -401,6 +445,7 @@ Tcl_DeleteCommand(interp, cmdName)
     }
     ckfree((char *) cmdPtr);
     Tcl_DeleteHashEntry(hPtr);
+    iPtr->cmdEpoch++;
     return 0;
 }
 
@@ -421,7 +466,13 @@ Tcl_DeleteCommand(interp, cmdName)
  *	character or a closing bracket).
  *
  * Side effects:
- *	Almost certainly;  depends on the command.
+ *	Almost certainly;  depends on the command.  Complete scripts
+ *	(as opposed to bracketed commands) are entered in the
+ *	interpreter's script cache, and the second time a script
+ *	is seen it is compiled so that later evaluations of the
+ *	same text needn't parse it again.  Literal scripts passed
+ *	from compiled code (loop bodies, etc.) are compiled the
+ *	first time they are evaluated, and found by address.
  *
  *-----------------------------------------------------------------
  */
@@ -437,6 +488,73 @@ Tcl_Eval(interp, cmd, flags, termPtr)
 				 * to with the address of the char. just after
 				 * the last one that was part of cmd.  See
 				 * the man page for details on this. */
+{
+    register Interp *iPtr = (Interp *) interp;
+    ByteCode *codePtr;
+    int result;
+
+    if ((flags & (TCL_BRACKET_TERM|TCL_RECORD_BOUNDS)) || iPtr->noEval) {
+	return TclEvalCode(interp, cmd, (ByteCode *) NULL, 0, flags,
+		termPtr);
+    }
+    codePtr = NULL;
+    if (iPtr->execArgc != 0) {
+	codePtr = TclLiteralCode(iPtr, cmd);
+    }
+    if (codePtr == NULL) {
+	codePtr = LookupScript(iPtr, cmd);
+	if (codePtr == NULL) {
+	    return TclEvalCode(interp, cmd, (ByteCode *) NULL, 0, flags,
+		    termPtr);
+	}
+    }
+
+    /*
+     * Hold a reference to the code while it executes:  it could be
+     * flushed from the cache by commands that it invokes.
+     */
+
+    codePtr->refCount++;
+    result = TclEvalCode(interp, cmd, codePtr, 0, flags, termPtr);
+    TclReleaseCode(codePtr);
+    return result;
+}
+
+/*
+ *-----------------------------------------------------------------
+ *
+ * TclEvalCode --
+ *
+ *	Execute a Tcl script, either by parsing its text or from
+ *	code previously generated by TclCompileScript.  This
+ *	procedure does all of the work of Tcl_Eval, and is also
+ *	used to execute the nested commands of compiled scripts.
+ *
+ * Results:
+ *	Same as for Tcl_Eval.
+ *
+ * Side effects:
+ *	Almost certainly;  depends on the command.
+ *
+ *-----------------------------------------------------------------
+ */
+
+int
+TclEvalCode(interp, base, codePtr, script, flags, termPtr)
+    Tcl_Interp *interp;		/* Token for command interpreter (returned
+				 * by a previous call to Tcl_CreateInterp). */
+    char *base;			/* If codePtr is NULL, the script to
+				 * interpret.  Otherwise the text from
+				 * which codePtr was compiled. */
+    ByteCode *codePtr;		/* Compiled form of script to execute, or
+				 * NULL to parse it from base. */
+    int script;			/* Index in codePtr->scripts of the script
+				 * to execute (0 for the outermost one). */
+    int flags;			/* OR-ed combination of flags like
+				 * TCL_BRACKET_TERM and TCL_RECORD_BOUNDS. */
+    char **termPtr;		/* If non-NULL, fill in the address it points
+				 * to with the address of the char. just after
+				 * the last one that was part of the script. */
 {
     /*
      * The storage immediately below is used to generate a copy
@@ -451,18 +569,34 @@ Tcl_Eval(interp, cmd, flags, termPtr)
 
     /*
      * This procedure generates an (argv, argc) array for the command,
-     * It starts out with stack-allocated space but uses dynamically-
-     * allocated storage to increase it if needed.
+     * It starts out with stack-allocated space but uses storage from
+     * the interpreter's arena to increase it if needed (the same goes
+     * for pv).  Everything taken from the arena is given back before
+     * the next command's words are built, and at the end, by releasing
+     * the arena back to arenaMark.
      */
 
 #   define NUM_ARGS 10
     char *(argStorage[NUM_ARGS]);
     char **argv = argStorage;
+    CodeLiteral *(litStorage[NUM_ARGS]);
+    CodeLiteral **lits = litStorage;	/* For compiled commands, the
+					 * literal each word of argv was
+					 * copied from, or NULL. */
     int argc;
     int argSize = NUM_ARGS;
+    char *arenaMark;
 
+    char *cmd;				/* First character of script. */
     register char *src;			/* Points to current character
 					 * in cmd. */
+    int *pc;				/* Next instruction to execute from
+					 * codePtr. */
+    int cmdEnd;				/* Offset of the character that
+					 * terminates a compiled command. */
+    char **savedArgv;			/* Previous values of iPtr->execArgv, */
+    CodeLiteral **savedLits;		/* iPtr->execLits, */
+    int savedArgc;			/* and iPtr->execArgc. */
     char termChar;			/* Return when this character is found
 					 * (either ']' or '\0').  Zero means
 					 * that newlines terminate commands. */
@@ -470,6 +604,9 @@ Tcl_Eval(interp, cmd, flags, termPtr)
     register Interp *iPtr = (Interp *) interp;
     Tcl_HashEntry *hPtr;
     Command *cmdPtr;
+    CodeLiteral *cmdLitPtr;		/* If the command's name is a literal
+					 * in codePtr, the literal;  it caches
+					 * the Command for the name. */
     char *dummy;			/* Make termPtr point here if it was
 					 * originally NULL. */
     char *cmdStart;			/* Points to first non-blank char. in
@@ -509,11 +646,22 @@ Tcl_Eval(interp, cmd, flags, termPtr)
      * Initialize the area in which command copies will be assembled.
      */
 
+    arenaMark = iPtr->arenaNext;
     pv.buffer = copyStorage;
     pv.end = copyStorage + NUM_CHARS - 1;
-    pv.expandProc = TclExpandParseValue;
-    pv.clientData = (ClientData) NULL;
+    pv.expandProc = TclArenaExpand;
+    pv.clientData = (ClientData) iPtr;
 
+    if (codePtr == NULL) {
+	cmd = base;
+    } else {
+	cmd = base + codePtr->scripts[script].start;
+	pc = codePtr->code + codePtr->scripts[script].pc;
+    }
+    savedArgv = iPtr->execArgv;
+    savedLits = iPtr->execLits;
+    savedArgc = iPtr->execArgc;
+    iPtr->execArgc = 0;
     src = cmd;
     if (flags & TCL_BRACKET_TERM) {
 	termChar = ']';
@@ -532,7 +680,60 @@ Tcl_Eval(interp, cmd, flags, termPtr)
      * individual commands.
      */
 
-    while (*src != termChar) {
+    while (1) {
+	if (iPtr->arenaNext != arenaMark) {
+	    TclArenaRelease(iPtr, arenaMark);
+	    argv = argStorage;
+	    lits = litStorage;
+	    argSize = NUM_ARGS;
+	    pv.buffer = copyStorage;
+	    pv.end = copyStorage + NUM_CHARS - 1;
+	}
+	if (codePtr != NULL) {
+	    /*
+	     * The script has been compiled:  execute the instructions
+	     * that build the words of the next command.  Each command
+	     * starts with INST_COMMAND numWords start end.
+	     */
+
+	    if (*src != termChar) {
+		iPtr->flags &= ~(ERR_IN_PROGRESS | ERROR_CODE_SET);
+	    }
+	    if (*pc == INST_DONE) {
+		*termPtr = base + codePtr->scripts[script].end;
+		break;
+	    }
+	    argc = pc[1];
+	    cmdStart = base + pc[2];
+	    cmdEnd = pc[3];
+	    pc += 4;
+	    if (argc + 2 > argSize) {
+		argSize = argc + 2;
+		argv = (char **) TclArenaAlloc(iPtr,
+			argSize * sizeof(char *));
+		lits = (CodeLiteral **) TclArenaAlloc(iPtr,
+			argSize * sizeof(CodeLiteral *));
+	    }
+	    if (*pc == INST_PUSH_LIT) {
+		cmdLitPtr = &codePtr->literals[pc[1]];
+	    } else {
+		cmdLitPtr = NULL;
+	    }
+	    pv.next = pv.buffer;
+	    result = TclExecWords((Tcl_Interp *) iPtr, codePtr, base, &pc,
+		    argv, lits, &pv, termPtr);
+	    if (result != TCL_OK) {
+		src = *termPtr;
+		ellipsis = "...";
+		goto done;
+	    }
+	    src = *termPtr = base + cmdEnd;
+	    goto execute;
+	}
+
+	if (*src == termChar) {
+	    break;
+	}
 	iPtr->flags &= ~(ERR_IN_PROGRESS | ERROR_CODE_SET);
 
 	/*
@@ -568,6 +769,7 @@ Tcl_Eval(interp, cmd, flags, termPtr)
 
 	pv.next = oldBuffer = pv.buffer;
 	argc = 0;
+	cmdLitPtr = NULL;
 	while (1) {
 	    int newArgs, maxArgs;
 	    char **newArgv;
@@ -615,16 +817,14 @@ Tcl_Eval(interp, cmd, flags, termPtr)
 	     */
 
 	    argSize *= 2;
-	    newArgv = (char **)
-		    ckalloc((unsigned) argSize * sizeof(char *));
+	    newArgv = (char **) TclArenaAlloc(iPtr,
+		    argSize * sizeof(char *));
 	    for (i = 0; i < argc; i++) {
 		newArgv[i] = argv[i];
 	    }
-	    if (argv != argStorage) {
-		ckfree((char *) argv);
-	    }
 	    argv = newArgv;
 	}
+	iPtr->argVarPtr = NULL;
 
 	/*
 	 * If this is an empty command (or if we're just parsing
@@ -632,6 +832,7 @@ Tcl_Eval(interp, cmd, flags, termPtr)
 	 * next command.
 	 */
 
+	execute:
 	if ((argc == 0) || iPtr->noEval) {
 	    continue;
 	}
@@ -650,28 +851,46 @@ Tcl_Eval(interp, cmd, flags, termPtr)
 	 * Find the procedure to execute this command.  If there isn't
 	 * one, then see if there is a command "unknown".  If so,
 	 * invoke it instead, passing it the words of the original
-	 * command as arguments.
+	 * command as arguments.  If the name came from a literal in
+	 * compiled code, the literal remembers the command it found
+	 * last time, which is good until a command is created, deleted
+	 * or renamed.
 	 */
 
-	hPtr = Tcl_FindHashEntry(&iPtr->commandTable, argv[0]);
-	if (hPtr == NULL) {
-	    int i;
-
-	    hPtr = Tcl_FindHashEntry(&iPtr->commandTable, "unknown");
+	if ((cmdLitPtr != NULL) && (cmdLitPtr->cmdPtr != NULL)
+		&& (cmdLitPtr->cmdEpoch == iPtr->cmdEpoch)) {
+	    cmdPtr = cmdLitPtr->cmdPtr;
+	} else {
+	    hPtr = Tcl_FindHashEntry(&iPtr->commandTable, argv[0]);
 	    if (hPtr == NULL) {
-		Tcl_ResetResult(interp);
-		Tcl_AppendResult(interp, "invalid command name: \"",
-			argv[0], "\"", (char *) NULL);
-		result = TCL_ERROR;
-		goto done;
-	    }
-	    for (i = argc; i >= 0; i--) {
-		argv[i+1] = argv[i];
+		int i;
+
+		hPtr = Tcl_FindHashEntry(&iPtr->commandTable, "unknown");
+		if (hPtr == NULL) {
+		    Tcl_ResetResult(interp);
+		    Tcl_AppendResult(interp, "invalid command name: \"",
+			    argv[0], "\"", (char *) NULL);
+		    result = TCL_ERROR;
+		    goto done;
+		}
+		for (i = argc; i >= 0; i--) {
+		    argv[i+1] = argv[i];
+		    if ((codePtr != NULL) && (i < argc)) {
+			lits[i+1] = lits[i];
+		    }
+		}
+		argv[0] = "unknown";
+		lits[0] = NULL;
+		argc++;
+		cmdPtr = (Command *) Tcl_GetHashValue(hPtr);
+	    } else {
+		cmdPtr = (Command *) Tcl_GetHashValue(hPtr);
+		if (cmdLitPtr != NULL) {
+		    cmdLitPtr->cmdPtr = cmdPtr;
+		    cmdLitPtr->cmdEpoch = iPtr->cmdEpoch;
+		}
 	    }
-	    argv[0] = "unknown";
-	    argc++;
 	}
-	cmdPtr = (Command *) Tcl_GetHashValue(hPtr);
 
 	/*
 	 * Call trace procedures, if any.
@@ -702,7 +921,14 @@ Tcl_Eval(interp, cmd, flags, termPtr)
 	Tcl_FreeResult(iPtr);
 	iPtr->result = iPtr->resultSpace;
 	iPtr->resultSpace[0] = 0;
+	if (codePtr != NULL) {
+	    iPtr->execArgv = argv;
+	    iPtr->execLits = lits;
+	    iPtr->execArgc = argc;
+	}
 	result = (*cmdPtr->proc)(cmdPtr->clientData, interp, argc, argv);
+	iPtr->argVarPtr = NULL;
+	iPtr->execArgc = 0;
 	if (result != TCL_OK) {
 	    break;
 	}
@@ -713,12 +939,11 @@ Tcl_Eval(interp, cmd, flags, termPtr)
      */
 
     done:
-    if (pv.buffer != copyStorage) {
-	ckfree((char *) pv.buffer);
-    }
-    if (argv != argStorage) {
-	ckfree((char *) argv);
-    }
+    iPtr->argVarPtr = NULL;
+    iPtr->execArgv = savedArgv;
+    iPtr->execLits = savedLits;
+    iPtr->execArgc = savedArgc;
+    TclArenaRelease(iPtr, arenaMark);
     iPtr->numLevels--;
     if (iPtr->numLevels == 0) {
 	if (result == TCL_RETURN) {
@@ -794,6 +1019,127 @@ Tcl_Eval(interp, cmd, flags, termPtr)
     return result;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * LookupScript --
+ *
+ *	Find the compiled form of a script in an interpreter's script
+ *	cache.
+ *
+ * Results:
+ *	The return value is the compiled form of cmd, or NULL if there
+ *	isn't one (the script is too long, hasn't been seen before,
+ *	or contains a syntax error).
+ *
+ * Side effects:
+ *	The script is entered in the cache if it isn't already there,
+ *	and compiled if this is the second time it has been seen.
+ *	Other entries may be flushed to make room.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ByteCode *
+LookupScript(iPtr, cmd)
+    register Interp *iPtr;	/* Interpreter whose cache is to be used. */
+    char *cmd;			/* Text of script. */
+{
+    Tcl_HashEntry *hPtr;
+    register CachedScript *cachePtr;
+    int new, i;
+
+    /*
+     * Scripts such as procedure and loop bodies tend to be evaluated
+     * over and over from the same address, so check the entry last
+     * found at this address before hashing the whole script.
+     */
+
+    i = RECENT_INDEX(cmd);
+    if ((iPtr->recentText[i] == cmd) && (strcmp(cmd,
+	    Tcl_GetHashKey(&iPtr->scriptTable, iPtr->recentScripts[i])) == 0)) {
+	hPtr = iPtr->recentScripts[i];
+    } else {
+	if (strlen(cmd) > MAX_CACHED_LENGTH) {
+	    return NULL;
+	}
+	hPtr = Tcl_FindHashEntry(&iPtr->scriptTable, cmd);
+	if (hPtr == NULL) {
+	    if (iPtr->scriptTable.numEntries >= MAX_CACHED_SCRIPTS) {
+		FlushScripts(iPtr, 0);
+	    }
+	    hPtr = Tcl_CreateHashEntry(&iPtr->scriptTable, cmd, &new);
+	    cachePtr = (CachedScript *) ckalloc(sizeof(CachedScript));
+	    cachePtr->numUses = 0;
+	    cachePtr->codePtr = NULL;
+	    Tcl_SetHashValue(hPtr, cachePtr);
+	}
+	iPtr->recentText[i] = cmd;
+	iPtr->recentScripts[i] = hPtr;
+    }
+    cachePtr = (CachedScript *) Tcl_GetHashValue(hPtr);
+    if (cachePtr->numUses < 2) {
+	cachePtr->numUses++;
+	if (cachePtr->numUses < 2) {
+	    return NULL;
+	}
+	cachePtr->codePtr = TclCompileScript(cmd);
+    }
+    return cachePtr->codePtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FlushScripts --
+ *
+ *	Remove entries from an interpreter's script cache.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	If all is non-zero, the cache is emptied.  Otherwise scripts
+ *	that have only been seen once are removed and, if the cache
+ *	is still more than half full, everything else goes too.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FlushScripts(iPtr, all)
+    register Interp *iPtr;	/* Interpreter whose cache is to be
+				 * flushed. */
+    int all;			/* Non-zero means flush every entry. */
+{
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    register CachedScript *cachePtr;
+    int i;
+
+    for (i = 0; i < NUM_RECENT_SCRIPTS; i++) {
+	iPtr->recentText[i] = NULL;
+    }
+    while (1) {
+	for (hPtr = Tcl_FirstHashEntry(&iPtr->scriptTable, &search);
+		hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	    cachePtr = (CachedScript *) Tcl_GetHashValue(hPtr);
+	    if (!all && (cachePtr->numUses > 1)) {
+		continue;
+	    }
+	    if (cachePtr->codePtr != NULL) {
+		TclReleaseCode(cachePtr->codePtr);
+	    }
+	    ckfree((char *) cachePtr);
+	    Tcl_DeleteHashEntry(hPtr);
+	}
+	if (all || (iPtr->scriptTable.numEntries <= MAX_CACHED_SCRIPTS/2)) {
+	    return;
+	}
+	all = 1;
+    }
+}
+
 /*
  *----------------------------------------------------------------------
  *
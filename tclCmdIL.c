@@ -24,6 +24,9 @@
  * Forward declarations for procedures defined in this file:
  */
 
+static void		AppendFrameVars _ANSI_ARGS_((Tcl_Interp *interp,
+			    CallFrame *framePtr, char *pattern,
+			    int skipFlags));
 static int		SortCompareProc _ANSI_ARGS_((CONST VOID *first,
 			    CONST VOID *second));
 
@@ -145,8 +148,9 @@ Tcl_IncrCmd(dummy, interp, argc, argv)
     int argc;				/* Number of arguments. */
     char **argv;			/* Argument strings. */
 {
-    int value;
-    char *oldString, *result;
+    int value, result;
+    char *part2, *open, *close;
+    Var *varPtr;
     char newString[30];
 
     if ((argc != 2) && (argc != 3)) {
@@ -155,14 +159,35 @@ Tcl_IncrCmd(dummy, interp, argc, argv)
 	return TCL_ERROR;
     }
 
-    oldString = Tcl_GetVar(interp, argv[1], TCL_LEAVE_ERR_MSG);
-    if (oldString == NULL) {
-	return TCL_ERROR;
+    /*
+     * Split an array reference into its two parts once, as Tcl_GetVar
+     * and Tcl_SetVar would do, so that the variable itself can be
+     * read and written.  This lets the integer value be kept in the
+     * variable between increments.
+     */
+
+    part2 = NULL;
+    open = strchr(argv[1], '(');
+    if (open != NULL) {
+	close = open + strlen(open) - 1;
+	if (*close == ')') {
+	    *open = '\0';
+	    *close = '\0';
+	    part2 = open+1;
+	}
     }
-    if (Tcl_GetInt(interp, oldString, &value) != TCL_OK) {
+
+    result = TCL_ERROR;
+    varPtr = TclGetVar2Ptr(interp, argv[1], part2, TCL_LEAVE_ERR_MSG);
+    if (varPtr == NULL) {
+	goto done;
+    }
+    if (varPtr->repType == VAR_REP_INT) {
+	value = (int) varPtr->rep.intValue;
+    } else if (Tcl_GetInt(interp, varPtr->value.string, &value) != TCL_OK) {
 	Tcl_AddErrorInfo(interp,
 		"\n    (reading value of variable to increment)");
-	return TCL_ERROR;
+	goto done;
     }
     if (argc == 2) {
 	value += 1;
@@ -172,17 +197,35 @@ Tcl_IncrCmd(dummy, interp, argc, argv)
 	if (Tcl_GetInt(interp, argv[2], &increment) != TCL_OK) {
 	    Tcl_AddErrorInfo(interp,
 		    "\n    (reading increment)");
-	    return TCL_ERROR;
+	    goto done;
 	}
 	value += increment;
     }
     sprintf(newString, "%d", value);
-    result = Tcl_SetVar(interp, argv[1], newString, TCL_LEAVE_ERR_MSG);
-    if (result == NULL) {
-	return TCL_ERROR;
+    varPtr = TclSetVar2Ptr(interp, argv[1], part2, newString,
+	    TCL_LEAVE_ERR_MSG);
+    if (varPtr == NULL) {
+	goto done;
+    }
+
+    /*
+     * Remember the integer unless a write trace changed the value.
+     */
+
+    if (strcmp(varPtr->value.string, newString) == 0) {
+	TclFreeVarRep(varPtr);
+	varPtr->repType = VAR_REP_INT;
+	varPtr->rep.intValue = value;
     }
-    interp->result = result;
-    return TCL_OK; 
+    interp->result = varPtr->value.string;
+    result = TCL_OK;
+
+    done:
+    if (part2 != NULL) {
+	*open = '(';
+	*close = ')';
+    }
+    return result;
 }
 
 /*
@@ -358,11 +401,7 @@ Tcl_InfoCmd(dummy, interp, argc, argv)
 		iPtr->result = "0";
 		return TCL_OK;
 	    }
-	    if (iPtr->varFramePtr == NULL) {
-		hPtr = Tcl_FindHashEntry(&iPtr->globalTable, argv[2]);
-	    } else {
-		hPtr = Tcl_FindHashEntry(&iPtr->varFramePtr->varTable, argv[2]);
-	    }
+	    hPtr = TclLookupVar(iPtr, argv[2], 0, 0, (int *) NULL);
 	    if (hPtr == NULL) {
 		goto noVar;
 	    }
@@ -397,6 +436,26 @@ Tcl_InfoCmd(dummy, interp, argc, argv)
 	    Tcl_AppendElement(interp, name, 0);
 	}
 	return TCL_OK;
+    } else if ((c == 'h') && (strncmp(argv[1], "hashstats", length) == 0)) {
+	Tcl_HashTable *tablePtr;
+
+	if (argc != 3) {
+	    Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
+		    " hashstats table\"", (char *) NULL);
+	    return TCL_ERROR;
+	}
+	if (strcmp(argv[2], "commands") == 0) {
+	    tablePtr = &iPtr->commandTable;
+	} else if (strcmp(argv[2], "globals") == 0) {
+	    tablePtr = &iPtr->globalTable;
+	} else {
+	    Tcl_AppendResult(interp, "bad table \"", argv[2],
+		    "\": should be commands or globals", (char *) NULL);
+	    return TCL_ERROR;
+	}
+	interp->result = Tcl_HashStats(tablePtr);
+	interp->freeProc = (Tcl_FreeProc *) free;
+	return TCL_OK;
     } else if ((c == 'l') && (strncmp(argv[1], "level", length) == 0)
 	    && (length >= 2)) {
 	if (argc == 2) {
@@ -457,8 +516,6 @@ Tcl_InfoCmd(dummy, interp, argc, argv)
 	return TCL_OK;
     } else if ((c == 'l') && (strncmp(argv[1], "locals", length) == 0)
 	    && (length >= 2)) {
-	char *name;
-
 	if (argc > 3) {
 	    Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
 		    " locals [pattern]\"", (char *) NULL);
@@ -467,18 +524,9 @@ Tcl_InfoCmd(dummy, interp, argc, argv)
 	if (iPtr->varFramePtr == NULL) {
 	    return TCL_OK;
 	}
-	for (hPtr = Tcl_FirstHashEntry(&iPtr->varFramePtr->varTable, &search);
-		hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
-	    varPtr = (Var *) Tcl_GetHashValue(hPtr);
-	    if (varPtr->flags & (VAR_UNDEFINED|VAR_UPVAR)) {
-		continue;
-	    }
-	    name = Tcl_GetHashKey(&iPtr->varFramePtr->varTable, hPtr);
-	    if ((argc == 3) && !Tcl_StringMatch(name, argv[2])) {
-		continue;
-	    }
-	    Tcl_AppendElement(interp, name, 0);
-	}
+	AppendFrameVars(interp, iPtr->varFramePtr,
+		(argc == 3) ? argv[2] : (char *) NULL,
+		VAR_UNDEFINED|VAR_UPVAR);
 	return TCL_OK;
     } else if ((c == 'p') && (strncmp(argv[1], "procs", length)) == 0) {
 	if (argc > 3) {
@@ -500,6 +548,27 @@ Tcl_InfoCmd(dummy, interp, argc, argv)
 	    Tcl_AppendElement(interp, name, 0);
 	}
 	return TCL_OK;
+    } else if ((c == 'r') && (strncmp(argv[1], "regexpcache", length) == 0)) {
+	if (argc > 3) {
+	    Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
+		    " regexpcache ?size?\"", (char *) NULL);
+	    return TCL_ERROR;
+	}
+	if (argc == 3) {
+	    int size;
+
+	    if (Tcl_GetInt(interp, argv[2], &size) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    if (TclSetRegexpCacheSize(interp, size) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	}
+	sprintf(iPtr->result,
+		"size %d capacity %d hits %ld misses %ld evictions %ld",
+		iPtr->regexpTable.numEntries, iPtr->maxRegexps,
+		iPtr->regexpHits, iPtr->regexpMisses, iPtr->regexpEvictions);
+	return TCL_OK;
     } else if ((c == 's') && (strncmp(argv[1], "script", length) == 0)) {
 	if (argc != 2) {
 	    Tcl_AppendResult(interp, "wrong # args: should be \"",
@@ -533,11 +602,12 @@ Tcl_InfoCmd(dummy, interp, argc, argv)
 		    argv[0], " vars [pattern]\"", (char *) NULL);
 	    return TCL_ERROR;
 	}
-	if (iPtr->varFramePtr == NULL) {
-	    tablePtr = &iPtr->globalTable;
-	} else {
-	    tablePtr = &iPtr->varFramePtr->varTable;
+	if (iPtr->varFramePtr != NULL) {
+	    AppendFrameVars(interp, iPtr->varFramePtr,
+		    (argc == 3) ? argv[2] : (char *) NULL, VAR_UNDEFINED);
+	    return TCL_OK;
 	}
+	tablePtr = &iPtr->globalTable;
 	for (hPtr = Tcl_FirstHashEntry(tablePtr, &search);
 		hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
 	    varPtr = (Var *) Tcl_GetHashValue(hPtr);
@@ -555,8 +625,8 @@ Tcl_InfoCmd(dummy, interp, argc, argv)
 	Tcl_AppendResult(interp, "bad option \"", argv[1],
 		"\": should be args, body, cmdcount, commands, ",
 		"complete, default, ",
-		"exists, globals, level, library, locals, procs, ",
-		"script, tclversion, or vars",
+		"exists, globals, hashstats, level, library, locals, procs, ",
+		"regexpcache, script, tclversion, or vars",
 		(char *) NULL);
 	return TCL_ERROR;
     }
@@ -642,6 +712,7 @@ Tcl_LindexCmd(dummy, interp, argc, argv)
 {
     char *p, *element;
     int index, size, parenthesized, result;
+    VarList *listPtr;
 
     if (argc != 3) {
 	Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
@@ -654,11 +725,28 @@ Tcl_LindexCmd(dummy, interp, argc, argv)
     if (index < 0) {
 	return TCL_OK;
     }
-    for (p = argv[1] ; index >= 0; index--) {
-	result = TclFindElement(interp, p, &element, &p, &size,
-		&parenthesized);
-	if (result != TCL_OK) {
-	    return result;
+
+    /*
+     * If the list came straight from a variable, the variable may
+     * already know where each element is;  otherwise scan over the
+     * elements up to the one that's wanted.
+     */
+
+    listPtr = TclGetVarList(interp, argv[1]);
+    if (listPtr != NULL) {
+	if (index >= listPtr->numElements) {
+	    return TCL_OK;
+	}
+	element = argv[1] + listPtr->elements[index].offset;
+	size = listPtr->elements[index].size;
+	parenthesized = listPtr->elements[index].brace;
+    } else {
+	for (p = argv[1] ; index >= 0; index--) {
+	    result = TclFindElement(interp, p, &element, &p, &size,
+		    &parenthesized);
+	    if (result != TCL_OK) {
+		return result;
+	    }
 	}
     }
     if (size == 0) {
@@ -824,12 +912,18 @@ Tcl_LlengthCmd(dummy, interp, argc, argv)
 {
     int count, result;
     char *element, *p;
+    VarList *listPtr;
 
     if (argc != 2) {
 	Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
 		" list\"", (char *) NULL);
 	return TCL_ERROR;
     }
+    listPtr = TclGetVarList(interp, argv[1]);
+    if (listPtr != NULL) {
+	sprintf(interp->result, "%d", listPtr->numElements);
+	return TCL_OK;
+    }
     for (count = 0, p = argv[1]; *p != 0 ; count++) {
 	result = TclFindElement(interp, p, &element, &p, (int *) NULL,
 		(int *) NULL);
@@ -1149,6 +1243,74 @@ Tcl_LsortCmd(notUsed, interp, argc, argv)
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * AppendFrameVars --
+ *
+ *	Append to interp->result the names of the variables in a
+ *	procedure's call frame, for "info locals" and "info vars".
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The names of the frame's variables that match pattern (if it
+ *	isn't NULL) and have none of skipFlags set are appended to
+ *	interp->result as list elements:  first those that have slots,
+ *	in slot order, then those in the frame's hash table.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+AppendFrameVars(interp, framePtr, pattern, skipFlags)
+    Tcl_Interp *interp;			/* Interpreter for result. */
+    register CallFrame *framePtr;	/* Frame whose variables are to
+					 * be listed. */
+    char *pattern;			/* Pattern that names must match,
+					 * or NULL. */
+    int skipFlags;			/* Variables with any of these
+					 * flags set are left out. */
+{
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    Var *varPtr;
+    char *name;
+    int i, numSlots;
+
+    numSlots = 0;
+    if (framePtr->localsPtr != NULL) {
+	numSlots = framePtr->localsPtr->numLocals;
+    }
+    for (i = 0; i < numSlots; i++) {
+	varPtr = (Var *) Tcl_GetHashValue(&framePtr->slots[i]);
+	if ((varPtr == NULL) || (varPtr->flags & skipFlags)) {
+	    continue;
+	}
+	name = framePtr->localsPtr->names[i];
+	if ((pattern != NULL) && !Tcl_StringMatch(name, pattern)) {
+	    continue;
+	}
+	Tcl_AppendElement(interp, name, 0);
+    }
+    if (framePtr->varTablePtr == NULL) {
+	return;
+    }
+    for (hPtr = Tcl_FirstHashEntry(framePtr->varTablePtr, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	varPtr = (Var *) Tcl_GetHashValue(hPtr);
+	if (varPtr->flags & skipFlags) {
+	    continue;
+	}
+	name = Tcl_GetHashKey(framePtr->varTablePtr, hPtr);
+	if ((pattern != NULL) && !Tcl_StringMatch(name, pattern)) {
+	    continue;
+	}
+	Tcl_AppendElement(interp, name, 0);
+    }
+}
+
 /*
  * The procedure below is called back by qsort to determine
  * the proper ordering between two elements.
@@ -39,6 +39,12 @@ typedef struct {
  * Forward declarations for procedures defined in this file:
  */
 
+static void		AppendRange _ANSI_ARGS_((ParseValue *pvPtr,
+			    char *first, char *last));
+static int		RegexpAll _ANSI_ARGS_((Tcl_Interp *interp,
+			    regexp *regexpPtr, char *origString,
+			    char *string, int indices, int numVars,
+			    char **varNames));
 static char *		TraceVarProc _ANSI_ARGS_((ClientData clientData,
 			    Tcl_Interp *interp, char *name1, char *name2,
 			    int flags));
@@ -70,15 +76,16 @@ Tcl_RegexpCmd(dummy, interp, argc, argv)
 {
     int noCase = 0;
     int indices = 0;
+    int all = 0;
     regexp *regexpPtr;
     char **argPtr, *string;
-    int match, i;
+    int match, i, code;
 
     if (argc < 3) {
 	wrongNumArgs:
 	Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
-		" ?-nocase? exp string ?matchVar? ?subMatchVar ",
-		"subMatchVar ...?\"", (char *) NULL);
+		" ?-nocase? ?-indices? ?-all? exp string ?matchVar? ",
+		"?subMatchVar subMatchVar ...?\"", (char *) NULL);
 	return TCL_ERROR;
     }
     argPtr = argv+1;
@@ -92,6 +99,10 @@ Tcl_RegexpCmd(dummy, interp, argc, argv)
 	    argPtr++;
 	    argc--;
 	    noCase = 1;
+	} else if (strcmp(argPtr[0], "-all") == 0) {
+	    argPtr++;
+	    argc--;
+	    all = 1;
 	} else {
 	    break;
 	}
@@ -124,8 +135,17 @@ Tcl_RegexpCmd(dummy, interp, argc, argv)
     } else {
 	string = argPtr[1];
     }
+    if (all) {
+	code = RegexpAll(interp, regexpPtr, argPtr[1], string, indices,
+		argc - 2, argPtr + 2);
+	if (string != argPtr[1]) {
+	    ckfree(string);
+	}
+	return code;
+    }
     tclRegexpError = NULL;
-    match = regexec(regexpPtr, string);
+    match = TclExecRegexp(regexpPtr, string, string,
+	    (argc - 2 > NSUBEXP) ? NSUBEXP : argc - 2);
     if (string != argPtr[1]) {
 	ckfree(string);
     }
@@ -183,7 +203,157 @@ Tcl_RegexpCmd(dummy, interp, argc, argv)
     interp->result = "1";
     return TCL_OK;
 }
-
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RegexpAll --
+ *
+ *	This procedure implements "regexp -all":  it finds every
+ *	non-overlapping match of a compiled expression in a single
+ *	left-to-right pass over the string.
+ *
+ * Results:
+ *	A standard Tcl result.  Interp->result holds a list with one
+ *	element for each match, either the matching characters or,
+ *	if indices is non-zero, a "first last" index pair.
+ *
+ * Side effects:
+ *	If there is at least one match, each variable in varNames is
+ *	set to a list holding the corresponding submatch from every
+ *	match, in order.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+RegexpAll(interp, regexpPtr, origString, string, indices, numVars, varNames)
+    Tcl_Interp *interp;			/* Current interpreter. */
+    regexp *regexpPtr;			/* Compiled expression to match. */
+    char *origString;			/* String as passed to the command;
+					 * submatches are copied from here. */
+    char *string;			/* String to match against;  may be a
+					 * lower-cased copy of origString. */
+    int indices;			/* Non-zero means return index pairs
+					 * rather than matching characters. */
+    int numVars;			/* Number of names in varNames. */
+    char **varNames;			/* Variables to receive submatch
+					 * lists. */
+{
+    char *p, *last, *value, savedChar, info[50];
+    int numSubs, match, flags, i;
+
+    if (numVars > NSUBEXP) {
+	interp->result = "too many substring variables";
+	return TCL_ERROR;
+    }
+    numSubs = (numVars > 0) ? numVars : 1;
+
+    /*
+     * Each iteration resumes the search where the previous match
+     * ended.  An empty match can't advance the scan, so skip over
+     * the character that follows it before searching again;  this
+     * may leave the scan at the end of the string, where one more
+     * empty match can be found.  The variables are set by the first
+     * match and appended to by the rest, so they are left alone if
+     * nothing matches.
+     */
+
+    flags = TCL_LIST_ELEMENT;
+    for (p = string; ; ) {
+	tclRegexpError = NULL;
+	match = TclExecRegexp(regexpPtr, string, p, numSubs);
+	if (tclRegexpError != NULL) {
+	    Tcl_ResetResult(interp);
+	    Tcl_AppendResult(interp, "error while matching pattern: ",
+		    tclRegexpError, (char *) NULL);
+	    return TCL_ERROR;
+	}
+	if (!match) {
+	    break;
+	}
+	for (i = 0; i < numSubs; i++) {
+	    last = NULL;
+	    if (regexpPtr->startp[i] == NULL) {
+		value = indices ? "-1 -1" : "";
+	    } else if (indices) {
+		sprintf(info, "%d %d", (int) (regexpPtr->startp[i] - string),
+			(int) (regexpPtr->endp[i] - string - 1));
+		value = info;
+	    } else {
+		value = origString + (regexpPtr->startp[i] - string);
+		last = origString + (regexpPtr->endp[i] - string);
+		savedChar = *last;
+		*last = 0;
+	    }
+	    if (i == 0) {
+		Tcl_AppendElement(interp, value, 0);
+	    }
+	    if (i < numVars) {
+		value = Tcl_SetVar(interp, varNames[i], value, flags);
+	    }
+	    if (last != NULL) {
+		*last = savedChar;
+	    }
+	    if (value == NULL) {
+		goto cantSet;
+	    }
+	}
+	flags = TCL_APPEND_VALUE|TCL_LIST_ELEMENT;
+	p = regexpPtr->endp[0];
+	if (p == regexpPtr->startp[0]) {
+	    if (*p == 0) {
+		break;
+	    }
+	    p++;
+	} else if (*p == 0) {
+	    break;
+	}
+    }
+    return TCL_OK;
+
+    cantSet:
+    Tcl_ResetResult(interp);
+    Tcl_AppendResult(interp, "couldn't set variable \"",
+	    varNames[i], "\"", (char *) NULL);
+    return TCL_ERROR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AppendRange --
+ *
+ *	Copy a range of characters onto the end of a ParseValue,
+ *	expanding its buffer if necessary.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The characters from first up to (but not including) last are
+ *	stored at pvPtr->next, which is advanced past them.  The buffer
+ *	is not null-terminated.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+AppendRange(pvPtr, first, last)
+    register ParseValue *pvPtr;		/* Buffer to append to. */
+    char *first;			/* First character to copy. */
+    char *last;				/* Character just after the last
+					 * one to copy. */
+{
+    int length = last - first;
+
+    if ((pvPtr->end - pvPtr->next) < length) {
+	(*pvPtr->expandProc)(pvPtr, length);
+    }
+    memcpy((VOID *) pvPtr->next, (VOID *) first, length);
+    pvPtr->next += length;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -211,9 +381,12 @@ Tcl_RegsubCmd(dummy, interp, argc, argv)
 {
     int noCase = 0, all = 0;
     regexp *regexpPtr;
-    char *string, *p, *firstChar, *newValue, **argPtr;
-    int match, result, flags;
+    char *string, *p, *firstChar, **argPtr;
+    int match, result, numMatches;
     register char *src, c;
+#define SUBST_SPACE 200
+    char copyStorage[SUBST_SPACE];
+    ParseValue pv;
 
     if (argc < 5) {
 	wrongNumArgs:
@@ -264,17 +437,29 @@ Tcl_RegsubCmd(dummy, interp, argc, argv)
 	string = argPtr[1];
     }
 
+    /*
+     * The new value is assembled in pv and stored into the variable
+     * with a single Tcl_SetVar once all the substitutions are done.
+     */
+
+    pv.buffer = pv.next = copyStorage;
+    pv.end = copyStorage + SUBST_SPACE - 1;
+    pv.expandProc = TclExpandParseValue;
+    pv.clientData = (ClientData) NULL;
+
     /*
      * The following loop is to handle multiple matches within the
      * same source string;  each iteration handles one match and its
      * corresponding substitution.  If "-all" hasn't been specified
-     * then the loop body only gets executed once.
+     * then the loop body only gets executed once.  As in "regexp
+     * -all", an empty match just before the end of the string may be
+     * followed by another at the very end.
      */
 
-    flags = 0;
-    for (p = string; *p != 0; ) {
+    numMatches = 0;
+    for (p = string; ; ) {
 	tclRegexpError = NULL;
-	match = regexec(regexpPtr, p);
+	match = TclExecRegexp(regexpPtr, string, p, NSUBEXP);
 	if (tclRegexpError != NULL) {
 	    Tcl_AppendResult(interp, "error while matching pattern: ",
 		    tclRegexpError, (char *) NULL);
@@ -284,37 +469,26 @@ Tcl_RegsubCmd(dummy, interp, argc, argv)
 	if (!match) {
 	    break;
 	}
+	numMatches++;
 
 	/*
 	 * Copy the portion of the source string before the match to the
-	 * result variable.
+	 * new value.
 	 */
-    
-	src = argPtr[1] + (regexpPtr->startp[0] - string);
-	c = *src;
-	*src = 0;
-	newValue = Tcl_SetVar(interp, argPtr[3], argPtr[1] + (p - string),
-		flags);
-	*src = c;
-	flags = TCL_APPEND_VALUE;
-	if (newValue == NULL) {
-	    cantSet:
-	    Tcl_AppendResult(interp, "couldn't set variable \"",
-		    argPtr[3], "\"", (char *) NULL);
-	    result = TCL_ERROR;
-	    goto done;
-	}
-    
+
+	AppendRange(&pv, argPtr[1] + (p - string),
+		argPtr[1] + (regexpPtr->startp[0] - string));
+
 	/*
-	 * Append the subSpec argument to the variable, making appropriate
-	 * substitutions.  This code is a bit hairy because of the backslash
-	 * conventions and because the code saves up ranges of characters in
-	 * subSpec to reduce the number of calls to Tcl_SetVar.
+	 * Append the subSpec argument, making appropriate substitutions.
+	 * This code is a bit hairy because of the backslash conventions
+	 * and because it saves up ranges of characters in subSpec to
+	 * reduce the number of copies.
 	 */
-    
+
 	for (src = firstChar = argPtr[2], c = *src; c != 0; src++, c = *src) {
 	    int index;
-    
+
 	    if (c == '&') {
 		index = 0;
 	    } else if (c == '\\') {
@@ -322,15 +496,8 @@ Tcl_RegsubCmd(dummy, interp, argc, argv)
 		if ((c >= '0') && (c <= '9')) {
 		    index = c - '0';
 		} else if ((c == '\\') || (c == '&')) {
-		    *src = c;
-		    src[1] = 0;
-		    newValue = Tcl_SetVar(interp, argPtr[3], firstChar,
-			    TCL_APPEND_VALUE);
-		    *src = '\\';
-		    src[1] = c;
-		    if (newValue == NULL) {
-			goto cantSet;
-		    }
+		    AppendRange(&pv, firstChar, src);
+		    AppendRange(&pv, src+1, src+2);
 		    firstChar = src+2;
 		    src++;
 		    continue;
@@ -340,43 +507,37 @@ Tcl_RegsubCmd(dummy, interp, argc, argv)
 	    } else {
 		continue;
 	    }
-	    if (firstChar != src) {
-		c = *src;
-		*src = 0;
-		newValue = Tcl_SetVar(interp, argPtr[3], firstChar,
-			TCL_APPEND_VALUE);
-		*src = c;
-		if (newValue == NULL) {
-		    goto cantSet;
-		}
-	    }
+	    AppendRange(&pv, firstChar, src);
 	    if ((index < NSUBEXP) && (regexpPtr->startp[index] != NULL)
 		    && (regexpPtr->endp[index] != NULL)) {
-		char *first, *last, saved;
-    
-		first = argPtr[1] + (regexpPtr->startp[index] - string);
-		last = argPtr[1] + (regexpPtr->endp[index] - string);
-		saved = *last;
-		*last = 0;
-		newValue = Tcl_SetVar(interp, argPtr[3], first,
-			TCL_APPEND_VALUE);
-		*last = saved;
-		if (newValue == NULL) {
-		    goto cantSet;
-		}
+		AppendRange(&pv,
+			argPtr[1] + (regexpPtr->startp[index] - string),
+			argPtr[1] + (regexpPtr->endp[index] - string));
 	    }
 	    if (*src == '\\') {
 		src++;
 	    }
 	    firstChar = src+1;
 	}
-	if (firstChar != src) {
-	    if (Tcl_SetVar(interp, argPtr[3], firstChar,
-		    TCL_APPEND_VALUE) == NULL) {
-		goto cantSet;
+	AppendRange(&pv, firstChar, src);
+
+	/*
+	 * An empty match doesn't consume anything, so copy the next
+	 * character through unchanged;  otherwise "-all" would find
+	 * the same empty match forever.
+	 */
+
+	p = regexpPtr->endp[0];
+	if (p == regexpPtr->startp[0]) {
+	    if (*p == 0) {
+		break;
 	    }
+	    AppendRange(&pv, argPtr[1] + (p - string),
+		    argPtr[1] + (p + 1 - string));
+	    p++;
+	} else if (*p == 0) {
+	    break;
 	}
-	p = regexpPtr->endp[0];
 	if (!all) {
 	    break;
 	}
@@ -386,32 +547,42 @@ Tcl_RegsubCmd(dummy, interp, argc, argv)
      * If there were no matches at all, then return a "0" result.
      */
 
-    if (p == string) {
+    if (numMatches == 0) {
 	interp->result = "0";
 	result = TCL_OK;
 	goto done;
     }
 
     /*
-     * Copy the portion of the source string after the last match to the
-     * result variable.
+     * Copy the portion of the source string after the last match to
+     * the new value and store it in the result variable.
      */
 
-    if (*p != 0) {
-	if (Tcl_SetVar(interp, argPtr[3], p, TCL_APPEND_VALUE) == NULL) {
-	    goto cantSet;
-	}
+    AppendRange(&pv, argPtr[1] + (p - string),
+	    argPtr[1] + (p - string) + strlen(p));
+    if (pv.next == pv.end + 1) {
+	(*pv.expandProc)(&pv, 1);
+    }
+    *pv.next = 0;
+    if (Tcl_SetVar(interp, argPtr[3], pv.buffer, 0) == NULL) {
+	Tcl_AppendResult(interp, "couldn't set variable \"",
+		argPtr[3], "\"", (char *) NULL);
+	result = TCL_ERROR;
+	goto done;
     }
     interp->result = "1";
     result = TCL_OK;
 
     done:
+    if (pv.buffer != copyStorage) {
+	ckfree(pv.buffer);
+    }
     if (string != argPtr[1]) {
 	ckfree(string);
     }
     return result;
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
@@ -471,6 +642,7 @@ Tcl_RenameCmd(dummy, interp, argc, argv)
     Tcl_DeleteHashEntry(hPtr);
     hPtr = Tcl_CreateHashEntry(&iPtr->commandTable, argv[2], &new);
     Tcl_SetHashValue(hPtr, cmdPtr);
+    iPtr->cmdEpoch++;
     return TCL_OK;
 }
 
@@ -1357,8 +1529,18 @@ TraceVarProc(clientData, interp, name1, name2, flags)
 	    Tcl_ResetResult(interp);		/* Must clear error state. */
 	}
 	Tcl_FreeResult(interp);
-	interp->result = dummy.result;
-	interp->freeProc = dummy.freeProc;
+	if (dummy.freeProc == 0) {
+
+	    /*
+	     * The saved result is in dummy's own result space, which
+	     * goes away when this procedure returns:  copy it back.
+	     */
+
+	    Tcl_SetResult(interp, dummy.result, TCL_VOLATILE);
+	} else {
+	    interp->result = dummy.result;
+	    interp->freeProc = dummy.freeProc;
+	}
     }
     if (flags & TCL_TRACE_DESTROYED) {
 	ckfree((char *) tvarPtr);
@@ -0,0 +1,848 @@
+/*
+ * tclCode.c --
+ *
+ *	This file contains the procedures that compile Tcl scripts
+ *	into sequences of instructions, and the small stack machine
+ *	that executes the instructions to build the words of each
+ *	command.  Compiled code is used for procedure bodies, for
+ *	scripts in the interpreter's script cache, and for literal
+ *	scripts (such as loop bodies) passed to commands from
+ *	compiled code.
+ *
+ * Copyright 1991 Regents of the University of California.
+ * Permission to use, copy, modify, and distribute this
+ * software and its documentation for any purpose and without
+ * fee is hereby granted, provided that the above copyright
+ * notice appear in all copies.  The University of California
+ * makes no representations about the suitability of this
+ * software for any purpose.  It is provided "as is" without
+ * express or implied warranty.
+ *
+ * $Id$
+ */
+
+#include "tclInt.h"
+
+/*
+ * The structure below holds the state of a compilation while the
+ * instructions, literals and scripts are being accumulated.
+ */
+
+typedef struct CompileEnv {
+    int *code;			/* Instructions generated so far. */
+    int codeNext;		/* Index of next free slot in code. */
+    int codeSize;		/* Number of slots in code. */
+    char *pool;			/* Literal text accumulated so far. */
+    int poolNext;		/* Offset of next free byte in pool. */
+    int poolSize;		/* Number of bytes in pool. */
+    CodeLiteral *literals;	/* Literals found so far. */
+    int numLiterals;		/* Number of entries used in literals. */
+    int litSize;		/* Number of entries in literals. */
+    CodeScript *scripts;	/* Scripts found so far. */
+    ParsedScript **parsed;	/* Parsed form of each entry in scripts. */
+    int numScripts;		/* Number of entries used in scripts. */
+    int scriptSize;		/* Number of entries in scripts. */
+} CompileEnv;
+
+/*
+ * Forward references to procedures defined later in this file:
+ */
+
+static int	AddLiteral _ANSI_ARGS_((CompileEnv *envPtr, char *string,
+		    int length));
+static int	AddScript _ANSI_ARGS_((CompileEnv *envPtr,
+		    ParsedScript *scriptPtr));
+static void	AppendValue _ANSI_ARGS_((ParseValue *pvPtr, char *string,
+		    int length, char **argv, int argc));
+static int	BorrowWord _ANSI_ARGS_((Interp *iPtr, char *cmdName,
+		    ByteCode *codePtr, int *pc));
+static int	CompileParts _ANSI_ARGS_((CompileEnv *envPtr,
+		    ParsedWord *wordPtr, int depth));
+static int	CompileWord _ANSI_ARGS_((CompileEnv *envPtr,
+		    ParsedWord *wordPtr));
+static void	Emit _ANSI_ARGS_((CompileEnv *envPtr, int value));
+static VOID *	ExpandArray _ANSI_ARGS_((VOID *array, int *sizePtr,
+		    int needed, unsigned eltSize));
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclCompileScript --
+ *
+ *	Compile a script into instructions that can be executed by
+ *	TclEvalCode.
+ *
+ * Results:
+ *	The return value is a pointer to a malloc-ed ByteCode
+ *	structure with a reference count of 1, or NULL if the script
+ *	can't be compiled (it contains a syntax error, for example).
+ *	In the latter case the caller should just let Tcl_Eval parse
+ *	the script, so that any error is reported in the usual way at
+ *	the usual time.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+ByteCode *
+TclCompileScript(string)
+    char *string;		/* Script to compile.  Must be terminated
+				 * by a null character. */
+{
+    CompileEnv env;
+    register ByteCode *codePtr;
+    ParsedScript *scriptPtr;
+    ParsedCmd *cmdPtr;
+    int i, j, result;
+
+    scriptPtr = TclParseScript(string);
+    if (scriptPtr == NULL) {
+	return NULL;
+    }
+    env.code = NULL;
+    env.codeNext = env.codeSize = 0;
+    env.pool = NULL;
+    env.poolNext = env.poolSize = 0;
+    env.literals = NULL;
+    env.numLiterals = env.litSize = 0;
+    env.scripts = NULL;
+    env.parsed = NULL;
+    env.numScripts = env.scriptSize = 0;
+
+    /*
+     * Each nested script gets added to the end of the scripts array
+     * when it is found, and compiled after the scripts before it, so
+     * that the instructions for each script are contiguous.
+     */
+
+    result = TCL_OK;
+    AddScript(&env, scriptPtr);
+    for (i = 0; i < env.numScripts; i++) {
+	scriptPtr = env.parsed[i];
+	env.scripts[i].pc = env.codeNext;
+	for (j = 0, cmdPtr = scriptPtr->cmds; j < scriptPtr->numCmds;
+		j++, cmdPtr++) {
+	    int k;
+
+	    Emit(&env, INST_COMMAND);
+	    Emit(&env, cmdPtr->numWords);
+	    Emit(&env, cmdPtr->start);
+	    Emit(&env, cmdPtr->end);
+	    for (k = 0; k < cmdPtr->numWords; k++) {
+		if (CompileWord(&env, &cmdPtr->words[k]) != TCL_OK) {
+		    result = TCL_ERROR;
+		}
+	    }
+	}
+	Emit(&env, INST_DONE);
+    }
+
+    /*
+     * Nested scripts were detached from their parents as they were
+     * queued, so each one has to be freed separately.
+     */
+
+    for (i = 0; i < env.numScripts; i++) {
+	TclFreeScript(env.parsed[i]);
+    }
+    ckfree((char *) env.parsed);
+
+    codePtr = (ByteCode *) ckalloc(sizeof(ByteCode));
+    codePtr->refCount = 1;
+    codePtr->source = NULL;
+    codePtr->code = env.code;
+    codePtr->pool = env.pool;
+    codePtr->poolSize = env.poolNext;
+    codePtr->numLiterals = env.numLiterals;
+    codePtr->literals = env.literals;
+    codePtr->numScripts = env.numScripts;
+    codePtr->scripts = env.scripts;
+    codePtr->localsPtr = NULL;
+    if (result != TCL_OK) {
+	TclReleaseCode(codePtr);
+	return NULL;
+    }
+    return codePtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CompileWord, CompileParts --
+ *
+ *	Generate the instructions that build one word of a command.
+ *	CompileParts generates just the instructions for the parts of
+ *	a word, and is also used for the element names of array
+ *	references.
+ *
+ * Results:
+ *	The return value is TCL_OK, or TCL_ERROR if array references
+ *	are nested too deeply to be executed.
+ *
+ * Side effects:
+ *	Instructions and literals are added to *envPtr, and nested
+ *	scripts are queued to be compiled.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+CompileWord(envPtr, wordPtr)
+    register CompileEnv *envPtr;	/* Compilation to add to. */
+    ParsedWord *wordPtr;		/* Word to compile. */
+{
+    if (WORD_IS_LITERAL(wordPtr)) {
+	Emit(envPtr, INST_PUSH_LIT);
+	Emit(envPtr, AddLiteral(envPtr, wordPtr->parts[0].string,
+		wordPtr->parts[0].length));
+	return TCL_OK;
+    }
+    Emit(envPtr, INST_BEGIN_WORD);
+    if (CompileParts(envPtr, wordPtr, 1) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    Emit(envPtr, INST_END_WORD);
+    return TCL_OK;
+}
+
+static int
+CompileParts(envPtr, wordPtr, depth)
+    register CompileEnv *envPtr;	/* Compilation to add to. */
+    ParsedWord *wordPtr;		/* Word whose parts are to be
+					 * compiled. */
+    int depth;				/* Number of words and element
+					 * names under construction. */
+{
+    register ParsedPart *partPtr;
+    int i, lit;
+
+    for (i = 0, partPtr = wordPtr->parts; i < wordPtr->numParts;
+	    i++, partPtr++) {
+	switch (partPtr->type) {
+	    case PART_TEXT:
+		Emit(envPtr, INST_APPEND_LIT);
+		Emit(envPtr, AddLiteral(envPtr, partPtr->string,
+			partPtr->length));
+		break;
+	    case PART_VAR:
+		Emit(envPtr, INST_APPEND_VAR);
+		Emit(envPtr, AddLiteral(envPtr, partPtr->string,
+			partPtr->length));
+		Emit(envPtr, partPtr->end);
+		break;
+	    case PART_ARRAY:
+		if (depth >= MAX_CODE_MARKS) {
+		    return TCL_ERROR;
+		}
+		lit = AddLiteral(envPtr, partPtr->string, partPtr->length);
+		Emit(envPtr, INST_BEGIN_INDEX);
+		Emit(envPtr, lit);
+		if (CompileParts(envPtr, partPtr->indexPtr, depth+1)
+			!= TCL_OK) {
+		    return TCL_ERROR;
+		}
+		Emit(envPtr, INST_APPEND_ELEM);
+		Emit(envPtr, lit);
+		Emit(envPtr, partPtr->end);
+		break;
+	    case PART_COMMAND:
+		Emit(envPtr, INST_APPEND_CMD);
+		Emit(envPtr, AddScript(envPtr, partPtr->scriptPtr));
+		partPtr->scriptPtr = NULL;
+		break;
+	}
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Emit, AddLiteral, AddScript --
+ *
+ *	These procedures add an instruction word, a literal, or a
+ *	nested script to a compilation.
+ *
+ * Results:
+ *	AddLiteral and AddScript return the index of the new literal
+ *	or script.
+ *
+ * Side effects:
+ *	Storage in *envPtr is enlarged as needed.  AddScript takes
+ *	over ownership of scriptPtr.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+Emit(envPtr, value)
+    register CompileEnv *envPtr;	/* Compilation to add to. */
+    int value;				/* Instruction or operand. */
+{
+    if (envPtr->codeNext >= envPtr->codeSize) {
+	envPtr->code = (int *) ExpandArray((VOID *) envPtr->code,
+		&envPtr->codeSize, envPtr->codeNext+1, sizeof(int));
+    }
+    envPtr->code[envPtr->codeNext] = value;
+    envPtr->codeNext++;
+}
+
+static int
+AddLiteral(envPtr, string, length)
+    register CompileEnv *envPtr;	/* Compilation to add to. */
+    char *string;			/* Text of literal. */
+    int length;				/* Number of characters in
+					 * string. */
+{
+    register CodeLiteral *litPtr;
+
+    if (envPtr->poolNext + length + 1 > envPtr->poolSize) {
+	envPtr->pool = (char *) ExpandArray((VOID *) envPtr->pool,
+		&envPtr->poolSize, envPtr->poolNext + length + 1, 1);
+    }
+    if (envPtr->numLiterals >= envPtr->litSize) {
+	envPtr->literals = (CodeLiteral *) ExpandArray(
+		(VOID *) envPtr->literals, &envPtr->litSize,
+		envPtr->numLiterals+1, sizeof(CodeLiteral));
+    }
+    litPtr = &envPtr->literals[envPtr->numLiterals];
+    litPtr->offset = envPtr->poolNext;
+    litPtr->length = length;
+    litPtr->bodyPtr = NULL;
+    litPtr->flags = 0;
+    litPtr->cmdPtr = NULL;
+    litPtr->cmdEpoch = 0;
+    memcpy((VOID *) (envPtr->pool + envPtr->poolNext), (VOID *) string,
+	    length);
+    envPtr->pool[envPtr->poolNext + length] = 0;
+    envPtr->poolNext += length + 1;
+    envPtr->numLiterals++;
+    return envPtr->numLiterals - 1;
+}
+
+static int
+AddScript(envPtr, scriptPtr)
+    register CompileEnv *envPtr;	/* Compilation to add to. */
+    ParsedScript *scriptPtr;		/* Script to compile later. */
+{
+    int size;
+
+    if (envPtr->numScripts >= envPtr->scriptSize) {
+	size = envPtr->scriptSize;
+	envPtr->scripts = (CodeScript *) ExpandArray(
+		(VOID *) envPtr->scripts, &envPtr->scriptSize,
+		envPtr->numScripts+1, sizeof(CodeScript));
+	envPtr->parsed = (ParsedScript **) ExpandArray(
+		(VOID *) envPtr->parsed, &size,
+		envPtr->numScripts+1, sizeof(ParsedScript *));
+    }
+    envPtr->scripts[envPtr->numScripts].pc = 0;
+    envPtr->scripts[envPtr->numScripts].start = scriptPtr->start;
+    envPtr->scripts[envPtr->numScripts].end = scriptPtr->end;
+    envPtr->parsed[envPtr->numScripts] = scriptPtr;
+    envPtr->numScripts++;
+    return envPtr->numScripts - 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ExpandArray --
+ *
+ *	Make a dynamically-allocated array larger, doubling its size
+ *	until it can hold a given number of elements.
+ *
+ * Results:
+ *	The return value is the address of the new array.  *SizePtr
+ *	is updated to hold its size, in elements.
+ *
+ * Side effects:
+ *	The old array (if any) is copied and freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static VOID *
+ExpandArray(array, sizePtr, needed, eltSize)
+    VOID *array;		/* Current array, or NULL. */
+    int *sizePtr;		/* Current size of array, in elements. */
+    int needed;			/* Number of elements required. */
+    unsigned eltSize;		/* Size of each element. */
+{
+    VOID *new;
+    int size;
+
+    size = (*sizePtr == 0) ? 8 : 2 * *sizePtr;
+    while (size < needed) {
+	size *= 2;
+    }
+    new = (VOID *) ckalloc((unsigned) size * eltSize);
+    if (array != NULL) {
+	memcpy(new, array, *sizePtr * eltSize);
+	ckfree((char *) array);
+    }
+    *sizePtr = size;
+    return new;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclReleaseCode --
+ *
+ *	Drop a reference to a compiled script.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The code, along with the compiled forms of its literals, is
+ *	freed if this was the last reference to it.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclReleaseCode(codePtr)
+    register ByteCode *codePtr;	/* Code to release. */
+{
+    int i;
+
+    codePtr->refCount--;
+    if (codePtr->refCount > 0) {
+	return;
+    }
+    for (i = 0; i < codePtr->numLiterals; i++) {
+	if (codePtr->literals[i].bodyPtr != NULL) {
+	    TclReleaseCode(codePtr->literals[i].bodyPtr);
+	}
+    }
+    if (codePtr->source != NULL) {
+	ckfree(codePtr->source);
+    }
+    if (codePtr->code != NULL) {
+	ckfree((char *) codePtr->code);
+    }
+    if (codePtr->pool != NULL) {
+	ckfree(codePtr->pool);
+    }
+    if (codePtr->literals != NULL) {
+	ckfree((char *) codePtr->literals);
+    }
+    if (codePtr->localsPtr != NULL) {
+	ckfree((char *) codePtr->localsPtr);
+    }
+    ckfree((char *) codePtr->scripts);
+    ckfree((char *) codePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclLiteralCode --
+ *
+ *	Given a string that is about to be evaluated as a script,
+ *	see if it is one of the literal words of the command being
+ *	invoked from compiled code.  This is the case for bodies
+ *	passed to commands like "while" and "if".
+ *
+ * Results:
+ *	If string is a word of the current command that was copied
+ *	from a literal, the return value is the compiled form of that
+ *	literal.  NULL is returned if string isn't such a word, or if
+ *	it can't be compiled.
+ *
+ * Side effects:
+ *	The literal is compiled the first time it is evaluated.
+ *
+ *----------------------------------------------------------------------
+ */
+
+ByteCode *
+TclLiteralCode(iPtr, string)
+    register Interp *iPtr;	/* Interpreter in which string is
+				 * about to be evaluated. */
+    char *string;		/* Script about to be evaluated. */
+{
+    register CodeLiteral *litPtr;
+    int i;
+
+    for (i = 0; i < iPtr->execArgc; i++) {
+	if (iPtr->execArgv[i] != string) {
+	    continue;
+	}
+	litPtr = iPtr->execLits[i];
+	if (litPtr == NULL) {
+	    return NULL;
+	}
+	if ((litPtr->bodyPtr == NULL)
+		&& !(litPtr->flags & LITERAL_NOT_SCRIPT)) {
+	    litPtr->bodyPtr = TclCompileScript(string);
+	    if (litPtr->bodyPtr == NULL) {
+		litPtr->flags |= LITERAL_NOT_SCRIPT;
+	    }
+	}
+	return litPtr->bodyPtr;
+    }
+    return NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclExecWords --
+ *
+ *	Execute instructions to build the words of a command from a
+ *	compiled script.
+ *
+ * Results:
+ *	The return value is a standard Tcl result.  Argv is filled in
+ *	with pointers to the words of the command, and *pcPtr is
+ *	advanced to the instruction that starts the next command (or
+ *	ends the script).  The words are stored in the buffer at pvPtr,
+ *	even literal ones:  commands may modify their arguments in
+ *	place, and codePtr's pool is shared by every evaluation of the
+ *	script.  Lits is filled in with the literal each word was
+ *	copied from, or NULL if it wasn't a literal.  If an error
+ *	occurs then interp->result contains an error message and
+ *	*termPtr is filled in with the address (in the original
+ *	script text) of the place where the error was detected.
+ *
+ * Side effects:
+ *	Nested commands are executed, and the buffer space in pvPtr
+ *	may be enlarged.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclExecWords(interp, codePtr, base, pcPtr, argv, lits, pvPtr, termPtr)
+    Tcl_Interp *interp;		/* Interpreter to use for substitutions. */
+    register ByteCode *codePtr;	/* Code being executed. */
+    char *base;			/* Text from which codePtr was compiled. */
+    int **pcPtr;		/* Address of first instruction for the
+				 * command's words;  updated on return. */
+    char **argv;		/* Store addresses of words here. */
+    CodeLiteral **lits;		/* Store literal for each word here. */
+    register ParseValue *pvPtr;	/* Place to store substituted words. */
+    char **termPtr;		/* Store address of error location here. */
+{
+    register Interp *iPtr = (Interp *) interp;
+    register int *pc = *pcPtr;
+    register CodeLiteral *litPtr;
+    int argc, numMarks, i, result;
+    int markOffsets[MAX_CODE_MARKS];
+				/* Offsets in pvPtr at which the words and
+				 * element names under construction start. */
+    int markNames[MAX_CODE_MARKS];
+				/* For each element name under construction,
+				 * the literal holding the array's name;
+				 * -1 for words. */
+    char *value, *index, *name;
+    CallFrame *framePtr;
+    Var *varPtr;
+    Var *argVarPtr = NULL;	/* Variable from which argv[1] was
+				 * substituted in full, if any. */
+    int argVarEpoch = 0;
+    char *borrowed = NULL;	/* If non-NULL, argv[1] is this variable
+				 * value, used in place rather than
+				 * copied. */
+
+    argc = 0;
+    numMarks = 0;
+    while (1) {
+	switch (*pc) {
+	    case INST_PUSH_LIT:
+		litPtr = &codePtr->literals[pc[1]];
+		AppendValue(pvPtr, codePtr->pool + litPtr->offset,
+			litPtr->length, argv, argc);
+		argv[argc] = pvPtr->next - litPtr->length;
+		lits[argc] = litPtr;
+		argc++;
+		pvPtr->next++;
+		pc += 2;
+		break;
+	    case INST_BEGIN_WORD:
+	    case INST_BEGIN_INDEX:
+		AppendValue(pvPtr, "", 0, argv, argc);
+		markOffsets[numMarks] = pvPtr->next - pvPtr->buffer;
+		if (*pc == INST_BEGIN_WORD) {
+		    markNames[numMarks] = -1;
+		    pc += 1;
+		} else {
+		    markNames[numMarks] = pc[1];
+		    pc += 2;
+		}
+		numMarks++;
+		break;
+	    case INST_END_WORD:
+		numMarks--;
+		argv[argc] = pvPtr->buffer + markOffsets[numMarks];
+		if ((argc == 1) && (borrowed != NULL)) {
+		    argv[argc] = borrowed;
+		}
+		lits[argc] = NULL;
+		argc++;
+		pvPtr->next++;
+		pc += 1;
+		break;
+	    case INST_APPEND_LIT:
+		litPtr = &codePtr->literals[pc[1]];
+		AppendValue(pvPtr, codePtr->pool + litPtr->offset,
+			litPtr->length, argv, argc);
+		pc += 2;
+		break;
+	    case INST_APPEND_VAR:
+		if (!iPtr->noEval) {
+		    name = codePtr->pool + codePtr->literals[pc[1]].offset;
+		    value = NULL;
+
+		    /*
+		     * Plain values of compiled locals are read straight
+		     * from their slots;  everything else (traces, links
+		     * from "global" or "upvar", errors) is left to
+		     * TclGetVar2Ptr.
+		     */
+
+		    framePtr = iPtr->varFramePtr;
+		    if ((framePtr != NULL) && (framePtr->localsPtr != NULL)) {
+			i = TclFindSlot(framePtr, name);
+			if (i >= 0) {
+			    varPtr = (Var *) Tcl_GetHashValue(
+				    &framePtr->slots[i]);
+			    if ((varPtr != NULL) && (varPtr->tracePtr == NULL)
+				    && !(varPtr->flags & (VAR_UNDEFINED
+				    |VAR_UPVAR|VAR_ARRAY))) {
+				value = varPtr->value.string;
+			    }
+			}
+		    }
+		    if (value == NULL) {
+			varPtr = TclGetVar2Ptr(interp, name, (char *) NULL,
+				TCL_LEAVE_ERR_MSG);
+			if (varPtr == NULL) {
+			    *termPtr = base + pc[2];
+			    goto error;
+			}
+			value = varPtr->value.string;
+		    }
+
+		    /*
+		     * If this variable makes up the whole of argv[1],
+		     * remember it so that list commands can use the
+		     * variable's element index (see TclGetVarList).  For
+		     * the commands that only read the list, the value
+		     * needn't even be copied.
+		     */
+
+		    if ((argc == 1) && (numMarks == 1) && (markNames[0] < 0)
+			    && (pc[3] == INST_END_WORD) && (pvPtr->next
+			    == pvPtr->buffer + markOffsets[0])) {
+			argVarPtr = varPtr;
+			argVarEpoch = iPtr->varEpoch;
+			if ((*argv[0] == 'l')
+				&& BorrowWord(iPtr, argv[0], codePtr, pc+4)) {
+			    borrowed = value;
+			    pc += 3;
+			    break;
+			}
+		    }
+		    AppendValue(pvPtr, value, strlen(value), argv, argc);
+		}
+		pc += 3;
+		break;
+	    case INST_APPEND_ELEM:
+		numMarks--;
+		index = pvPtr->buffer + markOffsets[numMarks];
+		if (iPtr->noEval) {
+		    value = "";
+		} else {
+		    value = Tcl_GetVar2(interp,
+			    codePtr->pool + codePtr->literals[pc[1]].offset,
+			    index, TCL_LEAVE_ERR_MSG);
+		}
+		pvPtr->next = index;
+		*index = 0;
+		if (value == NULL) {
+		    *termPtr = base + pc[2];
+		    goto error;
+		}
+		AppendValue(pvPtr, value, strlen(value), argv, argc);
+		pc += 3;
+		break;
+	    case INST_APPEND_CMD:
+		result = TclEvalCode(interp, base, codePtr, pc[1],
+			TCL_BRACKET_TERM, termPtr);
+		if (result != TCL_OK) {
+		    if (**termPtr == ']') {
+			*termPtr += 1;
+		    }
+		    goto unwind;
+		}
+		AppendValue(pvPtr, iPtr->result, strlen(iPtr->result),
+			argv, argc);
+		Tcl_FreeResult(iPtr);
+		iPtr->result = iPtr->resultSpace;
+		iPtr->resultSpace[0] = '\0';
+		pc += 2;
+		break;
+	    default:
+		iPtr->argVarPtr = argVarPtr;
+		if (argVarPtr != NULL) {
+		    iPtr->argVarWord = argv[1];
+		    iPtr->argVarEpoch = argVarEpoch;
+		}
+		*pcPtr = pc;
+		return TCL_OK;
+	}
+    }
+
+    /*
+     * An error occurred.  Record the array names whose element names
+     * were being built, innermost first.
+     */
+
+    error:
+    result = TCL_ERROR;
+    unwind:
+    for (i = numMarks-1; i >= 0; i--) {
+	char msg[100];
+
+	if (markNames[i] < 0) {
+	    continue;
+	}
+	litPtr = &codePtr->literals[markNames[i]];
+	sprintf(msg, "\n    (parsing index for array \"%.*s\")",
+		litPtr->length, codePtr->pool + litPtr->offset);
+	Tcl_AddErrorInfo(interp, msg);
+    }
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * BorrowWord --
+ *
+ *	Decide whether the value of a variable that makes up the whole
+ *	of argv[1] can be passed to the command without copying it.
+ *	This is only done for "lindex" and "llength", which never
+ *	modify variables, and only if no other code can run before the
+ *	command is invoked:  the rest of the command's words must not
+ *	contain command substitutions or references to variables with
+ *	traces.
+ *
+ * Results:
+ *	Returns 1 if the value can be used in place, 0 otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+BorrowWord(iPtr, cmdName, codePtr, pc)
+    Interp *iPtr;		/* Interpreter executing code. */
+    char *cmdName;		/* Argv[0] of the command. */
+    ByteCode *codePtr;		/* Code being executed. */
+    register int *pc;		/* First instruction after argv[1]. */
+{
+    Tcl_HashEntry *hPtr;
+    Command *cmdPtr;
+    Var *varPtr;
+
+    if ((iPtr->tracePtr != NULL) || ((strcmp(cmdName, "lindex") != 0)
+	    && (strcmp(cmdName, "llength") != 0))) {
+	return 0;
+    }
+    hPtr = Tcl_FindHashEntry(&iPtr->commandTable, cmdName);
+    if (hPtr == NULL) {
+	return 0;
+    }
+    cmdPtr = (Command *) Tcl_GetHashValue(hPtr);
+    if ((cmdPtr->proc != Tcl_LindexCmd) && (cmdPtr->proc != Tcl_LlengthCmd)) {
+	return 0;
+    }
+    while (1) {
+	switch (*pc) {
+	    case INST_PUSH_LIT:
+	    case INST_APPEND_LIT:
+		pc += 2;
+		break;
+	    case INST_BEGIN_WORD:
+	    case INST_END_WORD:
+		pc += 1;
+		break;
+	    case INST_APPEND_VAR:
+		hPtr = TclLookupVar(iPtr,
+			codePtr->pool + codePtr->literals[pc[1]].offset,
+			0, 0, (int *) NULL);
+		if (hPtr != NULL) {
+		    varPtr = (Var *) Tcl_GetHashValue(hPtr);
+		    if (varPtr->flags & VAR_UPVAR) {
+			varPtr = (Var *) Tcl_GetHashValue(
+				varPtr->value.upvarPtr);
+		    }
+		    if (varPtr->tracePtr != NULL) {
+			return 0;
+		    }
+		}
+		pc += 3;
+		break;
+	    case INST_COMMAND:
+	    case INST_DONE:
+		return 1;
+	    default:
+		return 0;
+	}
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AppendValue --
+ *
+ *	Add characters to the end of the word being built in a
+ *	ParseValue, keeping it null-terminated.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The buffer space in pvPtr may be enlarged, in which case the
+ *	words already stored in it are relocated.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+AppendValue(pvPtr, string, length, argv, argc)
+    register ParseValue *pvPtr;	/* Where to add characters. */
+    char *string;		/* Characters to add. */
+    int length;			/* Number of characters to add. */
+    char **argv;		/* Words completed so far.  Those that
+				 * aren't in pvPtr's buffer (borrowed
+				 * values) are left alone. */
+    int argc;			/* Number of entries in argv. */
+{
+    char *oldBuffer, *oldEnd;
+    int i;
+
+    if ((pvPtr->end - pvPtr->next) <= length) {
+	oldBuffer = pvPtr->buffer;
+	oldEnd = pvPtr->end;
+	(*pvPtr->expandProc)(pvPtr, length);
+	for (i = 0; i < argc; i++) {
+	    if ((argv[i] >= oldBuffer) && (argv[i] <= oldEnd)) {
+		argv[i] = pvPtr->buffer + (argv[i] - oldBuffer);
+	    }
+	}
+    }
+    memcpy((VOID *) pvPtr->next, (VOID *) string, length);
+    pvPtr->next += length;
+    *pvPtr->next = 0;
+}
@@ -136,7 +136,7 @@ main()
     setup();
 
     interp = Tcl_CreateInterp();
-#ifdef TCL_MEM_DEBUG
+#if defined(TCL_MEM_DEBUG) || defined(TCL_MEM_POOL)
     Tcl_InitMemory(interp);
 #endif
     Tcl_CreateCommand(interp, "echo", cmdEcho, (ClientData) "echo",
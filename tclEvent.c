@@ -0,0 +1,774 @@
+/*
+ * tclEvent.c --
+ *
+ *	This file contains the event loop:  the procedures that wait
+ *	for events and invoke the scripts registered to handle them,
+ *	plus the "update" and "vwait" commands that drive the loop
+ *	from Tcl scripts and the "after" command that schedules
+ *	scripts for later.  Events come from the files an interpreter
+ *	has open, whose waiting is done by TclWaitForFiles in the UNIX
+ *	and DOS utility files, and from "after" handlers, which are
+ *	kept here.
+ *
+ * Copyright 1991 Regents of the University of California.
+ * Permission to use, copy, modify, and distribute this
+ * software and its documentation for any purpose and without
+ * fee is hereby granted, provided that the above copyright
+ * notice appear in all copies.  The University of California
+ * makes no representations about the suitability of this
+ * software for any purpose.  It is provided "as is" without
+ * express or implied warranty.
+ *
+ * $Id$
+ */
+
+#include "tclInt.h"
+
+/*
+ * The structure below describes a handler created by the "after"
+ * command:  either a timer handler, kept in the interpreter's timer
+ * heap, or an idle handler, kept in its idle list.
+ */
+
+typedef struct AfterHandler {
+    TclTime time;		/* When a timer handler is due.  Not used
+				 * for idle handlers. */
+    long id;			/* Number in the handler's identifier,
+				 * "after#id".  Also breaks ties between
+				 * timers due at the same time, so that
+				 * they run in the order created. */
+    char *script;		/* Malloc-ed script to evaluate. */
+    struct AfterHandler *nextPtr;
+				/* Next idle handler, or NULL. */
+} AfterHandler;
+
+/*
+ * The macro below is non-zero if timer handler a is due before timer
+ * handler b.
+ */
+
+#define DUE_BEFORE(a, b) (((a)->time.sec < (b)->time.sec) \
+	|| (((a)->time.sec == (b)->time.sec) \
+	&& (((a)->time.usec < (b)->time.usec) \
+	|| (((a)->time.usec == (b)->time.usec) && ((a)->id < (b)->id)))))
+
+/*
+ * Longest time, in milliseconds, that TclDoOneEvent waits at once.
+ * If the next timer still isn't due it just waits again, so this only
+ * keeps the count within the range of an int on small machines.
+ */
+
+#define MAX_WAIT 30000
+
+/*
+ * Prototypes for local procedures defined in this file:
+ */
+
+#ifndef TCL_GENERIC_ONLY
+static void		AddTimer _ANSI_ARGS_((Interp *iPtr,
+			    AfterHandler *afterPtr));
+static AfterHandler *	RemoveTimer _ANSI_ARGS_((Interp *iPtr, int index));
+static int		RunTimers _ANSI_ARGS_((Interp *iPtr));
+#endif
+static int		RunIdle _ANSI_ARGS_((Interp *iPtr));
+static char *		VwaitVarProc _ANSI_ARGS_((ClientData clientData,
+			    Tcl_Interp *interp, char *name1, char *name2,
+			    int flags));
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclDoOneEvent --
+ *
+ *	Wait for events, if asked to, and invoke the handlers for all
+ *	of the events that are ready:  first timers that are due, then
+ *	files that are ready.  Idle handlers are invoked only if there
+ *	was nothing else to do.  When waiting, the wait lasts until a
+ *	file becomes ready or the next timer is due, whichever comes
+ *	first.
+ *
+ * Results:
+ *	The return value is the number of handlers invoked, which may
+ *	be zero if wait is zero or the wait was interrupted.  -1 means
+ *	that no handlers are registered at all, so waiting would never
+ *	end.
+ *
+ * Side effects:
+ *	Depends on the handlers.  Errors in handlers are reported with
+ *	TclBackgroundError.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclDoOneEvent(interp, wait)
+    Tcl_Interp *interp;		/* Interpreter whose events to handle. */
+    int wait;			/* Non-zero means wait until an event is
+				 * ready;  zero means only handle events
+				 * that are ready already. */
+{
+#ifndef TCL_GENERIC_ONLY
+    Interp *iPtr = (Interp *) interp;
+    TclTime now;
+    long ms;
+    int count, numFiles, timeout;
+
+    count = RunTimers(iPtr);
+
+    /*
+     * Work out how long to wait:  not at all if something has been
+     * done already or idle handlers are waiting to run, otherwise
+     * until the next timer is due or forever if there are no timers.
+     */
+
+    timeout = -1;
+    if (!wait || (count > 0) || (iPtr->idleFirst != NULL)) {
+	timeout = 0;
+    } else if (iPtr->numTimers > 0) {
+	TclGetTime(&now);
+	ms = (iPtr->timerHeap[0]->time.sec - now.sec) * 1000
+		+ (iPtr->timerHeap[0]->time.usec - now.usec + 999) / 1000;
+	if (ms < 0) {
+	    ms = 0;
+	} else if (ms > MAX_WAIT) {
+	    ms = MAX_WAIT;
+	}
+	timeout = (int) ms;
+    }
+
+    numFiles = TclWaitForFiles(iPtr, timeout);
+    if (numFiles < 0) {
+	if (timeout < 0) {
+	    return -1;
+	}
+	if (timeout > 0) {
+	    TclSleep(timeout);
+	}
+    } else {
+	count += numFiles;
+    }
+    count += RunTimers(iPtr);
+    if ((count == 0) && (iPtr->idleFirst != NULL)) {
+	count = RunIdle(iPtr);
+    }
+    return count;
+#else
+    return -1;
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclEvalEvent --
+ *
+ *	Evaluate the script of an event handler at global level.
+ *
+ * Results:
+ *	A standard Tcl result.  The interpreter's result is reset,
+ *	since there is no-one to receive it.
+ *
+ * Side effects:
+ *	Depends on the script, which may even delete the handler that
+ *	it belongs to.  An error is reported with TclBackgroundError.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclEvalEvent(interp, script)
+    Tcl_Interp *interp;		/* Interpreter in which to evaluate. */
+    char *script;		/* Script of the handler.  A copy is
+				 * evaluated, so the handler may be
+				 * deleted while it runs. */
+{
+    char *copy;
+    int result;
+
+    copy = (char *) ckalloc((unsigned) (strlen(script) + 1));
+    strcpy(copy, script);
+    result = Tcl_GlobalEval(interp, copy);
+    ckfree(copy);
+    if (result == TCL_ERROR) {
+	TclBackgroundError(interp);
+    }
+    Tcl_ResetResult(interp);
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclBackgroundError --
+ *
+ *	Report an error that happened with no command to return it
+ *	to, such as in an event handler.  If a "bgerror" command
+ *	exists it is invoked with the error message as its argument;
+ *	otherwise the message and stack trace go to stderr.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The interpreter's result is reset.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclBackgroundError(interp)
+    Tcl_Interp *interp;		/* Interpreter in which the error happened;
+				 * interp->result holds the message. */
+{
+    Interp *iPtr = (Interp *) interp;
+    char *argv[2], *command, *errorInfo, *savedInfo;
+
+    errorInfo = Tcl_GetVar(interp, "errorInfo", TCL_GLOBAL_ONLY);
+    if (errorInfo == NULL) {
+	errorInfo = interp->result;
+    }
+    if (Tcl_FindHashEntry(&iPtr->commandTable, "bgerror") == NULL) {
+	fprintf(stderr, "%s\n", errorInfo);
+	Tcl_ResetResult(interp);
+	return;
+    }
+
+    savedInfo = (char *) ckalloc((unsigned) (strlen(errorInfo) + 1));
+    strcpy(savedInfo, errorInfo);
+    argv[0] = "bgerror";
+    argv[1] = interp->result;
+    command = Tcl_Merge(2, argv);
+    if (Tcl_GlobalEval(interp, command) == TCL_ERROR) {
+	fprintf(stderr, "bgerror failed to handle background error.\n");
+	fprintf(stderr, "    Original error: %s\n", savedInfo);
+	fprintf(stderr, "    Error in bgerror: %s\n", interp->result);
+    }
+    ckfree(command);
+    ckfree(savedInfo);
+    Tcl_ResetResult(interp);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclDeleteEvents --
+ *
+ *	Called when an interpreter is deleted, to free all of its
+ *	"after" handlers without invoking them.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclDeleteEvents(iPtr)
+    Interp *iPtr;		/* Interpreter being deleted. */
+{
+    AfterHandler *afterPtr;
+    int i;
+
+    for (i = 0; i < iPtr->numTimers; i++) {
+	afterPtr = iPtr->timerHeap[i];
+	ckfree(afterPtr->script);
+	ckfree((char *) afterPtr);
+    }
+    if (iPtr->timerHeap != NULL) {
+	ckfree((char *) iPtr->timerHeap);
+	iPtr->timerHeap = NULL;
+    }
+    iPtr->numTimers = iPtr->timerSpace = 0;
+    while (iPtr->idleFirst != NULL) {
+	afterPtr = iPtr->idleFirst;
+	iPtr->idleFirst = afterPtr->nextPtr;
+	ckfree(afterPtr->script);
+	ckfree((char *) afterPtr);
+    }
+    iPtr->idleLast = NULL;
+}
+
+#ifndef TCL_GENERIC_ONLY
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_AfterCmd --
+ *
+ *	This procedure is invoked to process the "after" Tcl command.
+ *	See the user documentation for details on what it does.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	See the user documentation.
+ *
+ *----------------------------------------------------------------------
+ */
+
+	/* ARGSUSED */
+int
+Tcl_AfterCmd(dummy, interp, argc, argv)
+    ClientData dummy;			/* Not used. */
+    Tcl_Interp *interp;			/* Current interpreter. */
+    int argc;				/* Number of arguments. */
+    char **argv;			/* Argument strings. */
+{
+    Interp *iPtr = (Interp *) interp;
+    register AfterHandler *afterPtr;
+    AfterHandler *prevPtr;
+    char *script, *end;
+    long id;
+    int ms, i, length;
+
+    if (argc < 2) {
+	Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
+		" option ?arg arg ...?\"", (char *) NULL);
+	return TCL_ERROR;
+    }
+
+    if (isdigit(argv[1][0])) {
+	if (Tcl_GetInt(interp, argv[1], &ms) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	if (argc == 2) {
+	    TclSleep(ms);
+	    return TCL_OK;
+	}
+	afterPtr = (AfterHandler *) ckalloc(sizeof(AfterHandler));
+	TclGetTime(&afterPtr->time);
+	afterPtr->time.sec += ms / 1000;
+	afterPtr->time.usec += (ms % 1000) * 1000L;
+	if (afterPtr->time.usec >= 1000000L) {
+	    afterPtr->time.sec++;
+	    afterPtr->time.usec -= 1000000L;
+	}
+	afterPtr->id = iPtr->afterId++;
+	afterPtr->script = Tcl_Concat(argc-2, argv+2);
+	afterPtr->nextPtr = NULL;
+	AddTimer(iPtr, afterPtr);
+	sprintf(interp->result, "after#%ld", afterPtr->id);
+	return TCL_OK;
+    }
+
+    length = strlen(argv[1]);
+    if ((argv[1][0] == 'i') && (strncmp(argv[1], "idle", length) == 0)) {
+	if (argc < 3) {
+	    Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
+		    " idle script ?script ...?\"", (char *) NULL);
+	    return TCL_ERROR;
+	}
+	afterPtr = (AfterHandler *) ckalloc(sizeof(AfterHandler));
+	afterPtr->time.sec = afterPtr->time.usec = 0;
+	afterPtr->id = iPtr->afterId++;
+	afterPtr->script = Tcl_Concat(argc-2, argv+2);
+	afterPtr->nextPtr = NULL;
+	if (iPtr->idleFirst == NULL) {
+	    iPtr->idleFirst = afterPtr;
+	} else {
+	    iPtr->idleLast->nextPtr = afterPtr;
+	}
+	iPtr->idleLast = afterPtr;
+	sprintf(interp->result, "after#%ld", afterPtr->id);
+	return TCL_OK;
+    }
+
+    if ((argv[1][0] != 'c') || (strncmp(argv[1], "cancel", length) != 0)) {
+	Tcl_AppendResult(interp, "bad argument \"", argv[1],
+		"\": must be cancel, idle, or a number", (char *) NULL);
+	return TCL_ERROR;
+    }
+    if (argc < 3) {
+	Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
+		" cancel id|script ?script ...?\"", (char *) NULL);
+	return TCL_ERROR;
+    }
+
+    /*
+     * The handler to cancel may be given by its identifier or by its
+     * script.  It's not an error if there is no such handler, since
+     * it may have run already.
+     */
+
+    id = -1;
+    script = NULL;
+    if ((argc == 3) && (strncmp(argv[2], "after#", 6) == 0)) {
+	id = strtol(argv[2]+6, &end, 10);
+	if ((end == argv[2]+6) || (*end != 0)) {
+	    id = -1;
+	}
+    }
+    if (id < 0) {
+	script = Tcl_Concat(argc-2, argv+2);
+    }
+    for (i = 0; i < iPtr->numTimers; i++) {
+	afterPtr = iPtr->timerHeap[i];
+	if ((afterPtr->id == id) || ((script != NULL)
+		&& (strcmp(afterPtr->script, script) == 0))) {
+	    RemoveTimer(iPtr, i);
+	    goto freeHandler;
+	}
+    }
+    for (prevPtr = NULL, afterPtr = iPtr->idleFirst; afterPtr != NULL;
+	    prevPtr = afterPtr, afterPtr = afterPtr->nextPtr) {
+	if ((afterPtr->id == id) || ((script != NULL)
+		&& (strcmp(afterPtr->script, script) == 0))) {
+	    if (prevPtr == NULL) {
+		iPtr->idleFirst = afterPtr->nextPtr;
+	    } else {
+		prevPtr->nextPtr = afterPtr->nextPtr;
+	    }
+	    if (iPtr->idleLast == afterPtr) {
+		iPtr->idleLast = prevPtr;
+	    }
+	    goto freeHandler;
+	}
+    }
+    afterPtr = NULL;
+
+    freeHandler:
+    if (afterPtr != NULL) {
+	ckfree(afterPtr->script);
+	ckfree((char *) afterPtr);
+    }
+    if (script != NULL) {
+	ckfree(script);
+    }
+    return TCL_OK;
+}
+#endif
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_UpdateCmd --
+ *
+ *	This procedure is invoked to process the "update" Tcl command.
+ *	See the user documentation for details on what it does.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	See the user documentation.
+ *
+ *----------------------------------------------------------------------
+ */
+
+	/* ARGSUSED */
+int
+Tcl_UpdateCmd(dummy, interp, argc, argv)
+    ClientData dummy;			/* Not used. */
+    Tcl_Interp *interp;			/* Current interpreter. */
+    int argc;				/* Number of arguments. */
+    char **argv;			/* Argument strings. */
+{
+    if (argc == 1) {
+	TclDoOneEvent(interp, 0);
+    } else if ((argc != 2) || (strncmp(argv[1], "idletasks",
+	    strlen(argv[1])) != 0)) {
+	Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
+		" ?idletasks?\"", (char *) NULL);
+	return TCL_ERROR;
+    }
+    RunIdle((Interp *) interp);
+    Tcl_ResetResult(interp);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_VwaitCmd --
+ *
+ *	This procedure is invoked to process the "vwait" Tcl command.
+ *	See the user documentation for details on what it does.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	See the user documentation.
+ *
+ *----------------------------------------------------------------------
+ */
+
+	/* ARGSUSED */
+int
+Tcl_VwaitCmd(dummy, interp, argc, argv)
+    ClientData dummy;			/* Not used. */
+    Tcl_Interp *interp;			/* Current interpreter. */
+    int argc;				/* Number of arguments. */
+    char **argv;			/* Argument strings. */
+{
+    int done, count;
+
+    if (argc != 2) {
+	Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
+		" varName\"", (char *) NULL);
+	return TCL_ERROR;
+    }
+    if (Tcl_TraceVar(interp, argv[1],
+	    TCL_GLOBAL_ONLY|TCL_TRACE_WRITES|TCL_TRACE_UNSETS,
+	    VwaitVarProc, (ClientData) &done) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    done = 0;
+    count = 0;
+    while (!done && (count >= 0)) {
+	count = TclDoOneEvent(interp, 1);
+    }
+    Tcl_UntraceVar(interp, argv[1],
+	    TCL_GLOBAL_ONLY|TCL_TRACE_WRITES|TCL_TRACE_UNSETS,
+	    VwaitVarProc, (ClientData) &done);
+    Tcl_ResetResult(interp);
+    if (!done) {
+	Tcl_AppendResult(interp, "can't wait for variable \"", argv[1],
+		"\":  would wait forever", (char *) NULL);
+	return TCL_ERROR;
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * VwaitVarProc --
+ *
+ *	This procedure is called by the variable trace that "vwait"
+ *	sets up on the variable it is waiting for.
+ *
+ * Results:
+ *	Always NULL.
+ *
+ * Side effects:
+ *	Tells the "vwait" command that it can stop waiting.
+ *
+ *----------------------------------------------------------------------
+ */
+
+	/* ARGSUSED */
+static char *
+VwaitVarProc(clientData, interp, name1, name2, flags)
+    ClientData clientData;	/* Address of "done" flag in vwait. */
+    Tcl_Interp *interp;		/* Interpreter containing variable. */
+    char *name1;		/* Name of variable. */
+    char *name2;		/* Name of element, if any. */
+    int flags;			/* Information about what happened. */
+{
+    *((int *) clientData) = 1;
+    return (char *) NULL;
+}
+
+#ifndef TCL_GENERIC_ONLY
+/*
+ *----------------------------------------------------------------------
+ *
+ * AddTimer --
+ *
+ *	Add a handler to an interpreter's heap of timer handlers.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The heap may be enlarged.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+AddTimer(iPtr, afterPtr)
+    register Interp *iPtr;		/* Interpreter that owns the heap. */
+    AfterHandler *afterPtr;		/* Handler to add. */
+{
+    AfterHandler **newHeap;
+    int i, parent;
+
+    if (iPtr->numTimers == iPtr->timerSpace) {
+	iPtr->timerSpace = (iPtr->timerSpace == 0) ? 8 : 2*iPtr->timerSpace;
+	newHeap = (AfterHandler **) ckalloc((unsigned)
+		(iPtr->timerSpace * sizeof(AfterHandler *)));
+	if (iPtr->timerHeap != NULL) {
+	    memcpy((VOID *) newHeap, (VOID *) iPtr->timerHeap,
+		    iPtr->numTimers * sizeof(AfterHandler *));
+	    ckfree((char *) iPtr->timerHeap);
+	}
+	iPtr->timerHeap = newHeap;
+    }
+
+    /*
+     * Start the new handler at the bottom of the heap and move it up
+     * past any handlers due after it.
+     */
+
+    i = iPtr->numTimers;
+    iPtr->numTimers++;
+    while (i > 0) {
+	parent = (i-1)/2;
+	if (!DUE_BEFORE(afterPtr, iPtr->timerHeap[parent])) {
+	    break;
+	}
+	iPtr->timerHeap[i] = iPtr->timerHeap[parent];
+	i = parent;
+    }
+    iPtr->timerHeap[i] = afterPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RemoveTimer --
+ *
+ *	Take a handler out of an interpreter's heap of timer handlers.
+ *
+ * Results:
+ *	The return value is the handler that was at the given index
+ *	of the heap.
+ *
+ * Side effects:
+ *	The heap is rearranged.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static AfterHandler *
+RemoveTimer(iPtr, index)
+    register Interp *iPtr;		/* Interpreter that owns the heap. */
+    int index;				/* Index in heap of handler to
+					 * remove. */
+{
+    register AfterHandler **heap = iPtr->timerHeap;
+    AfterHandler *afterPtr, *lastPtr;
+    int i, child;
+
+    afterPtr = heap[index];
+    iPtr->numTimers--;
+    if (index == iPtr->numTimers) {
+	return afterPtr;
+    }
+
+    /*
+     * Fill the hole with the last handler in the heap, then move that
+     * handler up or down until it is in order again.
+     */
+
+    lastPtr = heap[iPtr->numTimers];
+    i = index;
+    while ((i > 0) && DUE_BEFORE(lastPtr, heap[(i-1)/2])) {
+	heap[i] = heap[(i-1)/2];
+	i = (i-1)/2;
+    }
+    while (1) {
+	child = 2*i + 1;
+	if (child >= iPtr->numTimers) {
+	    break;
+	}
+	if ((child+1 < iPtr->numTimers)
+		&& DUE_BEFORE(heap[child+1], heap[child])) {
+	    child++;
+	}
+	if (!DUE_BEFORE(heap[child], lastPtr)) {
+	    break;
+	}
+	heap[i] = heap[child];
+	i = child;
+    }
+    heap[i] = lastPtr;
+    return afterPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RunTimers --
+ *
+ *	Invoke the timer handlers that are due.  Handlers created
+ *	while this is going on wait for the next call, even if they
+ *	are due already, so that a handler that reschedules itself
+ *	with a short delay can't keep this procedure from returning.
+ *
+ * Results:
+ *	The number of handlers invoked.
+ *
+ * Side effects:
+ *	Depends on the handlers.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+RunTimers(iPtr)
+    register Interp *iPtr;		/* Interpreter whose timers to run. */
+{
+    AfterHandler *afterPtr;
+    TclTime now;
+    long lastId;
+    int count;
+
+    if (iPtr->numTimers == 0) {
+	return 0;
+    }
+    TclGetTime(&now);
+    lastId = iPtr->afterId;
+    count = 0;
+    while (iPtr->numTimers > 0) {
+	afterPtr = iPtr->timerHeap[0];
+	if ((afterPtr->time.sec > now.sec) || ((afterPtr->time.sec == now.sec)
+		&& (afterPtr->time.usec > now.usec))
+		|| (afterPtr->id >= lastId)) {
+	    break;
+	}
+	RemoveTimer(iPtr, 0);
+	count++;
+	TclEvalEvent((Tcl_Interp *) iPtr, afterPtr->script);
+	ckfree(afterPtr->script);
+	ckfree((char *) afterPtr);
+    }
+    return count;
+}
+#endif
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RunIdle --
+ *
+ *	Invoke the idle handlers of an interpreter.  Handlers created
+ *	while this is going on wait for the next idle time.
+ *
+ * Results:
+ *	The number of handlers invoked.
+ *
+ * Side effects:
+ *	Depends on the handlers.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+RunIdle(iPtr)
+    register Interp *iPtr;		/* Interpreter whose handlers to run. */
+{
+    AfterHandler *afterPtr;
+    long lastId;
+    int count;
+
+    lastId = iPtr->afterId;
+    count = 0;
+    while ((iPtr->idleFirst != NULL) && (iPtr->idleFirst->id < lastId)) {
+	afterPtr = iPtr->idleFirst;
+	iPtr->idleFirst = afterPtr->nextPtr;
+	if (iPtr->idleFirst == NULL) {
+	    iPtr->idleLast = NULL;
+	}
+	count++;
+	TclEvalEvent((Tcl_Interp *) iPtr, afterPtr->script);
+	ckfree(afterPtr->script);
+	ckfree((char *) afterPtr);
+    }
+    return count;
+}
@@ -80,6 +80,12 @@ typedef struct {
 				 * expr.  See below for definitions.
 				 * Corresponds to the characters just
 				 * before expr. */
+    struct ExprCode *codePtr;	/* If non-NULL, the expression is being
+				 * compiled as it is evaluated:  nodes are
+				 * added here for each value and operator
+				 * parsed. */
+    int node;			/* When compiling, index in codePtr of the
+				 * node for the value most recently parsed. */
 } ExprInfo;
 
 /*
@@ -94,6 +100,16 @@ typedef struct {
 #define END		3
 #define UNKNOWN		4
 
+/*
+ * Operands of compiled expressions whose values must be computed
+ * each time (constant operands are just VALUE).  These are never
+ * returned by ExprLex.
+ */
+
+#define VAR_VALUE	5
+#define CMD_VALUE	6
+#define QUOTE_VALUE	7
+
 /*
  * Binary operators:
  */
@@ -158,19 +174,76 @@ char *operatorStrings[] = {
     "-", "!", "~"
 };
 
+/*
+ * The structures below hold the compiled form of an expression:  a
+ * tree of operators and operands with the precedence and grouping
+ * already worked out.  An expression is compiled by recording what
+ * ExprGetValue does while it evaluates the expression, so evaluating
+ * the tree later produces exactly the same values and errors, in the
+ * same order, without lexing or parsing the text again.  Only the
+ * variable and command substitutions are redone each time.
+ */
+
+typedef struct ExprNode {
+    int op;			/* Operator, or VALUE for a constant, or
+				 * one of VAR_VALUE, CMD_VALUE, QUOTE_VALUE
+				 * for operands that must be recomputed. */
+    int operands[3];		/* Indices of operand nodes (-1 if not
+				 * used).  For QUESTY, the condition, then
+				 * the two alternatives. */
+    int type;			/* For constants, the type of the value */
+    long intValue;		/* and its integer */
+    double doubleValue;		/* or floating-point value. */
+    char *string;		/* Malloc-ed string:  the value of a string
+				 * constant, the name of a scalar variable
+				 * for VAR_VALUE (NULL for more complicated
+				 * references), or the command for
+				 * CMD_VALUE.  NULL otherwise. */
+    int offset;			/* Offset in the source of the text for
+				 * QUOTE_VALUE (just after the quote) and
+				 * VAR_VALUE without a string (at the $). */
+} ExprNode;
+
+typedef struct ExprCode {
+    int refCount;		/* Number of references (cache entry plus
+				 * evaluations in progress);  freed when
+				 * this becomes zero. */
+    char *source;		/* Malloc-ed copy of the expression. */
+    int numNodes;		/* Number of nodes in use. */
+    int nodeSpace;		/* Number of nodes allocated. */
+    ExprNode *nodes;		/* Malloc-ed array of nodes;  operands
+				 * always come before their operators. */
+    int root;			/* Index of the node for the whole
+				 * expression. */
+} ExprCode;
+
 /*
  * Declarations for local procedures to this file:
  */
 
+static int		ExprAddNode _ANSI_ARGS_((ExprInfo *infoPtr, int op,
+			    int operand1, int operand2, int operand3));
+static int		ExprApplyBinary _ANSI_ARGS_((Tcl_Interp *interp,
+			    int operator, Value *valuePtr, Value *value2Ptr));
+static int		ExprApplyUnary _ANSI_ARGS_((Tcl_Interp *interp,
+			    int operator, Value *valuePtr));
+static int		ExprEvalNode _ANSI_ARGS_((Tcl_Interp *interp,
+			    ExprCode *codePtr, int index, Value *valuePtr));
+static void		ExprFreeCode _ANSI_ARGS_((ExprCode *codePtr));
 static int		ExprGetValue _ANSI_ARGS_((Tcl_Interp *interp,
 			    ExprInfo *infoPtr, int prec, Value *valuePtr));
+static int		ExprIllegalType _ANSI_ARGS_((Tcl_Interp *interp,
+			    int badType, int operator));
 static int		ExprLex _ANSI_ARGS_((Tcl_Interp *interp,
 			    ExprInfo *infoPtr, Value *valuePtr));
 static void		ExprMakeString _ANSI_ARGS_((Value *valuePtr));
 static int		ExprParseString _ANSI_ARGS_((Tcl_Interp *interp,
 			    char *string, Value *valuePtr));
+static void		ExprRecordValue _ANSI_ARGS_((ExprInfo *infoPtr,
+			    int op, char *start, char *end, Value *valuePtr));
 static int		ExprTopLevel _ANSI_ARGS_((Tcl_Interp *interp,
 			    char *string, Value *valuePtr));
+static Tcl_HashEntry *	LookupExpr _ANSI_ARGS_((Interp *iPtr, char *string));
 
 /*
  *--------------------------------------------------------------
@@ -356,6 +429,9 @@ ExprLex(interp, infoPtr, valuePtr)
 	    } else {
 		infoPtr->expr = term;
 	    }
+	    if (infoPtr->codePtr != NULL) {
+		ExprRecordValue(infoPtr, VALUE, p, infoPtr->expr, valuePtr);
+	    }
 	    return TCL_OK;
 
 	case '$':
@@ -370,6 +446,9 @@ ExprLex(interp, infoPtr, valuePtr)
 	    if (var == NULL) {
 		return TCL_ERROR;
 	    }
+	    if (infoPtr->codePtr != NULL) {
+		ExprRecordValue(infoPtr, VAR_VALUE, p, infoPtr->expr, valuePtr);
+	    }
 	    if (((Interp *) interp)->noEval) {
 		valuePtr->type = TYPE_INT;
 		valuePtr->intValue = 0;
@@ -385,6 +464,9 @@ ExprLex(interp, infoPtr, valuePtr)
 		return result;
 	    }
 	    infoPtr->expr++;
+	    if (infoPtr->codePtr != NULL) {
+		ExprRecordValue(infoPtr, CMD_VALUE, p, infoPtr->expr, valuePtr);
+	    }
 	    if (((Interp *) interp)->noEval) {
 		valuePtr->type = TYPE_INT;
 		valuePtr->intValue = 0;
@@ -405,7 +487,12 @@ ExprLex(interp, infoPtr, valuePtr)
 	    if (result != TCL_OK) {
 		return result;
 	    }
-	    return ExprParseString(interp, valuePtr->pv.buffer, valuePtr);
+	    result = ExprParseString(interp, valuePtr->pv.buffer, valuePtr);
+	    if ((result == TCL_OK) && (infoPtr->codePtr != NULL)) {
+		ExprRecordValue(infoPtr, QUOTE_VALUE, p, infoPtr->expr,
+			valuePtr);
+	    }
+	    return result;
 
 	case '{':
 	    infoPtr->token = VALUE;
@@ -414,7 +501,11 @@ ExprLex(interp, infoPtr, valuePtr)
 	    if (result != TCL_OK) {
 		return result;
 	    }
-	    return ExprParseString(interp, valuePtr->pv.buffer, valuePtr);
+	    result = ExprParseString(interp, valuePtr->pv.buffer, valuePtr);
+	    if ((result == TCL_OK) && (infoPtr->codePtr != NULL)) {
+		ExprRecordValue(infoPtr, VALUE, p, infoPtr->expr, valuePtr);
+	    }
+	    return result;
 
 	case '(':
 	    infoPtr->token = OPEN_PAREN;
@@ -587,6 +678,8 @@ ExprGetValue(interp, infoPtr, prec, valuePtr)
 					 * operator (while picking up value
 					 * for unary operator).  Don't lex
 					 * again. */
+    int node, node2;			/* When compiling, the nodes for
+					 * valuePtr and value2. */
     int result;
 
     /*
@@ -595,6 +688,7 @@ ExprGetValue(interp, infoPtr, prec, valuePtr)
      */
 
     gotOp = 0;
+    node = -1;
     value2.pv.buffer = value2.pv.next = value2.staticSpace;
     value2.pv.end = value2.pv.buffer + STATIC_STRING_SPACE - 1;
     value2.pv.expandProc = TclExpandParseValue;
@@ -621,6 +715,7 @@ ExprGetValue(interp, infoPtr, prec, valuePtr)
 	    result = TCL_ERROR;
 	    goto done;
 	}
+	node = infoPtr->node;
     } else {
 	if (infoPtr->token == MINUS) {
 	    infoPtr->token = UNARY_MINUS;
@@ -637,49 +732,16 @@ ExprGetValue(interp, infoPtr, prec, valuePtr)
 	    if (result != TCL_OK) {
 		goto done;
 	    }
-	    switch (operator) {
-		case UNARY_MINUS:
-		    if (valuePtr->type == TYPE_INT) {
-			valuePtr->intValue = -valuePtr->intValue;
-		    } else if (valuePtr->type == TYPE_DOUBLE){
-			valuePtr->doubleValue = -valuePtr->doubleValue;
-		    } else {
-			badType = valuePtr->type;
-			goto illegalType;
-		    } 
-		    break;
-		case NOT:
-		    if (valuePtr->type == TYPE_INT) {
-			valuePtr->intValue = !valuePtr->intValue;
-		    } else if (valuePtr->type == TYPE_DOUBLE) {
-			/*
-			 * Theoretically, should be able to use
-			 * "!valuePtr->intValue", but apparently some
-			 * compilers can't handle it.
-			 */
-			if (valuePtr->doubleValue == 0.0) {
-			    valuePtr->intValue = 1;
-			} else {
-			    valuePtr->intValue = 0;
-			}
-			valuePtr->type = TYPE_INT;
-		    } else {
-			badType = valuePtr->type;
-			goto illegalType;
-		    }
-		    break;
-		case BIT_NOT:
-		    if (valuePtr->type == TYPE_INT) {
-			valuePtr->intValue = ~valuePtr->intValue;
-		    } else {
-			badType  = valuePtr->type;
-			goto illegalType;
-		    }
-		    break;
+	    result = ExprApplyUnary(interp, operator, valuePtr);
+	    if (result != TCL_OK) {
+		goto done;
 	    }
+	    node = ExprAddNode(infoPtr, operator, infoPtr->node, -1, -1);
 	    gotOp = 1;
 	} else if (infoPtr->token != VALUE) {
 	    goto syntaxError;
+	} else {
+	    node = infoPtr->node;
 	}
     }
 
@@ -740,6 +802,7 @@ ExprGetValue(interp, infoPtr, prec, valuePtr)
 		    if (infoPtr->token != COLON) {
 			goto syntaxError;
 		    }
+		    node2 = infoPtr->node;
 		    value2.pv.next = value2.pv.buffer;
 		    iPtr->noEval++;
 		    result = ExprGetValue(interp, infoPtr, precTable[operator],
@@ -756,10 +819,16 @@ ExprGetValue(interp, infoPtr, prec, valuePtr)
 		    if (infoPtr->token != COLON) {
 			goto syntaxError;
 		    }
+		    node2 = infoPtr->node;
 		    valuePtr->pv.next = valuePtr->pv.buffer;
 		    result = ExprGetValue(interp, infoPtr, precTable[operator],
 			    valuePtr);
 		}
+		if (result != TCL_OK) {
+		    goto done;
+		}
+		node = ExprAddNode(infoPtr, QUESTY, node, node2,
+			infoPtr->node);
 	    } else {
 		result = ExprGetValue(interp, infoPtr, precTable[operator],
 			&value2);
@@ -776,303 +845,17 @@ ExprGetValue(interp, infoPtr, prec, valuePtr)
 		&& (infoPtr->token != CLOSE_PAREN)) {
 	    goto syntaxError;
 	}
-
-	/*
-	 * At this point we've got two values and an operator.  Check
-	 * to make sure that the particular data types are appropriate
-	 * for the particular operator, and perform type conversion
-	 * if necessary.
-	 */
-
-	switch (operator) {
-
-	    /*
-	     * For the operators below, no strings are allowed and
-	     * ints get converted to floats if necessary.
-	     */
-
-	    case MULT: case DIVIDE: case PLUS: case MINUS:
-		if ((valuePtr->type == TYPE_STRING)
-			|| (value2.type == TYPE_STRING)) {
-		    badType = TYPE_STRING;
-		    goto illegalType;
-		}
-		if (valuePtr->type == TYPE_DOUBLE) {
-		    if (value2.type == TYPE_INT) {
-			value2.doubleValue = value2.intValue;
-			value2.type = TYPE_DOUBLE;
-		    }
-		} else if (value2.type == TYPE_DOUBLE) {
-		    if (valuePtr->type == TYPE_INT) {
-			valuePtr->doubleValue = valuePtr->intValue;
-			valuePtr->type = TYPE_DOUBLE;
-		    }
-		}
-		break;
-
-	    /*
-	     * For the operators below, only integers are allowed.
-	     */
-
-	    case MOD: case LEFT_SHIFT: case RIGHT_SHIFT:
-	    case BIT_AND: case BIT_XOR: case BIT_OR:
-		 if (valuePtr->type != TYPE_INT) {
-		     badType = valuePtr->type;
-		     goto illegalType;
-		 } else if (value2.type != TYPE_INT) {
-		     badType = value2.type;
-		     goto illegalType;
-		 }
-		 break;
-
-	    /*
-	     * For the operators below, any type is allowed but the
-	     * two operands must have the same type.  Convert integers
-	     * to floats and either to strings, if necessary.
-	     */
-
-	    case LESS: case GREATER: case LEQ: case GEQ:
-	    case EQUAL: case NEQ:
-		if (valuePtr->type == TYPE_STRING) {
-		    if (value2.type != TYPE_STRING) {
-			ExprMakeString(&value2);
-		    }
-		} else if (value2.type == TYPE_STRING) {
-		    if (valuePtr->type != TYPE_STRING) {
-			ExprMakeString(valuePtr);
-		    }
-		} else if (valuePtr->type == TYPE_DOUBLE) {
-		    if (value2.type == TYPE_INT) {
-			value2.doubleValue = value2.intValue;
-			value2.type = TYPE_DOUBLE;
-		    }
-		} else if (value2.type == TYPE_DOUBLE) {
-		     if (valuePtr->type == TYPE_INT) {
-			valuePtr->doubleValue = valuePtr->intValue;
-			valuePtr->type = TYPE_DOUBLE;
-		    }
-		}
-		break;
-
-	    /*
-	     * For the operators below, no strings are allowed, but
-	     * no int->double conversions are performed.
-	     */
-
-	    case AND: case OR:
-		if (valuePtr->type == TYPE_STRING) {
-		    badType = valuePtr->type;
-		    goto illegalType;
-		}
-		if (value2.type == TYPE_STRING) {
-		    badType = value2.type;
-		    goto illegalType;
-		}
-		break;
-
-	    /*
-	     * For the operators below, type and conversions are
-	     * irrelevant:  they're handled elsewhere.
-	     */
-
-	    case QUESTY: case COLON:
-		break;
-
-	    /*
-	     * Any other operator is an error.
-	     */
-
-	    default:
-		interp->result = "unknown operator in expression";
-		result = TCL_ERROR;
-		goto done;
+	if (operator != QUESTY) {
+	    node = ExprAddNode(infoPtr, operator, node, infoPtr->node, -1);
 	}
-
-	/*
-	 * If necessary, convert one of the operands to the type
-	 * of the other.  If the operands are incompatible with
-	 * the operator (e.g. "+" on strings) then return an
-	 * error.
-	 */
-
-	switch (operator) {
-	    case MULT:
-		if (valuePtr->type == TYPE_INT) {
-		    valuePtr->intValue *= value2.intValue;
-		} else {
-		    valuePtr->doubleValue *= value2.doubleValue;
-		}
-		break;
-	    case DIVIDE:
-		if (valuePtr->type == TYPE_INT) {
-		    if (value2.intValue == 0) {
-			divideByZero:
-			interp->result = "divide by zero";
-			result = TCL_ERROR;
-			goto done;
-		    }
-		    valuePtr->intValue /= value2.intValue;
-		} else {
-		    if (value2.doubleValue == 0.0) {
-			goto divideByZero;
-		    }
-		    valuePtr->doubleValue /= value2.doubleValue;
-		}
-		break;
-	    case MOD:
-		if (value2.intValue == 0) {
-		    goto divideByZero;
-		}
-		valuePtr->intValue %= value2.intValue;
-		break;
-	    case PLUS:
-		if (valuePtr->type == TYPE_INT) {
-		    valuePtr->intValue += value2.intValue;
-		} else {
-		    valuePtr->doubleValue += value2.doubleValue;
-		}
-		break;
-	    case MINUS:
-		if (valuePtr->type == TYPE_INT) {
-		    valuePtr->intValue -= value2.intValue;
-		} else {
-		    valuePtr->doubleValue -= value2.doubleValue;
-		}
-		break;
-	    case LEFT_SHIFT:
-		valuePtr->intValue <<= value2.intValue;
-		break;
-	    case RIGHT_SHIFT:
-		/*
-		 * The following code is a bit tricky:  it ensures that
-		 * right shifts propagate the sign bit even on machines
-		 * where ">>" won't do it by default.
-		 */
-
-		if (valuePtr->intValue < 0) {
-		    valuePtr->intValue =
-			    ~((~valuePtr->intValue) >> value2.intValue);
-		} else {
-		    valuePtr->intValue >>= value2.intValue;
-		}
-		break;
-	    case LESS:
-		if (valuePtr->type == TYPE_INT) {
-		    valuePtr->intValue =
-			valuePtr->intValue < value2.intValue;
-		} else if (valuePtr->type == TYPE_DOUBLE) {
-		    valuePtr->intValue =
-			valuePtr->doubleValue < value2.doubleValue;
-		} else {
-		    valuePtr->intValue =
-			    strcmp(valuePtr->pv.buffer, value2.pv.buffer) < 0;
-		}
-		valuePtr->type = TYPE_INT;
-		break;
-	    case GREATER:
-		if (valuePtr->type == TYPE_INT) {
-		    valuePtr->intValue =
-			valuePtr->intValue > value2.intValue;
-		} else if (valuePtr->type == TYPE_DOUBLE) {
-		    valuePtr->intValue =
-			valuePtr->doubleValue > value2.doubleValue;
-		} else {
-		    valuePtr->intValue =
-			    strcmp(valuePtr->pv.buffer, value2.pv.buffer) > 0;
-		}
-		valuePtr->type = TYPE_INT;
-		break;
-	    case LEQ:
-		if (valuePtr->type == TYPE_INT) {
-		    valuePtr->intValue =
-			valuePtr->intValue <= value2.intValue;
-		} else if (valuePtr->type == TYPE_DOUBLE) {
-		    valuePtr->intValue =
-			valuePtr->doubleValue <= value2.doubleValue;
-		} else {
-		    valuePtr->intValue =
-			    strcmp(valuePtr->pv.buffer, value2.pv.buffer) <= 0;
-		}
-		valuePtr->type = TYPE_INT;
-		break;
-	    case GEQ:
-		if (valuePtr->type == TYPE_INT) {
-		    valuePtr->intValue =
-			valuePtr->intValue >= value2.intValue;
-		} else if (valuePtr->type == TYPE_DOUBLE) {
-		    valuePtr->intValue =
-			valuePtr->doubleValue >= value2.doubleValue;
-		} else {
-		    valuePtr->intValue =
-			    strcmp(valuePtr->pv.buffer, value2.pv.buffer) >= 0;
-		}
-		valuePtr->type = TYPE_INT;
-		break;
-	    case EQUAL:
-		if (valuePtr->type == TYPE_INT) {
-		    valuePtr->intValue =
-			valuePtr->intValue == value2.intValue;
-		} else if (valuePtr->type == TYPE_DOUBLE) {
-		    valuePtr->intValue =
-			valuePtr->doubleValue == value2.doubleValue;
-		} else {
-		    valuePtr->intValue =
-			    strcmp(valuePtr->pv.buffer, value2.pv.buffer) == 0;
-		}
-		valuePtr->type = TYPE_INT;
-		break;
-	    case NEQ:
-		if (valuePtr->type == TYPE_INT) {
-		    valuePtr->intValue =
-			valuePtr->intValue != value2.intValue;
-		} else if (valuePtr->type == TYPE_DOUBLE) {
-		    valuePtr->intValue =
-			valuePtr->doubleValue != value2.doubleValue;
-		} else {
-		    valuePtr->intValue =
-			    strcmp(valuePtr->pv.buffer, value2.pv.buffer) != 0;
-		}
-		valuePtr->type = TYPE_INT;
-		break;
-	    case BIT_AND:
-		valuePtr->intValue &= value2.intValue;
-		break;
-	    case BIT_XOR:
-		valuePtr->intValue ^= value2.intValue;
-		break;
-	    case BIT_OR:
-		valuePtr->intValue |= value2.intValue;
-		break;
-
-	    /*
-	     * For AND and OR, we know that the first value has already
-	     * been converted to an integer.  Thus we need only consider
-	     * the possibility of int vs. double for the second value.
-	     */
-
-	    case AND:
-		if (value2.type == TYPE_DOUBLE) {
-		    value2.intValue = value2.doubleValue != 0;
-		    value2.type = TYPE_INT;
-		}
-		valuePtr->intValue = valuePtr->intValue && value2.intValue;
-		break;
-	    case OR:
-		if (value2.type == TYPE_DOUBLE) {
-		    value2.intValue = value2.doubleValue != 0;
-		    value2.type = TYPE_INT;
-		}
-		valuePtr->intValue = valuePtr->intValue || value2.intValue;
-		break;
-
-	    case COLON:
-		interp->result = "can't have : operator without ? first";
-		result = TCL_ERROR;
-		goto done;
+	result = ExprApplyBinary(interp, operator, valuePtr, &value2);
+	if (result != TCL_OK) {
+	    goto done;
 	}
     }
 
     done:
+    infoPtr->node = node;
     if (value2.pv.buffer != value2.staticSpace) {
 	ckfree(value2.pv.buffer);
     }
@@ -1086,103 +869,1075 @@ ExprGetValue(interp, infoPtr, prec, valuePtr)
     goto done;
 
     illegalType:
-    Tcl_AppendResult(interp, "can't use ", (badType == TYPE_DOUBLE) ?
-	    "floating-point value" : "non-numeric string",
-	    " as operand of \"", operatorStrings[operator], "\"",
-	    (char *) NULL);
-    result = TCL_ERROR;
+    result = ExprIllegalType(interp, badType, operator);
     goto done;
 }
-
+
 /*
- *--------------------------------------------------------------
+ *----------------------------------------------------------------------
  *
- * ExprMakeString --
+ * ExprApplyUnary --
  *
- *	Convert a value from int or double representation to
- *	a string.
+ *	Apply a unary operator to a value.
  *
  * Results:
- *	The information at *valuePtr gets converted to string
- *	format, if it wasn't that way already.
+ *	Normally TCL_OK is returned and *valuePtr is replaced by the
+ *	result of the operator.  If the value has the wrong type for
+ *	the operator then TCL_ERROR is returned and interp->result
+ *	contains an error message.
  *
  * Side effects:
  *	None.
  *
- *--------------------------------------------------------------
+ *----------------------------------------------------------------------
  */
 
-static void
-ExprMakeString(valuePtr)
-    register Value *valuePtr;		/* Value to be converted. */
+static int
+ExprApplyUnary(interp, operator, valuePtr)
+    Tcl_Interp *interp;			/* Interpreter to use for error
+					 * reporting. */
+    int operator;			/* UNARY_MINUS, NOT, or BIT_NOT. */
+    register Value *valuePtr;		/* Operand;  overwritten with the
+					 * result. */
 {
-    int shortfall;
-
-    shortfall = 150 - (valuePtr->pv.end - valuePtr->pv.buffer);
-    if (shortfall > 0) {
-	(*valuePtr->pv.expandProc)(&valuePtr->pv, shortfall);
-    }
-    if (valuePtr->type == TYPE_INT) {
-	sprintf(valuePtr->pv.buffer, "%ld", valuePtr->intValue);
-    } else if (valuePtr->type == TYPE_DOUBLE) {
-	sprintf(valuePtr->pv.buffer, "%g", valuePtr->doubleValue);
+    switch (operator) {
+	case UNARY_MINUS:
+	    if (valuePtr->type == TYPE_INT) {
+		valuePtr->intValue = -valuePtr->intValue;
+	    } else if (valuePtr->type == TYPE_DOUBLE){
+		valuePtr->doubleValue = -valuePtr->doubleValue;
+	    } else {
+		return ExprIllegalType(interp, valuePtr->type, operator);
+	    }
+	    break;
+	case NOT:
+	    if (valuePtr->type == TYPE_INT) {
+		valuePtr->intValue = !valuePtr->intValue;
+	    } else if (valuePtr->type == TYPE_DOUBLE) {
+		/*
+		 * Theoretically, should be able to use
+		 * "!valuePtr->intValue", but apparently some
+		 * compilers can't handle it.
+		 */
+		if (valuePtr->doubleValue == 0.0) {
+		    valuePtr->intValue = 1;
+		} else {
+		    valuePtr->intValue = 0;
+		}
+		valuePtr->type = TYPE_INT;
+	    } else {
+		return ExprIllegalType(interp, valuePtr->type, operator);
+	    }
+	    break;
+	case BIT_NOT:
+	    if (valuePtr->type == TYPE_INT) {
+		valuePtr->intValue = ~valuePtr->intValue;
+	    } else {
+		return ExprIllegalType(interp, valuePtr->type, operator);
+	    }
+	    break;
     }
-    valuePtr->type = TYPE_STRING;
+    return TCL_OK;
 }
-
+
 /*
- *--------------------------------------------------------------
+ *----------------------------------------------------------------------
  *
- * ExprTopLevel --
+ * ExprApplyBinary --
  *
- *	This procedure provides top-level functionality shared by
- *	procedures like Tcl_ExprInt, Tcl_ExprDouble, etc.
+ *	Apply a binary operator to two values.  For AND, OR, and
+ *	QUESTY, the caller must already have converted the first
+ *	value to an integer and computed the second (for QUESTY,
+ *	*valuePtr already holds the result, so nothing is done).
  *
  * Results:
- *	The result is a standard Tcl return value.  If an error
- *	occurs then an error message is left in interp->result.
- *	The value of the expression is returned in *valuePtr, in
- *	whatever form it ends up in (could be string or integer
- *	or double).  Caller may need to convert result.  Caller
- *	is also responsible for freeing string memory in *valuePtr,
- *	if any was allocated.
+ *	Normally TCL_OK is returned and *valuePtr is replaced by the
+ *	result of the operator.  If the values are incompatible with
+ *	the operator (e.g. "+" on strings), or the operator fails
+ *	(e.g. division by zero), then TCL_ERROR is returned and
+ *	interp->result contains an error message.
  *
  * Side effects:
- *	None.
+ *	*value2Ptr may be converted to a different type.
  *
- *--------------------------------------------------------------
+ *----------------------------------------------------------------------
  */
 
 static int
-ExprTopLevel(interp, string, valuePtr)
-    Tcl_Interp *interp;			/* Context in which to evaluate the
-					 * expression. */
-    char *string;			/* Expression to evaluate. */
-    Value *valuePtr;			/* Where to store result.  Should
-					 * not be initialized by caller. */
+ExprApplyBinary(interp, operator, valuePtr, value2Ptr)
+    Tcl_Interp *interp;			/* Interpreter to use for error
+					 * reporting. */
+    int operator;			/* Binary operator to apply. */
+    register Value *valuePtr;		/* First operand;  overwritten with
+					 * the result. */
+    register Value *value2Ptr;		/* Second operand. */
 {
-    ExprInfo info;
-    int result;
+    /*
+     * Check to make sure that the particular data types are
+     * appropriate for the particular operator, and perform type
+     * conversion if necessary.
+     */
 
-    info.originalExpr = string;
-    info.expr = string;
-    valuePtr->pv.buffer = valuePtr->pv.next = valuePtr->staticSpace;
-    valuePtr->pv.end = valuePtr->pv.buffer + STATIC_STRING_SPACE - 1;
-    valuePtr->pv.expandProc = TclExpandParseValue;
-    valuePtr->pv.clientData = (ClientData) NULL;
+    switch (operator) {
+
+	/*
+	 * For the operators below, no strings are allowed and
+	 * ints get converted to floats if necessary.
+	 */
+
+	case MULT: case DIVIDE: case PLUS: case MINUS:
+	    if ((valuePtr->type == TYPE_STRING)
+		    || (value2Ptr->type == TYPE_STRING)) {
+		return ExprIllegalType(interp, TYPE_STRING, operator);
+	    }
+	    if (valuePtr->type == TYPE_DOUBLE) {
+		if (value2Ptr->type == TYPE_INT) {
+		    value2Ptr->doubleValue = value2Ptr->intValue;
+		    value2Ptr->type = TYPE_DOUBLE;
+		}
+	    } else if (value2Ptr->type == TYPE_DOUBLE) {
+		if (valuePtr->type == TYPE_INT) {
+		    valuePtr->doubleValue = valuePtr->intValue;
+		    valuePtr->type = TYPE_DOUBLE;
+		}
+	    }
+	    break;
+
+	/*
+	 * For the operators below, only integers are allowed.
+	 */
+
+	case MOD: case LEFT_SHIFT: case RIGHT_SHIFT:
+	case BIT_AND: case BIT_XOR: case BIT_OR:
+	     if (valuePtr->type != TYPE_INT) {
+		 return ExprIllegalType(interp, valuePtr->type, operator);
+	     } else if (value2Ptr->type != TYPE_INT) {
+		 return ExprIllegalType(interp, value2Ptr->type, operator);
+	     }
+	     break;
+
+	/*
+	 * For the operators below, any type is allowed but the
+	 * two operands must have the same type.  Convert integers
+	 * to floats and either to strings, if necessary.
+	 */
+
+	case LESS: case GREATER: case LEQ: case GEQ:
+	case EQUAL: case NEQ:
+	    if (valuePtr->type == TYPE_STRING) {
+		if (value2Ptr->type != TYPE_STRING) {
+		    ExprMakeString(value2Ptr);
+		}
+	    } else if (value2Ptr->type == TYPE_STRING) {
+		if (valuePtr->type != TYPE_STRING) {
+		    ExprMakeString(valuePtr);
+		}
+	    } else if (valuePtr->type == TYPE_DOUBLE) {
+		if (value2Ptr->type == TYPE_INT) {
+		    value2Ptr->doubleValue = value2Ptr->intValue;
+		    value2Ptr->type = TYPE_DOUBLE;
+		}
+	    } else if (value2Ptr->type == TYPE_DOUBLE) {
+		 if (valuePtr->type == TYPE_INT) {
+		    valuePtr->doubleValue = valuePtr->intValue;
+		    valuePtr->type = TYPE_DOUBLE;
+		}
+	    }
+	    break;
+
+	/*
+	 * For the operators below, no strings are allowed, but
+	 * no int->double conversions are performed.
+	 */
+
+	case AND: case OR:
+	    if (valuePtr->type == TYPE_STRING) {
+		return ExprIllegalType(interp, valuePtr->type, operator);
+	    }
+	    if (value2Ptr->type == TYPE_STRING) {
+		return ExprIllegalType(interp, value2Ptr->type, operator);
+	    }
+	    break;
+
+	/*
+	 * For the operators below, type and conversions are
+	 * irrelevant:  they're handled elsewhere.
+	 */
+
+	case QUESTY: case COLON:
+	    break;
+
+	/*
+	 * Any other operator is an error.
+	 */
+
+	default:
+	    interp->result = "unknown operator in expression";
+	    return TCL_ERROR;
+    }
+
+    /*
+     * Now apply the operator.
+     */
+
+    switch (operator) {
+	case MULT:
+	    if (valuePtr->type == TYPE_INT) {
+		valuePtr->intValue *= value2Ptr->intValue;
+	    } else {
+		valuePtr->doubleValue *= value2Ptr->doubleValue;
+	    }
+	    break;
+	case DIVIDE:
+	    if (valuePtr->type == TYPE_INT) {
+		if (value2Ptr->intValue == 0) {
+		    divideByZero:
+		    interp->result = "divide by zero";
+		    return TCL_ERROR;
+		}
+		valuePtr->intValue /= value2Ptr->intValue;
+	    } else {
+		if (value2Ptr->doubleValue == 0.0) {
+		    goto divideByZero;
+		}
+		valuePtr->doubleValue /= value2Ptr->doubleValue;
+	    }
+	    break;
+	case MOD:
+	    if (value2Ptr->intValue == 0) {
+		goto divideByZero;
+	    }
+	    valuePtr->intValue %= value2Ptr->intValue;
+	    break;
+	case PLUS:
+	    if (valuePtr->type == TYPE_INT) {
+		valuePtr->intValue += value2Ptr->intValue;
+	    } else {
+		valuePtr->doubleValue += value2Ptr->doubleValue;
+	    }
+	    break;
+	case MINUS:
+	    if (valuePtr->type == TYPE_INT) {
+		valuePtr->intValue -= value2Ptr->intValue;
+	    } else {
+		valuePtr->doubleValue -= value2Ptr->doubleValue;
+	    }
+	    break;
+	case LEFT_SHIFT:
+	    valuePtr->intValue <<= value2Ptr->intValue;
+	    break;
+	case RIGHT_SHIFT:
+	    /*
+	     * The following code is a bit tricky:  it ensures that
+	     * right shifts propagate the sign bit even on machines
+	     * where ">>" won't do it by default.
+	     */
+
+	    if (valuePtr->intValue < 0) {
+		valuePtr->intValue =
+			~((~valuePtr->intValue) >> value2Ptr->intValue);
+	    } else {
+		valuePtr->intValue >>= value2Ptr->intValue;
+	    }
+	    break;
+	case LESS:
+	    if (valuePtr->type == TYPE_INT) {
+		valuePtr->intValue =
+		    valuePtr->intValue < value2Ptr->intValue;
+	    } else if (valuePtr->type == TYPE_DOUBLE) {
+		valuePtr->intValue =
+		    valuePtr->doubleValue < value2Ptr->doubleValue;
+	    } else {
+		valuePtr->intValue =
+			strcmp(valuePtr->pv.buffer, value2Ptr->pv.buffer) < 0;
+	    }
+	    valuePtr->type = TYPE_INT;
+	    break;
+	case GREATER:
+	    if (valuePtr->type == TYPE_INT) {
+		valuePtr->intValue =
+		    valuePtr->intValue > value2Ptr->intValue;
+	    } else if (valuePtr->type == TYPE_DOUBLE) {
+		valuePtr->intValue =
+		    valuePtr->doubleValue > value2Ptr->doubleValue;
+	    } else {
+		valuePtr->intValue =
+			strcmp(valuePtr->pv.buffer, value2Ptr->pv.buffer) > 0;
+	    }
+	    valuePtr->type = TYPE_INT;
+	    break;
+	case LEQ:
+	    if (valuePtr->type == TYPE_INT) {
+		valuePtr->intValue =
+		    valuePtr->intValue <= value2Ptr->intValue;
+	    } else if (valuePtr->type == TYPE_DOUBLE) {
+		valuePtr->intValue =
+		    valuePtr->doubleValue <= value2Ptr->doubleValue;
+	    } else {
+		valuePtr->intValue =
+			strcmp(valuePtr->pv.buffer, value2Ptr->pv.buffer) <= 0;
+	    }
+	    valuePtr->type = TYPE_INT;
+	    break;
+	case GEQ:
+	    if (valuePtr->type == TYPE_INT) {
+		valuePtr->intValue =
+		    valuePtr->intValue >= value2Ptr->intValue;
+	    } else if (valuePtr->type == TYPE_DOUBLE) {
+		valuePtr->intValue =
+		    valuePtr->doubleValue >= value2Ptr->doubleValue;
+	    } else {
+		valuePtr->intValue =
+			strcmp(valuePtr->pv.buffer, value2Ptr->pv.buffer) >= 0;
+	    }
+	    valuePtr->type = TYPE_INT;
+	    break;
+	case EQUAL:
+	    if (valuePtr->type == TYPE_INT) {
+		valuePtr->intValue =
+		    valuePtr->intValue == value2Ptr->intValue;
+	    } else if (valuePtr->type == TYPE_DOUBLE) {
+		valuePtr->intValue =
+		    valuePtr->doubleValue == value2Ptr->doubleValue;
+	    } else {
+		valuePtr->intValue =
+			strcmp(valuePtr->pv.buffer, value2Ptr->pv.buffer) == 0;
+	    }
+	    valuePtr->type = TYPE_INT;
+	    break;
+	case NEQ:
+	    if (valuePtr->type == TYPE_INT) {
+		valuePtr->intValue =
+		    valuePtr->intValue != value2Ptr->intValue;
+	    } else if (valuePtr->type == TYPE_DOUBLE) {
+		valuePtr->intValue =
+		    valuePtr->doubleValue != value2Ptr->doubleValue;
+	    } else {
+		valuePtr->intValue =
+			strcmp(valuePtr->pv.buffer, value2Ptr->pv.buffer) != 0;
+	    }
+	    valuePtr->type = TYPE_INT;
+	    break;
+	case BIT_AND:
+	    valuePtr->intValue &= value2Ptr->intValue;
+	    break;
+	case BIT_XOR:
+	    valuePtr->intValue ^= value2Ptr->intValue;
+	    break;
+	case BIT_OR:
+	    valuePtr->intValue |= value2Ptr->intValue;
+	    break;
+
+	/*
+	 * For AND and OR, we know that the first value has already
+	 * been converted to an integer.  Thus we need only consider
+	 * the possibility of int vs. double for the second value.
+	 */
+
+	case AND:
+	    if (value2Ptr->type == TYPE_DOUBLE) {
+		value2Ptr->intValue = value2Ptr->doubleValue != 0;
+		value2Ptr->type = TYPE_INT;
+	    }
+	    valuePtr->intValue = valuePtr->intValue && value2Ptr->intValue;
+	    break;
+	case OR:
+	    if (value2Ptr->type == TYPE_DOUBLE) {
+		value2Ptr->intValue = value2Ptr->doubleValue != 0;
+		value2Ptr->type = TYPE_INT;
+	    }
+	    valuePtr->intValue = valuePtr->intValue || value2Ptr->intValue;
+	    break;
+
+	case COLON:
+	    interp->result = "can't have : operator without ? first";
+	    return TCL_ERROR;
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ExprIllegalType --
+ *
+ *	Generate an error message for an operand whose type doesn't
+ *	suit its operator.
+ *
+ * Results:
+ *	Always TCL_ERROR.
+ *
+ * Side effects:
+ *	A message is appended to interp->result.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ExprIllegalType(interp, badType, operator)
+    Tcl_Interp *interp;			/* Interpreter to use for error
+					 * reporting. */
+    int badType;			/* Type of offending operand. */
+    int operator;			/* Operator it was given to. */
+{
+    Tcl_AppendResult(interp, "can't use ", (badType == TYPE_DOUBLE) ?
+	    "floating-point value" : "non-numeric string",
+	    " as operand of \"", operatorStrings[operator], "\"",
+	    (char *) NULL);
+    return TCL_ERROR;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * ExprMakeString --
+ *
+ *	Convert a value from int or double representation to
+ *	a string.
+ *
+ * Results:
+ *	The information at *valuePtr gets converted to string
+ *	format, if it wasn't that way already.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+ExprMakeString(valuePtr)
+    register Value *valuePtr;		/* Value to be converted. */
+{
+    int shortfall;
+
+    shortfall = 150 - (valuePtr->pv.end - valuePtr->pv.buffer);
+    if (shortfall > 0) {
+	(*valuePtr->pv.expandProc)(&valuePtr->pv, shortfall);
+    }
+    if (valuePtr->type == TYPE_INT) {
+	sprintf(valuePtr->pv.buffer, "%ld", valuePtr->intValue);
+    } else if (valuePtr->type == TYPE_DOUBLE) {
+	sprintf(valuePtr->pv.buffer, "%g", valuePtr->doubleValue);
+    }
+    valuePtr->type = TYPE_STRING;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * ExprTopLevel --
+ *
+ *	This procedure provides top-level functionality shared by
+ *	procedures like Tcl_ExprInt, Tcl_ExprDouble, etc.
+ *
+ * Results:
+ *	The result is a standard Tcl return value.  If an error
+ *	occurs then an error message is left in interp->result.
+ *	The value of the expression is returned in *valuePtr, in
+ *	whatever form it ends up in (could be string or integer
+ *	or double).  Caller may need to convert result.  Caller
+ *	is also responsible for freeing string memory in *valuePtr,
+ *	if any was allocated.
+ *
+ * Side effects:
+ *	Expressions evaluated more than once are kept in compiled form
+ *	in the interpreter's expression cache:  the second time an
+ *	expression is seen it is compiled as it is evaluated, and after
+ *	that it is evaluated from the compiled form.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+ExprTopLevel(interp, string, valuePtr)
+    Tcl_Interp *interp;			/* Context in which to evaluate the
+					 * expression. */
+    char *string;			/* Expression to evaluate. */
+    Value *valuePtr;			/* Where to store result.  Should
+					 * not be initialized by caller. */
+{
+    Interp *iPtr = (Interp *) interp;
+    ExprInfo info;
+    ExprCode *codePtr;
+    Tcl_HashEntry *hPtr;
+    int result;
+
+    info.originalExpr = string;
+    info.expr = string;
+    info.codePtr = NULL;
+    info.node = -1;
+    valuePtr->pv.buffer = valuePtr->pv.next = valuePtr->staticSpace;
+    valuePtr->pv.end = valuePtr->pv.buffer + STATIC_STRING_SPACE - 1;
+    valuePtr->pv.expandProc = TclExpandParseValue;
+    valuePtr->pv.clientData = (ClientData) NULL;
+
+    /*
+     * Use the compiled form of the expression if there is one, or
+     * compile it while evaluating it if it's in the cache without
+     * one.  Hold a reference to compiled code while it executes:
+     * commands that it invokes could flush it from the cache.
+     */
+
+    if (!iPtr->noEval) {
+	hPtr = LookupExpr(iPtr, string);
+	if (hPtr != NULL) {
+	    codePtr = (ExprCode *) Tcl_GetHashValue(hPtr);
+	    if (codePtr != NULL) {
+		codePtr->refCount++;
+		result = ExprEvalNode(interp, codePtr, codePtr->root,
+			valuePtr);
+		if (--codePtr->refCount == 0) {
+		    ExprFreeCode(codePtr);
+		}
+		return result;
+	    }
+	    codePtr = (ExprCode *) ckalloc(sizeof(ExprCode));
+	    codePtr->refCount = 1;
+	    codePtr->source = NULL;
+	    codePtr->numNodes = 0;
+	    codePtr->nodeSpace = 8;
+	    codePtr->nodes = (ExprNode *)
+		    ckalloc((unsigned) (8 * sizeof(ExprNode)));
+	    codePtr->root = -1;
+	    info.codePtr = codePtr;
+	}
+    }
+
+    result = ExprGetValue(interp, &info, -1, valuePtr);
+    if ((result == TCL_OK) && (info.token != END)) {
+	Tcl_AppendResult(interp, "syntax error in expression \"",
+		string, "\"", (char *) NULL);
+	result = TCL_ERROR;
+    }
+
+    /*
+     * If the expression was compiled successfully, save it in the
+     * cache (the entry must be found again, since it could have been
+     * flushed during the evaluation).  An expression that got an
+     * error isn't saved:  it will be compiled again next time.
+     */
+
+    codePtr = info.codePtr;
+    if (codePtr != NULL) {
+	if (result == TCL_OK) {
+	    hPtr = Tcl_FindHashEntry(&iPtr->exprTable, string);
+	    if ((hPtr != NULL) && (Tcl_GetHashValue(hPtr) == NULL)) {
+		codePtr->source = (char *) ckalloc((unsigned)
+			(strlen(string) + 1));
+		strcpy(codePtr->source, string);
+		codePtr->root = info.node;
+		Tcl_SetHashValue(hPtr, codePtr);
+		codePtr = NULL;
+	    }
+	}
+	if (codePtr != NULL) {
+	    ExprFreeCode(codePtr);
+	}
+    }
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ExprAddNode --
+ *
+ *	Add a node to the expression being compiled, if any.
+ *
+ * Results:
+ *	The return value is the index of the new node, or -1 if
+ *	the expression isn't being compiled.
+ *
+ * Side effects:
+ *	The node array may be reallocated.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ExprAddNode(infoPtr, op, operand1, operand2, operand3)
+    ExprInfo *infoPtr;			/* Describes the state of the parse. */
+    int op;				/* Operator or kind of value. */
+    int operand1, operand2, operand3;	/* Indices of operand nodes, or
+					 * -1. */
+{
+    register ExprCode *codePtr = infoPtr->codePtr;
+    register ExprNode *nodePtr;
+
+    if (codePtr == NULL) {
+	return -1;
+    }
+    if (codePtr->numNodes == codePtr->nodeSpace) {
+	nodePtr = (ExprNode *) ckalloc((unsigned)
+		(2 * codePtr->nodeSpace * sizeof(ExprNode)));
+	memcpy((VOID *) nodePtr, (VOID *) codePtr->nodes,
+		codePtr->numNodes * sizeof(ExprNode));
+	ckfree((char *) codePtr->nodes);
+	codePtr->nodes = nodePtr;
+	codePtr->nodeSpace *= 2;
+    }
+    nodePtr = &codePtr->nodes[codePtr->numNodes];
+    nodePtr->op = op;
+    nodePtr->operands[0] = operand1;
+    nodePtr->operands[1] = operand2;
+    nodePtr->operands[2] = operand3;
+    nodePtr->type = TYPE_INT;
+    nodePtr->intValue = 0;
+    nodePtr->doubleValue = 0.0;
+    nodePtr->string = NULL;
+    nodePtr->offset = 0;
+    return codePtr->numNodes++;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ExprRecordValue --
+ *
+ *	Called by ExprLex while compiling an expression to add a node
+ *	for the value just parsed.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	A node is added to infoPtr->codePtr, and infoPtr->node is
+ *	set to its index.  Numbers, braced strings, and quoted strings
+ *	without substitutions become constants;  other values are
+ *	recorded so that they can be recomputed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ExprRecordValue(infoPtr, op, start, end, valuePtr)
+    ExprInfo *infoPtr;			/* Describes the state of the parse. */
+    int op;				/* VALUE, VAR_VALUE, CMD_VALUE, or
+					 * QUOTE_VALUE. */
+    char *start;			/* First character of value's text. */
+    char *end;				/* Character just after the text. */
+    Value *valuePtr;			/* Value that was parsed (only
+					 * meaningful for constants). */
+{
+    register ExprNode *nodePtr;
+    register char *p;
+    char *name;
+    int index;
+
+    if (op == QUOTE_VALUE) {
+	for (p = start+1; p < end; p++) {
+	    if ((*p == '$') || (*p == '[')) {
+		break;
+	    }
+	}
+	if (p == end) {
+	    op = VALUE;
+	}
+    }
+    index = ExprAddNode(infoPtr, op, -1, -1, -1);
+    nodePtr = &infoPtr->codePtr->nodes[index];
+    nodePtr->offset = start - infoPtr->originalExpr;
+    name = NULL;
+    p = NULL;
+    switch (op) {
+	case VALUE:
+	    nodePtr->type = valuePtr->type;
+	    nodePtr->intValue = valuePtr->intValue;
+	    nodePtr->doubleValue = valuePtr->doubleValue;
+	    if (valuePtr->type == TYPE_STRING) {
+		name = valuePtr->pv.buffer;
+		p = name + strlen(name);
+	    }
+	    break;
+
+	case VAR_VALUE:
+
+	    /*
+	     * References to scalar variables are common enough to
+	     * look up directly by name.  Anything else is parsed from
+	     * the source each time.
+	     */
+
+	    if (start[1] == '{') {
+		name = start+2;
+		p = end-1;
+	    } else {
+		for (p = start+1; isalnum(*p) || (*p == '_'); p++) {
+		    /* Empty loop body. */
+		}
+		if ((p != start+1) && (*p != '(')) {
+		    name = start+1;
+		}
+	    }
+	    break;
+
+	case CMD_VALUE:
+	    name = start+1;
+	    p = end-1;
+	    break;
+
+	case QUOTE_VALUE:
+	    nodePtr->offset++;
+	    break;
+    }
+    if (name != NULL) {
+	nodePtr->string = (char *) ckalloc((unsigned) (p - name + 1));
+	strncpy(nodePtr->string, name, p - name);
+	nodePtr->string[p - name] = 0;
+    }
+    infoPtr->node = index;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ExprEvalNode --
+ *
+ *	Evaluate part of a compiled expression.  This does just what
+ *	ExprGetValue did when it parsed that part of the expression,
+ *	including short-circuiting of "&&", "||", and "?:".
+ *
+ * Results:
+ *	Same as for ExprGetValue.
+ *
+ * Side effects:
+ *	Depends on the commands in the expression.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ExprEvalNode(interp, codePtr, index, valuePtr)
+    Tcl_Interp *interp;			/* Context in which to evaluate the
+					 * expression. */
+    ExprCode *codePtr;			/* Compiled expression. */
+    int index;				/* Index of node to evaluate. */
+    register Value *valuePtr;		/* Where to store the value.  Caller
+					 * must have initialized pv field. */
+{
+    Interp *iPtr = (Interp *) interp;
+    register ExprNode *nodePtr = &codePtr->nodes[index];
+    Value value2;
+    char *var, *end;
+    Var *varPtr;
+    int result;
+
+    switch (nodePtr->op) {
+	case VALUE:
+	    if (nodePtr->type == TYPE_STRING) {
+		return ExprParseString(interp, nodePtr->string, valuePtr);
+	    }
+	    valuePtr->type = nodePtr->type;
+	    valuePtr->intValue = nodePtr->intValue;
+	    valuePtr->doubleValue = nodePtr->doubleValue;
+	    return TCL_OK;
+
+	case VAR_VALUE:
+	    if (nodePtr->string == NULL) {
+		var = Tcl_ParseVar(interp, codePtr->source + nodePtr->offset,
+			(char **) NULL);
+	    } else if (iPtr->noEval) {
+		var = "";
+	    } else {
+		varPtr = TclGetVar2Ptr(interp, nodePtr->string, (char *) NULL,
+			TCL_LEAVE_ERR_MSG);
+		if (varPtr == NULL) {
+		    return TCL_ERROR;
+		}
+
+		/*
+		 * Use the number cached in the variable if there is one;
+		 * otherwise convert the string and save the number for
+		 * next time.
+		 */
+
+		if (varPtr->repType == VAR_REP_INT) {
+		    valuePtr->type = TYPE_INT;
+		    valuePtr->intValue = varPtr->rep.intValue;
+		    return TCL_OK;
+		} else if (varPtr->repType == VAR_REP_DOUBLE) {
+		    valuePtr->type = TYPE_DOUBLE;
+		    valuePtr->doubleValue = varPtr->rep.doubleValue;
+		    return TCL_OK;
+		}
+		result = ExprParseString(interp, varPtr->value.string,
+			valuePtr);
+		if (result != TCL_OK) {
+		    return result;
+		}
+		if (valuePtr->type == TYPE_INT) {
+		    TclFreeVarRep(varPtr);
+		    varPtr->repType = VAR_REP_INT;
+		    varPtr->rep.intValue = valuePtr->intValue;
+		} else if (valuePtr->type == TYPE_DOUBLE) {
+		    TclFreeVarRep(varPtr);
+		    varPtr->repType = VAR_REP_DOUBLE;
+		    varPtr->rep.doubleValue = valuePtr->doubleValue;
+		}
+		return TCL_OK;
+	    }
+	    if (var == NULL) {
+		return TCL_ERROR;
+	    }
+	    if (iPtr->noEval) {
+		valuePtr->type = TYPE_INT;
+		valuePtr->intValue = 0;
+		return TCL_OK;
+	    }
+	    return ExprParseString(interp, var, valuePtr);
+
+	case CMD_VALUE:
+	    result = Tcl_Eval(interp, nodePtr->string, 0, (char **) NULL);
+	    if (result != TCL_OK) {
+		return result;
+	    }
+	    if (iPtr->noEval) {
+		valuePtr->type = TYPE_INT;
+		valuePtr->intValue = 0;
+		Tcl_ResetResult(interp);
+		return TCL_OK;
+	    }
+	    result = ExprParseString(interp, interp->result, valuePtr);
+	    if (result != TCL_OK) {
+		return result;
+	    }
+	    Tcl_ResetResult(interp);
+	    return TCL_OK;
+
+	case QUOTE_VALUE:
+	    valuePtr->pv.next = valuePtr->pv.buffer;
+	    result = TclParseQuotes(interp, codePtr->source + nodePtr->offset,
+		    '"', 0, &end, &valuePtr->pv);
+	    if (result != TCL_OK) {
+		return result;
+	    }
+	    return ExprParseString(interp, valuePtr->pv.buffer, valuePtr);
+
+	case UNARY_MINUS:
+	case NOT:
+	case BIT_NOT:
+	    result = ExprEvalNode(interp, codePtr, nodePtr->operands[0],
+		    valuePtr);
+	    if (result != TCL_OK) {
+		return result;
+	    }
+	    return ExprApplyUnary(interp, nodePtr->op, valuePtr);
+    }
+
+    /*
+     * Binary operator (or "?:").
+     */
+
+    result = ExprEvalNode(interp, codePtr, nodePtr->operands[0], valuePtr);
+    if (result != TCL_OK) {
+	return result;
+    }
+    value2.pv.buffer = value2.pv.next = value2.staticSpace;
+    value2.pv.end = value2.pv.buffer + STATIC_STRING_SPACE - 1;
+    value2.pv.expandProc = TclExpandParseValue;
+    value2.pv.clientData = (ClientData) NULL;
+    if ((nodePtr->op == AND) || (nodePtr->op == OR)
+	    || (nodePtr->op == QUESTY)) {
+	if (valuePtr->type == TYPE_DOUBLE) {
+	    valuePtr->intValue = valuePtr->doubleValue != 0;
+	    valuePtr->type = TYPE_INT;
+	} else if (valuePtr->type == TYPE_STRING) {
+	    result = ExprIllegalType(interp, TYPE_STRING, nodePtr->op);
+	    goto done;
+	}
+	if (((nodePtr->op == AND) && !valuePtr->intValue)
+		|| ((nodePtr->op == OR) && valuePtr->intValue)) {
+	    iPtr->noEval++;
+	    result = ExprEvalNode(interp, codePtr, nodePtr->operands[1],
+		    &value2);
+	    iPtr->noEval--;
+	} else if (nodePtr->op == QUESTY) {
+	    if (valuePtr->intValue != 0) {
+		valuePtr->pv.next = valuePtr->pv.buffer;
+		result = ExprEvalNode(interp, codePtr, nodePtr->operands[1],
+			valuePtr);
+		if (result != TCL_OK) {
+		    goto done;
+		}
+		iPtr->noEval++;
+		result = ExprEvalNode(interp, codePtr, nodePtr->operands[2],
+			&value2);
+		iPtr->noEval--;
+	    } else {
+		iPtr->noEval++;
+		result = ExprEvalNode(interp, codePtr, nodePtr->operands[1],
+			&value2);
+		iPtr->noEval--;
+		if (result != TCL_OK) {
+		    goto done;
+		}
+		valuePtr->pv.next = valuePtr->pv.buffer;
+		result = ExprEvalNode(interp, codePtr, nodePtr->operands[2],
+			valuePtr);
+	    }
+	    goto done;
+	} else {
+	    result = ExprEvalNode(interp, codePtr, nodePtr->operands[1],
+		    &value2);
+	}
+    } else {
+	result = ExprEvalNode(interp, codePtr, nodePtr->operands[1],
+		&value2);
+    }
+    if (result == TCL_OK) {
+	result = ExprApplyBinary(interp, nodePtr->op, valuePtr, &value2);
+    }
+
+    done:
+    if (value2.pv.buffer != value2.staticSpace) {
+	ckfree(value2.pv.buffer);
+    }
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ExprFreeCode --
+ *
+ *	Free a compiled expression.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	All of the storage for codePtr is released.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ExprFreeCode(codePtr)
+    register ExprCode *codePtr;		/* Compiled expression to free. */
+{
+    int i;
+
+    for (i = 0; i < codePtr->numNodes; i++) {
+	if (codePtr->nodes[i].string != NULL) {
+	    ckfree(codePtr->nodes[i].string);
+	}
+    }
+    ckfree((char *) codePtr->nodes);
+    if (codePtr->source != NULL) {
+	ckfree(codePtr->source);
+    }
+    ckfree((char *) codePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LookupExpr --
+ *
+ *	Find an expression in an interpreter's expression cache.
+ *
+ * Results:
+ *	The return value is the cache entry for the expression, whose
+ *	value is the compiled form of the expression or NULL if it
+ *	hasn't been compiled yet.  NULL is returned if the expression
+ *	isn't in the cache.
+ *
+ * Side effects:
+ *	The expression is entered in the cache if this is the second
+ *	time it has been seen.  Other entries may be flushed to make
+ *	room.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_HashEntry *
+LookupExpr(iPtr, string)
+    register Interp *iPtr;	/* Interpreter whose cache is to be used. */
+    char *string;		/* Text of expression. */
+{
+    Tcl_HashEntry *hPtr;
+    register char *p;
+    unsigned int hash;
+    int new, i;
+
+    i = RECENT_INDEX(string);
+    if ((iPtr->recentExprText[i] == string) && (strcmp(string,
+	    Tcl_GetHashKey(&iPtr->exprTable, iPtr->recentExprs[i])) == 0)) {
+	return iPtr->recentExprs[i];
+    }
+    hash = 0;
+    for (p = string; *p != 0; p++) {
+	hash += (hash << 3) + *p;
+    }
+    if ((p - string) > MAX_CACHED_EXPR_LENGTH) {
+	return NULL;
+    }
+    hPtr = Tcl_FindHashEntry(&iPtr->exprTable, string);
+    if (hPtr == NULL) {
+
+	/*
+	 * Expressions are often built by substitution ("expr $i*2"),
+	 * so most texts are never seen again.  Rather than filling the
+	 * cache with them, just remember a hash of each new text, and
+	 * enter the text in the cache when it turns up a second time.
+	 */
+
+	if (iPtr->seenExprs[hash % NUM_RECENT_SCRIPTS] != hash) {
+	    iPtr->seenExprs[hash % NUM_RECENT_SCRIPTS] = hash;
+	    return NULL;
+	}
+	if (iPtr->exprTable.numEntries >= MAX_CACHED_EXPRS) {
+	    TclFlushExprs(iPtr);
+	}
+	hPtr = Tcl_CreateHashEntry(&iPtr->exprTable, string, &new);
+	Tcl_SetHashValue(hPtr, NULL);
+    }
+    iPtr->recentExprText[i] = string;
+    iPtr->recentExprs[i] = hPtr;
+    return hPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclFlushExprs --
+ *
+ *	Empty an interpreter's expression cache.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	All entries are removed from the cache, and compiled
+ *	expressions that aren't being evaluated are freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclFlushExprs(iPtr)
+    register Interp *iPtr;	/* Interpreter whose cache is to be
+				 * flushed. */
+{
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    register ExprCode *codePtr;
+    int i;
+
+    for (i = 0; i < NUM_RECENT_SCRIPTS; i++) {
+	iPtr->recentExprText[i] = NULL;
+    }
+    for (hPtr = Tcl_FirstHashEntry(&iPtr->exprTable, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	codePtr = (ExprCode *) Tcl_GetHashValue(hPtr);
+	if ((codePtr != NULL) && (--codePtr->refCount == 0)) {
+	    ExprFreeCode(codePtr);
+	}
+	Tcl_DeleteHashEntry(hPtr);
+    }
+}
 
-    result = ExprGetValue(interp, &info, -1, valuePtr);
-    if (result != TCL_OK) {
-	return result;
-    }
-    if (info.token != END) {
-	Tcl_AppendResult(interp, "syntax error in expression \"",
-		string, "\"", (char *) NULL);
-	return TCL_ERROR;
-    }
-    return TCL_OK;
-}
-
 /*
  *--------------------------------------------------------------
  *
@@ -43,6 +43,36 @@ extern void panic();
 #define RANDOM_INDEX(tablePtr, i) \
     (((((long) (i))*1103515245) >> (tablePtr)->downShift) & (tablePtr)->mask)
 
+/*
+ * Parameters for tables that use open addressing:  the number of slots
+ * in a new table (must be a power of two), and the number of old slots
+ * whose entries are moved to the new slot array each time an entry is
+ * created while the table is being enlarged.  A table is enlarged when
+ * three quarters of its slots are in use, so the move is always
+ * finished well before the new array fills up.
+ */
+
+#define OPEN_INITIAL_SIZE	8
+#define MOVE_STEP		8
+
+/*
+ * Slots whose entries have been deleted point to the entry below, so
+ * that searches for other keys continue past them.
+ */
+
+static Tcl_HashEntry deletedEntry;
+#define DELETED_ENTRY	(&deletedEntry)
+
+/*
+ * The following macro mixes one word of a key into a hash value in
+ * HashKey.  All arithmetic is done modulo 2^32, so that hash values
+ * are the same whatever the size of a long.
+ */
+
+#define MIX_WORD(hash, word) \
+    ((hash) = ((((hash) ^ (word)) * 0x9e3779b1UL) & 0xffffffffUL), \
+    (hash) ^= (hash) >> 15)
+
 /*
  * Procedure prototypes for static procedures in this file:
  */
@@ -55,7 +85,24 @@ static Tcl_HashEntry *	BogusFind _ANSI_ARGS_((Tcl_HashTable *tablePtr,
 			    char *key));
 static Tcl_HashEntry *	BogusCreate _ANSI_ARGS_((Tcl_HashTable *tablePtr,
 			    char *key, int *newPtr));
+static int		EntrySize _ANSI_ARGS_((Tcl_HashTable *tablePtr,
+			    Tcl_HashEntry *hPtr));
+static void		EnlargeOpenTable _ANSI_ARGS_((
+			    Tcl_HashTable *tablePtr));
+static unsigned long	HashKey _ANSI_ARGS_((Tcl_HashTable *tablePtr,
+			    char *key));
 static unsigned int	HashString _ANSI_ARGS_((char *string));
+static void		MoveOldSlots _ANSI_ARGS_((Tcl_HashTable *tablePtr,
+			    int count));
+static Tcl_HashEntry *	OpenCreate _ANSI_ARGS_((Tcl_HashTable *tablePtr,
+			    char *key, int *newPtr));
+static void		OpenDelete _ANSI_ARGS_((Tcl_HashTable *tablePtr,
+			    Tcl_HashEntry *entryPtr));
+static Tcl_HashEntry *	OpenFind _ANSI_ARGS_((Tcl_HashTable *tablePtr,
+			    char *key));
+static Tcl_HashSlot *	OpenLookup _ANSI_ARGS_((Tcl_HashTable *tablePtr,
+			    Tcl_HashSlot *slots, int mask, unsigned long hash,
+			    char *key, Tcl_HashSlot **freePtrPtr));
 static void		RebuildTable _ANSI_ARGS_((Tcl_HashTable *tablePtr));
 static Tcl_HashEntry *	StringFind _ANSI_ARGS_((Tcl_HashTable *tablePtr,
 			    char *key));
@@ -79,7 +126,8 @@ static Tcl_HashEntry *	OneWordCreate _ANSI_ARGS_((Tcl_HashTable *tablePtr,
  *
  * Side effects:
  *	TablePtr is now ready to be passed to Tcl_FindHashEntry and
- *	Tcl_CreateHashEntry.
+ *	Tcl_CreateHashEntry.  If keyType includes TCL_OPEN_HASH, the
+ *	table's initial slot array is allocated.
  *
  *----------------------------------------------------------------------
  */
@@ -90,8 +138,29 @@ Tcl_InitHashTable(tablePtr, keyType)
 					 * is supplied by the caller. */
     int keyType;			/* Type of keys to use in table:
 					 * TCL_STRING_KEYS, TCL_ONE_WORD_KEYS,
-					 * or an integer >= 2. */
+					 * or an integer >= 2, possibly or-ed
+					 * with TCL_OPEN_HASH. */
 {
+    tablePtr->numRebuilds = 0;
+    tablePtr->numLookups = tablePtr->numProbes = 0;
+    tablePtr->slots = tablePtr->oldSlots = NULL;
+    tablePtr->numUsed = tablePtr->numOldSlots = tablePtr->nextOld = 0;
+    if (keyType & TCL_OPEN_HASH) {
+	tablePtr->buckets = NULL;
+	tablePtr->numBuckets = OPEN_INITIAL_SIZE;
+	tablePtr->numEntries = 0;
+	tablePtr->rebuildSize = OPEN_INITIAL_SIZE - OPEN_INITIAL_SIZE/4;
+	tablePtr->downShift = 0;
+	tablePtr->mask = OPEN_INITIAL_SIZE - 1;
+	tablePtr->keyType = keyType & ~TCL_OPEN_HASH;
+	tablePtr->slots = (Tcl_HashSlot *) ckalloc((unsigned)
+		(OPEN_INITIAL_SIZE * sizeof(Tcl_HashSlot)));
+	memset((VOID *) tablePtr->slots, 0,
+		OPEN_INITIAL_SIZE * sizeof(Tcl_HashSlot));
+	tablePtr->findProc = OpenFind;
+	tablePtr->createProc = OpenCreate;
+	return;
+    }
     tablePtr->buckets = tablePtr->staticBuckets;
     tablePtr->staticBuckets[0] = tablePtr->staticBuckets[1] = 0;
     tablePtr->staticBuckets[2] = tablePtr->staticBuckets[3] = 0;
@@ -138,7 +207,9 @@ Tcl_DeleteHashEntry(entryPtr)
 {
     register Tcl_HashEntry *prevPtr;
 
-    if (*entryPtr->bucketPtr == entryPtr) {
+    if (entryPtr->tablePtr->slots != NULL) {
+	OpenDelete(entryPtr->tablePtr, entryPtr);
+    } else if (*entryPtr->bucketPtr == entryPtr) {
 	*entryPtr->bucketPtr = entryPtr->nextPtr;
     } else {
 	for (prevPtr = *entryPtr->bucketPtr; ; prevPtr = prevPtr->nextPtr) {
@@ -183,6 +254,33 @@ Tcl_DeleteHashTable(tablePtr)
      * Free up all the entries in the table.
      */
 
+    if (tablePtr->slots != NULL) {
+	register Tcl_HashSlot *slotPtr;
+
+	for (i = 0, slotPtr = tablePtr->oldSlots; i < tablePtr->numOldSlots;
+		i++, slotPtr++) {
+	    if ((slotPtr->entryPtr != NULL)
+		    && (slotPtr->entryPtr != DELETED_ENTRY)) {
+		ckfree((char *) slotPtr->entryPtr);
+	    }
+	}
+	for (i = 0, slotPtr = tablePtr->slots; i < tablePtr->numBuckets;
+		i++, slotPtr++) {
+	    if ((slotPtr->entryPtr != NULL)
+		    && (slotPtr->entryPtr != DELETED_ENTRY)) {
+		ckfree((char *) slotPtr->entryPtr);
+	    }
+	}
+	if (tablePtr->oldSlots != NULL) {
+	    ckfree((char *) tablePtr->oldSlots);
+	}
+	ckfree((char *) tablePtr->slots);
+	tablePtr->slots = tablePtr->oldSlots = NULL;
+	tablePtr->numBuckets = tablePtr->numOldSlots = 0;
+	tablePtr->findProc = BogusFind;
+	tablePtr->createProc = BogusCreate;
+	return;
+    }
     for (i = 0; i < tablePtr->numBuckets; i++) {
 	hPtr = tablePtr->buckets[i];
 	while (hPtr != NULL) {
@@ -270,6 +368,32 @@ Tcl_NextHashEntry(searchPtr)
 					 * Tcl_FirstHashEntry. */
 {
     Tcl_HashEntry *hPtr;
+    register Tcl_HashTable *tablePtr = searchPtr->tablePtr;
+
+    /*
+     * For tables that use open addressing, nextIndex runs through the
+     * old slots (if the table is being enlarged) and then the current
+     * ones.
+     */
+
+    if (tablePtr->slots != NULL) {
+	int index;
+
+	while (1) {
+	    index = searchPtr->nextIndex;
+	    if (index < tablePtr->numOldSlots) {
+		hPtr = tablePtr->oldSlots[index].entryPtr;
+	    } else if (index - tablePtr->numOldSlots < tablePtr->numBuckets) {
+		hPtr = tablePtr->slots[index - tablePtr->numOldSlots].entryPtr;
+	    } else {
+		return NULL;
+	    }
+	    searchPtr->nextIndex++;
+	    if ((hPtr != NULL) && (hPtr != DELETED_ENTRY)) {
+		return hPtr;
+	    }
+	}
+    }
 
     while (searchPtr->nextEntryPtr == NULL) {
 	if (searchPtr->nextIndex >= searchPtr->tablePtr->numBuckets) {
@@ -290,7 +414,8 @@ Tcl_NextHashEntry(searchPtr)
  * Tcl_HashStats --
  *
  *	Return statistics describing the layout of the hash table
- *	in its hash buckets.
+ *	in its hash buckets (or slots), the storage it occupies, and
+ *	the work done by lookups in it so far.
  *
  * Results:
  *	The return value is a malloc-ed string containing information
@@ -310,51 +435,152 @@ Tcl_HashStats(tablePtr)
 #define NUM_COUNTERS 10
     int count[NUM_COUNTERS], overflow, i, j;
     double average, tmp;
+    long bytes;
     register Tcl_HashEntry *hPtr;
     char *result, *p;
 
-    /*
-     * Compute a histogram of bucket usage.
-     */
-
     for (i = 0; i < NUM_COUNTERS; i++) {
 	count[i] = 0;
     }
     overflow = 0;
     average = 0.0;
-    for (i = 0; i < tablePtr->numBuckets; i++) {
-	j = 0;
-	for (hPtr = tablePtr->buckets[i]; hPtr != NULL; hPtr = hPtr->nextPtr) {
-	    j++;
+    bytes = 0;
+    result = (char *) ckalloc((unsigned) ((NUM_COUNTERS*60) + 500));
+
+    if (tablePtr->slots != NULL) {
+	Tcl_HashSlot *slots = tablePtr->oldSlots;
+	int numSlots = tablePtr->numOldSlots;
+	int pass;
+
+	/*
+	 * For tables that use open addressing, compute a histogram of
+	 * how far each entry is from the slot its hash value selects.
+	 */
+
+	for (pass = 0; pass < 2; pass++) {
+	    for (i = 0; i < numSlots; i++) {
+		hPtr = slots[i].entryPtr;
+		if ((hPtr == NULL) || (hPtr == DELETED_ENTRY)) {
+		    continue;
+		}
+		j = (i - (int) (slots[i].hash & (numSlots - 1)))
+			& (numSlots - 1);
+		if (j < NUM_COUNTERS) {
+		    count[j]++;
+		} else {
+		    overflow++;
+		}
+		average += j + 1;
+		bytes += EntrySize(tablePtr, hPtr);
+	    }
+	    slots = tablePtr->slots;
+	    numSlots = tablePtr->numBuckets;
 	}
-	if (j < NUM_COUNTERS) {
-	    count[j]++;
-	} else {
-	    overflow++;
+	if (tablePtr->numEntries > 0) {
+	    average /= tablePtr->numEntries;
+	}
+	bytes += (long) (tablePtr->numBuckets + tablePtr->numOldSlots)
+		* sizeof(Tcl_HashSlot);
+
+	sprintf(result, "%d entries in table, %d slots (%d used)",
+		tablePtr->numEntries, tablePtr->numBuckets, tablePtr->numUsed);
+	p = result + strlen(result);
+	if (tablePtr->oldSlots != NULL) {
+	    sprintf(p, ", %d old slots", tablePtr->numOldSlots);
+	    p += strlen(p);
+	}
+	*p = '\n';
+	p++;
+	for (i = 0; i < NUM_COUNTERS; i++) {
+	    sprintf(p, "number of entries %d slots from home: %d\n",
+		    i, count[i]);
+	    p += strlen(p);
+	}
+	sprintf(p, "number of entries %d or more slots from home: %d\n",
+		NUM_COUNTERS, overflow);
+	p += strlen(p);
+    } else {
+	/*
+	 * Compute a histogram of bucket usage.
+	 */
+
+	for (i = 0; i < tablePtr->numBuckets; i++) {
+	    j = 0;
+	    for (hPtr = tablePtr->buckets[i]; hPtr != NULL;
+		    hPtr = hPtr->nextPtr) {
+		j++;
+		bytes += EntrySize(tablePtr, hPtr);
+	    }
+	    if (j < NUM_COUNTERS) {
+		count[j]++;
+	    } else {
+		overflow++;
+	    }
+	    tmp = j;
+	    average += (tmp+1.0)*(tmp/tablePtr->numEntries)/2.0;
+	}
+	if (tablePtr->buckets != tablePtr->staticBuckets) {
+	    bytes += (long) tablePtr->numBuckets * sizeof(Tcl_HashEntry *);
 	}
-	tmp = j;
-	average += (tmp+1.0)*(tmp/tablePtr->numEntries)/2.0;
-    }
-
-    /*
-     * Print out the histogram and a few other pieces of information.
-     */
 
-    result = (char *) ckalloc((unsigned) ((NUM_COUNTERS*60) + 300));
-    sprintf(result, "%d entries in table, %d buckets\n",
-	    tablePtr->numEntries, tablePtr->numBuckets);
-    p = result + strlen(result);
-    for (i = 0; i < NUM_COUNTERS; i++) {
-	sprintf(p, "number of buckets with %d entries: %d\n",
-		i, count[i]);
+	/*
+	 * Print out the histogram and a few other pieces of information.
+	 */
+
+	sprintf(result, "%d entries in table, %d buckets\n",
+		tablePtr->numEntries, tablePtr->numBuckets);
+	p = result + strlen(result);
+	for (i = 0; i < NUM_COUNTERS; i++) {
+	    sprintf(p, "number of buckets with %d entries: %d\n",
+		    i, count[i]);
+	    p += strlen(p);
+	}
+	sprintf(p, "number of buckets with more %d or more entries: %d\n",
+		NUM_COUNTERS, overflow);
 	p += strlen(p);
     }
-    sprintf(p, "number of buckets with more %d or more entries: %d\n",
-	    NUM_COUNTERS, overflow);
+    sprintf(p, "number of rebuilds: %d\n", tablePtr->numRebuilds);
+    p += strlen(p);
+    sprintf(p, "number of lookups: %ld\n", tablePtr->numLookups);
+    p += strlen(p);
+    sprintf(p, "number of entries examined: %ld\n", tablePtr->numProbes);
+    p += strlen(p);
+    sprintf(p, "bytes allocated for buckets and entries: %ld\n", bytes);
     p += strlen(p);
     sprintf(p, "average search distance for entry: %.1f", average);
     return result;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EntrySize --
+ *
+ *	Compute how much storage was allocated for a hash table entry.
+ *
+ * Results:
+ *	The return value is the number of bytes that were passed to
+ *	ckalloc when the entry was created.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+EntrySize(tablePtr, hPtr)
+    Tcl_HashTable *tablePtr;	/* Table containing entry. */
+    Tcl_HashEntry *hPtr;	/* Entry whose size is wanted. */
+{
+    if (tablePtr->keyType == TCL_STRING_KEYS) {
+	return sizeof(Tcl_HashEntry) + strlen(hPtr->key.string)
+		- (sizeof(hPtr->key) -1);
+    } else if (tablePtr->keyType == TCL_ONE_WORD_KEYS) {
+	return sizeof(Tcl_HashEntry);
+    }
+    return sizeof(Tcl_HashEntry) + (tablePtr->keyType*sizeof(int)) - 4;
+}
 
 /*
  *----------------------------------------------------------------------
@@ -434,16 +660,22 @@ StringFind(tablePtr, key)
 {
     register Tcl_HashEntry *hPtr;
     register char *p1, *p2;
-    int index;
+    unsigned int hash;
 
-    index = HashString(key) & tablePtr->mask;
+    tablePtr->numLookups++;
+    hash = HashString(key);
 
     /*
-     * Search all of the entries in the appropriate bucket.
+     * Search all of the entries in the appropriate bucket.  Only
+     * compare the keys of entries whose hash values match.
      */
 
-    for (hPtr = tablePtr->buckets[index]; hPtr != NULL;
+    for (hPtr = tablePtr->buckets[hash & tablePtr->mask]; hPtr != NULL;
 	    hPtr = hPtr->nextPtr) {
+	tablePtr->numProbes++;
+	if (hPtr->hash != hash) {
+	    continue;
+	}
 	for (p1 = key, p2 = hPtr->key.string; ; p1++, p2++) {
 	    if (*p1 != *p2) {
 		break;
@@ -487,9 +719,12 @@ StringCreate(tablePtr, key, newPtr)
 {
     register Tcl_HashEntry *hPtr;
     register char *p1, *p2;
+    unsigned int hash;
     int index;
 
-    index = HashString(key) & tablePtr->mask;
+    tablePtr->numLookups++;
+    hash = HashString(key);
+    index = hash & tablePtr->mask;
 
     /*
      * Search all of the entries in this bucket.
@@ -497,6 +732,10 @@ StringCreate(tablePtr, key, newPtr)
 
     for (hPtr = tablePtr->buckets[index]; hPtr != NULL;
 	    hPtr = hPtr->nextPtr) {
+	tablePtr->numProbes++;
+	if (hPtr->hash != hash) {
+	    continue;
+	}
 	for (p1 = key, p2 = hPtr->key.string; ; p1++, p2++) {
 	    if (*p1 != *p2) {
 		break;
@@ -519,6 +758,7 @@ StringCreate(tablePtr, key, newPtr)
     hPtr->bucketPtr = &(tablePtr->buckets[index]);
     hPtr->nextPtr = *hPtr->bucketPtr;
     hPtr->clientData = 0;
+    hPtr->hash = hash;
     strcpy(hPtr->key.string, key);
     *hPtr->bucketPtr = hPtr;
     tablePtr->numEntries++;
@@ -560,6 +800,7 @@ OneWordFind(tablePtr, key)
     register Tcl_HashEntry *hPtr;
     int index;
 
+    tablePtr->numLookups++;
     index = RANDOM_INDEX(tablePtr, key);
 
     /*
@@ -568,6 +809,7 @@ OneWordFind(tablePtr, key)
 
     for (hPtr = tablePtr->buckets[index]; hPtr != NULL;
 	    hPtr = hPtr->nextPtr) {
+	tablePtr->numProbes++;
 	if (hPtr->key.oneWordValue == key) {
 	    return hPtr;
 	}
@@ -607,6 +849,7 @@ OneWordCreate(tablePtr, key, newPtr)
     register Tcl_HashEntry *hPtr;
     int index;
 
+    tablePtr->numLookups++;
     index = RANDOM_INDEX(tablePtr, key);
 
     /*
@@ -615,6 +858,7 @@ OneWordCreate(tablePtr, key, newPtr)
 
     for (hPtr = tablePtr->buckets[index]; hPtr != NULL;
 	    hPtr = hPtr->nextPtr) {
+	tablePtr->numProbes++;
 	if (hPtr->key.oneWordValue == key) {
 	    *newPtr = 0;
 	    return hPtr;
@@ -674,6 +918,7 @@ ArrayFind(tablePtr, key)
     register int *iPtr1, *iPtr2;
     int index, count;
 
+    tablePtr->numLookups++;
     for (index = 0, count = tablePtr->keyType, iPtr1 = arrayPtr;
 	    count > 0; count--, iPtr1++) {
 	index += *iPtr1;
@@ -686,6 +931,7 @@ ArrayFind(tablePtr, key)
 
     for (hPtr = tablePtr->buckets[index]; hPtr != NULL;
 	    hPtr = hPtr->nextPtr) {
+	tablePtr->numProbes++;
 	for (iPtr1 = arrayPtr, iPtr2 = hPtr->key.words,
 		count = tablePtr->keyType; ; count--, iPtr1++, iPtr2++) {
 	    if (count == 0) {
@@ -733,6 +979,7 @@ ArrayCreate(tablePtr, key, newPtr)
     register int *iPtr1, *iPtr2;
     int index, count;
 
+    tablePtr->numLookups++;
     for (index = 0, count = tablePtr->keyType, iPtr1 = arrayPtr;
 	    count > 0; count--, iPtr1++) {
 	index += *iPtr1;
@@ -745,6 +992,7 @@ ArrayCreate(tablePtr, key, newPtr)
 
     for (hPtr = tablePtr->buckets[index]; hPtr != NULL;
 	    hPtr = hPtr->nextPtr) {
+	tablePtr->numProbes++;
 	for (iPtr1 = arrayPtr, iPtr2 = hPtr->key.words,
 		count = tablePtr->keyType; ; count--, iPtr1++, iPtr2++) {
 	    if (count == 0) {
@@ -786,6 +1034,446 @@ ArrayCreate(tablePtr, key, newPtr)
     return hPtr;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * HashKey --
+ *
+ *	Compute the full hash value of a key in a table that uses open
+ *	addressing.  Unlike HashString, this function mixes every bit
+ *	of the key into every bit of the result, because the slot is
+ *	selected from the low-order bits and neighboring slots are
+ *	searched linearly, so clusters of similar keys would be costly.
+ *	String keys are consumed four characters at a time.
+ *
+ * Results:
+ *	The return value is a 32-bit hash value for key.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static unsigned long
+HashKey(tablePtr, key)
+    Tcl_HashTable *tablePtr;	/* Table whose key type applies. */
+    char *key;			/* Key to hash. */
+{
+    register unsigned long hash, word;
+
+    hash = 0;
+    if (tablePtr->keyType == TCL_STRING_KEYS) {
+	register unsigned char *p = (unsigned char *) key;
+	register unsigned int c;
+
+	while ((c = p[0]) != 0) {
+	    word = c;
+	    if ((c = p[1]) != 0) {
+		word |= c << 8;
+		if ((c = p[2]) != 0) {
+		    word |= ((unsigned long) c) << 16;
+		    if ((c = p[3]) != 0) {
+			word |= ((unsigned long) c) << 24;
+			MIX_WORD(hash, word);
+			p += 4;
+			continue;
+		    }
+		}
+	    }
+	    MIX_WORD(hash, word);
+	    break;
+	}
+    } else if (tablePtr->keyType == TCL_ONE_WORD_KEYS) {
+	word = (unsigned long) key;
+	MIX_WORD(hash, word ^ ((word >> 16) >> 16));
+    } else {
+	register int *wordPtr = (int *) key;
+	int count;
+
+	for (count = tablePtr->keyType; count > 0; count--, wordPtr++) {
+	    MIX_WORD(hash, (unsigned long) *wordPtr);
+	}
+    }
+    hash ^= hash >> 16;
+    hash = (hash * 0x85ebca6bUL) & 0xffffffffUL;
+    hash ^= hash >> 13;
+    hash = (hash * 0xc2b2ae35UL) & 0xffffffffUL;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * OpenLookup --
+ *
+ *	Search one slot array of a table that uses open addressing for
+ *	the entry with a given key.
+ *
+ * Results:
+ *	The return value is the slot holding the matching entry, or NULL
+ *	if there is none.  If freePtrPtr isn't NULL and no match was
+ *	found, *freePtrPtr is set to the first slot along the way that
+ *	could hold the key (either a deleted entry or the empty slot
+ *	that ended the search).
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_HashSlot *
+OpenLookup(tablePtr, slots, mask, hash, key, freePtrPtr)
+    Tcl_HashTable *tablePtr;	/* Table whose key type applies. */
+    Tcl_HashSlot *slots;	/* Slot array to search. */
+    int mask;			/* Number of slots, minus one. */
+    unsigned long hash;		/* Result of HashKey for key. */
+    char *key;			/* Key to look for. */
+    Tcl_HashSlot **freePtrPtr;	/* If not NULL, where to store a slot
+				 * for key if it isn't found. */
+{
+    register Tcl_HashSlot *slotPtr;
+    register Tcl_HashEntry *hPtr;
+    Tcl_HashSlot *freePtr = NULL;
+    int index;
+
+    for (index = (int) (hash & mask); ; index = (index + 1) & mask) {
+	tablePtr->numProbes++;
+	slotPtr = &slots[index];
+	hPtr = slotPtr->entryPtr;
+	if (hPtr == NULL) {
+	    break;
+	}
+	if (hPtr == DELETED_ENTRY) {
+	    if (freePtr == NULL) {
+		freePtr = slotPtr;
+	    }
+	    continue;
+	}
+	if (slotPtr->hash != hash) {
+	    continue;
+	}
+	if (tablePtr->keyType == TCL_STRING_KEYS) {
+	    register char *p1, *p2;
+
+	    for (p1 = key, p2 = hPtr->key.string; *p1 == *p2; p1++, p2++) {
+		if (*p1 == '\0') {
+		    return slotPtr;
+		}
+	    }
+	} else if (tablePtr->keyType == TCL_ONE_WORD_KEYS) {
+	    if (hPtr->key.oneWordValue == key) {
+		return slotPtr;
+	    }
+	} else {
+	    register int *iPtr1, *iPtr2;
+	    int count;
+
+	    for (iPtr1 = (int *) key, iPtr2 = hPtr->key.words,
+		    count = tablePtr->keyType; ; count--, iPtr1++, iPtr2++) {
+		if (count == 0) {
+		    return slotPtr;
+		}
+		if (*iPtr1 != *iPtr2) {
+		    break;
+		}
+	    }
+	}
+    }
+    if (freePtrPtr != NULL) {
+	*freePtrPtr = (freePtr != NULL) ? freePtr : slotPtr;
+    }
+    return NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * OpenFind --
+ *
+ *	Given a hash table that uses open addressing, and a key, find
+ *	the entry with a matching key.
+ *
+ * Results:
+ *	The return value is a token for the matching entry in the
+ *	hash table, or NULL if there was no matching entry.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_HashEntry *
+OpenFind(tablePtr, key)
+    Tcl_HashTable *tablePtr;	/* Table in which to lookup entry. */
+    char *key;			/* Key to use to find matching entry. */
+{
+    register Tcl_HashSlot *slotPtr;
+    unsigned long hash;
+
+    tablePtr->numLookups++;
+    hash = HashKey(tablePtr, key);
+    slotPtr = OpenLookup(tablePtr, tablePtr->slots, tablePtr->mask, hash,
+	    key, (Tcl_HashSlot **) NULL);
+    if ((slotPtr == NULL) && (tablePtr->oldSlots != NULL)) {
+	slotPtr = OpenLookup(tablePtr, tablePtr->oldSlots,
+		tablePtr->numOldSlots - 1, hash, key, (Tcl_HashSlot **) NULL);
+    }
+    if (slotPtr == NULL) {
+	return NULL;
+    }
+    return slotPtr->entryPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * OpenCreate --
+ *
+ *	Given a hash table that uses open addressing, and a key, find
+ *	the entry with a matching key.  If there is no matching entry,
+ *	then create a new entry that does match.
+ *
+ * Results:
+ *	The return value is a pointer to the matching entry.  If this
+ *	is a newly-created entry, then *newPtr will be set to a non-zero
+ *	value;  otherwise *newPtr will be set to 0.  If this is a new
+ *	entry the value stored in the entry will initially be 0.
+ *
+ * Side effects:
+ *	A new entry may be added to the hash table.  If the table is
+ *	being enlarged, a few more of the old entries are moved to the
+ *	new slot array.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_HashEntry *
+OpenCreate(tablePtr, key, newPtr)
+    Tcl_HashTable *tablePtr;	/* Table in which to lookup entry. */
+    char *key;			/* Key to use to find or create matching
+				 * entry. */
+    int *newPtr;		/* Store info here telling whether a new
+				 * entry was created. */
+{
+    register Tcl_HashEntry *hPtr;
+    Tcl_HashSlot *slotPtr, *freePtr;
+    unsigned long hash;
+
+    tablePtr->numLookups++;
+    hash = HashKey(tablePtr, key);
+    slotPtr = OpenLookup(tablePtr, tablePtr->slots, tablePtr->mask, hash,
+	    key, &freePtr);
+    if ((slotPtr == NULL) && (tablePtr->oldSlots != NULL)) {
+	slotPtr = OpenLookup(tablePtr, tablePtr->oldSlots,
+		tablePtr->numOldSlots - 1, hash, key, (Tcl_HashSlot **) NULL);
+    }
+    if (slotPtr != NULL) {
+	*newPtr = 0;
+	return slotPtr->entryPtr;
+    }
+
+    /*
+     * Entry not found.  Make a new one and put it in the free slot
+     * found while searching the current slot array.
+     */
+
+    *newPtr = 1;
+    if (tablePtr->keyType == TCL_STRING_KEYS) {
+	hPtr = (Tcl_HashEntry *) ckalloc((unsigned) (sizeof(Tcl_HashEntry)
+		+ strlen(key) - (sizeof(hPtr->key) -1)));
+	strcpy(hPtr->key.string, key);
+    } else if (tablePtr->keyType == TCL_ONE_WORD_KEYS) {
+	hPtr = (Tcl_HashEntry *) ckalloc(sizeof(Tcl_HashEntry));
+	hPtr->key.oneWordValue = key;
+    } else {
+	hPtr = (Tcl_HashEntry *) ckalloc((unsigned) (sizeof(Tcl_HashEntry)
+		+ (tablePtr->keyType*sizeof(int)) - 4));
+	memcpy((VOID *) hPtr->key.words, (VOID *) key,
+		tablePtr->keyType*sizeof(int));
+    }
+    hPtr->tablePtr = tablePtr;
+    hPtr->bucketPtr = NULL;
+    hPtr->nextPtr = NULL;
+    hPtr->clientData = 0;
+    hPtr->hash = hash;
+    if (freePtr->entryPtr == NULL) {
+	tablePtr->numUsed++;
+    }
+    freePtr->hash = hash;
+    freePtr->entryPtr = hPtr;
+    tablePtr->numEntries++;
+
+    if (tablePtr->oldSlots != NULL) {
+	MoveOldSlots(tablePtr, MOVE_STEP);
+    }
+    if (tablePtr->numUsed >= tablePtr->rebuildSize) {
+	EnlargeOpenTable(tablePtr);
+    }
+    return hPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * OpenDelete --
+ *
+ *	Remove an entry from a hash table that uses open addressing.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The entry's slot is marked as deleted, or as empty if that
+ *	doesn't break the search for any other key.  The entry itself
+ *	is not freed.  No other entry changes slots, so it's safe to
+ *	delete entries during a search of the table.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+OpenDelete(tablePtr, entryPtr)
+    register Tcl_HashTable *tablePtr;	/* Table containing entryPtr. */
+    Tcl_HashEntry *entryPtr;		/* Entry to remove. */
+{
+    Tcl_HashSlot *slots;
+    unsigned long hash;
+    int mask, index, pass;
+
+    hash = entryPtr->hash;
+    slots = tablePtr->slots;
+    mask = tablePtr->mask;
+    for (pass = 0; ; pass++) {
+	for (index = (int) (hash & mask); slots[index].entryPtr != NULL;
+		index = (index + 1) & mask) {
+	    if (slots[index].entryPtr != entryPtr) {
+		continue;
+	    }
+	    if (slots[(index + 1) & mask].entryPtr == NULL) {
+		slots[index].entryPtr = NULL;
+		if (slots == tablePtr->slots) {
+		    tablePtr->numUsed--;
+		}
+	    } else {
+		slots[index].entryPtr = DELETED_ENTRY;
+	    }
+	    return;
+	}
+	if ((pass > 0) || (tablePtr->oldSlots == NULL)) {
+	    panic("malformed slot array in Tcl_DeleteHashEntry");
+	}
+	slots = tablePtr->oldSlots;
+	mask = tablePtr->numOldSlots - 1;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * EnlargeOpenTable --
+ *
+ *	This procedure is invoked when too many of the slots of a table
+ *	that uses open addressing are in use.  It allocates a new slot
+ *	array, twice as large unless most of the used slots hold deleted
+ *	entries, and arranges for the entries to be moved to it a few
+ *	at a time.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Any enlargement already in progress is completed, and a new
+ *	one is started.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+EnlargeOpenTable(tablePtr)
+    register Tcl_HashTable *tablePtr;	/* Table to enlarge. */
+{
+    int newSize;
+
+    if (tablePtr->oldSlots != NULL) {
+	MoveOldSlots(tablePtr, tablePtr->numOldSlots);
+    }
+    newSize = tablePtr->numBuckets;
+    if (tablePtr->numEntries*2 >= newSize) {
+	newSize *= 2;
+    }
+    tablePtr->numRebuilds++;
+    tablePtr->oldSlots = tablePtr->slots;
+    tablePtr->numOldSlots = tablePtr->numBuckets;
+    tablePtr->nextOld = 0;
+    tablePtr->slots = (Tcl_HashSlot *) ckalloc((unsigned)
+	    (newSize * sizeof(Tcl_HashSlot)));
+    memset((VOID *) tablePtr->slots, 0, newSize * sizeof(Tcl_HashSlot));
+    tablePtr->numBuckets = newSize;
+    tablePtr->mask = newSize - 1;
+    tablePtr->rebuildSize = newSize - newSize/4;
+    tablePtr->numUsed = 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MoveOldSlots --
+ *
+ *	Move entries from the old slot array of a table that is being
+ *	enlarged to the current slot array.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Up to count old slots are emptied;  their entries are added to
+ *	the current slot array, and the old slots are marked as deleted
+ *	so that searches for entries not yet moved still work.  When
+ *	the last old slot has been processed, the old array is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+MoveOldSlots(tablePtr, count)
+    register Tcl_HashTable *tablePtr;	/* Table being enlarged. */
+    int count;				/* Maximum number of old slots to
+					 * process. */
+{
+    register Tcl_HashSlot *oldPtr, *newPtr;
+    int index;
+
+    for ( ; (count > 0) && (tablePtr->nextOld < tablePtr->numOldSlots);
+	    count--, tablePtr->nextOld++) {
+	oldPtr = &tablePtr->oldSlots[tablePtr->nextOld];
+	if ((oldPtr->entryPtr == NULL) || (oldPtr->entryPtr == DELETED_ENTRY)) {
+	    continue;
+	}
+	for (index = (int) (oldPtr->hash & tablePtr->mask); ;
+		index = (index + 1) & tablePtr->mask) {
+	    newPtr = &tablePtr->slots[index];
+	    if (newPtr->entryPtr == NULL) {
+		tablePtr->numUsed++;
+		break;
+	    }
+	    if (newPtr->entryPtr == DELETED_ENTRY) {
+		break;
+	    }
+	}
+	*newPtr = *oldPtr;
+	oldPtr->entryPtr = DELETED_ENTRY;
+    }
+    if (tablePtr->nextOld >= tablePtr->numOldSlots) {
+	ckfree((char *) tablePtr->oldSlots);
+	tablePtr->oldSlots = NULL;
+	tablePtr->numOldSlots = tablePtr->nextOld = 0;
+    }
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -876,6 +1564,7 @@ RebuildTable(tablePtr)
 
     oldSize = tablePtr->numBuckets;
     oldBuckets = tablePtr->buckets;
+    tablePtr->numRebuilds++;
 
     /*
      * Allocate and initialize the new bucket array, and set up
@@ -901,7 +1590,7 @@ RebuildTable(tablePtr)
 	for (hPtr = *oldChainPtr; hPtr != NULL; hPtr = *oldChainPtr) {
 	    *oldChainPtr = hPtr->nextPtr;
 	    if (tablePtr->keyType == TCL_STRING_KEYS) {
-		index = HashString(hPtr->key.string) & tablePtr->mask;
+		index = hPtr->hash & tablePtr->mask;
 	    } else if (tablePtr->keyType == TCL_ONE_WORD_KEYS) {
 		index = RANDOM_INDEX(tablePtr, hPtr->key.oneWordValue);
 	    } else {
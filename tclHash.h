@@ -39,6 +39,12 @@ typedef struct Tcl_HashEntry {
 					 * used for deleting the entry. */
     ClientData clientData;		/* Application stores something here
 					 * with Tcl_SetHashValue. */
+    unsigned long hash;			/* For string keys and for tables
+					 * that use open addressing, the full
+					 * hash value of the key, so that it
+					 * is never recomputed and keys with
+					 * different hashes are never
+					 * compared. */
     union {				/* Key has one of these forms: */
 	char *oneWordValue;		/* One-word value for key. */
 	int words[1];			/* Multiple integer words for key.
@@ -51,6 +57,22 @@ typedef struct Tcl_HashEntry {
     } key;				/* MUST BE LAST FIELD IN RECORD!! */
 } Tcl_HashEntry;
 
+/*
+ * Structure definition for one slot of a hash table that uses open
+ * addressing (see TCL_OPEN_HASH below) instead of bucket chains.
+ */
+
+typedef struct Tcl_HashSlot {
+    unsigned long hash;			/* Full hash value of the key of
+					 * entryPtr, so that most mismatches
+					 * are caught without touching the
+					 * entry itself. */
+    Tcl_HashEntry *entryPtr;		/* Entry in this slot, or NULL if the
+					 * slot has never been used.  Slots
+					 * whose entry was deleted point to a
+					 * special marker entry. */
+} Tcl_HashSlot;
+
 /*
  * Structure definition for a hash table.  Must be in tcl.h so clients
  * can allocate space for these structures, but clients should never
@@ -85,6 +107,31 @@ typedef struct Tcl_HashTable {
 	    char *key));
     Tcl_HashEntry *(*createProc) _ANSI_ARGS_((struct Tcl_HashTable *tablePtr,
 	    char *key, int *newPtr));
+    int numRebuilds;			/* Number of times the table has been
+					 * enlarged. */
+    long numLookups;			/* Number of finds and creates done. */
+    long numProbes;			/* Number of entries (or slots)
+					 * examined by those lookups. */
+
+    /*
+     * The fields below are used only by tables created with the
+     * TCL_OPEN_HASH flag.  For those tables numBuckets is the number
+     * of slots, mask selects a slot from a hash value, and rebuildSize
+     * is the number of used slots at which the table is enlarged.
+     */
+
+    Tcl_HashSlot *slots;		/* Array of numBuckets slots, or NULL
+					 * if the table uses bucket chains. */
+    int numUsed;			/* Number of slots in slots that aren't
+					 * empty (live or deleted entries). */
+    Tcl_HashSlot *oldSlots;		/* While the table is being enlarged,
+					 * the previous slot array, whose
+					 * entries are moved to slots a few at
+					 * a time as new entries are created;
+					 * otherwise NULL. */
+    int numOldSlots;			/* Number of slots in oldSlots. */
+    int nextOld;			/* Index of the next slot in oldSlots
+					 * whose entry is to be moved. */
 } Tcl_HashTable;
 
 /*
@@ -107,6 +154,15 @@ typedef struct Tcl_HashSearch {
 #define TCL_STRING_KEYS		0
 #define TCL_ONE_WORD_KEYS	1
 
+/*
+ * Flag that may be or-ed with the key type passed to Tcl_InitHashTable
+ * to get a table that keeps its entries in a single array of slots
+ * with open addressing, and that is enlarged incrementally.  This
+ * suits tables that grow large, such as array variables.
+ */
+
+#define TCL_OPEN_HASH		0x1000
+
 /*
  * Macros for clients to use to access fields of hash entries:
  */
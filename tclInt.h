@@ -139,7 +139,9 @@ typedef struct Var {
 				 * For array and global variables this is
 				 * meaningless. */
     int valueSpace;		/* Total number of bytes of space allocated
-				 * at value. */
+				 * at value.string, or 0 if no space has
+				 * been allocated yet (the variable has
+				 * never had a value, or it was unset). */
     int upvarUses;		/* Counts number of times variable is
 				 * is referenced via global or upvar variables
 				 * (i.e. how many variables have "upvarPtr"
@@ -152,10 +154,23 @@ typedef struct Var {
 				 * for this variable, or NULL if none. */
     int flags;			/* Miscellaneous bits of information about
 				 * variable.  See below for definitions. */
+    int repType;		/* Type of internal representation cached
+				 * for the variable's value (see below), or
+				 * VAR_REP_NONE.  Reset whenever the value
+				 * changes. */
     union {
-	char string[4];		/* String value of variable.  The actual
-				 * length of this field is given by the
-				 * valueSpace field above. */
+	long intValue;		/* VAR_REP_INT:  value as an integer. */
+	double doubleValue;	/* VAR_REP_DOUBLE:  value as a double. */
+	struct VarList *listPtr;/* VAR_REP_LIST:  where the elements of the
+				 * value lie, when it is parsed as a list.
+				 * Malloc-ed. */
+    } rep;
+    union {
+	char *string;		/* String value of variable, malloc-ed
+				 * separately so that the variable needn't
+				 * move when the value grows.  The size of
+				 * the space is given by the valueSpace
+				 * field above. */
 	Tcl_HashTable *tablePtr;/* For array variables, this points to
 				 * information about the hash table used
 				 * to implement the associative array. 
@@ -166,7 +181,7 @@ typedef struct Var {
 				 * created by "upvar", this field points to
 				 * the hash table entry for the higher-level
 				 * variable. */
-    } value;			/* MUST BE LAST FIELD IN STRUCTURE!!! */
+    } value;
 } Var;
 
 /*
@@ -203,6 +218,48 @@ typedef struct Var {
 #define VAR_TRACE_ACTIVE	0x20
 #define VAR_SEARCHES_POSSIBLE	0x40
 
+/*
+ * Flag bit that the Tcl core may pass to Tcl_SetVar and Tcl_SetVar2,
+ * in addition to the public ones in tcl.h:
+ *
+ * TCL_OWN_VALUE -		newValue was allocated with ckalloc and
+ *				the variable takes it over as its storage
+ *				instead of copying it.  The caller must
+ *				not touch newValue afterwards, even if
+ *				the set fails.
+ */
+
+#define TCL_OWN_VALUE		0x400
+
+/*
+ * Internal representations that may be cached for the value of a
+ * scalar variable, so that it needn't be converted from a string
+ * each time it is used as a number or a list.  The numeric types are
+ * only cached for values that "expr" would treat as numbers (the
+ * whole string is an integer or floating-point number).
+ */
+
+#define VAR_REP_NONE		0
+#define VAR_REP_INT		1
+#define VAR_REP_DOUBLE		2
+#define VAR_REP_LIST		3
+
+typedef struct ListElement {
+    int offset;			/* Offset of element within the value. */
+    int size;			/* Number of characters in element. */
+    int brace;			/* Non-zero means the element was enclosed
+				 * in braces, so its characters are used
+				 * as is;  zero means backslash sequences
+				 * must be collapsed. */
+} ListElement;
+
+typedef struct VarList {
+    int numElements;		/* Number of elements in list. */
+    ListElement elements[1];	/* Location of each element.  The actual
+				 * size of this array is at least
+				 * numElements. */
+} VarList;
+
 /*
  *----------------------------------------------------------------
  * Data structures related to procedures.   These are used primarily
@@ -241,8 +298,35 @@ typedef struct Proc {
 				 * the procedure (dynamically allocated). */
     Arg *argPtr;		/* Pointer to first of procedure's formal
 				 * arguments, or NULL if none. */
+    struct ByteCode *codePtr;	/* Compiled form of command, or NULL if
+				 * it couldn't be compiled (in which case
+				 * the body is evaluated as a string). */
 } Proc;
 
+/*
+ * The structure below describes the local variables of a procedure
+ * that are kept in slots in its call frames rather than in a hash
+ * table.  So that names passed to commands like "set" can be found
+ * without searching, it also remembers the slots found for the last
+ * few name strings looked up, indexed by their addresses;  since the
+ * same address may later hold a different string, a remembered slot
+ * is only used if its name matches.
+ */
+
+#define LOCAL_CACHE_SIZE 16
+
+typedef struct CompiledLocals {
+    int numLocals;		/* Number of entries in names. */
+    char **names;		/* Names of the variables, formal arguments
+				 * first.  Stored in the same malloc-ed
+				 * block as this structure. */
+    char *cacheNames[LOCAL_CACHE_SIZE];
+				/* Addresses of strings recently looked up
+				 * (NULL for unused entries). */
+    int cacheSlots[LOCAL_CACHE_SIZE];
+				/* Slot found for each of cacheNames. */
+} CompiledLocals;
+
 /*
  * The structure below defines a command trace.  This is used to allow Tcl
  * clients to find out whenever a command is about to be executed.
@@ -263,8 +347,20 @@ typedef struct Trace {
  */
 
 typedef struct CallFrame {
-    Tcl_HashTable varTable;	/* Hash table containing all of procedure's
-				 * local variables. */
+    Tcl_HashTable varTable;	/* Hash table containing those of the
+				 * procedure's local variables that don't
+				 * have slots.  Initialized only when the
+				 * first such variable is created. */
+    Tcl_HashTable *varTablePtr;	/* &varTable once it has been initialized,
+				 * NULL before. */
+    struct CompiledLocals *localsPtr;
+				/* Names of the variables in slots, or NULL
+				 * if the frame has no slots. */
+    Tcl_HashEntry *slots;	/* One entry for each of the procedure's
+				 * compiled local variables.  These entries
+				 * aren't part of any hash table (tablePtr
+				 * is NULL);  the value is NULL if the
+				 * variable doesn't exist. */
     int level;			/* Level of this procedure, for "uplevel"
 				 * purposes (i.e. corresponds to nesting of
 				 * callerVarPtr's, not callerPtr's).  1 means
@@ -323,6 +419,17 @@ typedef struct HistoryRev {
 				 * NULL for end of list. */
 } HistoryRev;
 
+/*
+ * The structure below holds a time, such as when an "after" handler
+ * is due.  Times are measured from an arbitrary starting point by
+ * TclGetTime, which never runs backwards.
+ */
+
+typedef struct TclTime {
+    long sec;			/* Seconds. */
+    long usec;			/* Microseconds. */
+} TclTime;
+
 /*
  *----------------------------------------------------------------
  * Data structures related to files.  These are used primarily in
@@ -355,8 +462,68 @@ typedef struct OpenFile {
     int errorId;		/* File id of file that receives error
 				 * output from pipeline.  -1 means not
 				 * used (i.e. this is a normal file). */
+    char *readBuf;		/* Malloc-ed buffer holding input that
+				 * has been read from f but not yet
+				 * consumed, or NULL if none allocated. */
+    int readSize;		/* Number of bytes allocated at readBuf. */
+    char *readPtr;		/* First unconsumed byte in readBuf. */
+    char *readEnd;		/* Just after the last valid byte in
+				 * readBuf. */
+    int readDirect;		/* Non-zero means f has no stdio input
+				 * buffer of its own, so readBuf may be
+				 * refilled with large reads straight from
+				 * its file descriptor.  Zero means refill
+				 * through stdio a line at a time, so as
+				 * not to read ahead of other users of f. */
+    int readEof;		/* Non-zero means a refill of readBuf hit
+				 * end of file. */
+    int readPartial;		/* Non-zero means readBuf holds only part
+				 * of a line, and no more input was
+				 * available to complete it:  the file
+				 * isn't readable again until more
+				 * arrives. */
+    char *writeBuf;		/* Malloc-ed buffer holding output that
+				 * hasn't been written yet, or NULL if
+				 * none allocated. */
+    int writeSize;		/* Size of output buffer to use, in bytes. */
+    int writeCount;		/* Number of bytes waiting in writeBuf. */
+    int buffering;		/* When output is written:  one of
+				 * FILE_BUFFER_NONE, FILE_BUFFER_LINE, or
+				 * FILE_BUFFER_FULL. */
+    int writeDirect;		/* Non-zero means the output stream has no
+				 * stdio buffer of its own, so output is
+				 * collected in writeBuf and written
+				 * straight to its file descriptor.  Zero
+				 * means output goes through stdio, whose
+				 * buffering is set to match the fields
+				 * above. */
+    struct OpenFile *nextPtr;	/* Next in list of files with output held
+				 * in writeBuf, which are all flushed when
+				 * the process exits. */
+    int blocking;		/* Zero means reads return whatever input
+				 * is available instead of waiting for
+				 * more. */
+    char *readScript;		/* Malloc-ed script to evaluate whenever
+				 * the file is readable (see "fileevent"),
+				 * or NULL. */
+    char *writeScript;		/* Malloc-ed script to evaluate whenever
+				 * the file is writable, or NULL. */
 } OpenFile;
 
+/*
+ * Values for the buffering field of an OpenFile:
+ *
+ * FILE_BUFFER_NONE -		Write output as soon as it is produced.
+ * FILE_BUFFER_LINE -		Write output whenever a newline has been
+ *				produced or the buffer fills.
+ * FILE_BUFFER_FULL -		Write output only when the buffer fills
+ *				or the file is flushed or closed.
+ */
+
+#define FILE_BUFFER_NONE	0
+#define FILE_BUFFER_LINE	1
+#define FILE_BUFFER_FULL	2
+
 /*
  *----------------------------------------------------------------
  * This structure defines an interpreter, which is a collection of
@@ -398,6 +565,10 @@ typedef struct Interp {
     Tcl_HashTable commandTable;	/* Contains all of the commands currently
 				 * registered in this interpreter.  Indexed
 				 * by strings; values have type (Command *). */
+    long cmdEpoch;		/* Incremented whenever a command is
+				 * created, deleted or renamed, so that
+				 * commands cached in compiled code (see
+				 * CodeLiteral) can be recognized as stale. */
 
     /*
      * Information related to procedures and variables.  See tclProc.c
@@ -422,6 +593,17 @@ typedef struct Interp {
     ActiveVarTrace *activeTracePtr;
 				/* First in list of active traces for interp,
 				 * or NULL if no active traces. */
+    int varEpoch;		/* Incremented whenever the value of any
+				 * variable changes or a variable is
+				 * deleted. */
+    Var *argVarPtr;		/* If argv[1] of the command being invoked
+				 * was substituted from just a variable,
+				 * this is the variable;  otherwise NULL.
+				 * See TclGetVarList. */
+    char *argVarWord;		/* Address of that argv[1]. */
+    int argVarEpoch;		/* Value of varEpoch when the variable was
+				 * read:  if varEpoch has changed since, the
+				 * variable may no longer hold the word. */
 
     /*
      * Information related to history:
@@ -478,23 +660,122 @@ typedef struct Interp {
 				 * it means no files have been used, so even
 				 * stdin/stdout/stderr entries haven't been
 				 * setup yet. */
+
+    /*
+     * Handlers created by the "after" command.  See tclEvent.c for
+     * details.
+     */
+
+    struct AfterHandler **timerHeap;
+				/* Malloc-ed array holding a heap of the
+				 * pending timer handlers, ordered by when
+				 * they are due:  entry 0 is due first.
+				 * NULL if none allocated. */
+    int numTimers;		/* Number of handlers in timerHeap. */
+    int timerSpace;		/* Number of entries allocated at
+				 * timerHeap. */
+    struct AfterHandler *idleFirst;
+				/* First of the handlers to invoke the next
+				 * time the event loop is idle, or NULL. */
+    struct AfterHandler *idleLast;
+				/* Last idle handler, or NULL. */
+    long afterId;		/* Number to use in the identifier of the
+				 * next handler created. */
+
     /*
      * A cache of compiled regular expressions.  See TclCompileRegexp
      * in tclUtil.c for details.
      */
 
-#define NUM_REGEXPS 5
-    char *patterns[NUM_REGEXPS];/* Strings corresponding to compiled
-				 * regular expression patterns.  NULL
-				 * means that this slot isn't used.
-				 * Malloc-ed. */
-    int patLengths[NUM_REGEXPS];/* Number of non-null characters in
-				 * corresponding entry in patterns.
-				 * -1 means entry isn't used. */
-    regexp *regexps[NUM_REGEXPS];
-				/* Compiled forms of above strings.  Also
-				 * malloc-ed, or NULL if not in use yet. */
+#define DEFAULT_MAX_REGEXPS 40
+    Tcl_HashTable regexpTable;	/* Maps regular expression patterns to
+				 * CachedRegexp structures holding their
+				 * compiled forms.  At most maxRegexps
+				 * entries. */
+    struct CachedRegexp *regexpFirst;
+				/* Most recently used entry in regexpTable,
+				 * or NULL if the table is empty. */
+    struct CachedRegexp *regexpLast;
+				/* Least recently used entry in regexpTable:
+				 * the next one to be discarded. */
+    int maxRegexps;		/* Capacity of the cache. */
+    long regexpHits;		/* Number of times a pattern was found in
+				 * the cache. */
+    long regexpMisses;		/* Number of times a pattern had to be
+				 * compiled. */
+    long regexpEvictions;	/* Number of compiled patterns discarded
+				 * to make room for others. */
+
+    /*
+     * A cache of compiled scripts.  See Tcl_Eval in tclBasic.c for
+     * details.
+     */
 
+#define MAX_CACHED_SCRIPTS 50
+#define MAX_CACHED_LENGTH 10000
+    Tcl_HashTable scriptTable;	/* Maps the text of recently-evaluated
+				 * scripts to CachedScript structures.  At
+				 * most MAX_CACHED_SCRIPTS entries, each no
+				 * longer than MAX_CACHED_LENGTH chars. */
+#define NUM_RECENT_SCRIPTS 16
+#define RECENT_INDEX(string) \
+    ((int) (((unsigned long) (string) >> 3) % NUM_RECENT_SCRIPTS))
+    char *recentText[NUM_RECENT_SCRIPTS];
+				/* Addresses at which cached scripts were
+				 * recently found, indexed by RECENT_INDEX.
+				 * Lets a script evaluated repeatedly from
+				 * the same place be found by comparing
+				 * strings rather than hashing. */
+    Tcl_HashEntry *recentScripts[NUM_RECENT_SCRIPTS];
+				/* Cache entry for each of recentText. */
+
+    /*
+     * A cache of compiled expressions, much like the script cache.
+     * See ExprTopLevel in tclExpr.c for details.
+     */
+
+#define MAX_CACHED_EXPRS 100
+#define MAX_CACHED_EXPR_LENGTH 1000
+    Tcl_HashTable exprTable;	/* Maps the text of expressions that have
+				 * been evaluated more than once to their
+				 * compiled forms (ExprCode structures, or
+				 * NULL if not compiled).  At most
+				 * MAX_CACHED_EXPRS entries, each no longer
+				 * than MAX_CACHED_EXPR_LENGTH chars. */
+    unsigned int seenExprs[NUM_RECENT_SCRIPTS];
+				/* Hash values of expressions that have
+				 * been seen once, indexed by hash value
+				 * modulo NUM_RECENT_SCRIPTS. */
+    char *recentExprText[NUM_RECENT_SCRIPTS];
+				/* Addresses at which cached expressions
+				 * were recently found. */
+    Tcl_HashEntry *recentExprs[NUM_RECENT_SCRIPTS];
+				/* Cache entry for each of recentExprText. */
+    char **execArgv;		/* Words of the command currently being
+				 * invoked from compiled code.  Those
+				 * copied from literals can be recognized
+				 * by address when they are evaluated as
+				 * scripts (loop bodies, etc.). */
+    struct CodeLiteral **execLits;
+				/* For each of execArgv, the literal it
+				 * was copied from, or NULL. */
+    int execArgc;		/* Number of entries in execArgv;  0 if
+				 * no compiled command is executing. */
+
+    /*
+     * Scratch storage for command words.  See TclArenaAlloc in
+     * tclParse.c for details.
+     */
+
+    struct ArenaChunk *arenaPtr;/* Chunk from which storage is currently
+				 * being allocated, or NULL.  Older chunks
+				 * still in use are linked from it. */
+    char *arenaNext;		/* Next free byte in *arenaPtr. */
+    struct ArenaChunk *freeChunkPtr;
+				/* Chunks no longer in use, kept so they
+				 * needn't be allocated again.  At most
+				 * MAX_FREE_CHUNKS of them. */
+    int numFreeChunks;		/* Number of chunks in freeChunkPtr list. */
 
     /*
      * Miscellaneous information:
@@ -572,6 +853,229 @@ typedef struct ParseValue {
 				 * expandProc. */
 } ParseValue;
 
+/*
+ * Scratch storage for the words and argv arrays of commands being
+ * evaluated comes from a per-interpreter arena, which is allocated
+ * from and released in stack order (see TclArenaAlloc in tclParse.c).
+ * The arena is made up of the chunks below.
+ */
+
+typedef struct ArenaChunk {
+    struct ArenaChunk *nextPtr;	/* Next older chunk in use, or next chunk
+				 * in the list of free chunks. */
+    char *end;			/* Address just after the last usable byte
+				 * of space. */
+    double space[1];		/* Storage for the arena.  The actual size
+				 * of this field is given by end.  Declared
+				 * as a double for alignment. */
+} ArenaChunk;
+
+#define ARENA_CHUNK_SIZE	2000
+#define MAX_FREE_CHUNKS		4
+
+/*
+ * Each entry in an interpreter's cache of compiled regular expressions
+ * is described by a structure of the following type.  The entries are
+ * also linked in order of use, so that the least recently used one can
+ * be found quickly when the cache is full.
+ */
+
+typedef struct CachedRegexp {
+    regexp *regexpPtr;		/* Compiled form of the pattern. */
+    Tcl_HashEntry *hPtr;	/* Entry in regexpTable for this pattern;
+				 * its key is the pattern. */
+    struct CachedRegexp *prevPtr;
+				/* Next more recently used entry, or NULL. */
+    struct CachedRegexp *nextPtr;
+				/* Next less recently used entry, or NULL. */
+} CachedRegexp;
+
+/*
+ * The structures below hold the parsed form of a script, as produced
+ * by TclParseScript and turned into instructions by TclCompileScript
+ * (see tclCode.c).  A parsed script records the word boundaries of each command
+ * and the places where substitutions must occur;  literal text has
+ * already had backslash sequences and braces processed.  All offsets
+ * are relative to the first character of the outermost script text,
+ * so that error messages and trace procedures can refer back to the
+ * original text.
+ */
+
+typedef struct ParsedPart {
+    int type;			/* Kind of part:  see below. */
+    char *string;		/* For PART_TEXT, the (null-terminated)
+				 * characters of the part;  for PART_VAR and
+				 * PART_ARRAY, the name of the variable.
+				 * Malloc-ed. */
+    int length;			/* Number of characters in string. */
+    struct ParsedWord *indexPtr;
+				/* For PART_ARRAY, the parts making up the
+				 * element name.  Malloc-ed. */
+    struct ParsedScript *scriptPtr;
+				/* For PART_COMMAND, the nested script. */
+    int end;			/* Offset of the character just after the
+				 * last one in the part. */
+} ParsedPart;
+
+/*
+ * Values for the type field of ParsedPart:
+ *
+ * PART_TEXT -		Literal characters.
+ * PART_VAR -		Value of a scalar variable ($name or ${name}).
+ * PART_ARRAY -		Value of an array element ($name(index)).
+ * PART_COMMAND -	Result of a bracketed command.
+ */
+
+#define PART_TEXT	0
+#define PART_VAR	1
+#define PART_ARRAY	2
+#define PART_COMMAND	3
+
+typedef struct ParsedWord {
+    int numParts;		/* Number of entries in parts. */
+    ParsedPart *parts;		/* Malloc-ed array of parts whose values
+				 * are concatenated to form the word. */
+} ParsedWord;
+
+/*
+ * A word consisting of a single PART_TEXT part needs no substitution
+ * at all:  its text can be passed to the command procedure directly.
+ */
+
+#define WORD_IS_LITERAL(wordPtr) \
+    (((wordPtr)->numParts == 1) && ((wordPtr)->parts[0].type == PART_TEXT))
+
+typedef struct ParsedCmd {
+    int start;			/* Offset of first character of command. */
+    int end;			/* Offset of character that terminated the
+				 * command (newline, semi-colon, etc.). */
+    int numWords;		/* Number of entries in words. */
+    ParsedWord *words;		/* Malloc-ed array of words. */
+} ParsedCmd;
+
+typedef struct ParsedScript {
+    int start;			/* Offset of first character of script. */
+    int end;			/* Offset of the character that terminated
+				 * the script (null or close-bracket). */
+    int numCmds;		/* Number of non-empty commands. */
+    ParsedCmd *cmds;		/* Malloc-ed array of commands. */
+} ParsedScript;
+
+/*
+ * The structures below describe a compiled script, as produced by
+ * TclCompileScript and executed by TclEvalCode.  The instructions
+ * for each script (the outermost one and each bracketed command
+ * nested in it) build the words of one command after another;
+ * TclEvalCode invokes each command once its words are complete.
+ * Literal words are kept in a single pool of characters and are
+ * passed to commands without copying.
+ */
+
+typedef struct CodeLiteral {
+    int offset;			/* Offset of literal's first character in
+				 * the pool. */
+    int length;			/* Number of characters in literal. */
+    struct ByteCode *bodyPtr;	/* Compiled form of the literal, if it has
+				 * been evaluated as a script;  NULL if it
+				 * hasn't (or couldn't be compiled). */
+    int flags;			/* LITERAL_NOT_SCRIPT means compiling the
+				 * literal as a script already failed. */
+    struct Command *cmdPtr;	/* If the literal is the name of a command,
+				 * the command it referred to when last
+				 * invoked, or NULL.  Only valid if cmdEpoch
+				 * matches the interpreter's cmdEpoch. */
+    long cmdEpoch;		/* Value of cmdEpoch when cmdPtr was set. */
+} CodeLiteral;
+
+#define LITERAL_NOT_SCRIPT	1
+
+typedef struct CodeScript {
+    int pc;			/* Index in code of first instruction. */
+    int start;			/* Offset of first character of script. */
+    int end;			/* Offset of the character that terminated
+				 * the script (null or close-bracket). */
+} CodeScript;
+
+typedef struct ByteCode {
+    int refCount;		/* Number of references (cache entry or
+				 * procedure, plus evaluations in progress);
+				 * freed when this becomes zero. */
+    char *source;		/* If non-NULL, malloc-ed text from which
+				 * code was compiled;  freed with the code.
+				 * Set when the owner of the text goes away
+				 * while the code is still executing. */
+    int *code;			/* Instructions (see below). */
+    char *pool;			/* Text of all literals, each one null-
+				 * terminated. */
+    int poolSize;		/* Number of bytes in pool. */
+    int numLiterals;		/* Number of entries in literals. */
+    CodeLiteral *literals;	/* Literals, in order of their offsets. */
+    int numScripts;		/* Number of entries in scripts. */
+    CodeScript *scripts;	/* Outermost script (first) and nested
+				 * commands. */
+    struct CompiledLocals *localsPtr;
+				/* For procedure bodies, the variables that
+				 * get slots in call frames;  NULL for other
+				 * code or if there are no such variables. */
+} ByteCode;
+
+/*
+ * Instructions, each followed by the operands listed:
+ *
+ * INST_DONE -			End of script.
+ * INST_COMMAND num start end -	Start of a command with num words,
+ *				whose text runs from offset start up to
+ *				offset end.
+ * INST_PUSH_LIT lit -		Next word is literal lit.
+ * INST_BEGIN_WORD -		Start building a word in which
+ *				substitutions occur.
+ * INST_END_WORD -		Finish building the word.
+ * INST_BEGIN_INDEX name -	Start building the element name for an
+ *				array reference;  name is the literal
+ *				holding the array's name.
+ * INST_APPEND_LIT lit -	Append literal lit to the current word.
+ * INST_APPEND_VAR lit end -	Append the value of the scalar variable
+ *				named by literal lit;  end is the offset
+ *				just after the reference, for errors.
+ * INST_APPEND_ELEM lit end -	Append the value of an element of array
+ *				lit, whose name was just built.
+ * INST_APPEND_CMD script -	Execute nested script and append its
+ *				result.
+ */
+
+#define INST_DONE		0
+#define INST_COMMAND		1
+#define INST_PUSH_LIT		2
+#define INST_BEGIN_WORD		3
+#define INST_END_WORD		4
+#define INST_BEGIN_INDEX	5
+#define INST_APPEND_LIT		6
+#define INST_APPEND_VAR		7
+#define INST_APPEND_ELEM	8
+#define INST_APPEND_CMD		9
+
+/*
+ * Maximum number of words (and array element names within them)
+ * that can be under construction at once.  Scripts with deeper
+ * nesting of array references aren't compiled.
+ */
+
+#define MAX_CODE_MARKS 10
+
+/*
+ * The script cache of an interpreter maps script text to the
+ * following structure.  A script is compiled only the second time
+ * it is seen, so that one-shot scripts (e.g. files being sourced)
+ * don't pay for compiling they'll never benefit from.
+ */
+
+typedef struct CachedScript {
+    int numUses;		/* Number of times script has been seen
+				 * (stops counting at 2). */
+    ByteCode *codePtr;		/* Compiled form of script, or NULL if it
+				 * hasn't been compiled (yet). */
+} CachedScript;
+
 /*
  * A table used to classify input characters to assist in parsing
  * Tcl commands.  The table should be indexed with a signed character
@@ -641,12 +1145,36 @@ extern char *		tclRegexpError;
  */
 
 extern void		panic();
+extern char *		TclArenaAlloc _ANSI_ARGS_((Interp *iPtr, int size));
+extern void		TclArenaExpand _ANSI_ARGS_((ParseValue *pvPtr,
+			    int needed));
+extern void		TclArenaRelease _ANSI_ARGS_((Interp *iPtr,
+			    char *mark));
+extern void		TclBackgroundError _ANSI_ARGS_((Tcl_Interp *interp));
 extern regexp *		TclCompileRegexp _ANSI_ARGS_((Tcl_Interp *interp,
 			    char *string));
+extern ByteCode *	TclCompileScript _ANSI_ARGS_((char *string));
 extern void		TclCopyAndCollapse _ANSI_ARGS_((int count, char *src,
 			    char *dst));
+extern void		TclDeleteEvents _ANSI_ARGS_((Interp *iPtr));
+extern void		TclDeleteFrame _ANSI_ARGS_((Interp *iPtr,
+			    CallFrame *framePtr));
 extern void		TclDeleteVars _ANSI_ARGS_((Interp *iPtr,
 			    Tcl_HashTable *tablePtr));
+extern void		TclDirectOutput _ANSI_ARGS_((OpenFile *filePtr));
+extern int		TclDoOneEvent _ANSI_ARGS_((Tcl_Interp *interp,
+			    int wait));
+extern int		TclEvalCode _ANSI_ARGS_((Tcl_Interp *interp,
+			    char *base, ByteCode *codePtr, int script,
+			    int flags, char **termPtr));
+extern int		TclEvalEvent _ANSI_ARGS_((Tcl_Interp *interp,
+			    char *script));
+extern int		TclExecRegexp _ANSI_ARGS_((regexp *regexpPtr,
+			    char *string, char *start, int numSubs));
+extern int		TclExecWords _ANSI_ARGS_((Tcl_Interp *interp,
+			    ByteCode *codePtr, char *base, int **pcPtr,
+			    char **argv, CodeLiteral **lits,
+			    ParseValue *pvPtr, char **termPtr));
 extern void		TclExpandParseValue _ANSI_ARGS_((ParseValue *pvPtr,
 			    int needed));
 extern int		TclFindElement _ANSI_ARGS_((Tcl_Interp *interp,
@@ -654,13 +1182,33 @@ extern int		TclFindElement _ANSI_ARGS_((Tcl_Interp *interp,
 			    int *sizePtr, int *bracePtr));
 extern Proc *		TclFindProc _ANSI_ARGS_((Interp *iPtr,
 			    char *procName));
+extern int		TclFindSlot _ANSI_ARGS_((CallFrame *framePtr,
+			    char *name));
+extern void		TclFlushExprs _ANSI_ARGS_((Interp *iPtr));
+extern int		TclFlushFile _ANSI_ARGS_((OpenFile *filePtr));
+extern void		TclFlushRegexps _ANSI_ARGS_((Interp *iPtr));
+extern void		TclFreeRegexp _ANSI_ARGS_((regexp *regexpPtr));
+extern void		TclFreeScript _ANSI_ARGS_((ParsedScript *scriptPtr));
+extern void		TclFreeVarRep _ANSI_ARGS_((Var *varPtr));
 extern int		TclGetFrame _ANSI_ARGS_((Tcl_Interp *interp,
 			    char *string, CallFrame **framePtrPtr));
+extern int		TclGetLine _ANSI_ARGS_((OpenFile *filePtr,
+			    char **linePtr));
 extern int		TclGetListIndex _ANSI_ARGS_((Tcl_Interp *interp,
 			    char *string, int *indexPtr));
 extern int		TclGetOpenFile _ANSI_ARGS_((Tcl_Interp *interp,
 			    char *string, OpenFile **filePtrPtr));
+extern void		TclGetTime _ANSI_ARGS_((TclTime *timePtr));
+extern Var *		TclGetVar2Ptr _ANSI_ARGS_((Tcl_Interp *interp,
+			    char *part1, char *part2, int flags));
+extern VarList *	TclGetVarList _ANSI_ARGS_((Tcl_Interp *interp,
+			    char *word));
 extern Proc *		TclIsProc _ANSI_ARGS_((Command *cmdPtr));
+extern ByteCode *	TclLiteralCode _ANSI_ARGS_((Interp *iPtr,
+			    char *string));
+extern Tcl_HashEntry *	TclLookupVar _ANSI_ARGS_((Interp *iPtr,
+			    char *name, int flags, int create,
+			    int *newPtr));
 extern void		TclMakeFileTable _ANSI_ARGS_((Interp *iPtr,
 			    int index));
 extern int		TclParseBraces _ANSI_ARGS_((Tcl_Interp *interp,
@@ -671,12 +1219,36 @@ extern int		TclParseNestedCmd _ANSI_ARGS_((Tcl_Interp *interp,
 extern int		TclParseQuotes _ANSI_ARGS_((Tcl_Interp *interp,
 			    char *string, int termChar, int flags,
 			    char **termPtr, ParseValue *pvPtr));
+extern ParsedScript *	TclParseScript _ANSI_ARGS_((char *string));
 extern int		TclParseWords _ANSI_ARGS_((Tcl_Interp *interp,
 			    char *string, int flags, int maxWords,
 			    char **termPtr, int *argcPtr, char **argv,
 			    ParseValue *pvPtr));
+extern int		TclReadFile _ANSI_ARGS_((OpenFile *filePtr,
+			    char *buffer, int count));
+extern void		TclReleaseCode _ANSI_ARGS_((ByteCode *codePtr));
+extern int		TclReleaseFile _ANSI_ARGS_((OpenFile *filePtr));
+extern int		TclSeekFile _ANSI_ARGS_((OpenFile *filePtr,
+			    long offset, int mode));
+extern int		TclSetBlocking _ANSI_ARGS_((OpenFile *filePtr,
+			    int blocking));
+extern int		TclSetBuffering _ANSI_ARGS_((OpenFile *filePtr,
+			    int buffering, int size));
+extern void		TclSetLocal _ANSI_ARGS_((Tcl_HashEntry *hPtr,
+			    char *value));
+extern int		TclSetRegexpCacheSize _ANSI_ARGS_((
+			    Tcl_Interp *interp, int size));
+extern Var *		TclSetVar2Ptr _ANSI_ARGS_((Tcl_Interp *interp,
+			    char *part1, char *part2, char *newValue,
+			    int flags));
 extern void		TclSetupEnv _ANSI_ARGS_((Tcl_Interp *interp));
+extern void		TclSleep _ANSI_ARGS_((int ms));
+extern long		TclTellFile _ANSI_ARGS_((OpenFile *filePtr));
+extern int		TclWaitForFiles _ANSI_ARGS_((Interp *iPtr,
+			    int timeout));
 extern char *		TclWordEnd _ANSI_ARGS_((char *start, int nested));
+extern int		TclWriteFile _ANSI_ARGS_((OpenFile *filePtr,
+			    char *string, int length, int newline));
 
 /*
  *----------------------------------------------------------------
@@ -762,10 +1334,14 @@ extern int	Tcl_TraceCmd _ANSI_ARGS_((ClientData clientData,
 		    Tcl_Interp *interp, int argc, char **argv));
 extern int	Tcl_UnsetCmd _ANSI_ARGS_((ClientData clientData,
 		    Tcl_Interp *interp, int argc, char **argv));
+extern int	Tcl_UpdateCmd _ANSI_ARGS_((ClientData clientData,
+		    Tcl_Interp *interp, int argc, char **argv));
 extern int	Tcl_UplevelCmd _ANSI_ARGS_((ClientData clientData,
 		    Tcl_Interp *interp, int argc, char **argv));
 extern int	Tcl_UpvarCmd _ANSI_ARGS_((ClientData clientData,
 		    Tcl_Interp *interp, int argc, char **argv));
+extern int	Tcl_VwaitCmd _ANSI_ARGS_((ClientData clientData,
+		    Tcl_Interp *interp, int argc, char **argv));
 extern int	Tcl_WhileCmd _ANSI_ARGS_((ClientData clientData,
 		    Tcl_Interp *interp, int argc, char **argv));
 extern int	Tcl_Cmd _ANSI_ARGS_((ClientData clientData,
@@ -779,6 +1355,8 @@ extern int	Tcl_Cmd _ANSI_ARGS_((ClientData clientData,
  *----------------------------------------------------------------
  */
 
+extern int	Tcl_AfterCmd _ANSI_ARGS_((ClientData clientData,
+		    Tcl_Interp *interp, int argc, char **argv));
 extern int	Tcl_CdCmd _ANSI_ARGS_((ClientData clientData,
 		    Tcl_Interp *interp, int argc, char **argv));
 extern int	Tcl_CloseCmd _ANSI_ARGS_((ClientData clientData,
@@ -789,10 +1367,16 @@ extern int	Tcl_ExecCmd _ANSI_ARGS_((ClientData clientData,
 		    Tcl_Interp *interp, int argc, char **argv));
 extern int	Tcl_ExitCmd _ANSI_ARGS_((ClientData clientData,
 		    Tcl_Interp *interp, int argc, char **argv));
+extern int	Tcl_FconfigureCmd _ANSI_ARGS_((ClientData clientData,
+		    Tcl_Interp *interp, int argc, char **argv));
 extern int	Tcl_FileCmd _ANSI_ARGS_((ClientData clientData,
 		    Tcl_Interp *interp, int argc, char **argv));
+extern int	Tcl_FileEventCmd _ANSI_ARGS_((ClientData clientData,
+		    Tcl_Interp *interp, int argc, char **argv));
 extern int	Tcl_FlushCmd _ANSI_ARGS_((ClientData clientData,
 		    Tcl_Interp *interp, int argc, char **argv));
+extern int	Tcl_ForeachLineCmd _ANSI_ARGS_((ClientData clientData,
+		    Tcl_Interp *interp, int argc, char **argv));
 extern int	Tcl_GetsCmd _ANSI_ARGS_((ClientData clientData,
 		    Tcl_Interp *interp, int argc, char **argv));
 extern int	Tcl_GlobCmd _ANSI_ARGS_((ClientData clientData,
@@ -0,0 +1,1260 @@
+/*
+ * tclNfa.c --
+ *
+ *	This file contains a second matcher for the regular expressions
+ *	compiled by regcomp.  The matcher in regexp.c works by
+ *	backtracking:  it retries the pattern from every starting
+ *	position in the string and can take exponential time on
+ *	patterns such as "(a+)+b".  The procedures here translate a
+ *	compiled pattern into a Thompson NFA and simulate all of its
+ *	paths at once, in a single pass over the string, so the time
+ *	taken is proportional to the length of the string times the
+ *	size of the pattern.  Whether a string matches at all is
+ *	decided by a DFA whose states are built from the NFA as they
+ *	are needed; the NFA itself is simulated, keeping submatch
+ *	positions for each path, only when the caller wants to know
+ *	where the match is.
+ *
+ *	Paths through the NFA are ranked the same way regexec tries
+ *	them (earlier alternatives first, longer repetitions first), so
+ *	both matchers report the same match and submatches.
+ *
+ *	While no match is in progress, both the DFA and the NFA skip
+ *	ahead to the next place a match could begin, using the literal
+ *	prefix found by regcomp or the set of characters a match can
+ *	begin with, and the library's string scanning routines.
+ *
+ * Copyright 1991 Regents of the University of California.
+ * Permission to use, copy, modify, and distribute this
+ * software and its documentation for any purpose and without
+ * fee is hereby granted, provided that the above copyright
+ * notice appear in all copies.  The University of California
+ * makes no representations about the suitability of this
+ * software for any purpose.  It is provided "as is" without
+ * express or implied warranty.
+ *
+ * $Id$
+ */
+
+#include "tclInt.h"
+
+/*
+ * The following definitions describe the program built by regcomp.
+ * They must agree with the ones in regexp.c.
+ */
+
+#define	END	0
+#define	BOL	1
+#define	EOL	2
+#define	ANY	3
+#define	ANYOF	4
+#define	ANYBUT	5
+#define	BRANCH	6
+#define	BACK	7
+#define	EXACTLY	8
+#define	NOTHING	9
+#define	STAR	10
+#define	PLUS	11
+#define	OPEN	20
+#define	CLOSE	30
+
+#define	OP(p)		(*(p))
+#define	NEXT(p)		(((*((p)+1)&0377)<<8) + (*((p)+2)&0377))
+#define	OPERAND(p)	((p) + 3)
+
+#define UCHAR(c)	((unsigned char) (c))
+
+/*
+ * The NFA is an array of instructions of the following form.  Each
+ * instruction either consumes one character of the string (NFA_CHAR
+ * and NFA_CLASS), tests the position in the string (NFA_BOL and
+ * NFA_EOL), or leads on to other instructions without consuming
+ * anything.
+ */
+
+typedef struct NfaInst {
+    unsigned char op;		/* One of the NFA_ values below. */
+    unsigned char arg;		/* Character for NFA_CHAR, submatch slot
+				 * for NFA_SAVE. */
+    short next;			/* Index of the instruction to continue
+				 * with. */
+    short alt;			/* For NFA_SPLIT, index of the less
+				 * preferred instruction to continue with.
+				 * For NFA_CLASS, index of the character
+				 * set. */
+} NfaInst;
+
+#define NFA_CHAR	0	/* Match the character arg. */
+#define NFA_CLASS	1	/* Match any character in set alt. */
+#define NFA_BOL		2	/* Match "" at the start of the string. */
+#define NFA_EOL		3	/* Match "" at the end of the string. */
+#define NFA_JUMP	4	/* Continue at next. */
+#define NFA_SPLIT	5	/* Continue at next and, failing that, at
+				 * alt. */
+#define NFA_SAVE	6	/* Record the position in slot arg. */
+#define NFA_MATCH	7	/* The pattern has matched. */
+
+#define SET_BYTES	32
+#define IN_SET(setPtr, c) ((setPtr)[(c) >> 3] & (1 << ((c) & 7)))
+
+/*
+ * A state of the DFA is the set of NFA instructions waiting for the
+ * next character (NFA_CHAR, NFA_CLASS and NFA_EOL instructions) after
+ * some prefix of the string has been read.  States are kept in a small
+ * hash table, and each remembers the states that follow it, indexed by
+ * character class, as they are computed.  A state and its arrays are
+ * allocated as a single block.
+ */
+
+typedef struct DfaState {
+    struct DfaState *hashNext;	/* Next state in the same bucket. */
+    unsigned long hash;		/* Hash value of members and isMatch. */
+    int isMatch;		/* Non-zero means that NFA_MATCH has been
+				 * reached:  the string matches. */
+    int numMembers;		/* Number of entries in members. */
+    short *members;		/* Waiting instructions, in increasing
+				 * order. */
+    struct DfaState **next;	/* Successor state for each character
+				 * class, or NULL if not known yet. */
+} DfaState;
+
+#define DFA_BUCKETS	16
+#define MAX_DFA_STATES	32
+
+/*
+ * Skipping ahead with strpbrk is only worthwhile if few characters can
+ * begin a match.
+ */
+
+#define MAX_FIRST_CHARS	16
+
+/*
+ * The structure below holds the NFA for a compiled regular expression,
+ * along with the DFA states built from it and scratch space for
+ * matching.  It is created the first time the expression is matched by
+ * TclExecRegexp and freed along with the expression by TclFreeRegexp.
+ */
+
+typedef struct RegNfa {
+    NfaInst *inst;		/* Instructions of the NFA. */
+    int numInst;		/* Number of instructions. */
+    int start;			/* Index of the first instruction. */
+    unsigned char *sets;	/* Character sets for NFA_CLASS, SET_BYTES
+				 * bytes (a bit per character) each. */
+    int numSlots;		/* Number of submatch slots:  two for the
+				 * whole match and two for each
+				 * parenthesized subexpression. */
+    unsigned char charClass[256];
+				/* Characters that no instruction tells
+				 * apart share a class;  this maps each
+				 * character to its class. */
+    int numClasses;		/* Number of character classes. */
+    DfaState *buckets[DFA_BUCKETS];
+				/* Hash table of the DFA states built so
+				 * far. */
+    int numStates;		/* Number of states in buckets. */
+    int numFlushes;		/* Number of times the states have been
+				 * discarded to bound their memory. */
+    DfaState *initialPtr;	/* State at the start of the string, or
+				 * NULL if it hasn't been built. */
+    DfaState *restartPtr;	/* State at any later position when no
+				 * match is in progress, or NULL if it
+				 * hasn't been built. */
+    char *prefix;		/* String every match begins with (from
+				 * regcomp), or NULL. */
+    char *firstChars;		/* Null-terminated string of the characters
+				 * a match can begin with, or NULL.  Not
+				 * needed if prefix isn't NULL.  Malloc-ed. */
+    int canSkip;		/* Non-zero means prefix or firstChars can
+				 * be used to skip to the next place a
+				 * match could begin. */
+    unsigned long *marks;	/* Value of gen when each instruction was
+				 * last visited. */
+    unsigned long gen;		/* Incremented to forget all marks. */
+    short *stack;		/* Scratch stack for AddClosure. */
+    short *work;		/* Members of the DFA state being built. */
+    int numWork;		/* Number of entries in work. */
+    int workMatch;		/* Non-zero means NFA_MATCH was reached
+				 * while building the state. */
+    short *threadPc[2];		/* Two lists of NFA threads (current and
+				 * next) for NfaMatch:  instruction at which
+				 * each thread waits... */
+    char **threadSlots[2];	/* ...and its submatch positions, numSlots
+				 * per thread.  NULL until first needed. */
+    int numThreads[2];		/* Number of threads in each list. */
+    char **slots;		/* Scratch submatch positions. */
+    int useSlots;		/* Number of slots kept during the current
+				 * NfaMatch call. */
+} RegNfa;
+
+/*
+ * Forward declarations for procedures defined in this file:
+ */
+
+static void		AddClosure _ANSI_ARGS_((RegNfa *nfaPtr, int pc,
+			    int atStart, int atEnd));
+static void		AddThread _ANSI_ARGS_((RegNfa *nfaPtr, int list,
+			    int pc, char **slots, char *sp, char *string));
+static int		DfaMatch _ANSI_ARGS_((RegNfa *nfaPtr, char *string,
+			    char *start));
+static DfaState *	DfaStep _ANSI_ARGS_((RegNfa *nfaPtr,
+			    DfaState *statePtr, int c));
+static DfaState *	FindState _ANSI_ARGS_((RegNfa *nfaPtr));
+static void		FlushStates _ANSI_ARGS_((RegNfa *nfaPtr));
+static char *		NextCandidate _ANSI_ARGS_((RegNfa *nfaPtr, char *p));
+static RegNfa *		NfaCompile _ANSI_ARGS_((regexp *regexpPtr));
+static int		NfaMatch _ANSI_ARGS_((RegNfa *nfaPtr, char *string,
+			    char *start, char **result));
+static char *		NodeAfter _ANSI_ARGS_((char *node));
+static DfaState *	StartState _ANSI_ARGS_((RegNfa *nfaPtr, int atStart));
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclExecRegexp --
+ *
+ *	Match a compiled regular expression against the part of a string
+ *	from start on;  "^" matches only at the beginning of the whole
+ *	string, so a search can be resumed after an earlier match.  Patterns
+ *	that use alternation or repetition (those for which regcomp sets
+ *	reglinear) are matched with the NFA in this file, in time
+ *	linear in the length of the string;  others are simple enough
+ *	for regexec.
+ *
+ * Results:
+ *	Returns 1 if string matches the expression, 0 otherwise.  If it
+ *	matches, the startp and endp fields of regexpPtr give the match
+ *	and submatches, as with regexec.  When numSubs is zero and the
+ *	NFA is used, only the result is computed:  startp and endp are
+ *	all set to NULL.
+ *
+ * Side effects:
+ *	The NFA for the expression is built on first use, and DFA states
+ *	are added to it.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclExecRegexp(regexpPtr, string, start, numSubs)
+    regexp *regexpPtr;			/* Compiled regular expression. */
+    char *string;			/* String to match against. */
+    char *start;			/* Where in string to start looking
+					 * for a match. */
+    int numSubs;			/* Number of startp/endp pairs the
+					 * caller needs, counting the whole
+					 * match;  0 means the caller needs
+					 * only to know whether there is a
+					 * match. */
+{
+    register RegNfa *nfaPtr;
+    char *result[2*NSUBEXP];
+    int i;
+
+    if (!regexpPtr->reglinear) {
+	return regexecfrom(regexpPtr, string, start);
+    }
+    nfaPtr = regexpPtr->regnfa;
+    if (nfaPtr == NULL) {
+	nfaPtr = regexpPtr->regnfa = NfaCompile(regexpPtr);
+    }
+    for (i = 0; i < NSUBEXP; i++) {
+	regexpPtr->startp[i] = regexpPtr->endp[i] = NULL;
+    }
+    if ((regexpPtr->regmust != NULL)
+	    && (regexpPtr->regmust != regexpPtr->regprefix)
+	    && (strstr(start, regexpPtr->regmust) == NULL)) {
+	return 0;
+    }
+    if (!DfaMatch(nfaPtr, string, start)) {
+	return 0;
+    }
+    if (numSubs <= 0) {
+	return 1;
+    }
+
+    /*
+     * The string matches;  now find out where.
+     */
+
+    nfaPtr->useSlots = 2*numSubs;
+    if (nfaPtr->useSlots > nfaPtr->numSlots) {
+	nfaPtr->useSlots = nfaPtr->numSlots;
+    }
+    if (NfaMatch(nfaPtr, string, start, result)) {
+	for (i = 0; i < nfaPtr->useSlots/2; i++) {
+	    regexpPtr->startp[i] = result[2*i];
+	    regexpPtr->endp[i] = result[2*i + 1];
+	}
+    }
+    return 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclFreeRegexp --
+ *
+ *	Free a regular expression compiled by regcomp, along with its
+ *	NFA if TclExecRegexp has built one.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Storage is released.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclFreeRegexp(regexpPtr)
+    regexp *regexpPtr;			/* Expression to free. */
+{
+    register RegNfa *nfaPtr = regexpPtr->regnfa;
+    int i;
+
+    if (nfaPtr != NULL) {
+	FlushStates(nfaPtr);
+	ckfree((char *) nfaPtr->inst);
+	if (nfaPtr->sets != NULL) {
+	    ckfree((char *) nfaPtr->sets);
+	}
+	ckfree((char *) nfaPtr->marks);
+	ckfree((char *) nfaPtr->stack);
+	ckfree((char *) nfaPtr->work);
+	if (nfaPtr->firstChars != NULL) {
+	    ckfree(nfaPtr->firstChars);
+	}
+	for (i = 0; i < 2; i++) {
+	    if (nfaPtr->threadSlots[i] != NULL) {
+		ckfree((char *) nfaPtr->threadPc[i]);
+		ckfree((char *) nfaPtr->threadSlots[i]);
+	    }
+	}
+	if (nfaPtr->slots != NULL) {
+	    ckfree((char *) nfaPtr->slots);
+	}
+	ckfree((char *) nfaPtr);
+    }
+    ckfree((char *) regexpPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NodeAfter --
+ *
+ *	Find the node that follows a given one in the storage of a
+ *	program built by regcomp (not the node it leads to).
+ *
+ * Results:
+ *	The address of the following node.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static char *
+NodeAfter(node)
+    char *node;				/* Node in a regcomp program. */
+{
+    int op = OP(node);
+
+    node += 3;
+    if ((op == ANYOF) || (op == ANYBUT) || (op == EXACTLY)) {
+	node += strlen(node) + 1;
+    }
+    return node;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NfaCompile --
+ *
+ *	Translate the program built by regcomp into an NFA.  Each node
+ *	of the program becomes one instruction, except that an EXACTLY
+ *	node becomes one instruction per character and a PLUS node
+ *	becomes two (a jump to its operand and a loop back to it).  The
+ *	operand of a STAR or PLUS node, which has no successor of its
+ *	own, continues at the loop.
+ *
+ * Results:
+ *	The return value is a pointer to the new NFA.
+ *
+ * Side effects:
+ *	Storage is allocated.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static RegNfa *
+NfaCompile(regexpPtr)
+    regexp *regexpPtr;			/* Compiled expression. */
+{
+    register RegNfa *nfaPtr;
+    register NfaInst *instPtr;
+    char *program = regexpPtr->program;
+    char *scan, *nextNode, *loopNode, *s;
+    short *nodeIndex, *remap;
+    unsigned char *setPtr;
+    int length, numInst, numSets, numGroups, follow, i, c, n;
+
+    /*
+     * First pass:  find the size of the program and of the NFA, and
+     * the instruction at which each node starts.  END is always the
+     * last node in the program.
+     */
+
+    for (scan = program + 1; OP(scan) != END; scan = NodeAfter(scan)) {
+	/* Empty loop body. */
+    }
+    length = NodeAfter(scan) - program;
+    nodeIndex = (short *) ckalloc((unsigned) (length * sizeof(short)));
+    numInst = numSets = numGroups = 0;
+    for (scan = program + 1; ; scan = NodeAfter(scan)) {
+	nodeIndex[scan - program] = numInst;
+	switch (OP(scan)) {
+	    case EXACTLY:
+		numInst += strlen(OPERAND(scan));
+		break;
+	    case PLUS:
+		numInst += 2;
+		break;
+	    case ANY:
+	    case ANYOF:
+	    case ANYBUT:
+		numSets++;
+		numInst++;
+		break;
+	    default:
+		if ((OP(scan) > OPEN) && (OP(scan) < CLOSE)
+			&& (OP(scan) - OPEN > numGroups)) {
+		    numGroups = OP(scan) - OPEN;
+		}
+		numInst++;
+		break;
+	}
+	if (OP(scan) == END) {
+	    break;
+	}
+    }
+
+    nfaPtr = (RegNfa *) ckalloc(sizeof(RegNfa));
+    nfaPtr->inst = (NfaInst *) ckalloc((unsigned)
+	    (numInst * sizeof(NfaInst)));
+    nfaPtr->numInst = numInst;
+    nfaPtr->start = 0;
+    if (numSets > 0) {
+	nfaPtr->sets = (unsigned char *) ckalloc((unsigned)
+		(numSets * SET_BYTES));
+	memset((VOID *) nfaPtr->sets, 0, numSets * SET_BYTES);
+    } else {
+	nfaPtr->sets = NULL;
+    }
+    nfaPtr->numSlots = 2*(numGroups + 1);
+
+    /*
+     * Second pass:  generate the instructions.
+     */
+
+    numSets = 0;
+    loopNode = NULL;
+    for (scan = program + 1; ; scan = NodeAfter(scan)) {
+	instPtr = &nfaPtr->inst[nodeIndex[scan - program]];
+	if (loopNode != NULL) {
+	    follow = nodeIndex[loopNode - program];
+	    if (OP(loopNode) == PLUS) {
+		follow++;
+	    }
+	    loopNode = NULL;
+	} else {
+	    n = NEXT(scan);
+	    if (n == 0) {
+		follow = 0;
+	    } else if (OP(scan) == BACK) {
+		follow = nodeIndex[scan - n - program];
+	    } else {
+		follow = nodeIndex[scan + n - program];
+	    }
+	}
+	instPtr->arg = 0;
+	instPtr->next = follow;
+	instPtr->alt = 0;
+	switch (OP(scan)) {
+	    case END:
+		instPtr->op = NFA_MATCH;
+		break;
+	    case BOL:
+		instPtr->op = NFA_BOL;
+		break;
+	    case EOL:
+		instPtr->op = NFA_EOL;
+		break;
+	    case ANY:
+	    case ANYOF:
+	    case ANYBUT:
+		instPtr->op = NFA_CLASS;
+		instPtr->alt = numSets;
+		setPtr = nfaPtr->sets + numSets*SET_BYTES;
+		numSets++;
+		if (OP(scan) == ANYOF) {
+		    for (s = OPERAND(scan); *s != 0; s++) {
+			setPtr[UCHAR(*s) >> 3] |= 1 << (UCHAR(*s) & 7);
+		    }
+		} else {
+		    memset((VOID *) setPtr, 0xff, SET_BYTES);
+		    setPtr[0] &= ~1;
+		    if (OP(scan) == ANYBUT) {
+			for (s = OPERAND(scan); *s != 0; s++) {
+			    setPtr[UCHAR(*s) >> 3] &= ~(1 << (UCHAR(*s) & 7));
+			}
+		    }
+		}
+		break;
+	    case EXACTLY:
+		for (s = OPERAND(scan); *s != 0; s++, instPtr++) {
+		    instPtr->op = NFA_CHAR;
+		    instPtr->arg = UCHAR(*s);
+		    instPtr->alt = 0;
+		    instPtr->next = (s[1] == 0) ? follow
+			    : (instPtr - nfaPtr->inst) + 1;
+		}
+		break;
+	    case BRANCH:
+
+		/*
+		 * A BRANCH followed by another is a choice between their
+		 * operands;  the last (or only) BRANCH of a set leads on
+		 * to its operand alone.
+		 */
+
+		nextNode = scan + NEXT(scan);
+		if (OP(nextNode) == BRANCH) {
+		    instPtr->op = NFA_SPLIT;
+		    instPtr->next = nodeIndex[OPERAND(scan) - program];
+		    instPtr->alt = follow;
+		} else {
+		    instPtr->op = NFA_JUMP;
+		    instPtr->next = nodeIndex[OPERAND(scan) - program];
+		}
+		break;
+	    case STAR:
+		instPtr->op = NFA_SPLIT;
+		instPtr->next = nodeIndex[OPERAND(scan) - program];
+		instPtr->alt = follow;
+		loopNode = scan;
+		break;
+	    case PLUS:
+		instPtr->op = NFA_JUMP;
+		instPtr->next = nodeIndex[OPERAND(scan) - program];
+		instPtr++;
+		instPtr->op = NFA_SPLIT;
+		instPtr->arg = 0;
+		instPtr->next = nodeIndex[OPERAND(scan) - program];
+		instPtr->alt = follow;
+		loopNode = scan;
+		break;
+	    default:
+		c = OP(scan);
+		if ((c > OPEN) && (c < CLOSE)) {
+		    instPtr->op = NFA_SAVE;
+		    instPtr->arg = 2*(c - OPEN);
+		} else if (c > CLOSE) {
+		    instPtr->op = NFA_SAVE;
+		    instPtr->arg = 2*(c - CLOSE) + 1;
+		} else {
+		    /* BACK and NOTHING. */
+		    instPtr->op = NFA_JUMP;
+		}
+		break;
+	}
+	if (OP(scan) == END) {
+	    break;
+	}
+    }
+    ckfree((char *) nodeIndex);
+
+    /*
+     * Divide the characters into classes that no instruction tells
+     * apart, refining the partition by one instruction at a time.
+     */
+
+    memset((VOID *) nfaPtr->charClass, 0, sizeof(nfaPtr->charClass));
+    nfaPtr->numClasses = 1;
+    remap = (short *) ckalloc(2*256*sizeof(short));
+    for (instPtr = nfaPtr->inst; instPtr < nfaPtr->inst + numInst;
+	    instPtr++) {
+	if ((instPtr->op != NFA_CHAR) && (instPtr->op != NFA_CLASS)) {
+	    continue;
+	}
+	for (i = 0; i < 2*nfaPtr->numClasses; i++) {
+	    remap[i] = -1;
+	}
+	n = 0;
+	setPtr = nfaPtr->sets + instPtr->alt*SET_BYTES;
+	for (c = 0; c < 256; c++) {
+	    i = 2*nfaPtr->charClass[c];
+	    if ((instPtr->op == NFA_CHAR) ? (c == instPtr->arg)
+		    : IN_SET(setPtr, c)) {
+		i++;
+	    }
+	    if (remap[i] < 0) {
+		remap[i] = n++;
+	    }
+	    nfaPtr->charClass[c] = remap[i];
+	}
+	nfaPtr->numClasses = n;
+    }
+    ckfree((char *) remap);
+
+    for (i = 0; i < DFA_BUCKETS; i++) {
+	nfaPtr->buckets[i] = NULL;
+    }
+    nfaPtr->numStates = 0;
+    nfaPtr->numFlushes = 0;
+    nfaPtr->initialPtr = NULL;
+    nfaPtr->restartPtr = NULL;
+    nfaPtr->marks = (unsigned long *) ckalloc((unsigned)
+	    (numInst * sizeof(unsigned long)));
+    for (i = 0; i < numInst; i++) {
+	nfaPtr->marks[i] = 0;
+    }
+    nfaPtr->gen = 0;
+    nfaPtr->stack = (short *) ckalloc((unsigned) (numInst * sizeof(short)));
+    nfaPtr->work = (short *) ckalloc((unsigned) (numInst * sizeof(short)));
+    nfaPtr->numWork = 0;
+    nfaPtr->workMatch = 0;
+    for (i = 0; i < 2; i++) {
+	nfaPtr->threadPc[i] = NULL;
+	nfaPtr->threadSlots[i] = NULL;
+	nfaPtr->numThreads[i] = 0;
+    }
+    nfaPtr->slots = NULL;
+    nfaPtr->useSlots = 0;
+
+    /*
+     * Find the characters with which a match can begin (other than at
+     * the start of the string).  If a match can be empty or end with
+     * "$" there is no point, since it could begin anywhere.
+     */
+
+    nfaPtr->prefix = regexpPtr->regprefix;
+    nfaPtr->firstChars = NULL;
+    nfaPtr->canSkip = (nfaPtr->prefix != NULL);
+    if (!nfaPtr->canSkip) {
+	char chars[MAX_FIRST_CHARS+1];
+
+	nfaPtr->gen++;
+	nfaPtr->numWork = 0;
+	nfaPtr->workMatch = 0;
+	AddClosure(nfaPtr, nfaPtr->start, 0, 0);
+	n = 0;
+	for (i = 0; i < nfaPtr->numWork; i++) {
+	    if (nfaPtr->inst[nfaPtr->work[i]].op == NFA_EOL) {
+		break;
+	    }
+	}
+	if ((i == nfaPtr->numWork) && !nfaPtr->workMatch) {
+	    for (c = 1; (c < 256) && (n <= MAX_FIRST_CHARS); c++) {
+		for (i = 0; i < nfaPtr->numWork; i++) {
+		    instPtr = &nfaPtr->inst[nfaPtr->work[i]];
+		    if ((instPtr->op == NFA_CHAR) ? (c == instPtr->arg)
+			    : IN_SET(nfaPtr->sets + instPtr->alt*SET_BYTES,
+			    c)) {
+			if (n < MAX_FIRST_CHARS) {
+			    chars[n] = c;
+			}
+			n++;
+			break;
+		    }
+		}
+	    }
+	    if ((n > 0) && (n <= MAX_FIRST_CHARS)) {
+		chars[n] = 0;
+		nfaPtr->firstChars = (char *) ckalloc((unsigned) (n + 1));
+		strcpy(nfaPtr->firstChars, chars);
+		nfaPtr->canSkip = 1;
+	    }
+	}
+    }
+    return nfaPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NextCandidate --
+ *
+ *	Find the next position in a string at which a match could begin,
+ *	using the prefix or first characters of an NFA.
+ *
+ * Results:
+ *	The return value is the first position at or after p at which
+ *	a match could begin, or NULL if there is none.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static char *
+NextCandidate(nfaPtr, p)
+    register RegNfa *nfaPtr;		/* NFA whose canSkip is set. */
+    char *p;				/* Position to search from. */
+{
+    if (nfaPtr->prefix != NULL) {
+	if (nfaPtr->prefix[1] == 0) {
+	    return strchr(p, nfaPtr->prefix[0]);
+	}
+	return strstr(p, nfaPtr->prefix);
+    }
+    if (nfaPtr->firstChars[1] == 0) {
+	return strchr(p, nfaPtr->firstChars[0]);
+    }
+    return strpbrk(p, nfaPtr->firstChars);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AddClosure --
+ *
+ *	Add to the DFA state being built (nfaPtr->work) the NFA
+ *	instructions that wait for a character and can be reached from
+ *	a given instruction without consuming any.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Instructions are added to nfaPtr->work and marked with the
+ *	current generation;  nfaPtr->workMatch is set if NFA_MATCH can
+ *	be reached.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+AddClosure(nfaPtr, pc, atStart, atEnd)
+    register RegNfa *nfaPtr;		/* NFA whose DFA is being built. */
+    int pc;				/* Instruction to start from. */
+    int atStart;			/* Non-zero means the position is
+					 * the start of the string. */
+    int atEnd;				/* Non-zero means the position is
+					 * the end of the string. */
+{
+    register NfaInst *instPtr;
+    int depth = 0;
+
+#define PUSH(i) \
+    if (nfaPtr->marks[i] != nfaPtr->gen) { \
+	nfaPtr->marks[i] = nfaPtr->gen; \
+	nfaPtr->stack[depth++] = (i); \
+    }
+
+    PUSH(pc);
+    while (depth > 0) {
+	pc = nfaPtr->stack[--depth];
+	instPtr = &nfaPtr->inst[pc];
+	switch (instPtr->op) {
+	    case NFA_CHAR:
+	    case NFA_CLASS:
+		nfaPtr->work[nfaPtr->numWork++] = pc;
+		break;
+	    case NFA_BOL:
+		if (atStart) {
+		    PUSH(instPtr->next);
+		}
+		break;
+	    case NFA_EOL:
+		if (atEnd) {
+		    PUSH(instPtr->next);
+		} else {
+		    nfaPtr->work[nfaPtr->numWork++] = pc;
+		}
+		break;
+	    case NFA_SPLIT:
+		PUSH(instPtr->alt);
+		PUSH(instPtr->next);
+		break;
+	    case NFA_JUMP:
+	    case NFA_SAVE:
+		PUSH(instPtr->next);
+		break;
+	    case NFA_MATCH:
+		nfaPtr->workMatch = 1;
+		break;
+	}
+    }
+#undef PUSH
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FindState --
+ *
+ *	Find the DFA state whose members are those in nfaPtr->work,
+ *	creating it if it doesn't exist yet.  If the maximum number of
+ *	states already exists, they are all discarded first.
+ *
+ * Results:
+ *	The return value is a pointer to the state.
+ *
+ * Side effects:
+ *	The entries in nfaPtr->work are sorted.  A state may be created
+ *	and others freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static DfaState *
+FindState(nfaPtr)
+    register RegNfa *nfaPtr;		/* NFA whose DFA is being built. */
+{
+    register DfaState *statePtr;
+    short *work = nfaPtr->work;
+    int numWork = nfaPtr->numWork;
+    unsigned long hash;
+    int i, j, pc;
+
+    for (i = 1; i < numWork; i++) {
+	pc = work[i];
+	for (j = i; (j > 0) && (work[j-1] > pc); j--) {
+	    work[j] = work[j-1];
+	}
+	work[j] = pc;
+    }
+    hash = nfaPtr->workMatch;
+    for (i = 0; i < numWork; i++) {
+	hash = hash*9 + work[i];
+    }
+    for (statePtr = nfaPtr->buckets[hash % DFA_BUCKETS]; statePtr != NULL;
+	    statePtr = statePtr->hashNext) {
+	if ((statePtr->hash == hash) && (statePtr->numMembers == numWork)
+		&& (statePtr->isMatch == nfaPtr->workMatch)
+		&& (memcmp((VOID *) statePtr->members, (VOID *) work,
+		numWork * sizeof(short)) == 0)) {
+	    return statePtr;
+	}
+    }
+
+    if (nfaPtr->numStates >= MAX_DFA_STATES) {
+	FlushStates(nfaPtr);
+    }
+    statePtr = (DfaState *) ckalloc((unsigned) (sizeof(DfaState)
+	    + nfaPtr->numClasses * sizeof(DfaState *)
+	    + numWork * sizeof(short)));
+    statePtr->hash = hash;
+    statePtr->isMatch = nfaPtr->workMatch;
+    statePtr->numMembers = numWork;
+    statePtr->next = (DfaState **) (statePtr + 1);
+    for (i = 0; i < nfaPtr->numClasses; i++) {
+	statePtr->next[i] = NULL;
+    }
+    statePtr->members = (short *) (statePtr->next + nfaPtr->numClasses);
+    memcpy((VOID *) statePtr->members, (VOID *) work,
+	    numWork * sizeof(short));
+    statePtr->hashNext = nfaPtr->buckets[hash % DFA_BUCKETS];
+    nfaPtr->buckets[hash % DFA_BUCKETS] = statePtr;
+    nfaPtr->numStates++;
+    return statePtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FlushStates --
+ *
+ *	Discard all of the DFA states built for an NFA.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Storage is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FlushStates(nfaPtr)
+    register RegNfa *nfaPtr;		/* NFA whose states are to go. */
+{
+    register DfaState *statePtr;
+    int i;
+
+    for (i = 0; i < DFA_BUCKETS; i++) {
+	while (nfaPtr->buckets[i] != NULL) {
+	    statePtr = nfaPtr->buckets[i];
+	    nfaPtr->buckets[i] = statePtr->hashNext;
+	    ckfree((char *) statePtr);
+	}
+    }
+    nfaPtr->numStates = 0;
+    nfaPtr->numFlushes++;
+    nfaPtr->initialPtr = NULL;
+    nfaPtr->restartPtr = NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * StartState --
+ *
+ *	Find the DFA state in which a match may begin, either at the
+ *	start of the string or elsewhere.
+ *
+ * Results:
+ *	The return value is a pointer to the state.
+ *
+ * Side effects:
+ *	The state may be created, and others discarded.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static DfaState *
+StartState(nfaPtr, atStart)
+    register RegNfa *nfaPtr;		/* NFA whose DFA is being built. */
+    int atStart;			/* Non-zero means the state for the
+					 * start of the string. */
+{
+    nfaPtr->gen++;
+    nfaPtr->numWork = 0;
+    nfaPtr->workMatch = 0;
+    AddClosure(nfaPtr, nfaPtr->start, atStart, 0);
+    return FindState(nfaPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DfaStep --
+ *
+ *	Compute the DFA state that follows a given one when a given
+ *	character is read, and remember it in the given state.  Since
+ *	the match may begin at any position, the start of the NFA is
+ *	always part of the new state.
+ *
+ * Results:
+ *	The return value is a pointer to the following state.
+ *
+ * Side effects:
+ *	States may be created, or all discarded (including statePtr)
+ *	and the restart state rebuilt.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static DfaState *
+DfaStep(nfaPtr, statePtr, c)
+    register RegNfa *nfaPtr;		/* NFA whose DFA is being built. */
+    DfaState *statePtr;			/* State before the character. */
+    int c;				/* Character read (not 0). */
+{
+    register NfaInst *instPtr;
+    DfaState *nextPtr;
+    int i, numFlushes;
+
+    nfaPtr->gen++;
+    nfaPtr->numWork = 0;
+    nfaPtr->workMatch = 0;
+    for (i = 0; i < statePtr->numMembers; i++) {
+	instPtr = &nfaPtr->inst[statePtr->members[i]];
+	if ((instPtr->op == NFA_CHAR) ? (c == instPtr->arg)
+		: ((instPtr->op == NFA_CLASS)
+		&& IN_SET(nfaPtr->sets + instPtr->alt*SET_BYTES, c))) {
+	    AddClosure(nfaPtr, instPtr->next, 0, 0);
+	}
+    }
+    AddClosure(nfaPtr, nfaPtr->start, 0, 0);
+    numFlushes = nfaPtr->numFlushes;
+    nextPtr = FindState(nfaPtr);
+    if (nfaPtr->numFlushes == numFlushes) {
+	statePtr->next[nfaPtr->charClass[c]] = nextPtr;
+    } else {
+	/*
+	 * The states were discarded, so DfaMatch needs the restart
+	 * state again.  With so few states left, finding it won't
+	 * discard nextPtr.
+	 */
+
+	nfaPtr->restartPtr = StartState(nfaPtr, 0);
+    }
+    return nextPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DfaMatch --
+ *
+ *	Run the DFA for an NFA over a string to find out whether the
+ *	string matches.
+ *
+ * Results:
+ *	Returns 1 if the string matches, 0 otherwise.
+ *
+ * Side effects:
+ *	DFA states may be created.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+DfaMatch(nfaPtr, string, start)
+    register RegNfa *nfaPtr;		/* NFA to match with. */
+    char *string;			/* String to match against. */
+    char *start;			/* Where in string to start. */
+{
+    register DfaState *statePtr, *nextPtr;
+    register char *p;
+    int i;
+
+    /*
+     * Building either start state may discard the other, but not
+     * twice in a row.
+     */
+
+    while ((nfaPtr->initialPtr == NULL) || (nfaPtr->restartPtr == NULL)) {
+	if (nfaPtr->restartPtr == NULL) {
+	    nfaPtr->restartPtr = StartState(nfaPtr, 0);
+	}
+	if (nfaPtr->initialPtr == NULL) {
+	    nfaPtr->initialPtr = StartState(nfaPtr, 1);
+	}
+    }
+    statePtr = (start == string) ? nfaPtr->initialPtr : nfaPtr->restartPtr;
+    for (p = start; ; p++) {
+	if (statePtr->isMatch) {
+	    return 1;
+	}
+	if ((statePtr == nfaPtr->restartPtr) && nfaPtr->canSkip) {
+	    p = NextCandidate(nfaPtr, p);
+	    if (p == NULL) {
+		return 0;
+	    }
+	}
+	if (*p == 0) {
+	    break;
+	}
+	if (statePtr->numMembers == 0) {
+	    /*
+	     * Only possible if the pattern is anchored at the start.
+	     */
+
+	    return 0;
+	}
+	nextPtr = statePtr->next[nfaPtr->charClass[UCHAR(*p)]];
+	if (nextPtr == NULL) {
+	    nextPtr = DfaStep(nfaPtr, statePtr, UCHAR(*p));
+	}
+	statePtr = nextPtr;
+    }
+
+    /*
+     * At the end of the string, the string matches if an NFA_EOL
+     * instruction waiting in the final state leads to NFA_MATCH.
+     */
+
+    nfaPtr->gen++;
+    nfaPtr->numWork = 0;
+    nfaPtr->workMatch = 0;
+    for (i = 0; i < statePtr->numMembers; i++) {
+	if (nfaPtr->inst[statePtr->members[i]].op == NFA_EOL) {
+	    AddClosure(nfaPtr, nfaPtr->inst[statePtr->members[i]].next,
+		    p == string, 1);
+	}
+    }
+    return nfaPtr->workMatch;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AddThread --
+ *
+ *	Add a thread to one of NfaMatch's thread lists, following the
+ *	instructions that don't consume characters.  Threads are added
+ *	in order of preference, and an instruction already reached by a
+ *	more preferred thread is not added again.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Threads are added to the list.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+AddThread(nfaPtr, list, pc, slots, sp, string)
+    register RegNfa *nfaPtr;		/* NFA being simulated. */
+    int list;				/* Index of list to add to. */
+    int pc;				/* Instruction reached. */
+    char **slots;			/* Submatch positions of thread. */
+    char *sp;				/* Current position in string. */
+    char *string;			/* Start of string. */
+{
+    register NfaInst *instPtr;
+    char *saved;
+    int n;
+
+    if (nfaPtr->marks[pc] == nfaPtr->gen) {
+	return;
+    }
+    nfaPtr->marks[pc] = nfaPtr->gen;
+    instPtr = &nfaPtr->inst[pc];
+    switch (instPtr->op) {
+	case NFA_JUMP:
+	    AddThread(nfaPtr, list, instPtr->next, slots, sp, string);
+	    break;
+	case NFA_SPLIT:
+	    AddThread(nfaPtr, list, instPtr->next, slots, sp, string);
+	    AddThread(nfaPtr, list, instPtr->alt, slots, sp, string);
+	    break;
+	case NFA_SAVE:
+	    if (instPtr->arg < nfaPtr->useSlots) {
+		saved = slots[instPtr->arg];
+		slots[instPtr->arg] = sp;
+		AddThread(nfaPtr, list, instPtr->next, slots, sp, string);
+		slots[instPtr->arg] = saved;
+	    } else {
+		AddThread(nfaPtr, list, instPtr->next, slots, sp, string);
+	    }
+	    break;
+	case NFA_BOL:
+	    if (sp == string) {
+		AddThread(nfaPtr, list, instPtr->next, slots, sp, string);
+	    }
+	    break;
+	case NFA_EOL:
+	    if (*sp == 0) {
+		AddThread(nfaPtr, list, instPtr->next, slots, sp, string);
+	    }
+	    break;
+	default:
+	    n = nfaPtr->numThreads[list]++;
+	    nfaPtr->threadPc[list][n] = pc;
+	    memcpy((VOID *) (nfaPtr->threadSlots[list] + n*nfaPtr->useSlots),
+		    (VOID *) slots, nfaPtr->useSlots * sizeof(char *));
+	    break;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NfaMatch --
+ *
+ *	Simulate an NFA over a string, keeping the submatch positions
+ *	of each thread, to find the match that regexec would find.
+ *
+ * Results:
+ *	Returns 1 if the string matches, 0 otherwise.  If it matches,
+ *	the first nfaPtr->useSlots entries of result are filled in with
+ *	the start and end of the match and of each submatch (or NULL
+ *	for submatches that didn't take part).
+ *
+ * Side effects:
+ *	The thread lists are allocated on first use.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+NfaMatch(nfaPtr, string, start, result)
+    register RegNfa *nfaPtr;		/* NFA to simulate. */
+    char *string;			/* String to match against. */
+    char *start;			/* Where in string to start. */
+    char **result;			/* Where to store the positions. */
+{
+    register NfaInst *instPtr;
+    register char *sp;
+    char **slots, *p;
+    int cur, next, i, c, matched;
+
+    if (nfaPtr->slots == NULL) {
+	for (i = 0; i < 2; i++) {
+	    nfaPtr->threadPc[i] = (short *) ckalloc((unsigned)
+		    (nfaPtr->numInst * sizeof(short)));
+	    nfaPtr->threadSlots[i] = (char **) ckalloc((unsigned)
+		    (nfaPtr->numInst * nfaPtr->numSlots * sizeof(char *)));
+	}
+	nfaPtr->slots = (char **) ckalloc((unsigned)
+		(nfaPtr->numSlots * sizeof(char *)));
+    }
+
+    cur = 0;
+    matched = 0;
+    nfaPtr->numThreads[cur] = 0;
+    nfaPtr->gen++;
+    for (i = 0; i < nfaPtr->useSlots; i++) {
+	nfaPtr->slots[i] = NULL;
+    }
+    nfaPtr->slots[0] = start;
+    AddThread(nfaPtr, cur, nfaPtr->start, nfaPtr->slots, start, string);
+    for (sp = start; ; sp++) {
+	c = UCHAR(*sp);
+	next = 1 - cur;
+	nfaPtr->numThreads[next] = 0;
+	nfaPtr->gen++;
+	for (i = 0; i < nfaPtr->numThreads[cur]; i++) {
+	    instPtr = &nfaPtr->inst[nfaPtr->threadPc[cur][i]];
+	    slots = nfaPtr->threadSlots[cur] + i*nfaPtr->useSlots;
+	    if (instPtr->op == NFA_MATCH) {
+		/*
+		 * Threads after this one are less preferred, so they
+		 * can't lead to the match regexec would report.
+		 */
+
+		memcpy((VOID *) result, (VOID *) slots,
+			nfaPtr->useSlots * sizeof(char *));
+		result[1] = sp;
+		matched = 1;
+		break;
+	    }
+	    if ((instPtr->op == NFA_CHAR) ? (c == instPtr->arg)
+		    : ((c != 0) && IN_SET(nfaPtr->sets
+		    + instPtr->alt*SET_BYTES, c))) {
+		AddThread(nfaPtr, next, instPtr->next, slots, sp+1, string);
+	    }
+	}
+	if (c == 0) {
+	    break;
+	}
+	if (!matched) {
+	    /*
+	     * Start a least preferred thread at the next position, in
+	     * case the match begins there.  If there are no other
+	     * threads, skip to the next position where it could.
+	     */
+
+	    if ((nfaPtr->numThreads[next] == 0) && nfaPtr->canSkip) {
+		p = NextCandidate(nfaPtr, sp+1);
+		if (p == NULL) {
+		    break;
+		}
+		sp = p - 1;
+	    }
+	    for (i = 0; i < nfaPtr->useSlots; i++) {
+		nfaPtr->slots[i] = NULL;
+	    }
+	    nfaPtr->slots[0] = sp+1;
+	    AddThread(nfaPtr, next, nfaPtr->start, nfaPtr->slots, sp+1,
+		    string);
+	}
+	cur = next;
+	if (matched && (nfaPtr->numThreads[cur] == 0)) {
+	    break;
+	}
+    }
+    return matched;
+}
@@ -93,10 +93,39 @@ char tclTypeTable[] = {
     TCL_NORMAL,        TCL_CLOSE_BRACE,   TCL_NORMAL,        TCL_NORMAL,
 };
 
+/*
+ * Arena allocations are rounded up to a multiple of the following
+ * size, so that each one is aligned well enough to hold an argv array.
+ */
+
+#define ARENA_ALIGN(size) \
+    (((size) + sizeof(double) - 1) & ~(sizeof(double) - 1))
+
 /*
  * Function prototypes for procedures local to this file:
  */
 
+static void	AppendText _ANSI_ARGS_((ParseValue *pvPtr, char *string,
+		    int length));
+static void	ArenaNewChunk _ANSI_ARGS_((Interp *iPtr, int size));
+static void	FlushText _ANSI_ARGS_((ParsedWord *wordPtr,
+		    ParseValue *pvPtr, int end));
+static void	FreeWord _ANSI_ARGS_((ParsedWord *wordPtr));
+static VOID *	GrowArray _ANSI_ARGS_((VOID *array, int num,
+		    unsigned size));
+static ParsedPart *	NewPart _ANSI_ARGS_((ParsedWord *wordPtr, int type,
+		    int end));
+static int	ParseCmdWords _ANSI_ARGS_((char *base, char *string,
+		    int flags, int level, ParsedCmd *cmdPtr,
+		    char **termPtr));
+static int	ParseQuotedParts _ANSI_ARGS_((char *base, char *string,
+		    int termChar, int level, ParsedWord *wordPtr,
+		    ParseValue *pvPtr, char **termPtr));
+static ParsedScript *	ParseScript _ANSI_ARGS_((char *base, char *string,
+		    int flags, int level, char **termPtr));
+static int	ParseVarPart _ANSI_ARGS_((char *base, char *string,
+		    int level, ParsedWord *wordPtr, ParseValue *pvPtr,
+		    char **termPtr));
 static char *	QuoteEnd _ANSI_ARGS_((char *string, int term));
 static char *	VarNameEnd _ANSI_ARGS_((char *string));
 
@@ -435,9 +464,9 @@ TclParseNestedCmd(interp, string, flags, termPtr, pvPtr)
  *	The return value is a standard Tcl result, which is
  *	TCL_OK unless there was an error while parsing string.
  *	If an error occurs then interp->result contains a
- *	standard error message.  *TermPtr is filled
- *	in with the address of the character just after the
- *	last one successfully processed;  this is usually the
+ *	standard error message (unless interp is NULL).  *TermPtr
+ *	is filled in with the address of the character just after
+ *	the last one successfully processed;  this is usually the
  *	character just after the matching close-brace.  The
  *	information between curly braces is stored in standard
  *	fashion in *pvPtr, null-terminated with pvPtr->next
@@ -451,8 +480,8 @@ TclParseNestedCmd(interp, string, flags, termPtr, pvPtr)
 
 int
 TclParseBraces(interp, string, termPtr, pvPtr)
-    Tcl_Interp *interp;		/* Interpreter to use for nested command
-				 * evaluations and error messages. */
+    Tcl_Interp *interp;		/* Interpreter to use for error messages,
+				 * or NULL. */
     char *string;		/* Character just after opening bracket. */
     char **termPtr;		/* Store address of terminating character
 				 * here. */
@@ -522,7 +551,9 @@ TclParseBraces(interp, string, termPtr, pvPtr)
 		}
 	    }
 	} else if (c == '\0') {
-	    Tcl_SetResult(interp, "missing close-brace", TCL_STATIC);
+	    if (interp != NULL) {
+		Tcl_SetResult(interp, "missing close-brace", TCL_STATIC);
+	    }
 	    *termPtr = string-1;
 	    return TCL_ERROR;
 	}
@@ -850,6 +881,190 @@ TclExpandParseValue(pvPtr, needed)
     pvPtr->clientData = (ClientData) 1;
 }
 
+/*
+ *--------------------------------------------------------------
+ *
+ * TclArenaAlloc --
+ *
+ *	Allocate scratch storage from an interpreter's arena.  The
+ *	arena is meant for storage whose lifetime is bounded by a
+ *	call to Tcl_Eval and its relatives, such as the words of the
+ *	commands being executed:  a caller remembers iPtr->arenaNext
+ *	before allocating, and passes it to TclArenaRelease when it
+ *	is done, which frees everything allocated since.  Nested
+ *	evaluations must release their storage before returning.
+ *
+ * Results:
+ *	The return value is the address of at least size bytes of
+ *	storage, aligned for any use.
+ *
+ * Side effects:
+ *	A new chunk may be added to the arena.
+ *
+ *--------------------------------------------------------------
+ */
+
+char *
+TclArenaAlloc(iPtr, size)
+    register Interp *iPtr;		/* Interpreter whose arena is to
+					 * be used. */
+    int size;				/* Number of bytes needed. */
+{
+    char *result;
+
+    size = ARENA_ALIGN(size);
+    if ((iPtr->arenaPtr == NULL)
+	    || ((iPtr->arenaPtr->end - iPtr->arenaNext) < size)) {
+	ArenaNewChunk(iPtr, size);
+    }
+    result = iPtr->arenaNext;
+    iPtr->arenaNext += size;
+    return result;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * ArenaNewChunk --
+ *
+ *	Start allocating from a new chunk of an interpreter's arena.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	A chunk with room for at least size bytes is taken from the
+ *	free list or allocated, and becomes the current chunk.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+ArenaNewChunk(iPtr, size)
+    register Interp *iPtr;		/* Interpreter whose arena is to
+					 * be extended. */
+    int size;				/* Number of bytes needed. */
+{
+    register ArenaChunk *chunkPtr, **prevPtrPtr;
+
+    for (prevPtrPtr = &iPtr->freeChunkPtr; *prevPtrPtr != NULL;
+	    prevPtrPtr = &(*prevPtrPtr)->nextPtr) {
+	chunkPtr = *prevPtrPtr;
+	if ((chunkPtr->end - (char *) chunkPtr->space) >= size) {
+	    *prevPtrPtr = chunkPtr->nextPtr;
+	    iPtr->numFreeChunks--;
+	    goto gotChunk;
+	}
+    }
+    if (size < ARENA_CHUNK_SIZE) {
+	size = ARENA_CHUNK_SIZE;
+    }
+    chunkPtr = (ArenaChunk *) ckalloc((unsigned)
+	    (sizeof(ArenaChunk) - sizeof(chunkPtr->space) + size));
+    chunkPtr->end = (char *) chunkPtr->space + size;
+
+    gotChunk:
+    chunkPtr->nextPtr = iPtr->arenaPtr;
+    iPtr->arenaPtr = chunkPtr;
+    iPtr->arenaNext = (char *) chunkPtr->space;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TclArenaRelease --
+ *
+ *	Free all of the storage allocated from an interpreter's arena
+ *	since a given point.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Mark, which must be a value of iPtr->arenaNext saved earlier,
+ *	becomes the next address to be allocated.  Chunks that are no
+ *	longer in use are kept for reuse or freed.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+TclArenaRelease(iPtr, mark)
+    register Interp *iPtr;		/* Interpreter whose arena is to
+					 * be released. */
+    char *mark;				/* Value of iPtr->arenaNext before
+					 * the storage being freed was
+					 * allocated. */
+{
+    register ArenaChunk *chunkPtr;
+
+    while (((chunkPtr = iPtr->arenaPtr) != NULL)
+	    && ((mark < (char *) chunkPtr->space) || (mark > chunkPtr->end))) {
+	iPtr->arenaPtr = chunkPtr->nextPtr;
+	if (iPtr->numFreeChunks < MAX_FREE_CHUNKS) {
+	    chunkPtr->nextPtr = iPtr->freeChunkPtr;
+	    iPtr->freeChunkPtr = chunkPtr;
+	    iPtr->numFreeChunks++;
+	} else {
+	    ckfree((char *) chunkPtr);
+	}
+    }
+    iPtr->arenaNext = mark;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TclArenaExpand --
+ *
+ *	This procedure is used as the expandProc in a ParseValue whose
+ *	clientData is an interpreter, to get more space from the
+ *	interpreter's arena instead of from malloc.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	If the buffer is the most recent allocation from the arena and
+ *	there is room after it, it is simply extended.  Otherwise new
+ *	space is allocated from the arena and the contents of the old
+ *	buffer are copied to it;  the old space isn't reclaimed until
+ *	the arena is released.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+TclArenaExpand(pvPtr, needed)
+    register ParseValue *pvPtr;		/* Information about buffer that
+					 * must be expanded. */
+    int needed;				/* Minimum amount of additional space
+					 * to allocate. */
+{
+    register Interp *iPtr = (Interp *) pvPtr->clientData;
+    int oldSpace, newSpace;
+    char *new;
+
+    oldSpace = (pvPtr->end - pvPtr->buffer) + 1;
+    if (oldSpace < needed) {
+	newSpace = ARENA_ALIGN(oldSpace + needed);
+    } else {
+	newSpace = ARENA_ALIGN(2*oldSpace);
+    }
+    if ((pvPtr->end + 1 == iPtr->arenaNext)
+	    && ((iPtr->arenaPtr->end - iPtr->arenaNext)
+	    >= (newSpace - oldSpace))) {
+	iPtr->arenaNext = pvPtr->buffer + newSpace;
+    } else {
+	new = TclArenaAlloc(iPtr, newSpace);
+	memcpy((VOID *) new, (VOID *) pvPtr->buffer,
+		pvPtr->next - pvPtr->buffer);
+	pvPtr->next = new + (pvPtr->next - pvPtr->buffer);
+	pvPtr->buffer = new;
+    }
+    pvPtr->end = pvPtr->buffer + newSpace - 1;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1106,6 +1321,7 @@ Tcl_ParseVar(interp, string, termPtr)
 #define NUM_CHARS 200
     char copyStorage[NUM_CHARS];
     ParseValue pv;
+    char *arenaMark;
 
     /*
      * There are three cases:
@@ -1161,10 +1377,11 @@ Tcl_ParseVar(interp, string, termPtr)
 	     * is done for quotes.
 	     */
 
+	    arenaMark = ((Interp *) interp)->arenaNext;
 	    pv.buffer = pv.next = copyStorage;
 	    pv.end = copyStorage + NUM_CHARS - 1;
-	    pv.expandProc = TclExpandParseValue;
-	    pv.clientData = (ClientData) NULL;
+	    pv.expandProc = TclArenaExpand;
+	    pv.clientData = (ClientData) interp;
 	    if (TclParseQuotes(interp, string+1, ')', 0, &end, &pv)
 		    != TCL_OK) {
 		char msg[100];
@@ -1187,7 +1404,8 @@ Tcl_ParseVar(interp, string, termPtr)
     }
 
     if (((Interp *) interp)->noEval) {
-	return "";
+	result = "";
+	goto done;
     }
     c = *name1End;
     *name1End = 0;
@@ -1195,8 +1413,692 @@ Tcl_ParseVar(interp, string, termPtr)
     *name1End = c;
 
     done:
-    if ((name2 != NULL) && (pv.buffer != copyStorage)) {
-	ckfree(pv.buffer);
+    if (name2 != NULL) {
+	TclArenaRelease((Interp *) interp, arenaMark);
     }
     return result;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclParseScript --
+ *
+ *	Parse a script without executing it, recording the words of
+ *	each command and the substitutions that must be made in them.
+ *	The result is turned into instructions by TclCompileScript.
+ *
+ * Results:
+ *	The return value is a pointer to a malloc-ed ParsedScript
+ *	structure, or NULL if the script contains a syntax error (in
+ *	which case the caller should just let Tcl_Eval parse it, so
+ *	that the error is reported in the usual way at the usual
+ *	time).
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+ParsedScript *
+TclParseScript(string)
+    char *string;		/* Script to parse.  Must be terminated
+				 * by a null character. */
+{
+    char *term;
+
+    return ParseScript(string, string, 0, 0, &term);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParseScript --
+ *
+ *	This procedure does all of the work of TclParseScript.  It
+ *	mirrors the command loop in TclEvalCode, and is also used
+ *	for scripts nested in brackets.
+ *
+ * Results:
+ *	The return value is a malloc-ed ParsedScript, or NULL if a
+ *	syntax error was found.  *TermPtr is filled in with the
+ *	address of the character that terminated the script (the
+ *	null character or the close-bracket).
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ParsedScript *
+ParseScript(base, string, flags, level, termPtr)
+    char *base;			/* First character of outermost script;
+				 * all offsets are relative to this. */
+    char *string;		/* First character of script to parse. */
+    int flags;			/* TCL_BRACKET_TERM means script ends at
+				 * close-bracket;  otherwise at null. */
+    int level;			/* Nesting depth of brackets. */
+    char **termPtr;		/* Store address of terminating character
+				 * here. */
+{
+    register ParsedScript *scriptPtr;
+    register char *src;
+    char *cmdStart, *term;
+    char termChar;
+    ParsedCmd cmd;
+
+    if (level > MAX_NESTING_DEPTH) {
+	return NULL;
+    }
+    termChar = (flags & TCL_BRACKET_TERM) ? ']' : 0;
+    scriptPtr = (ParsedScript *) ckalloc(sizeof(ParsedScript));
+    scriptPtr->start = string - base;
+    scriptPtr->numCmds = 0;
+    scriptPtr->cmds = NULL;
+    src = term = string;
+    while (*src != termChar) {
+	while (1) {
+	    register char c = *src;
+
+	    if ((CHAR_TYPE(c) != TCL_SPACE) && (c != ';') && (c != '\n')) {
+		break;
+	    }
+	    src += 1;
+	}
+	if (*src == '#') {
+	    for (src++; *src != 0; src++) {
+		if ((*src == '\n') && (src[-1] != '\\')) {
+		    src++;
+		    break;
+		}
+	    }
+	    continue;
+	}
+	cmdStart = src;
+	if (ParseCmdWords(base, src, flags, level, &cmd, &term) != TCL_OK) {
+	    scriptPtr->end = 0;
+	    TclFreeScript(scriptPtr);
+	    return NULL;
+	}
+	src = term;
+	if (cmd.numWords == 0) {
+	    continue;
+	}
+	cmd.start = cmdStart - base;
+	cmd.end = term - base;
+	scriptPtr->cmds = (ParsedCmd *) GrowArray((VOID *) scriptPtr->cmds,
+		scriptPtr->numCmds, sizeof(ParsedCmd));
+	scriptPtr->cmds[scriptPtr->numCmds] = cmd;
+	scriptPtr->numCmds++;
+    }
+    scriptPtr->end = term - base;
+    *termPtr = src;
+    return scriptPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParseCmdWords --
+ *
+ *	Parse the words of a single command, in the same way as
+ *	TclParseWords except that substitutions are recorded rather
+ *	than performed.
+ *
+ * Results:
+ *	The return value is TCL_OK, or TCL_ERROR if there is a syntax
+ *	error in the command.  The words are stored at *cmdPtr (which
+ *	is left empty if there is an error), and *termPtr is filled in
+ *	with the address of the character that terminated the command.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ParseCmdWords(base, string, flags, level, cmdPtr, termPtr)
+    char *base;			/* First character of outermost script. */
+    char *string;		/* First character of command. */
+    int flags;			/* TCL_BRACKET_TERM or 0. */
+    int level;			/* Nesting depth of brackets. */
+    ParsedCmd *cmdPtr;		/* Fill in words here. */
+    char **termPtr;		/* Store address of terminating character
+				 * here. */
+{
+    register char *src;
+    register char c;
+    int type, i;
+    char *term;
+    ParsedWord *wordPtr;
+    ParsedScript *nestedPtr;
+#define TEXT_SPACE 200
+    char copyStorage[TEXT_SPACE];
+    ParseValue pv;
+
+    pv.buffer = pv.next = copyStorage;
+    pv.end = copyStorage + TEXT_SPACE - 1;
+    pv.expandProc = TclExpandParseValue;
+    pv.clientData = (ClientData) NULL;
+    cmdPtr->numWords = 0;
+    cmdPtr->words = NULL;
+    src = string;
+    while (1) {
+	skipSpace:
+	c = *src;
+	type = CHAR_TYPE(c);
+	while (type == TCL_SPACE) {
+	    src++;
+	    c = *src;
+	    type = CHAR_TYPE(c);
+	}
+	if (type == TCL_COMMAND_END) {
+	    if (flags & TCL_BRACKET_TERM) {
+		if (c == '\0') {
+		    goto error;
+		}
+		break;
+	    } else if (c != ']') {
+		break;
+	    }
+	} else if ((type == TCL_BACKSLASH) && (src[1] == '\n')) {
+	    src += 2;
+	    goto skipSpace;
+	}
+
+	/*
+	 * There's a word here.  Add it to the command, then handle
+	 * quoted and braced words, or fall through to the normal case.
+	 */
+
+	cmdPtr->words = (ParsedWord *) GrowArray((VOID *) cmdPtr->words,
+		cmdPtr->numWords, sizeof(ParsedWord));
+	wordPtr = &cmdPtr->words[cmdPtr->numWords];
+	cmdPtr->numWords++;
+	wordPtr->numParts = 0;
+	wordPtr->parts = NULL;
+	pv.next = pv.buffer;
+
+	if ((type == TCL_QUOTE) || (type == TCL_OPEN_BRACE)) {
+	    if (type == TCL_QUOTE) {
+		if (ParseQuotedParts(base, src+1, '"', level, wordPtr, &pv,
+			&term) != TCL_OK) {
+		    goto error;
+		}
+	    } else {
+		if (TclParseBraces((Tcl_Interp *) NULL, src+1, &term, &pv)
+			!= TCL_OK) {
+		    goto error;
+		}
+	    }
+	    c = *term;
+	    if ((c == '\\') && (term[1] == '\n')) {
+		c = term[2];
+	    }
+	    type = CHAR_TYPE(c);
+	    if ((type != TCL_SPACE) && (type != TCL_COMMAND_END)) {
+		goto error;
+	    }
+	    src = term;
+	    goto wordEnd;
+	}
+
+	while (1) {
+	    if (type == TCL_NORMAL) {
+		copy:
+		AppendText(&pv, src, 1);
+		src++;
+	    } else if (type == TCL_SPACE) {
+		break;
+	    } else if (type == TCL_DOLLAR) {
+		if (ParseVarPart(base, src, level, wordPtr, &pv, &term)
+			!= TCL_OK) {
+		    goto error;
+		}
+		src = term;
+	    } else if (type == TCL_COMMAND_END) {
+		if ((c == ']') && !(flags & TCL_BRACKET_TERM)) {
+		    goto copy;
+		}
+		break;
+	    } else if (type == TCL_OPEN_BRACKET) {
+		FlushText(wordPtr, &pv, src - base);
+		nestedPtr = ParseScript(base, src+1, flags | TCL_BRACKET_TERM,
+			level+1, &term);
+		if (nestedPtr == NULL) {
+		    goto error;
+		}
+		src = term+1;
+		NewPart(wordPtr, PART_COMMAND, src - base)->scriptPtr
+			= nestedPtr;
+	    } else if (type == TCL_BACKSLASH) {
+		int numRead;
+		char bs;
+
+		bs = Tcl_Backslash(src, &numRead);
+		if (bs != 0) {
+		    AppendText(&pv, &bs, 1);
+		}
+		src += numRead;
+	    } else {
+		goto copy;
+	    }
+	    c = *src;
+	    type = CHAR_TYPE(c);
+	}
+
+	wordEnd:
+	FlushText(wordPtr, &pv, src - base);
+	if (wordPtr->numParts == 0) {
+	    NewPart(wordPtr, PART_TEXT, src - base);
+	    wordPtr->parts[0].string = (char *) ckalloc(1);
+	    wordPtr->parts[0].string[0] = 0;
+	}
+    }
+
+    if (pv.buffer != copyStorage) {
+	ckfree(pv.buffer);
+    }
+    *termPtr = src;
+    return TCL_OK;
+
+    error:
+    if (pv.buffer != copyStorage) {
+	ckfree(pv.buffer);
+    }
+    for (i = 0; i < cmdPtr->numWords; i++) {
+	FreeWord(&cmdPtr->words[i]);
+    }
+    if (cmdPtr->words != NULL) {
+	ckfree((char *) cmdPtr->words);
+    }
+    cmdPtr->numWords = 0;
+    cmdPtr->words = NULL;
+    return TCL_ERROR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParseQuotedParts --
+ *
+ *	Parse a string with the conventions of TclParseQuotes,
+ *	recording its parts in a word rather than substituting.
+ *
+ * Results:
+ *	The return value is TCL_OK, or TCL_ERROR if the closing
+ *	character couldn't be found or there's a syntax error in
+ *	a nested command.  Parts are added to *wordPtr;  text
+ *	following the last substitution is left in *pvPtr for
+ *	the caller to flush.  *TermPtr is filled in with the address
+ *	of the character just after termChar.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ParseQuotedParts(base, string, termChar, level, wordPtr, pvPtr, termPtr)
+    char *base;			/* First character of outermost script. */
+    char *string;		/* Character just after opening quote. */
+    int termChar;		/* Character that terminates the string. */
+    int level;			/* Nesting depth of brackets. */
+    ParsedWord *wordPtr;	/* Add parts to this word. */
+    ParseValue *pvPtr;		/* Pending literal text of word. */
+    char **termPtr;		/* Store address of terminating character
+				 * here. */
+{
+    register char *src;
+    char c, *term;
+    ParsedScript *nestedPtr;
+
+    src = string;
+    while (1) {
+	c = *src;
+	src++;
+	if (c == termChar) {
+	    *termPtr = src;
+	    return TCL_OK;
+	} else if (CHAR_TYPE(c) == TCL_NORMAL) {
+	    copy:
+	    AppendText(pvPtr, &c, 1);
+	} else if (c == '$') {
+	    if (ParseVarPart(base, src-1, level, wordPtr, pvPtr, &term)
+		    != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    src = term;
+	} else if (c == '[') {
+	    FlushText(wordPtr, pvPtr, src - 1 - base);
+	    nestedPtr = ParseScript(base, src, TCL_BRACKET_TERM, level+1,
+		    &term);
+	    if (nestedPtr == NULL) {
+		return TCL_ERROR;
+	    }
+	    src = term+1;
+	    NewPart(wordPtr, PART_COMMAND, src - base)->scriptPtr = nestedPtr;
+	} else if (c == '\\') {
+	    int numRead;
+	    char bs;
+
+	    src--;
+	    bs = Tcl_Backslash(src, &numRead);
+	    if (bs != 0) {
+		AppendText(pvPtr, &bs, 1);
+	    }
+	    src += numRead;
+	} else if (c == '\0') {
+	    return TCL_ERROR;
+	} else {
+	    goto copy;
+	}
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParseVarPart --
+ *
+ *	Parse a variable reference with the conventions of
+ *	Tcl_ParseVar, and add a part for it to a word.
+ *
+ * Results:
+ *	The return value is TCL_OK, or TCL_ERROR if there's a syntax
+ *	error in the reference.  *TermPtr is filled in with the address
+ *	of the character just after the variable specifier.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ParseVarPart(base, string, level, wordPtr, pvPtr, termPtr)
+    char *base;			/* First character of outermost script. */
+    register char *string;	/* Points to dollar sign. */
+    int level;			/* Nesting depth of brackets. */
+    ParsedWord *wordPtr;	/* Add parts to this word. */
+    ParseValue *pvPtr;		/* Pending literal text of word. */
+    char **termPtr;		/* Store address of terminating character
+				 * here. */
+{
+    char *name1, *name1End, *end;
+    ParsedWord *indexPtr;
+    ParsedPart *partPtr;
+    char copyStorage[TEXT_SPACE];
+    ParseValue pv;
+
+    indexPtr = NULL;
+    string++;
+    if (*string == '{') {
+	string++;
+	name1 = string;
+	while (*string != '}') {
+	    if (*string == 0) {
+		return TCL_ERROR;
+	    }
+	    string++;
+	}
+	name1End = string;
+	string++;
+    } else {
+	name1 = string;
+	while (isalnum(*string) || (*string == '_')) {
+	    string++;
+	}
+	if (string == name1) {
+	    AppendText(pvPtr, "$", 1);
+	    *termPtr = string;
+	    return TCL_OK;
+	}
+	name1End = string;
+	if (*string == '(') {
+	    indexPtr = (ParsedWord *) ckalloc(sizeof(ParsedWord));
+	    indexPtr->numParts = 0;
+	    indexPtr->parts = NULL;
+	    pv.buffer = pv.next = copyStorage;
+	    pv.end = copyStorage + TEXT_SPACE - 1;
+	    pv.expandProc = TclExpandParseValue;
+	    pv.clientData = (ClientData) NULL;
+	    if (ParseQuotedParts(base, string+1, ')', level, indexPtr, &pv,
+		    &end) != TCL_OK) {
+		if (pv.buffer != copyStorage) {
+		    ckfree(pv.buffer);
+		}
+		FreeWord(indexPtr);
+		ckfree((char *) indexPtr);
+		return TCL_ERROR;
+	    }
+	    FlushText(indexPtr, &pv, end - base);
+	    if (pv.buffer != copyStorage) {
+		ckfree(pv.buffer);
+	    }
+	    string = end;
+	}
+    }
+
+    FlushText(wordPtr, pvPtr, name1 - base);
+    partPtr = NewPart(wordPtr, (indexPtr != NULL) ? PART_ARRAY : PART_VAR,
+	    string - base);
+    partPtr->length = name1End - name1;
+    partPtr->string = (char *) ckalloc((unsigned) (partPtr->length + 1));
+    strncpy(partPtr->string, name1, partPtr->length);
+    partPtr->string[partPtr->length] = 0;
+    partPtr->indexPtr = indexPtr;
+    *termPtr = string;
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AppendText --
+ *
+ *	Add characters to the end of the text accumulated in a
+ *	ParseValue, keeping it null-terminated.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The buffer space in pvPtr may be enlarged.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+AppendText(pvPtr, string, length)
+    register ParseValue *pvPtr;	/* Where to add characters. */
+    char *string;		/* Characters to add. */
+    int length;			/* Number of characters to add. */
+{
+    if ((pvPtr->end - pvPtr->next) <= length) {
+	(*pvPtr->expandProc)(pvPtr, length);
+    }
+    memcpy((VOID *) pvPtr->next, (VOID *) string, length);
+    pvPtr->next += length;
+    *pvPtr->next = 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FlushText --
+ *
+ *	If any literal text has been accumulated for a word, turn it
+ *	into a PART_TEXT part.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	A part may be added to *wordPtr, and pvPtr is emptied.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FlushText(wordPtr, pvPtr, end)
+    ParsedWord *wordPtr;	/* Word to add text to. */
+    register ParseValue *pvPtr;	/* Accumulated text. */
+    int end;			/* Offset just after the source of text. */
+{
+    ParsedPart *partPtr;
+    int length;
+
+    length = pvPtr->next - pvPtr->buffer;
+    if (length == 0) {
+	return;
+    }
+    partPtr = NewPart(wordPtr, PART_TEXT, end);
+    partPtr->string = (char *) ckalloc((unsigned) (length + 1));
+    memcpy((VOID *) partPtr->string, (VOID *) pvPtr->buffer, length);
+    partPtr->string[length] = 0;
+    partPtr->length = length;
+    pvPtr->next = pvPtr->buffer;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NewPart --
+ *
+ *	Add an empty part to the end of a word.
+ *
+ * Results:
+ *	The return value is a pointer to the new part, whose type
+ *	and end fields are initialized and other fields are zero.
+ *
+ * Side effects:
+ *	The parts array of wordPtr may be reallocated.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ParsedPart *
+NewPart(wordPtr, type, end)
+    ParsedWord *wordPtr;	/* Word to add part to. */
+    int type;			/* Type for new part. */
+    int end;			/* Offset just after source of part. */
+{
+    register ParsedPart *partPtr;
+
+    wordPtr->parts = (ParsedPart *) GrowArray((VOID *) wordPtr->parts,
+	    wordPtr->numParts, sizeof(ParsedPart));
+    partPtr = &wordPtr->parts[wordPtr->numParts];
+    wordPtr->numParts++;
+    partPtr->type = type;
+    partPtr->string = NULL;
+    partPtr->length = 0;
+    partPtr->indexPtr = NULL;
+    partPtr->scriptPtr = NULL;
+    partPtr->end = end;
+    return partPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GrowArray --
+ *
+ *	Make room for one more element at the end of a dynamically-
+ *	allocated array.  Arrays are doubled in size each time they
+ *	fill up, so the current size can be derived from the number
+ *	of elements in use.
+ *
+ * Results:
+ *	The return value is the (possibly new) address of the array,
+ *	which has room for at least num+1 elements.
+ *
+ * Side effects:
+ *	The old array may be freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static VOID *
+GrowArray(array, num, size)
+    VOID *array;		/* Current array, or NULL if num is 0. */
+    int num;			/* Number of elements currently in use. */
+    unsigned size;		/* Size of each element. */
+{
+    VOID *new;
+
+    if ((num & (num-1)) != 0) {
+	return array;
+    }
+    new = (VOID *) ckalloc((unsigned) ((num == 0) ? 1 : 2*num) * size);
+    if (num != 0) {
+	memcpy(new, array, num * size);
+	ckfree((char *) array);
+    }
+    return new;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclFreeScript --
+ *
+ *	Free all of the storage associated with a parsed script.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	ScriptPtr and everything it refers to are freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclFreeScript(scriptPtr)
+    ParsedScript *scriptPtr;	/* Script returned by TclParseScript. */
+{
+    int i, j;
+    ParsedCmd *cmdPtr;
+
+    for (i = 0, cmdPtr = scriptPtr->cmds; i < scriptPtr->numCmds;
+	    i++, cmdPtr++) {
+	for (j = 0; j < cmdPtr->numWords; j++) {
+	    FreeWord(&cmdPtr->words[j]);
+	}
+	ckfree((char *) cmdPtr->words);
+    }
+    if (scriptPtr->cmds != NULL) {
+	ckfree((char *) scriptPtr->cmds);
+    }
+    ckfree((char *) scriptPtr);
+}
+
+static void
+FreeWord(wordPtr)
+    ParsedWord *wordPtr;	/* Word whose parts are to be freed. */
+{
+    int i;
+    register ParsedPart *partPtr;
+
+    for (i = 0, partPtr = wordPtr->parts; i < wordPtr->numParts;
+	    i++, partPtr++) {
+	if (partPtr->string != NULL) {
+	    ckfree(partPtr->string);
+	}
+	if (partPtr->indexPtr != NULL) {
+	    FreeWord(partPtr->indexPtr);
+	    ckfree((char *) partPtr->indexPtr);
+	}
+	if (partPtr->scriptPtr != NULL) {
+	    TclFreeScript(partPtr->scriptPtr);
+	}
+    }
+    if (wordPtr->parts != NULL) {
+	ckfree((char *) wordPtr->parts);
+    }
+}
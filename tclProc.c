@@ -18,10 +18,24 @@
 
 #include "tclInt.h"
 
+/*
+ * The compiled locals of a procedure (see FindLocals) are kept in
+ * slots in each call frame.  Up to NUM_STATIC_SLOTS slots are
+ * allocated on the stack;  procedures with more locals get their
+ * slots from ckalloc.  At most MAX_LOCALS names are picked out of
+ * any procedure:  other variables go in the frame's hash table.
+ */
+
+#define NUM_STATIC_SLOTS	6
+#define MAX_LOCALS		32
+
 /*
  * Forward references to procedures defined later in this file:
  */
 
+static  int	AddLocal _ANSI_ARGS_((char **starts, int *lengths,
+		    int *numPtr, char *name, int length));
+static  void	FindLocals _ANSI_ARGS_((Proc *procPtr));
 static  int	InterpProc _ANSI_ARGS_((ClientData clientData,
 		    Tcl_Interp *interp, int argc, char **argv));
 static  void	ProcDeleteProc _ANSI_ARGS_((ClientData clientData));
@@ -70,6 +84,7 @@ Tcl_ProcCmd(dummy, interp, argc, argv)
     procPtr->command = (char *) ckalloc((unsigned) strlen(argv[3]) + 1);
     strcpy(procPtr->command, argv[3]);
     procPtr->argPtr = NULL;
+    procPtr->codePtr = NULL;
 
     /*
      * Break up the argument list into argument specifiers, then process
@@ -135,6 +150,15 @@ Tcl_ProcCmd(dummy, interp, argc, argv)
 	ckfree((char *) fieldValues);
     }
 
+    /*
+     * Compile the body now, so that every invocation of the procedure
+     * can just execute the instructions.  If the body can't be
+     * compiled it will be parsed each time, and any syntax error
+     * reported when the procedure is invoked.
+     */
+
+    procPtr->codePtr = TclCompileScript(procPtr->command);
+    FindLocals(procPtr);
     Tcl_CreateCommand(interp, argv[1], InterpProc, (ClientData) procPtr,
 	    ProcDeleteProc);
     ckfree((char *) argArray);
@@ -154,6 +178,163 @@ Tcl_ProcCmd(dummy, interp, argc, argv)
     return result;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * FindLocals --
+ *
+ *	Choose the local variables of a procedure that will be kept in
+ *	slots in its call frames, rather than in a hash table.  These
+ *	are the formal arguments, followed by the names that appear in
+ *	the body after "$" or after one of the commands that set
+ *	variables.  The body's text is scanned as a whole, so names
+ *	used in loop bodies and other nested scripts are found too.
+ *	It doesn't matter if some of the names found aren't really
+ *	variables, or if some variables aren't found.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The localsPtr field of the procedure's code is filled in.  Nothing is done if the body couldn't be
+ *	compiled, or if two formal arguments have the same name.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FindLocals(procPtr)
+    Proc *procPtr;		/* Procedure whose code and formal
+				 * arguments are complete. */
+{
+    char *starts[MAX_LOCALS];
+    int lengths[MAX_LOCALS];
+    int numLocals, numBytes, prevLength, i;
+    register char *p;
+    char *name, *prev, *dst;
+    CompiledLocals *localsPtr;
+    Arg *argPtr;
+
+    if (procPtr->codePtr == NULL) {
+	return;
+    }
+    numLocals = 0;
+    for (argPtr = procPtr->argPtr; argPtr != NULL; argPtr = argPtr->nextPtr) {
+	if (!AddLocal(starts, lengths, &numLocals, argPtr->name,
+		strlen(argPtr->name))) {
+	    return;
+	}
+    }
+
+    prev = NULL;
+    prevLength = 0;
+    for (p = procPtr->command; *p != 0; ) {
+	if (*p == '$') {
+	    p++;
+	    if (*p == '{') {
+		p++;
+	    }
+	    for (name = p; isalnum(*p) || (*p == '_'); p++) {
+		/* Empty loop body. */
+	    }
+	    if (p > name) {
+		(void) AddLocal(starts, lengths, &numLocals, name, p - name);
+	    }
+	    prevLength = 0;
+	} else if (isalnum(*p) || (*p == '_')) {
+	    for (name = p; isalnum(*p) || (*p == '_'); p++) {
+		/* Empty loop body. */
+	    }
+	    if (((prevLength == 3) && (strncmp(prev, "set", 3) == 0))
+		    || ((prevLength == 4) && (strncmp(prev, "incr", 4) == 0))
+		    || ((prevLength == 6) && ((strncmp(prev, "append", 6) == 0)
+			|| (strncmp(prev, "global", 6) == 0)))
+		    || ((prevLength == 7) && ((strncmp(prev, "lappend", 7) == 0)
+			|| (strncmp(prev, "foreach", 7) == 0)))) {
+		(void) AddLocal(starts, lengths, &numLocals, name, p - name);
+	    }
+	    prev = name;
+	    prevLength = p - name;
+	} else {
+	    if ((*p != ' ') && (*p != '\t')) {
+		prevLength = 0;
+	    }
+	    p++;
+	}
+    }
+
+    /*
+     * Make a single block holding the CompiledLocals structure, then
+     * the array of names, then their characters.
+     */
+
+    if (numLocals == 0) {
+	return;
+    }
+    numBytes = sizeof(CompiledLocals) + numLocals * sizeof(char *);
+    for (i = 0; i < numLocals; i++) {
+	numBytes += lengths[i] + 1;
+    }
+    localsPtr = (CompiledLocals *) ckalloc((unsigned) numBytes);
+    localsPtr->numLocals = numLocals;
+    localsPtr->names = (char **) (localsPtr + 1);
+    dst = (char *) (localsPtr->names + numLocals);
+    for (i = 0; i < numLocals; i++) {
+	localsPtr->names[i] = dst;
+	strncpy(dst, starts[i], lengths[i]);
+	dst[lengths[i]] = 0;
+	dst += lengths[i] + 1;
+    }
+    for (i = 0; i < LOCAL_CACHE_SIZE; i++) {
+	localsPtr->cacheNames[i] = NULL;
+	localsPtr->cacheSlots[i] = 0;
+    }
+    procPtr->codePtr->localsPtr = localsPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AddLocal --
+ *
+ *	Add a name to the locals being collected by FindLocals.
+ *
+ * Results:
+ *	The return value is 1 if the name was added, or 0 if it was
+ *	already present or there isn't room for it.
+ *
+ * Side effects:
+ *	The name's location is stored in starts and lengths, and
+ *	*numPtr is incremented.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+AddLocal(starts, lengths, numPtr, name, length)
+    char **starts;		/* First characters of names so far. */
+    int *lengths;		/* Lengths of names so far. */
+    int *numPtr;		/* Number of names so far. */
+    char *name;			/* Name to add (need not be terminated). */
+    int length;			/* Number of characters in name. */
+{
+    int i;
+
+    for (i = 0; i < *numPtr; i++) {
+	if ((lengths[i] == length)
+		&& (strncmp(starts[i], name, length) == 0)) {
+	    return 0;
+	}
+    }
+    if (*numPtr >= MAX_LOCALS) {
+	return 0;
+    }
+    starts[*numPtr] = name;
+    lengths[*numPtr] = length;
+    *numPtr += 1;
+    return 1;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -424,15 +605,38 @@ InterpProc(clientData, interp, argc, argv)
     register Interp *iPtr = (Interp *) interp;
     char **args;
     CallFrame frame;
-    char *value, *end;
-    int result;
+    Tcl_HashEntry staticSlots[NUM_STATIC_SLOTS];
+    char *value, *end, *body;
+    ByteCode *codePtr;
+    int result, i;
 
     /*
-     * Set up a call frame for the new procedure invocation.
+     * Set up a call frame for the new procedure invocation.  The
+     * frame refers to the names of the compiled locals, so the code
+     * is held until the frame has been deleted.  The frame's hash
+     * table isn't initialized until some variable without a slot is
+     * created.
      */
 
     iPtr = procPtr->iPtr;
-    Tcl_InitHashTable(&frame.varTable, TCL_STRING_KEYS);
+    codePtr = procPtr->codePtr;
+    frame.varTablePtr = NULL;
+    frame.localsPtr = NULL;
+    frame.slots = staticSlots;
+    if (codePtr != NULL) {
+	codePtr->refCount++;
+	frame.localsPtr = codePtr->localsPtr;
+    }
+    if (frame.localsPtr != NULL) {
+	if (frame.localsPtr->numLocals > NUM_STATIC_SLOTS) {
+	    frame.slots = (Tcl_HashEntry *) ckalloc((unsigned)
+		    (frame.localsPtr->numLocals * sizeof(Tcl_HashEntry)));
+	}
+	for (i = 0; i < frame.localsPtr->numLocals; i++) {
+	    frame.slots[i].tablePtr = NULL;
+	    Tcl_SetHashValue(&frame.slots[i], NULL);
+	}
+    }
     if (iPtr->varFramePtr != NULL) {
 	frame.level = iPtr->varFramePtr->level + 1;
     } else {
@@ -447,12 +651,13 @@ InterpProc(clientData, interp, argc, argv)
 
     /*
      * Match the actual arguments against the procedure's formal
-     * parameters to compute local variables.
+     * parameters to compute local variables.  If the procedure has
+     * slots, the first ones are for the formal parameters, in order.
      */
 
-    for (argPtr = procPtr->argPtr, args = argv+1, argc -= 1;
+    for (argPtr = procPtr->argPtr, args = argv+1, argc -= 1, i = 0;
 	    argPtr != NULL;
-	    argPtr = argPtr->nextPtr, args++, argc--) {
+	    argPtr = argPtr->nextPtr, args++, argc--, i++) {
 
 	/*
 	 * Handle the special case of the last formal being "args".  When
@@ -466,7 +671,11 @@ InterpProc(clientData, interp, argc, argv)
 		argc = 0;
 	    }
 	    value = Tcl_Merge(argc, args);
-	    Tcl_SetVar(interp, argPtr->name, value, 0);
+	    if (frame.localsPtr != NULL) {
+		TclSetLocal(&frame.slots[i], value);
+	    } else {
+		Tcl_SetVar(interp, argPtr->name, value, 0);
+	    }
 	    ckfree(value);
 	    argc = 0;
 	    break;
@@ -481,7 +690,11 @@ InterpProc(clientData, interp, argc, argv)
 	    result = TCL_ERROR;
 	    goto procDone;
 	}
-	Tcl_SetVar(interp, argPtr->name, value, 0);
+	if (frame.localsPtr != NULL) {
+	    TclSetLocal(&frame.slots[i], value);
+	} else {
+	    Tcl_SetVar(interp, argPtr->name, value, 0);
+	}
     }
     if (argc > 0) {
 	Tcl_AppendResult(interp, "called \"", argv[0],
@@ -494,7 +707,12 @@ InterpProc(clientData, interp, argc, argv)
      * Invoke the commands in the procedure's body.
      */
 
-    result = Tcl_Eval(interp, procPtr->command, 0, &end);
+    body = procPtr->command;
+    if (codePtr != NULL) {
+	result = TclEvalCode(interp, body, codePtr, 0, 0, &end);
+    } else {
+	result = Tcl_Eval(interp, body, 0, &end);
+    }
     if (result == TCL_RETURN) {
 	result = TCL_OK;
     } else if (result == TCL_ERROR) {
@@ -525,7 +743,23 @@ InterpProc(clientData, interp, argc, argv)
     procDone:
     iPtr->framePtr = frame.callerPtr;
     iPtr->varFramePtr = frame.callerVarPtr;
-    TclDeleteVars(iPtr, &frame.varTable);
+
+    /*
+     * The result may point into the value of one of the procedure's
+     * local variables (e.g. if the last command was "set"), so copy
+     * it before the variables are deleted.
+     */
+
+    if ((iPtr->freeProc == 0) && (iPtr->result != iPtr->resultSpace)) {
+	Tcl_SetResult(interp, iPtr->result, TCL_VOLATILE);
+    }
+    TclDeleteFrame(iPtr, &frame);
+    if (frame.slots != staticSlots) {
+	ckfree((char *) frame.slots);
+    }
+    if (codePtr != NULL) {
+	TclReleaseCode(codePtr);
+    }
     return result;
 }
 
@@ -554,7 +788,18 @@ ProcDeleteProc(clientData)
     register Proc *procPtr = (Proc *) clientData;
     register Arg *argPtr;
 
-    ckfree((char *) procPtr->command);
+    /*
+     * If the procedure is being executed (it may have redefined
+     * itself), its code is still in use:  let the code take over
+     * the body's text, which it refers to, and free it when done.
+     */
+
+    if (procPtr->codePtr != NULL) {
+	procPtr->codePtr->source = procPtr->command;
+	TclReleaseCode(procPtr->codePtr);
+    } else {
+	ckfree((char *) procPtr->command);
+    }
     for (argPtr = procPtr->argPtr; argPtr != NULL; ) {
 	Arg *nextPtr = argPtr->nextPtr;
 
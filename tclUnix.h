@@ -54,6 +54,11 @@
  *				pid_t.  0 means that it doesn't.
  * TCL_UID_T -			1 means that <sys/types> defines the type
  *				uid_t.  0 means that it doesn't.
+ * TCL_POSIX_SPAWN -		1 means there exists a library procedure
+ *				"posix_spawnp" (POSIX.1-2001), which
+ *				starts pipeline processes without copying
+ *				the whole address space the way "fork"
+ *				does.  0 means have to use "fork".
  */
 
 #define TCL_GETTOD 0
@@ -64,6 +69,7 @@
 #define TCL_UNION_WAIT 0
 #define TCL_PID_T 0
 #define TCL_UID_T 1
+#define TCL_POSIX_SPAWN 1
 
 #include <errno.h>
 #include <fcntl.h>
@@ -83,6 +89,9 @@
 #if TCL_SYS_WAIT_H
 /* #   include <sys/wait.h> */
 #endif
+#if TCL_POSIX_SPAWN
+#   include <spawn.h>
+#endif
 
 /*
  * Not all systems declare the errno variable in errno.h. so this
@@ -301,6 +310,7 @@ extern void	_exit 	   _ANSI_ARGS_((int status));
 /* extern pid_t	getpid	   _ANSI_ARGS_((void)); */
 /* extern char *	getcwd 	   _ANSI_ARGS_((char *buffer, int size)); */
 extern char *	getwd  	   _ANSI_ARGS_((char *buffer));
+extern int	isatty	   _ANSI_ARGS_((int fd));
 /* extern int	kill	   _ANSI_ARGS_((pid_t pid, int sig)); */
 /* extern long	lseek	   _ANSI_ARGS_((int fd, int offset, int whence)); */
 extern char *	mktemp	   _ANSI_ARGS_((char *template));
@@ -54,6 +54,7 @@ char *tclRegexpError = NULL;
  * Function prototypes for local procedures in this file:
  */
 
+static void		DiscardRegexps _ANSI_ARGS_((Interp *iPtr, int keep));
 static void		SetupAppendBuffer _ANSI_ARGS_((Interp *iPtr,
 			    int newSpace));
 
@@ -1346,15 +1347,20 @@ TclGetListIndex(interp, string, indexPtr)
  * TclCompileRegexp --
  *
  *	Compile a regular expression into a form suitable for fast
- *	matching.  This procedure retains a small cache of pre-compiled
+ *	matching.  This procedure retains a cache of pre-compiled
  *	regular expressions in the interpreter, in order to avoid
- *	compilation costs as much as possible.
+ *	compilation costs as much as possible.  The cache is a hash
+ *	table keyed by pattern, with its entries kept in order of use
+ *	so that the least recently used pattern is the one discarded
+ *	when the cache is full.
  *
  * Results:
  *	The return value is a pointer to the compiled form of string,
- *	suitable for passing to regexec.  If an error occurred while
+ *	suitable for passing to TclExecRegexp.  If an error occurred while
  *	compiling the pattern, then NULL is returned and an error
- *	message is left in interp->result.
+ *	message is left in interp->result.  The compiled form belongs
+ *	to the cache and remains valid only until the next call to
+ *	this procedure.
  *
  * Side effects:
  *	The cache of compiled regexp's in interp will be modified to
@@ -1371,42 +1377,52 @@ TclCompileRegexp(interp, string)
 					 * compiled regular expression. */
 {
     register Interp *iPtr = (Interp *) interp;
-    int i, length;
+    register CachedRegexp *cachePtr;
+    Tcl_HashEntry *hPtr;
     regexp *result;
+    int new;
 
-    length = strlen(string);
-    for (i = 0; i < NUM_REGEXPS; i++) {
-	if ((length == iPtr->patLengths[i])
-		&& (strcmp(string, iPtr->patterns[i]) == 0)) {
-	    /*
-	     * Move the matched pattern to the first slot in the
-	     * cache and shift the other patterns down one position.
-	     */
+    /*
+     * The most recently used pattern is checked first, without
+     * hashing, since a script often uses the same pattern many
+     * times in a row.
+     */
+
+    cachePtr = iPtr->regexpFirst;
+    if ((cachePtr != NULL) && (strcmp(string,
+	    Tcl_GetHashKey(&iPtr->regexpTable, cachePtr->hPtr)) == 0)) {
+	iPtr->regexpHits++;
+	return cachePtr->regexpPtr;
+    }
+    hPtr = Tcl_FindHashEntry(&iPtr->regexpTable, string);
+    if (hPtr != NULL) {
+	iPtr->regexpHits++;
+	cachePtr = (CachedRegexp *) Tcl_GetHashValue(hPtr);
 
-	    if (i != 0) {
-		int j;
-		char *cachedString;
+	/*
+	 * Move the entry to the front of the list of entries.
+	 */
 
-		cachedString = iPtr->patterns[i];
-		result = iPtr->regexps[i];
-		for (j = i-1; j >= 0; j--) {
-		    iPtr->patterns[j+1] = iPtr->patterns[j];
-		    iPtr->patLengths[j+1] = iPtr->patLengths[j];
-		    iPtr->regexps[j+1] = iPtr->regexps[j];
-		}
-		iPtr->patterns[0] = cachedString;
-		iPtr->patLengths[0] = length;
-		iPtr->regexps[0] = result;
-	    }
-	    return iPtr->regexps[0];
+	cachePtr->prevPtr->nextPtr = cachePtr->nextPtr;
+	if (cachePtr->nextPtr != NULL) {
+	    cachePtr->nextPtr->prevPtr = cachePtr->prevPtr;
+	} else {
+	    iPtr->regexpLast = cachePtr->prevPtr;
 	}
+	cachePtr->prevPtr = NULL;
+	cachePtr->nextPtr = iPtr->regexpFirst;
+	iPtr->regexpFirst->prevPtr = cachePtr;
+	iPtr->regexpFirst = cachePtr;
+	return cachePtr->regexpPtr;
     }
 
     /*
      * No match in the cache.  Compile the string and add it to the
-     * cache.
+     * cache, discarding the least recently used pattern if the cache
+     * is full.
      */
 
+    iPtr->regexpMisses++;
     tclRegexpError = NULL;
     result = regcomp(string);
     if (tclRegexpError != NULL) {
@@ -1415,22 +1431,131 @@ TclCompileRegexp(interp, string)
 	    tclRegexpError, (char *) NULL);
 	return NULL;
     }
-    if (iPtr->patterns[NUM_REGEXPS-1] != NULL) {
-	ckfree(iPtr->patterns[NUM_REGEXPS-1]);
-	ckfree((char *) iPtr->regexps[NUM_REGEXPS-1]);
+    if (iPtr->regexpTable.numEntries >= iPtr->maxRegexps) {
+	DiscardRegexps(iPtr, iPtr->maxRegexps - 1);
     }
-    for (i = NUM_REGEXPS - 2; i >= 0; i--) {
-	iPtr->patterns[i+1] = iPtr->patterns[i];
-	iPtr->patLengths[i+1] = iPtr->patLengths[i];
-	iPtr->regexps[i+1] = iPtr->regexps[i];
+    cachePtr = (CachedRegexp *) ckalloc(sizeof(CachedRegexp));
+    cachePtr->regexpPtr = result;
+    cachePtr->hPtr = Tcl_CreateHashEntry(&iPtr->regexpTable, string, &new);
+    Tcl_SetHashValue(cachePtr->hPtr, cachePtr);
+    cachePtr->prevPtr = NULL;
+    cachePtr->nextPtr = iPtr->regexpFirst;
+    if (iPtr->regexpFirst != NULL) {
+	iPtr->regexpFirst->prevPtr = cachePtr;
+    } else {
+	iPtr->regexpLast = cachePtr;
     }
-    iPtr->patterns[0] = (char *) ckalloc((unsigned) (length+1));
-    strcpy(iPtr->patterns[0], string);
-    iPtr->patLengths[0] = length;
-    iPtr->regexps[0] = result;
+    iPtr->regexpFirst = cachePtr;
     return result;
 }
-
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DiscardRegexps --
+ *
+ *	Discard the least recently used entries in an interpreter's
+ *	cache of compiled regular expressions until no more than a
+ *	given number remain.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Compiled regular expressions are freed, and the interpreter's
+ *	count of evictions is incremented for each one.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+DiscardRegexps(iPtr, keep)
+    register Interp *iPtr;		/* Interpreter whose cache is to
+					 * be trimmed. */
+    int keep;				/* Number of entries to keep. */
+{
+    register CachedRegexp *cachePtr;
+
+    while (iPtr->regexpTable.numEntries > keep) {
+	cachePtr = iPtr->regexpLast;
+	iPtr->regexpLast = cachePtr->prevPtr;
+	if (cachePtr->prevPtr != NULL) {
+	    cachePtr->prevPtr->nextPtr = NULL;
+	} else {
+	    iPtr->regexpFirst = NULL;
+	}
+	Tcl_DeleteHashEntry(cachePtr->hPtr);
+	TclFreeRegexp(cachePtr->regexpPtr);
+	ckfree((char *) cachePtr);
+	iPtr->regexpEvictions++;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclFlushRegexps --
+ *
+ *	Empty an interpreter's cache of compiled regular expressions.
+ *	Called when the interpreter is deleted.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	All of the compiled regular expressions are freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclFlushRegexps(iPtr)
+    Interp *iPtr;			/* Interpreter whose cache is to
+					 * be emptied. */
+{
+    long evictions = iPtr->regexpEvictions;
+
+    DiscardRegexps(iPtr, 0);
+    iPtr->regexpEvictions = evictions;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclSetRegexpCacheSize --
+ *
+ *	Change the number of compiled regular expressions an interpreter
+ *	may keep in its cache.
+ *
+ * Results:
+ *	A standard Tcl result.  If size is less than one, TCL_ERROR is
+ *	returned and an error message is left in interp->result.
+ *
+ * Side effects:
+ *	If the cache holds more than size patterns, the least recently
+ *	used ones are discarded.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclSetRegexpCacheSize(interp, size)
+    Tcl_Interp *interp;			/* Interpreter whose cache is to
+					 * be resized. */
+    int size;				/* New capacity of the cache. */
+{
+    register Interp *iPtr = (Interp *) interp;
+
+    if (size < 1) {
+	sprintf(interp->result,
+		"bad regexp cache size %d: must be at least 1", size);
+	return TCL_ERROR;
+    }
+    iPtr->maxRegexps = size;
+    DiscardRegexps(iPtr, size);
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -33,6 +33,20 @@ static char *needArray =	"variable isn't array";
 static char *noSuchElement =	"no such element in array";
 static char *traceActive =	"trace is active on variable";
 
+/*
+ * The macro below removes the hash table entry for a variable that is
+ * being deleted.  The entries for a procedure's compiled locals
+ * belong to its call frame rather than to a table:  they just lose
+ * their value.
+ */
+
+#define DeleteVarEntry(hPtr) \
+    if ((hPtr)->tablePtr == NULL) { \
+	Tcl_SetHashValue(hPtr, NULL); \
+    } else { \
+	Tcl_DeleteHashEntry(hPtr); \
+    }
+
 /*
  * Forward references to procedures defined later in this file:
  */
@@ -43,7 +57,10 @@ static  char *		CallTraces _ANSI_ARGS_((Interp *iPtr, Var *arrayPtr,
 static void		DeleteSearches _ANSI_ARGS_((Var *arrayVarPtr));
 static void		DeleteArray _ANSI_ARGS_((Interp *iPtr, char *arrayName,
 			    Var *varPtr, int flags));
+static void		DeleteVar _ANSI_ARGS_((Interp *iPtr,
+			    Tcl_HashEntry *hPtr, char *name, int flags));
 static Var *		NewVar _ANSI_ARGS_((int space));
+static int		SameName _ANSI_ARGS_((char *p, char *q));
 static ArraySearch *	ParseSearchId _ANSI_ARGS_((Tcl_Interp *interp,
 			    Var *varPtr, char *varName, char *string));
 static void		VarErrMsg _ANSI_ARGS_((Tcl_Interp *interp,
@@ -147,6 +164,49 @@ Tcl_GetVar2(interp, part1, part2, flags)
 				 * array. */
     int flags;			/* OR-ed combination of TCL_GLOBAL_ONLY
 				 * or TCL_LEAVE_ERR_MSG bits. */
+{
+    Var *varPtr;
+
+    varPtr = TclGetVar2Ptr(interp, part1, part2, flags);
+    if (varPtr == NULL) {
+	return NULL;
+    }
+    return varPtr->value.string;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclGetVar2Ptr --
+ *
+ *	Read a variable the way Tcl_GetVar2 does, but return the
+ *	variable itself rather than just its string value, so that
+ *	the caller can use or fill in the variable's cached internal
+ *	representation.
+ *
+ * Results:
+ *	The return value points to the variable given by part1 and
+ *	part2, which is defined and is not an array.  If the variable
+ *	can't be read then NULL is returned, as for Tcl_GetVar2.  The
+ *	pointer is only valid up until the next change to any variable
+ *	(see the varEpoch field of Interp).
+ *
+ * Side effects:
+ *	Read traces are invoked.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Var *
+TclGetVar2Ptr(interp, part1, part2, flags)
+    Tcl_Interp *interp;		/* Command interpreter in which variable is
+				 * to be looked up. */
+    char *part1;		/* Name of array (if part2 is NULL) or
+				 * name of variable. */
+    char *part2;		/* If non-null, gives name of element in
+				 * array. */
+    int flags;			/* OR-ed combination of TCL_GLOBAL_ONLY
+				 * or TCL_LEAVE_ERR_MSG bits. */
 {
     Tcl_HashEntry *hPtr;
     Var *varPtr;
@@ -157,11 +217,7 @@ Tcl_GetVar2(interp, part1, part2, flags)
      * Lookup the first name.
      */
 
-    if ((flags & TCL_GLOBAL_ONLY) || (iPtr->varFramePtr == NULL)) {
-	hPtr = Tcl_FindHashEntry(&iPtr->globalTable, part1);
-    } else {
-	hPtr = Tcl_FindHashEntry(&iPtr->varFramePtr->varTable, part1);
-    }
+    hPtr = TclLookupVar(iPtr, part1, flags, 0, (int *) NULL);
     if (hPtr == NULL) {
 	if (flags & TCL_LEAVE_ERR_MSG) {
 	    VarErrMsg(interp, part1, part2, "read", noSuchVar);
@@ -216,14 +272,6 @@ Tcl_GetVar2(interp, part1, part2, flags)
 	    VarErrMsg(interp, part1, part2, "read", msg);
 	    return NULL;
 	}
-
-	/*
-	 * Watch out!  The variable could have gotten re-allocated to
-	 * a larger size.  Fortunately the hash table entry will still
-	 * be around.
-	 */
-
-	varPtr = (Var *) Tcl_GetHashValue(hPtr);
     }
     if (varPtr->flags & (VAR_UNDEFINED|VAR_UPVAR|VAR_ARRAY)) {
 	if (flags & TCL_LEAVE_ERR_MSG) {
@@ -231,7 +279,7 @@ Tcl_GetVar2(interp, part1, part2, flags)
 	}
 	return NULL;
     }
-    return varPtr->value.string;
+    return varPtr;
 }
 
 /*
@@ -336,6 +384,52 @@ Tcl_SetVar2(interp, part1, part2, newValue, flags)
 				 * any of TCL_GLOBAL_ONLY, TCL_APPEND_VALUE,
 				 * TCL_LIST_ELEMENT, and TCL_NO_SPACE, or
 				 * TCL_LEAVE_ERR_MSG . */
+{
+    Var *varPtr;
+
+    varPtr = TclSetVar2Ptr(interp, part1, part2, newValue, flags);
+    if (varPtr == NULL) {
+	return NULL;
+    }
+    return varPtr->value.string;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclSetVar2Ptr --
+ *
+ *	Change the value of a variable the way Tcl_SetVar2 does, but
+ *	return the variable itself.
+ *
+ * Results:
+ *	Returns a pointer to the variable given by part1 and part2,
+ *	after its write traces have been invoked.  The caller may
+ *	store an internal representation in the variable if it is
+ *	sure that it matches the variable's (possibly traced) string
+ *	value.  If the write was disallowed then NULL is returned, as
+ *	for Tcl_SetVar2.
+ *
+ * Side effects:
+ *	The value of the given variable is set, as for Tcl_SetVar2.
+ *	Any internal representation cached for the old value is
+ *	discarded.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Var *
+TclSetVar2Ptr(interp, part1, part2, newValue, flags)
+    Tcl_Interp *interp;		/* Command interpreter in which variable is
+				 * to be looked up. */
+    char *part1;		/* If part2 is NULL, this is name of scalar
+				 * variable.  Otherwise it is name of array. */
+    char *part2;		/* Name of an element within array, or NULL. */
+    char *newValue;		/* New value for variable. */
+    int flags;			/* Various flags that tell how to set value:
+				 * any of TCL_GLOBAL_ONLY, TCL_APPEND_VALUE,
+				 * TCL_LIST_ELEMENT, TCL_NO_SPACE,
+				 * TCL_OWN_VALUE, or TCL_LEAVE_ERR_MSG. */
 {
     Tcl_HashEntry *hPtr;
     register Var *varPtr = NULL;
@@ -349,12 +443,7 @@ Tcl_SetVar2(interp, part1, part2, newValue, flags)
      * Lookup the first name.
      */
 
-    if ((flags & TCL_GLOBAL_ONLY) || (iPtr->varFramePtr == NULL)) {
-	hPtr = Tcl_CreateHashEntry(&iPtr->globalTable, part1, &new);
-    } else {
-	hPtr = Tcl_CreateHashEntry(&iPtr->varFramePtr->varTable,
-		part1, &new);
-    }
+    hPtr = TclLookupVar(iPtr, part1, flags, 1, &new);
     if (!new) {
 	varPtr = (Var *) Tcl_GetHashValue(hPtr);
 	if (varPtr->flags & VAR_UPVAR) {
@@ -376,17 +465,22 @@ Tcl_SetVar2(interp, part1, part2, newValue, flags)
 	    varPtr->flags = VAR_ARRAY;
 	    varPtr->value.tablePtr = (Tcl_HashTable *)
 		    ckalloc(sizeof(Tcl_HashTable));
-	    Tcl_InitHashTable(varPtr->value.tablePtr, TCL_STRING_KEYS);
+	    Tcl_InitHashTable(varPtr->value.tablePtr,
+		    TCL_STRING_KEYS|TCL_OPEN_HASH);
 	} else {
 	    if (varPtr->flags & VAR_UNDEFINED) {
 		varPtr->flags = VAR_ARRAY;
 		varPtr->value.tablePtr = (Tcl_HashTable *)
 			ckalloc(sizeof(Tcl_HashTable));
-		Tcl_InitHashTable(varPtr->value.tablePtr, TCL_STRING_KEYS);
+		Tcl_InitHashTable(varPtr->value.tablePtr,
+			TCL_STRING_KEYS|TCL_OPEN_HASH);
 	    } else if (!(varPtr->flags & VAR_ARRAY)) {
 		if (flags & TCL_LEAVE_ERR_MSG) {
 		    VarErrMsg(interp, part1, part2, "set", needArray);
 		}
+		if (flags & TCL_OWN_VALUE) {
+		    ckfree(newValue);
+		}
 		return NULL;
 	    }
 	    arrayPtr = varPtr;
@@ -412,7 +506,7 @@ Tcl_SetVar2(interp, part1, part2, newValue, flags)
      */
 
     if (new) {
-	varPtr = NewVar(length);
+	varPtr = NewVar((flags & TCL_OWN_VALUE) ? 0 : length + 1);
 	Tcl_SetHashValue(hPtr, varPtr);
 	if ((arrayPtr != NULL) && (arrayPtr->searchPtr != NULL)) {
 	    DeleteSearches(arrayPtr);
@@ -423,36 +517,61 @@ Tcl_SetVar2(interp, part1, part2, newValue, flags)
 	    if (flags & TCL_LEAVE_ERR_MSG) {
 		VarErrMsg(interp, part1, part2, "set", isArray);
 	    }
+	    if (flags & TCL_OWN_VALUE) {
+		ckfree(newValue);
+	    }
 	    return NULL;
 	}
 	if (!(flags & TCL_APPEND_VALUE) || (varPtr->flags & VAR_UNDEFINED)) {
 	    varPtr->valueLength = 0;
 	}
+	TclFreeVarRep(varPtr);
+    }
+    iPtr->varEpoch++;
+
+    /*
+     * A value handed over with TCL_OWN_VALUE simply replaces the
+     * variable's space, unless it has to be appended or converted
+     * to a list element, in which case it is copied like any other.
+     */
+
+    if ((flags & TCL_OWN_VALUE) && !(flags & TCL_LIST_ELEMENT)
+	    && (varPtr->valueLength == 0)) {
+	if (varPtr->valueSpace > 0) {
+	    ckfree(varPtr->value.string);
+	}
+	varPtr->value.string = newValue;
+	varPtr->valueSpace = length + 1;
+	varPtr->valueLength = length;
+	varPtr->flags &= ~VAR_UNDEFINED;
+	goto traces;
     }
 
     /*
      * Make sure there's enough space to hold the variable's
-     * new value.  If not, enlarge the variable's space.
+     * new value.  If not, enlarge the variable's space:  at least
+     * double it, so that a value built up by repeated appends only
+     * gets copied a few times.  The space is separate from the
+     * variable, so the variable itself stays where it is.
      */
 
     if ((length + varPtr->valueLength) >= varPtr->valueSpace) {
-	Var *newVarPtr;
 	int newSize;
 
 	newSize = 2*varPtr->valueSpace;
 	if (newSize <= (length + varPtr->valueLength)) {
-	    newSize += length;
-	}
-	newVarPtr = NewVar(newSize);
-	newVarPtr->valueLength = varPtr->valueLength;
-	newVarPtr->upvarUses = varPtr->upvarUses;
-	newVarPtr->tracePtr = varPtr->tracePtr;
-	newVarPtr->searchPtr = varPtr->searchPtr;
-	newVarPtr->flags = varPtr->flags;
-	strcpy(newVarPtr->value.string, varPtr->value.string);
-	Tcl_SetHashValue(hPtr, newVarPtr);
-	ckfree((char *) varPtr);
-	varPtr = newVarPtr;
+	    newSize = length + varPtr->valueLength + 1;
+	}
+	if (varPtr->valueLength > 0) {
+	    varPtr->value.string = ckrealloc(varPtr->value.string,
+		    (unsigned) newSize);
+	} else {
+	    if (varPtr->valueSpace > 0) {
+		ckfree(varPtr->value.string);
+	    }
+	    varPtr->value.string = ckalloc((unsigned) newSize);
+	}
+	varPtr->valueSpace = newSize;
     }
 
     /*
@@ -469,10 +588,16 @@ Tcl_SetVar2(interp, part1, part2, newValue, flags)
 		varPtr->value.string + varPtr->valueLength, listFlags);
 	varPtr->value.string[varPtr->valueLength] = 0;
     } else {
-	strcpy(varPtr->value.string + varPtr->valueLength, newValue);
+	memcpy((VOID *) (varPtr->value.string + varPtr->valueLength),
+		(VOID *) newValue, length + 1);
 	varPtr->valueLength += length;
     }
     varPtr->flags &= ~VAR_UNDEFINED;
+    if (flags & TCL_OWN_VALUE) {
+	ckfree(newValue);
+    }
+
+    traces:
 
     /*
      * Invoke any write traces for the variable.
@@ -488,16 +613,8 @@ Tcl_SetVar2(interp, part1, part2, newValue, flags)
 	    VarErrMsg(interp, part1, part2, "set", msg);
 	    return NULL;
 	}
-
-	/*
-	 * Watch out!  The variable could have gotten re-allocated to
-	 * a larger size.  Fortunately the hash table entry will still
-	 * be around.
-	 */
-
-	varPtr = (Var *) Tcl_GetHashValue(hPtr);
     }
-    return varPtr->value.string;
+    return varPtr;
 }
 
 /*
@@ -597,11 +714,7 @@ Tcl_UnsetVar2(interp, part1, part2, flags)
     Interp *iPtr = (Interp *) interp;
     Var *arrayPtr = NULL;
 
-    if ((flags & TCL_GLOBAL_ONLY) || (iPtr->varFramePtr == NULL)) {
-	hPtr = Tcl_FindHashEntry(&iPtr->globalTable, part1);
-    } else {
-	hPtr = Tcl_FindHashEntry(&iPtr->varFramePtr->varTable, part1);
-    }
+    hPtr = TclLookupVar(iPtr, part1, flags, 0, (int *) NULL);
     if (hPtr == NULL) {
 	if (flags & TCL_LEAVE_ERR_MSG) {
 	    VarErrMsg(interp, part1, part2, "unset", noSuchVar);
@@ -676,14 +789,19 @@ Tcl_UnsetVar2(interp, part1, part2, flags)
      * storage using the dummy copies.
      */
 
+    TclFreeVarRep(varPtr);
+    iPtr->varEpoch++;
     dummyVar = *varPtr;
     Tcl_SetHashValue(&dummyEntry, &dummyVar);
     if (varPtr->upvarUses == 0) {
-	Tcl_DeleteHashEntry(hPtr);
+	DeleteVarEntry(hPtr);
 	ckfree((char *) varPtr);
     } else {
 	varPtr->flags = VAR_UNDEFINED;
 	varPtr->tracePtr = NULL;
+	varPtr->valueLength = 0;
+	varPtr->valueSpace = 0;
+	varPtr->value.string = NULL;
     }
 
     /*
@@ -711,6 +829,8 @@ Tcl_UnsetVar2(interp, part1, part2, flags)
     if (dummyVar.flags & VAR_ARRAY) {
 	DeleteArray(iPtr, part1, &dummyVar,
 	    (flags & TCL_GLOBAL_ONLY) | TCL_TRACE_UNSETS);
+    } else if (dummyVar.valueSpace > 0) {
+	ckfree(dummyVar.value.string);
     }
     if (dummyVar.flags & VAR_UNDEFINED) {
 	if (flags & TCL_LEAVE_ERR_MSG) {
@@ -837,11 +957,7 @@ Tcl_TraceVar2(interp, part1, part2, flags, proc, clientData)
      * Locate the variable, making a new (undefined) one if necessary.
      */
 
-    if ((flags & TCL_GLOBAL_ONLY) || (iPtr->varFramePtr == NULL)) {
-	hPtr = Tcl_CreateHashEntry(&iPtr->globalTable, part1, &new);
-    } else {
-	hPtr = Tcl_CreateHashEntry(&iPtr->varFramePtr->varTable, part1, &new);
-    }
+    hPtr = TclLookupVar(iPtr, part1, flags, 1, &new);
     if (!new) {
 	varPtr = (Var *) Tcl_GetHashValue(hPtr);
 	if (varPtr->flags & VAR_UPVAR) {
@@ -864,13 +980,15 @@ Tcl_TraceVar2(interp, part1, part2, flags, proc, clientData)
 	    varPtr->flags = VAR_ARRAY;
 	    varPtr->value.tablePtr = (Tcl_HashTable *)
 		    ckalloc(sizeof(Tcl_HashTable));
-	    Tcl_InitHashTable(varPtr->value.tablePtr, TCL_STRING_KEYS);
+	    Tcl_InitHashTable(varPtr->value.tablePtr,
+		    TCL_STRING_KEYS|TCL_OPEN_HASH);
 	} else {
 	    if (varPtr->flags & VAR_UNDEFINED) {
 		varPtr->flags = VAR_ARRAY;
 		varPtr->value.tablePtr = (Tcl_HashTable *)
 			ckalloc(sizeof(Tcl_HashTable));
-		Tcl_InitHashTable(varPtr->value.tablePtr, TCL_STRING_KEYS);
+		Tcl_InitHashTable(varPtr->value.tablePtr,
+			TCL_STRING_KEYS|TCL_OPEN_HASH);
 	    } else if (!(varPtr->flags & VAR_ARRAY)) {
 		iPtr->result = needArray;
 		return TCL_ERROR;
@@ -1008,11 +1126,7 @@ Tcl_UntraceVar2(interp, part1, part2, flags, proc, clientData)
      * First, lookup the variable.
      */
 
-    if ((flags & TCL_GLOBAL_ONLY) || (iPtr->varFramePtr == NULL)) {
-	hPtr = Tcl_FindHashEntry(&iPtr->globalTable, part1);
-    } else {
-	hPtr = Tcl_FindHashEntry(&iPtr->varFramePtr->varTable, part1);
-    }
+    hPtr = TclLookupVar(iPtr, part1, flags, 0, (int *) NULL);
     if (hPtr == NULL) {
 	return;
     }
@@ -1178,11 +1292,7 @@ Tcl_VarTraceInfo2(interp, part1, part2, flags, proc, prevClientData)
      * First, lookup the variable.
      */
 
-    if ((flags & TCL_GLOBAL_ONLY) || (iPtr->varFramePtr == NULL)) {
-	hPtr = Tcl_FindHashEntry(&iPtr->globalTable, part1);
-    } else {
-	hPtr = Tcl_FindHashEntry(&iPtr->varFramePtr->varTable, part1);
-    }
+    hPtr = TclLookupVar(iPtr, part1, flags, 0, (int *) NULL);
     if (hPtr == NULL) {
 	return NULL;
     }
@@ -1447,11 +1557,7 @@ Tcl_ArrayCmd(dummy, interp, argc, argv)
      * Locate the array variable (and it better be an array).
      */
 
-    if (iPtr->varFramePtr == NULL) {
-	hPtr = Tcl_FindHashEntry(&iPtr->globalTable, argv[2]);
-    } else {
-	hPtr = Tcl_FindHashEntry(&iPtr->varFramePtr->varTable, argv[2]);
-    }
+    hPtr = TclLookupVar(iPtr, argv[2], 0, 0, (int *) NULL);
     if (hPtr == NULL) {
 	notArray:
 	Tcl_AppendResult(interp, "\"", argv[2], "\" isn't an array",
@@ -1623,10 +1729,19 @@ Tcl_ArrayCmd(dummy, interp, argc, argv)
 		&searchPtr->search);
 	searchPtr->nextPtr = varPtr->searchPtr;
 	varPtr->searchPtr = searchPtr;
+    } else if ((c == 's') && (strncmp(argv[1], "statistics", length) == 0)
+	    && (length >= 4)) {
+	if (argc != 3) {
+	    Tcl_AppendResult(interp, "wrong # args: should be \"",
+		    argv[0], " statistics arrayName\"", (char *) NULL);
+	    return TCL_ERROR;
+	}
+	interp->result = Tcl_HashStats(varPtr->value.tablePtr);
+	interp->freeProc = (Tcl_FreeProc *) free;
     } else {
 	Tcl_AppendResult(interp, "bad option \"", argv[1],
 		"\": should be anymore, donesearch, names, nextelement, ",
-		"size, or startsearch", (char *) NULL);
+		"size, startsearch, or statistics", (char *) NULL);
 	return TCL_ERROR;
     }
     return TCL_OK;
@@ -1680,7 +1795,7 @@ Tcl_GlobalCmd(dummy, interp, argc, argv)
 	} else {
 	    gVarPtr = (Var *) Tcl_GetHashValue(hPtr);
 	}
-	hPtr2 = Tcl_CreateHashEntry(&iPtr->varFramePtr->varTable, *argv, &new);
+	hPtr2 = TclLookupVar(iPtr, *argv, 0, 1, &new);
 	if (!new) {
 	    Var *varPtr;
 	    varPtr = (Var *) Tcl_GetHashValue(hPtr2);
@@ -1728,9 +1843,8 @@ Tcl_UpvarCmd(dummy, interp, argc, argv)
 {
     register Interp *iPtr = (Interp *) interp;
     int result;
-    CallFrame *framePtr;
+    CallFrame *framePtr, *savedVarFramePtr;
     Var *varPtr = NULL;
-    Tcl_HashTable *upVarTablePtr;
     Tcl_HashEntry *hPtr, *hPtr2;
     int new;
     Var *upVarPtr;
@@ -1744,7 +1858,7 @@ Tcl_UpvarCmd(dummy, interp, argc, argv)
     }
 
     /*
-     * Find the hash table containing the variable being referenced.
+     * Find the frame containing the variable being referenced.
      */
 
     result = TclGetFrame(interp, argv[1], &framePtr);
@@ -1753,11 +1867,6 @@ Tcl_UpvarCmd(dummy, interp, argc, argv)
     }
     argc -= result+1;
     argv += result+1;
-    if (framePtr == NULL) {
-	upVarTablePtr = &iPtr->globalTable;
-    } else {
-	upVarTablePtr = &framePtr->varTable;
-    }
 
     if ((argc & 1) != 0) {
 	goto upvarSyntax;
@@ -1771,7 +1880,10 @@ Tcl_UpvarCmd(dummy, interp, argc, argv)
      */
 
     while (argc > 0) {
-        hPtr = Tcl_CreateHashEntry(upVarTablePtr, argv[0], &new);
+	savedVarFramePtr = iPtr->varFramePtr;
+	iPtr->varFramePtr = framePtr;
+        hPtr = TclLookupVar(iPtr, argv[0], 0, 1, &new);
+	iPtr->varFramePtr = savedVarFramePtr;
         if (new) {
             upVarPtr = NewVar(0);
             upVarPtr->flags |= VAR_UNDEFINED;
@@ -1784,8 +1896,7 @@ Tcl_UpvarCmd(dummy, interp, argc, argv)
 	    }
         }
 
-        hPtr2 = Tcl_CreateHashEntry(&iPtr->varFramePtr->varTable,
-                    argv[1], &new);
+        hPtr2 = TclLookupVar(iPtr, argv[1], 0, 1, &new);
         if (!new) {
             Tcl_AppendResult((Tcl_Interp *) iPtr, "variable \"", argv[1],
                 "\" already exists", (char *) NULL);
@@ -1832,8 +1943,7 @@ TclDeleteVars(iPtr, tablePtr)
 {
     Tcl_HashSearch search;
     Tcl_HashEntry *hPtr;
-    register Var *varPtr;
-    int flags, globalFlag;
+    int flags;
 
     flags = TCL_TRACE_UNSETS;
     if (tablePtr == &iPtr->globalTable) {
@@ -1841,59 +1951,134 @@ TclDeleteVars(iPtr, tablePtr)
     }
     for (hPtr = Tcl_FirstHashEntry(tablePtr, &search); hPtr != NULL;
 	    hPtr = Tcl_NextHashEntry(&search)) {
-	varPtr = (Var *) Tcl_GetHashValue(hPtr);
+	DeleteVar(iPtr, hPtr, Tcl_GetHashKey(tablePtr, hPtr), flags);
+    }
+    Tcl_DeleteHashTable(tablePtr);
+}
 
-	/*
-	 * For global/upvar variables referenced in procedures, free up the
-	 * local space and then decrement the reference count on the
-	 * variable referred to.  If there are no more references to the
-	 * global/upvar and it is undefined and has no traces set, then
-	 * follow on and delete the referenced variable too.
-	 */
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclDeleteFrame --
+ *
+ *	This procedure is called to recycle the variables of a
+ *	procedure's call frame, both those in its slots and those in
+ *	its hash table.  As with TclDeleteVars, the frame must no
+ *	longer be accessible from Tcl commands.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Variables are deleted and trace procedures are invoked, if
+ *	any are declared.  The storage for the slots themselves
+ *	belongs to the caller.
+ *
+ *----------------------------------------------------------------------
+ */
 
-	globalFlag = 0;
-	if (varPtr->flags & VAR_UPVAR) {
-	    hPtr = varPtr->value.upvarPtr;
-	    ckfree((char *) varPtr);
-	    varPtr = (Var *) Tcl_GetHashValue(hPtr);
-	    varPtr->upvarUses--;
-	    if ((varPtr->upvarUses != 0) || !(varPtr->flags & VAR_UNDEFINED)
-		    || (varPtr->tracePtr != NULL)) {
-		continue;
-	    }
-	    globalFlag = TCL_GLOBAL_ONLY;
-	}
-
-	/*
-	 * Invoke traces on the variable that is being deleted, then
-	 * free up the variable's space (no need to free the hash entry
-	 * here, unless we're dealing with a global variable:  the
-	 * hash entries will be deleted automatically when the whole
-	 * table is deleted).
-	 */
-
-	if (varPtr->tracePtr != NULL) {
-	    (void) CallTraces(iPtr, (Var *) NULL, hPtr,
-		    Tcl_GetHashKey(tablePtr, hPtr), (char *) NULL,
-		    flags | globalFlag);
-	    while (varPtr->tracePtr != NULL) {
-		VarTrace *tracePtr = varPtr->tracePtr;
-		varPtr->tracePtr = tracePtr->nextPtr;
-		ckfree((char *) tracePtr);
+void
+TclDeleteFrame(iPtr, framePtr)
+    Interp *iPtr;		/* Interpreter to which frame belongs. */
+    register CallFrame *framePtr;	/* Frame whose variables are to
+					 * be deleted. */
+{
+    int i;
+
+    if (framePtr->localsPtr != NULL) {
+	for (i = 0; i < framePtr->localsPtr->numLocals; i++) {
+	    if (Tcl_GetHashValue(&framePtr->slots[i]) != NULL) {
+		DeleteVar(iPtr, &framePtr->slots[i],
+			framePtr->localsPtr->names[i], TCL_TRACE_UNSETS);
 	    }
 	}
-	if (varPtr->flags & VAR_ARRAY) {
-	    DeleteArray(iPtr, Tcl_GetHashKey(tablePtr, hPtr), varPtr,
-		    flags | globalFlag);
+    }
+    if (framePtr->varTablePtr != NULL) {
+	TclDeleteVars(iPtr, framePtr->varTablePtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * DeleteVar --
+ *
+ *	Delete one of the variables of a table or frame that is being
+ *	deleted as a whole (see TclDeleteVars).
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The variable's traces are invoked and its storage is freed.
+ *	The entry at hPtr is left for the caller to clean up.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+DeleteVar(iPtr, hPtr, name, flags)
+    Interp *iPtr;		/* Interpreter to which variable belongs. */
+    Tcl_HashEntry *hPtr;	/* Entry for variable. */
+    char *name;			/* Name of variable. */
+    int flags;			/* Flags to pass to trace procedures. */
+{
+    register Var *varPtr;
+    int globalFlag;
+
+    varPtr = (Var *) Tcl_GetHashValue(hPtr);
+
+    /*
+     * For global/upvar variables referenced in procedures, free up the
+     * local space and then decrement the reference count on the
+     * variable referred to.  If there are no more references to the
+     * global/upvar and it is undefined and has no traces set, then
+     * follow on and delete the referenced variable too.
+     */
+
+    globalFlag = 0;
+    if (varPtr->flags & VAR_UPVAR) {
+	hPtr = varPtr->value.upvarPtr;
+	ckfree((char *) varPtr);
+	varPtr = (Var *) Tcl_GetHashValue(hPtr);
+	varPtr->upvarUses--;
+	if ((varPtr->upvarUses != 0) || !(varPtr->flags & VAR_UNDEFINED)
+		|| (varPtr->tracePtr != NULL)) {
+	    return;
 	}
-	if (globalFlag) {
-	    Tcl_DeleteHashEntry(hPtr);
+	globalFlag = TCL_GLOBAL_ONLY;
+    }
+
+    /*
+     * Invoke traces on the variable that is being deleted, then
+     * free up the variable's space (no need to free the hash entry
+     * here, unless we're dealing with a global variable:  the
+     * hash entries will be deleted automatically when the whole
+     * table is deleted).
+     */
+
+    if (varPtr->tracePtr != NULL) {
+	(void) CallTraces(iPtr, (Var *) NULL, hPtr, name, (char *) NULL,
+		flags | globalFlag);
+	while (varPtr->tracePtr != NULL) {
+	    VarTrace *tracePtr = varPtr->tracePtr;
+	    varPtr->tracePtr = tracePtr->nextPtr;
+	    ckfree((char *) tracePtr);
 	}
-	ckfree((char *) varPtr);
     }
-    Tcl_DeleteHashTable(tablePtr);
+    if (varPtr->flags & VAR_ARRAY) {
+	DeleteArray(iPtr, name, varPtr, flags | globalFlag);
+    } else if (varPtr->valueSpace > 0) {
+	ckfree(varPtr->value.string);
+    }
+    if (globalFlag) {
+	DeleteVarEntry(hPtr);
+    }
+    TclFreeVarRep(varPtr);
+    iPtr->varEpoch++;
+    ckfree((char *) varPtr);
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
@@ -2023,6 +2208,290 @@ CallTraces(iPtr, arrayPtr, hPtr, part1, part2, flags)
     return result;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclLookupVar --
+ *
+ *	Locate the hash table entry for a variable (but not an array
+ *	element) in the current context:  the global table, or the
+ *	slots and table of the current procedure's frame.
+ *
+ * Results:
+ *	The return value is a pointer to the entry for name.  If there
+ *	is no such variable then NULL is returned, unless create is
+ *	non-zero:  in that case a new entry is made, *newPtr is set to
+ *	1 and the caller must fill in its value.  Otherwise *newPtr
+ *	(if create is non-zero) is set to 0.
+ *
+ * Side effects:
+ *	The frame's hash table is initialized the first time a
+ *	variable without a slot is created in it.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_HashEntry *
+TclLookupVar(iPtr, name, flags, create, newPtr)
+    Interp *iPtr;		/* Interpreter in which to look up name. */
+    char *name;			/* Name of variable. */
+    int flags;			/* TCL_GLOBAL_ONLY means look only in the
+				 * global table;  other bits are ignored. */
+    int create;			/* Non-zero means create the entry if it
+				 * doesn't already exist. */
+    int *newPtr;		/* Set to 1 if a new entry was created.
+				 * Not used if create is zero. */
+{
+    register CallFrame *framePtr = iPtr->varFramePtr;
+    Tcl_HashEntry *hPtr;
+    int slot;
+
+    if ((flags & TCL_GLOBAL_ONLY) || (framePtr == NULL)) {
+	if (create) {
+	    return Tcl_CreateHashEntry(&iPtr->globalTable, name, newPtr);
+	}
+	return Tcl_FindHashEntry(&iPtr->globalTable, name);
+    }
+    if (framePtr->localsPtr != NULL) {
+	slot = TclFindSlot(framePtr, name);
+	if (slot >= 0) {
+	    hPtr = &framePtr->slots[slot];
+	    if (Tcl_GetHashValue(hPtr) == NULL) {
+		if (!create) {
+		    return NULL;
+		}
+		*newPtr = 1;
+	    } else if (create) {
+		*newPtr = 0;
+	    }
+	    return hPtr;
+	}
+    }
+    if (framePtr->varTablePtr == NULL) {
+	if (!create) {
+	    return NULL;
+	}
+	framePtr->varTablePtr = &framePtr->varTable;
+	Tcl_InitHashTable(framePtr->varTablePtr, TCL_STRING_KEYS);
+    }
+    if (create) {
+	return Tcl_CreateHashEntry(framePtr->varTablePtr, name, newPtr);
+    }
+    return Tcl_FindHashEntry(framePtr->varTablePtr, name);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclFindSlot --
+ *
+ *	Find the slot that holds one of a procedure's compiled local
+ *	variables.
+ *
+ * Results:
+ *	The return value is the index in framePtr->slots of the
+ *	variable called name, or -1 if name isn't one of the frame's
+ *	compiled locals.
+ *
+ * Side effects:
+ *	The slot is remembered in the procedure's CompiledLocals, so
+ *	that the same name string (usually a literal of compiled code)
+ *	can be found again without a search.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclFindSlot(framePtr, name)
+    CallFrame *framePtr;	/* Frame whose slots are to be searched.
+				 * Its localsPtr must not be NULL. */
+    char *name;			/* Name of variable (not array element). */
+{
+    register CompiledLocals *localsPtr = framePtr->localsPtr;
+    int i, index;
+
+    index = (int) ((unsigned long) name & (LOCAL_CACHE_SIZE - 1));
+    i = localsPtr->cacheSlots[index];
+    if ((localsPtr->cacheNames[index] == name)
+	    && SameName(localsPtr->names[i], name)) {
+	return i;
+    }
+    for (i = 0; i < localsPtr->numLocals; i++) {
+	if (SameName(localsPtr->names[i], name)) {
+	    localsPtr->cacheNames[index] = name;
+	    localsPtr->cacheSlots[index] = i;
+	    return i;
+	}
+    }
+    return -1;
+}
+
+/*
+ * The procedure below compares two variable names.  Names are usually
+ * just a few characters long, so this is cheaper than strcmp.
+ */
+
+static int
+SameName(p, q)
+    register char *p, *q;	/* Names to compare. */
+{
+    while (*p == *q) {
+	if (*p == 0) {
+	    return 1;
+	}
+	p++;
+	q++;
+    }
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclSetLocal --
+ *
+ *	Create one of the compiled locals of a new call frame, such
+ *	as a formal argument, with a given value.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	A variable is created and stored in the slot at hPtr, which
+ *	must be empty.  No traces can exist yet, so none are invoked.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclSetLocal(hPtr, value)
+    Tcl_HashEntry *hPtr;	/* Slot for variable. */
+    char *value;		/* Initial value for variable. */
+{
+    register Var *varPtr;
+    int length;
+
+    length = strlen(value);
+    varPtr = NewVar(length + 1);
+    memcpy((VOID *) varPtr->value.string, (VOID *) value, length + 1);
+    varPtr->valueLength = length;
+    Tcl_SetHashValue(hPtr, varPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclFreeVarRep --
+ *
+ *	Discard the internal representation cached for a variable's
+ *	value, if there is one.  This must be done whenever the
+ *	string value changes.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Storage for a split list may be freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclFreeVarRep(varPtr)
+    register Var *varPtr;	/* Variable whose value is changing. */
+{
+    if (varPtr->repType == VAR_REP_LIST) {
+	ckfree((char *) varPtr->rep.listPtr);
+    }
+    varPtr->repType = VAR_REP_NONE;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclGetVarList --
+ *
+ *	This procedure is called by list commands to find out whether
+ *	the list they were given as argv[1] is the unmodified value of
+ *	a variable, and if so to get the locations of the list's
+ *	elements without scanning it again.
+ *
+ * Results:
+ *	If word is argv[1] of the command currently being invoked, it
+ *	was substituted from nothing but a variable (see TclExecWords),
+ *	the variable's value hasn't changed since, and that value is a
+ *	proper list, then the return value gives the
+ *	offset and size of each element within word.  It belongs to
+ *	the variable and must not be modified or freed by the caller.
+ *	Otherwise NULL is returned and the caller should parse word
+ *	itself.
+ *
+ * Side effects:
+ *	The element index is cached in the variable.
+ *
+ *----------------------------------------------------------------------
+ */
+
+VarList *
+TclGetVarList(interp, word)
+    Tcl_Interp *interp;		/* Interpreter invoking the command. */
+    char *word;			/* Argv[1] of the command. */
+{
+    register Interp *iPtr = (Interp *) interp;
+    register Var *varPtr = iPtr->argVarPtr;
+    register VarList *listPtr;
+    ListElement *elPtr;
+    char *list, *p, *element;
+    int size, elSize, brace;
+
+    if ((varPtr == NULL) || (iPtr->argVarWord != word)
+	    || (iPtr->argVarEpoch != iPtr->varEpoch)) {
+	return NULL;
+    }
+    if (varPtr->repType == VAR_REP_LIST) {
+	return varPtr->rep.listPtr;
+    }
+
+    /*
+     * Scan the list the same way as Tcl_SplitList, but record where
+     * each element lies instead of copying it.  The number of
+     * space characters limits the number of elements.
+     */
+
+    list = varPtr->value.string;
+    for (size = 1, p = list; *p != 0; p++) {
+	if (isspace(*p)) {
+	    size++;
+	}
+    }
+    listPtr = (VarList *) ckalloc((unsigned) (sizeof(VarList)
+	    + (size - 1) * sizeof(ListElement)));
+    listPtr->numElements = 0;
+    for (p = list, elPtr = listPtr->elements; *p != 0; elPtr++) {
+	if (TclFindElement(interp, p, &element, &p, &elSize, &brace)
+		!= TCL_OK) {
+	    Tcl_ResetResult(interp);
+	    ckfree((char *) listPtr);
+	    return NULL;
+	}
+	if (*element == 0) {
+	    break;
+	}
+	if (listPtr->numElements >= size) {
+	    ckfree((char *) listPtr);
+	    return NULL;
+	}
+	elPtr->offset = element - list;
+	elPtr->size = elSize;
+	elPtr->brace = brace;
+	listPtr->numElements++;
+    }
+    TclFreeVarRep(varPtr);
+    varPtr->repType = VAR_REP_LIST;
+    varPtr->rep.listPtr = listPtr;
+    return listPtr;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -2035,7 +2504,9 @@ CallTraces(iPtr, arrayPtr, hPtr, part1, part2, flags)
  *	The variable will not be part of any hash table yet, and its
  *	upvarUses count is initialized to 0.  Its initial value will
  *	be empty, but "space" bytes will be available in the value
- *	area.
+ *	area.  If space is 0 then no value area is allocated;  this is
+ *	used for variables that are undefined, arrays, or links to
+ *	other variables.
  *
  * Side effects:
  *	Storage gets allocated.
@@ -2048,22 +2519,22 @@ NewVar(space)
     int space;		/* Minimum amount of space to allocate
 			 * for variable's value. */
 {
-    int extra;
     register Var *varPtr;
 
-    extra = space - sizeof(varPtr->value);
-    if (extra < 0) {
-	extra = 0;
-	space = sizeof(varPtr->value);
-    }
-    varPtr = (Var *) ckalloc((unsigned) (sizeof(Var) + extra));
+    varPtr = (Var *) ckalloc(sizeof(Var));
     varPtr->valueLength = 0;
     varPtr->valueSpace = space;
     varPtr->upvarUses = 0;
     varPtr->tracePtr = NULL;
     varPtr->searchPtr = NULL;
     varPtr->flags = 0;
-    varPtr->value.string[0] = 0;
+    varPtr->repType = VAR_REP_NONE;
+    if (space > 0) {
+	varPtr->value.string = ckalloc((unsigned) space);
+	varPtr->value.string[0] = 0;
+    } else {
+	varPtr->value.string = NULL;
+    }
     return varPtr;
 }
 
@@ -2220,6 +2691,10 @@ DeleteArray(iPtr, arrayName, varPtr, flags)
 	if (elPtr->flags & VAR_SEARCHES_POSSIBLE) {
 	    panic("DeleteArray found searches on array alement!");
 	}
+	TclFreeVarRep(elPtr);
+	if (elPtr->valueSpace > 0) {
+	    ckfree(elPtr->value.string);
+	}
 	ckfree((char *) elPtr);
     }
     Tcl_DeleteHashTable(varPtr->value.tablePtr);
@@ -511,6 +511,367 @@ Tcl_CreateCommand (interp, "memory", MemoryCmd, (ClientData)NULL,
 
 #else
 
+#ifdef TCL_MEM_POOL
+
+/*
+ * Pool allocator.  Requests of up to MAX_POOL_SIZE bytes are rounded
+ * up to one of the sizes in poolSizes and served from a free list of
+ * blocks of exactly that size.  Blocks are carved out of pages of
+ * POOL_PAGE_SIZE bytes obtained from malloc;  pages are never given
+ * back, so once a program reaches its steady state the small objects
+ * it churns through (hash entries, variables, traces, short strings)
+ * are recycled without calling malloc or free and without fragmenting
+ * the heap.  Larger requests go to malloc directly.
+ *
+ * Every block is preceded by a PoolHeader that records which pool it
+ * came from (or NUM_POOLS for blocks from malloc) and the size that
+ * was requested.  While a block is on a free list its first word
+ * links it to the next free block.
+ */
+
+typedef union PoolHeader {
+    struct {
+	unsigned int size;	/* Number of bytes requested by caller. */
+	unsigned char pool;	/* Index of pool block belongs to, or
+				 * NUM_POOLS if it came from malloc. */
+    } info;
+    double align;		/* Forces body to be aligned for any use. */
+} PoolHeader;
+
+#define NUM_POOLS	10
+#define MAX_POOL_SIZE	256
+#define POOL_PAGE_SIZE	4096
+
+static unsigned int poolSizes[NUM_POOLS] = {
+    8, 16, 24, 32, 48, 64, 96, 128, 192, 256
+};
+
+/*
+ * The table below maps (size+7)/8 to the smallest pool whose blocks
+ * can hold size bytes.
+ */
+
+static unsigned char poolIndex[MAX_POOL_SIZE/8 + 1] = {
+    0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7,
+    8, 8, 8, 8, 8, 8, 8, 8, 9, 9, 9, 9, 9, 9, 9, 9
+};
+
+typedef struct Pool {
+    char *freePtr;		/* First free block (address of its body),
+				 * or NULL. */
+    long numAllocs;		/* Total number of allocations so far. */
+    int inUse;			/* Number of blocks currently allocated. */
+    int maxInUse;		/* Largest value inUse has ever had. */
+    int numPages;		/* Number of pages carved into blocks. */
+} Pool;
+
+/*
+ * Pools[NUM_POOLS] keeps the statistics for large blocks;  its freePtr
+ * and numPages fields aren't used.
+ */
+
+static Pool pools[NUM_POOLS+1];
+static long largeBytes = 0;	/* Bytes currently allocated in large
+				 * blocks, not counting headers. */
+static long maxLargeBytes = 0;	/* Largest value largeBytes has had. */
+
+#define BODY(hdrPtr)	((char *) ((hdrPtr) + 1))
+#define HEADER(ptr)	(((PoolHeader *) (ptr)) - 1)
+#define NEXT_FREE(ptr)	(*((char **) (ptr)))
+
+static void		PoolNewPage _ANSI_ARGS_((int pool));
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_PoolAlloc --
+ *
+ *	Allocate storage;  this is what ckalloc maps to when TCL_MEM_POOL
+ *	is defined.
+ *
+ * Results:
+ *	The return value is the address of at least size bytes of
+ *	storage, which must eventually be freed with Tcl_PoolFree.
+ *
+ * Side effects:
+ *	A new page may be added to a pool.  Panics if memory runs out.
+ *
+ *----------------------------------------------------------------------
+ */
+
+char *
+Tcl_PoolAlloc(size)
+    unsigned int size;		/* Number of bytes needed. */
+{
+    register PoolHeader *hdrPtr;
+    register Pool *poolPtr;
+    register char *result;
+    int pool;
+
+    if (size <= MAX_POOL_SIZE) {
+	pool = poolIndex[(size+7) >> 3];
+	poolPtr = &pools[pool];
+	if (poolPtr->freePtr == NULL) {
+	    PoolNewPage(pool);
+	}
+	result = poolPtr->freePtr;
+	poolPtr->freePtr = NEXT_FREE(result);
+	hdrPtr = HEADER(result);
+    } else {
+	pool = NUM_POOLS;
+	poolPtr = &pools[NUM_POOLS];
+	hdrPtr = (PoolHeader *) malloc(sizeof(PoolHeader) + size);
+	if (hdrPtr == NULL) {
+	    panic("unable to alloc %u bytes", size);
+	}
+	result = BODY(hdrPtr);
+	largeBytes += size;
+	if (largeBytes > maxLargeBytes) {
+	    maxLargeBytes = largeBytes;
+	}
+    }
+    hdrPtr->info.size = size;
+    hdrPtr->info.pool = pool;
+    poolPtr->numAllocs++;
+    poolPtr->inUse++;
+    if (poolPtr->inUse > poolPtr->maxInUse) {
+	poolPtr->maxInUse = poolPtr->inUse;
+    }
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PoolNewPage --
+ *
+ *	Refill the free list of a pool.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	A page is allocated with malloc, and all of the blocks in it are
+ *	put on the pool's free list.  Panics if memory runs out.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+PoolNewPage(pool)
+    int pool;			/* Index of pool that needs blocks. */
+{
+    register Pool *poolPtr = &pools[pool];
+    register char *blockPtr;
+    unsigned int blockSize;
+    int i, numBlocks;
+    char *page;
+
+    blockSize = sizeof(PoolHeader) + poolSizes[pool];
+    numBlocks = POOL_PAGE_SIZE / blockSize;
+    page = (char *) malloc(numBlocks * blockSize);
+    if (page == NULL) {
+	panic("unable to alloc %u bytes", numBlocks * blockSize);
+    }
+    poolPtr->numPages++;
+
+    /*
+     * Thread the blocks onto the free list in address order, so that
+     * consecutive allocations are next to each other in memory.
+     */
+
+    blockPtr = page + (numBlocks-1)*blockSize;
+    for (i = 0; i < numBlocks; i++, blockPtr -= blockSize) {
+	NEXT_FREE(BODY((PoolHeader *) blockPtr)) = poolPtr->freePtr;
+	poolPtr->freePtr = BODY((PoolHeader *) blockPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_PoolFree --
+ *
+ *	Free storage allocated by Tcl_PoolAlloc or Tcl_PoolRealloc.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The block is returned to its pool, or to malloc if it was large.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+Tcl_PoolFree(ptr)
+    char *ptr;			/* Storage to free;  NULL is ignored. */
+{
+    register PoolHeader *hdrPtr;
+    register Pool *poolPtr;
+
+    if (ptr == NULL) {
+	return;
+    }
+    hdrPtr = HEADER(ptr);
+    if (hdrPtr->info.pool > NUM_POOLS) {
+	panic("bad block passed to ckfree");
+    }
+    poolPtr = &pools[hdrPtr->info.pool];
+    poolPtr->inUse--;
+    if (hdrPtr->info.pool == NUM_POOLS) {
+	largeBytes -= hdrPtr->info.size;
+	free((char *) hdrPtr);
+    } else {
+	NEXT_FREE(ptr) = poolPtr->freePtr;
+	poolPtr->freePtr = ptr;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_PoolRealloc --
+ *
+ *	Change the size of a block allocated by Tcl_PoolAlloc.
+ *
+ * Results:
+ *	The return value is the address of at least size bytes of
+ *	storage, holding the contents of the old block (as much of
+ *	them as fit).
+ *
+ * Side effects:
+ *	The old block may be freed.  Panics if memory runs out.
+ *
+ *----------------------------------------------------------------------
+ */
+
+char *
+Tcl_PoolRealloc(ptr, size)
+    char *ptr;			/* Block to resize, or NULL. */
+    unsigned int size;		/* Number of bytes needed. */
+{
+    register PoolHeader *hdrPtr;
+    char *new;
+    unsigned int oldSize;
+
+    if (ptr == NULL) {
+	return Tcl_PoolAlloc(size);
+    }
+    hdrPtr = HEADER(ptr);
+    oldSize = hdrPtr->info.size;
+    if (hdrPtr->info.pool < NUM_POOLS) {
+	if (size <= poolSizes[hdrPtr->info.pool]) {
+	    hdrPtr->info.size = size;
+	    return ptr;
+	}
+    } else if (size > MAX_POOL_SIZE) {
+	hdrPtr = (PoolHeader *) realloc((char *) hdrPtr,
+		sizeof(PoolHeader) + size);
+	if (hdrPtr == NULL) {
+	    panic("unable to realloc %u bytes", size);
+	}
+	largeBytes += (long) size - (long) oldSize;
+	if (largeBytes > maxLargeBytes) {
+	    maxLargeBytes = largeBytes;
+	}
+	hdrPtr->info.size = size;
+	return BODY(hdrPtr);
+    }
+    new = Tcl_PoolAlloc(size);
+    memcpy((VOID *) new, (VOID *) ptr, (size < oldSize) ? size : oldSize);
+    Tcl_PoolFree(ptr);
+    return new;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MemoryCmd --
+ *     Implements the TCL memory command when the pool allocator is in
+ *     use:
+ *       memory info
+ *
+ * Results:
+ *     Standard TCL results.  "memory info" returns a table of the usage
+ *     of each pool and of large blocks, one line per pool.
+ *
+ *----------------------------------------------------------------------
+ */
+	/* ARGSUSED */
+static int
+MemoryCmd (clientData, interp, argc, argv)
+    char       *clientData;
+    Tcl_Interp *interp;
+    int         argc;
+    char      **argv;
+{
+    register Pool *poolPtr;
+    char line[100];
+    unsigned int blockSize;
+    int i;
+    long pageBytes;
+
+    if (argc < 2) {
+	Tcl_AppendResult(interp, "wrong # args:  should be \"",
+		argv[0], " option [args..]\"", (char *) NULL);
+	return TCL_ERROR;
+    }
+    if (strcmp(argv[1], "info") != 0) {
+	Tcl_AppendResult(interp, "bad option \"", argv[1],
+		"\":  should be info", (char *) NULL);
+	return TCL_ERROR;
+    }
+
+    sprintf(line, "%5s %10s %8s %8s %6s\n", "size", "allocs", "in use",
+	    "maximum", "pages");
+    Tcl_AppendResult(interp, line, (char *) NULL);
+    pageBytes = 0;
+    for (i = 0, poolPtr = pools; i < NUM_POOLS; i++, poolPtr++) {
+	sprintf(line, "%5u %10ld %8d %8d %6d\n", poolSizes[i],
+		poolPtr->numAllocs, poolPtr->inUse, poolPtr->maxInUse,
+		poolPtr->numPages);
+	Tcl_AppendResult(interp, line, (char *) NULL);
+
+	/*
+	 * PoolNewPage mallocs only as many whole blocks as fit in a
+	 * page, so count those rather than POOL_PAGE_SIZE.
+	 */
+
+	blockSize = sizeof(PoolHeader) + poolSizes[i];
+	pageBytes += (long) poolPtr->numPages
+		* ((POOL_PAGE_SIZE / blockSize) * blockSize);
+    }
+    sprintf(line, "%5s %10ld %8d %8d\n", "large", poolPtr->numAllocs,
+	    poolPtr->inUse, poolPtr->maxInUse);
+    Tcl_AppendResult(interp, line, (char *) NULL);
+    sprintf(line, "bytes in pool pages        %10ld\n", pageBytes);
+    Tcl_AppendResult(interp, line, (char *) NULL);
+    sprintf(line, "current bytes in large     %10ld\n", largeBytes);
+    Tcl_AppendResult(interp, line, (char *) NULL);
+    sprintf(line, "maximum bytes in large     %10ld", maxLargeBytes);
+    Tcl_AppendResult(interp, line, (char *) NULL);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_InitMemory --
+ *     Initialize the memory command.
+ *
+ *----------------------------------------------------------------------
+ */
+void
+Tcl_InitMemory(interp)
+    Tcl_Interp *interp;
+{
+Tcl_CreateCommand (interp, "memory", MemoryCmd, (ClientData)NULL, 
+                  (void (*)())NULL);
+}
+
+#endif /* TCL_MEM_POOL */
+
 
 /*
  *----------------------------------------------------------------------
@@ -555,15 +916,17 @@ Tcl_Ckfree (ptr)
  *
  * Tcl_InitMemory --
  *     Dummy initialization for memory command, which is only available 
- *     if TCL_MEM_DEBUG is on.
+ *     if TCL_MEM_DEBUG or TCL_MEM_POOL is on.
  *
  *----------------------------------------------------------------------
  */
+#ifndef TCL_MEM_POOL
 	/* ARGSUSED */
 void
 Tcl_InitMemory(interp)
     Tcl_Interp *interp;
 {
 }
+#endif
 
 #endif
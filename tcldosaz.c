@@ -37,6 +37,12 @@
 
 static char *currentDir =  NULL;
 
+/*
+ * Largest buffer size that "fconfigure -buffersize" will accept.
+ */
+
+#define MAX_BUFFER_SIZE 16384
+
 /*
  * Prototypes for local procedures defined in this file:
  */
@@ -140,7 +146,17 @@ Tcl_CloseCmd(dummy, interp, argc, argv)
     ((Interp *) interp)->filePtrArray[fileno(filePtr->f)] = NULL;
 
     /*
-     * First close the file (in the case of a process pipeline, there may
+     * Write out any output Tcl is still holding for the file.
+     */
+
+    if (TclReleaseFile(filePtr) != 0) {
+	Tcl_AppendResult(interp, "error flushing \"", argv[1],
+		"\": ", Tcl_UnixError(interp), "\n", (char *) NULL);
+	result = TCL_ERROR;
+    }
+
+    /*
+     * Then close the file (in the case of a process pipeline, there may
      * be two files, one for the pipe at each end of the pipeline).
      */
 
@@ -196,7 +212,8 @@ Tcl_EofCmd(notUsed, interp, argc, argv)
     if (TclGetOpenFile(interp, argv[1], &filePtr) != TCL_OK) {
 	return TCL_ERROR;
     }
-    if (feof(filePtr->f)) {
+    if ((filePtr->readPtr == filePtr->readEnd)
+	    && (filePtr->readEof || feof(filePtr->f))) {
 	interp->result = "1";
     } else {
 	interp->result = "0";
@@ -246,6 +263,132 @@ Tcl_ExitCmd(dummy, interp, argc, argv)
     return TCL_OK;			/* Better not ever reach this! */
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_FconfigureCmd --
+ *
+ *	This procedure is invoked to process the "fconfigure" Tcl
+ *	command.  See the user documentation for details on what it
+ *	does.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	See the user documentation.
+ *
+ *----------------------------------------------------------------------
+ */
+
+	/* ARGSUSED */
+int
+Tcl_FconfigureCmd(notUsed, interp, argc, argv)
+    ClientData notUsed;			/* Not used. */
+    Tcl_Interp *interp;			/* Current interpreter. */
+    int argc;				/* Number of arguments. */
+    char **argv;			/* Argument strings. */
+{
+    OpenFile *filePtr;
+    int i, blocking, buffering, size, setBuffering;
+    char sizeString[20];
+    static char *bufferingNames[] = {"none", "line", "full"};
+
+    if ((argc < 2) || ((argc > 3) && ((argc & 1) != 0))) {
+	Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
+		" fileId ?optionName? ?value optionName value ...?\"",
+		(char *) NULL);
+	return TCL_ERROR;
+    }
+    if (TclGetOpenFile(interp, argv[1], &filePtr) != TCL_OK) {
+	return TCL_ERROR;
+    }
+
+    /*
+     * With no value given, return the current settings.
+     */
+
+    if (argc <= 3) {
+	sprintf(sizeString, "%d", filePtr->writeSize);
+	if (argc == 2) {
+	    Tcl_AppendResult(interp, "-blocking ",
+		    filePtr->blocking ? "1" : "0", " -buffering ",
+		    bufferingNames[filePtr->buffering], " -buffersize ",
+		    sizeString, (char *) NULL);
+	} else if (strcmp(argv[2], "-blocking") == 0) {
+	    interp->result = filePtr->blocking ? "1" : "0";
+	} else if (strcmp(argv[2], "-buffering") == 0) {
+	    interp->result = bufferingNames[filePtr->buffering];
+	} else if (strcmp(argv[2], "-buffersize") == 0) {
+	    Tcl_SetResult(interp, sizeString, TCL_VOLATILE);
+	} else {
+	    i = 2;
+	    goto badOption;
+	}
+	return TCL_OK;
+    }
+
+    blocking = filePtr->blocking;
+    buffering = filePtr->buffering;
+    size = filePtr->writeSize;
+    setBuffering = 0;
+    for (i = 2; i < argc; i += 2) {
+	if (strcmp(argv[i], "-blocking") == 0) {
+	    if (Tcl_GetBoolean(interp, argv[i+1], &blocking) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    continue;
+	}
+	setBuffering = 1;
+	if (strcmp(argv[i], "-buffering") == 0) {
+	    for (buffering = FILE_BUFFER_FULL; buffering >= 0; buffering--) {
+		if (strcmp(argv[i+1], bufferingNames[buffering]) == 0) {
+		    break;
+		}
+	    }
+	    if (buffering < 0) {
+		Tcl_AppendResult(interp, "bad buffering mode \"", argv[i+1],
+			"\": should be full, line, or none", (char *) NULL);
+		return TCL_ERROR;
+	    }
+	} else if (strcmp(argv[i], "-buffersize") == 0) {
+	    if (Tcl_GetInt(interp, argv[i+1], &size) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    if ((size < 1) || (size > MAX_BUFFER_SIZE)) {
+		sprintf(sizeString, "%d", MAX_BUFFER_SIZE);
+		Tcl_AppendResult(interp, "bad buffer size \"", argv[i+1],
+			"\": must be between 1 and ", sizeString,
+			(char *) NULL);
+		return TCL_ERROR;
+	    }
+	} else {
+	    badOption:
+	    Tcl_AppendResult(interp, "bad option \"", argv[i],
+		    "\": should be -blocking, -buffering, or -buffersize",
+		    (char *) NULL);
+	    return TCL_ERROR;
+	}
+    }
+    if (setBuffering && !filePtr->writable) {
+	Tcl_AppendResult(interp, "\"", argv[1],
+		"\" wasn't opened for writing", (char *) NULL);
+	return TCL_ERROR;
+    }
+    if ((blocking != filePtr->blocking)
+	    && (TclSetBlocking(filePtr, blocking) != 0)) {
+	Tcl_AppendResult(interp, "error configuring \"", argv[1],
+		"\": ", Tcl_UnixError(interp), (char *) NULL);
+	return TCL_ERROR;
+    }
+    if (setBuffering && (TclSetBuffering(filePtr, buffering, size) != 0)) {
+	Tcl_AppendResult(interp, "error configuring \"", argv[1],
+		"\": ", Tcl_UnixError(interp), (char *) NULL);
+	return TCL_ERROR;
+    }
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -569,6 +712,83 @@ Tcl_FileCmd(dummy, interp, argc, argv)
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_FileEventCmd --
+ *
+ *	This procedure is invoked to process the "fileevent" Tcl
+ *	command.  See the user documentation for details on what it
+ *	does.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	See the user documentation.
+ *
+ *----------------------------------------------------------------------
+ */
+
+	/* ARGSUSED */
+int
+Tcl_FileEventCmd(notUsed, interp, argc, argv)
+    ClientData notUsed;			/* Not used. */
+    Tcl_Interp *interp;			/* Current interpreter. */
+    int argc;				/* Number of arguments. */
+    char **argv;			/* Argument strings. */
+{
+    OpenFile *filePtr;
+    char **scriptPtr;
+    int length;
+
+    if ((argc != 3) && (argc != 4)) {
+	Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
+		" fileId event ?script?\"", (char *) NULL);
+	return TCL_ERROR;
+    }
+    if (TclGetOpenFile(interp, argv[1], &filePtr) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    length = strlen(argv[2]);
+    if ((argv[2][0] == 'r') && (strncmp(argv[2], "readable", length) == 0)) {
+	if (!filePtr->readable) {
+	    Tcl_AppendResult(interp, "\"", argv[1],
+		    "\" wasn't opened for reading", (char *) NULL);
+	    return TCL_ERROR;
+	}
+	scriptPtr = &filePtr->readScript;
+    } else if ((argv[2][0] == 'w')
+	    && (strncmp(argv[2], "writable", length) == 0)) {
+	if (!filePtr->writable) {
+	    Tcl_AppendResult(interp, "\"", argv[1],
+		    "\" wasn't opened for writing", (char *) NULL);
+	    return TCL_ERROR;
+	}
+	scriptPtr = &filePtr->writeScript;
+    } else {
+	Tcl_AppendResult(interp, "bad event name \"", argv[2],
+		"\": must be readable or writable", (char *) NULL);
+	return TCL_ERROR;
+    }
+
+    if (argc == 3) {
+	if (*scriptPtr != NULL) {
+	    Tcl_SetResult(interp, *scriptPtr, TCL_VOLATILE);
+	}
+	return TCL_OK;
+    }
+    if (*scriptPtr != NULL) {
+	ckfree(*scriptPtr);
+	*scriptPtr = NULL;
+    }
+    if (argv[3][0] != 0) {
+	*scriptPtr = (char *) ckalloc((unsigned) (strlen(argv[3]) + 1));
+	strcpy(*scriptPtr, argv[3]);
+    }
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -720,7 +940,6 @@ Tcl_FlushCmd(notUsed, interp, argc, argv)
     char **argv;			/* Argument strings. */
 {
     OpenFile *filePtr;
-    FILE *f;
 
     if (argc != 2) {
 	Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
@@ -735,14 +954,9 @@ Tcl_FlushCmd(notUsed, interp, argc, argv)
 		"\" wasn't opened for writing", (char *) NULL);
 	return TCL_ERROR;
     }
-    f = filePtr->f2;
-    if (f == NULL) {
-	f = filePtr->f;
-    }
-    if (fflush(f) == EOF) {
+    if (TclFlushFile(filePtr) != 0) {
 	Tcl_AppendResult(interp, "error flushing \"", argv[1],
 		"\": ", Tcl_UnixError(interp), (char *) NULL);
-	clearerr(f);
 	return TCL_ERROR;
     }
     return TCL_OK;
@@ -751,10 +965,11 @@ Tcl_FlushCmd(notUsed, interp, argc, argv)
 /*
  *----------------------------------------------------------------------
  *
- * Tcl_GetsCmd --
+ * Tcl_ForeachLineCmd --
  *
- *	This procedure is invoked to process the "gets" Tcl command.
- *	See the user documentation for details on what it does.
+ *	This procedure is invoked to process the "foreach_line" Tcl
+ *	command.  See the user documentation for details on what it
+ *	does.
  *
  * Results:
  *	A standard Tcl result.
@@ -767,83 +982,204 @@ Tcl_FlushCmd(notUsed, interp, argc, argv)
 
 	/* ARGSUSED */
 int
-Tcl_GetsCmd(notUsed, interp, argc, argv)
+Tcl_ForeachLineCmd(notUsed, interp, argc, argv)
     ClientData notUsed;			/* Not used. */
     Tcl_Interp *interp;			/* Current interpreter. */
     int argc;				/* Number of arguments. */
     char **argv;			/* Argument strings. */
 {
-#   define BUF_SIZE 200
-    char buffer[BUF_SIZE+1];
-    int totalCount, done, flags;
+    Interp *iPtr = (Interp *) interp;
     OpenFile *filePtr;
-    register FILE *f;
+    char *line, *value;
+    int numLines, count, length, flags, result, fd;
+    int chunkSpace, used;
 
-    if ((argc != 2) && (argc != 3)) {
+    numLines = 0;
+    if ((argc == 6) && (strcmp(argv[1], "-lines") == 0)) {
+	if (Tcl_GetInt(interp, argv[2], &numLines) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	if (numLines < 1) {
+	    Tcl_AppendResult(interp, "bad line count \"", argv[2],
+		    "\": must be at least 1", (char *) NULL);
+	    return TCL_ERROR;
+	}
+	argc -= 2;
+	argv += 2;
+    }
+    if (argc != 4) {
 	Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
-		" fileId ?varName?\"", (char *) NULL);
+		" ?-lines count? varName fileId command\"", (char *) NULL);
 	return TCL_ERROR;
     }
-    if (TclGetOpenFile(interp, argv[1], &filePtr) != TCL_OK) {
+
+    if (TclGetOpenFile(interp, argv[2], &filePtr) != TCL_OK) {
 	return TCL_ERROR;
     }
     if (!filePtr->readable) {
-	Tcl_AppendResult(interp, "\"", argv[1],
+	Tcl_AppendResult(interp, "\"", argv[2],
 		"\" wasn't opened for reading", (char *) NULL);
 	return TCL_ERROR;
     }
 
     /*
-     * We can't predict how large a line will be, so read it in
-     * pieces, appending to the current result or to a variable.
+     * The body may close the file, so check before each read that
+     * it is still open and stop quietly if it isn't.
      */
 
-    totalCount = 0;
-    done = 0;
-    flags = 0;
-    f = filePtr->f;
-    while (!done) {
-	register int c, count;
-	register char *p;
-
-	for (p = buffer, count = 0; count < BUF_SIZE-1; count++, p++) {
-	    c = getc(f);
-	    if (c == EOF) {
-		if (ferror(filePtr->f)) {
-		    Tcl_ResetResult(interp);
-		    Tcl_AppendResult(interp, "error reading \"", argv[1],
-			    "\": ", Tcl_UnixError(interp), (char *) NULL);
-		    clearerr(filePtr->f);
-		    return TCL_ERROR;
-		} else if (feof(filePtr->f)) {
-		    if ((totalCount == 0) && (count == 0)) {
-			totalCount = -1;
-		    }
-		    done = 1;
+    fd = fileno(filePtr->f);
+    chunkSpace = 256;
+    result = TCL_OK;
+    while (1) {
+	if ((fd >= iPtr->numFiles) || (iPtr->filePtrArray[fd] != filePtr)) {
+	    break;
+	}
+	if (numLines == 0) {
+	    length = TclGetLine(filePtr, &line);
+	    if (length == -2) {
+		goto readError;
+	    }
+	    if (length == -1) {
+		break;
+	    }
+	    value = line;
+	    flags = 0;
+	} else {
+
+	    /*
+	     * Gather up to numLines lines, separated by newlines, in
+	     * a buffer that the variable then takes over.
+	     */
+
+	    value = (char *) ckalloc((unsigned) chunkSpace);
+	    used = 0;
+	    for (count = 0; count < numLines; count++) {
+		length = TclGetLine(filePtr, &line);
+		if (length == -2) {
+		    ckfree(value);
+		    goto readError;
+		}
+		if (length == -1) {
 		    break;
 		}
+		if ((used + length + 2) > chunkSpace) {
+		    while ((used + length + 2) > chunkSpace) {
+			chunkSpace *= 2;
+		    }
+		    value = (char *) ckrealloc(value, (unsigned) chunkSpace);
+		}
+		if (count > 0) {
+		    value[used] = '\n';
+		    used++;
+		}
+		memcpy((VOID *) (value + used), (VOID *) line, length);
+		used += length;
 	    }
-	    if (c == '\n') {
-		done = 1;
+	    if (count == 0) {
+		ckfree(value);
 		break;
 	    }
-	    *p = c;
+	    value[used] = 0;
+	    flags = TCL_OWN_VALUE;
 	}
-	*p = 0;
-	if (argc == 2) {
-	    Tcl_AppendResult(interp, buffer, (char *) NULL);
-	} else {
-	    if (Tcl_SetVar(interp, argv[2], buffer, flags|TCL_LEAVE_ERR_MSG)
-		    == NULL) {
-		return TCL_ERROR;
+	if (Tcl_SetVar(interp, argv[1], value, flags) == NULL) {
+	    Tcl_SetResult(interp, "couldn't set loop variable", TCL_STATIC);
+	    return TCL_ERROR;
+	}
+
+	result = Tcl_Eval(interp, argv[3], 0, (char **) NULL);
+	if (result != TCL_OK) {
+	    if (result == TCL_CONTINUE) {
+		result = TCL_OK;
+	    } else if (result == TCL_BREAK) {
+		result = TCL_OK;
+		break;
+	    } else if (result == TCL_ERROR) {
+		char msg[100];
+		sprintf(msg, "\n    (\"foreach_line\" body line %d)",
+			interp->errorLine);
+		Tcl_AddErrorInfo(interp, msg);
+		break;
+	    } else {
+		break;
 	    }
-	    flags = TCL_APPEND_VALUE;
 	}
-	totalCount += count;
     }
+    if (result == TCL_OK) {
+	Tcl_ResetResult(interp);
+    }
+    return result;
 
-    if (argc == 3) {
-	sprintf(interp->result, "%d", totalCount);
+    readError:
+    Tcl_AppendResult(interp, "error reading \"", argv[2],
+	    "\": ", Tcl_UnixError(interp), (char *) NULL);
+    return TCL_ERROR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Tcl_GetsCmd --
+ *
+ *	This procedure is invoked to process the "gets" Tcl command.
+ *	See the user documentation for details on what it does.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	See the user documentation.
+ *
+ *----------------------------------------------------------------------
+ */
+
+	/* ARGSUSED */
+int
+Tcl_GetsCmd(notUsed, interp, argc, argv)
+    ClientData notUsed;			/* Not used. */
+    Tcl_Interp *interp;			/* Current interpreter. */
+    int argc;				/* Number of arguments. */
+    char **argv;			/* Argument strings. */
+{
+    OpenFile *filePtr;
+    char *line;
+    int length;
+
+    if ((argc != 2) && (argc != 3)) {
+	Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
+		" fileId ?varName?\"", (char *) NULL);
+	return TCL_ERROR;
+    }
+    if (TclGetOpenFile(interp, argv[1], &filePtr) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if (!filePtr->readable) {
+	Tcl_AppendResult(interp, "\"", argv[1],
+		"\" wasn't opened for reading", (char *) NULL);
+	return TCL_ERROR;
+    }
+
+    /*
+     * TclGetLine hands back the whole line from the file's read
+     * buffer, so it can be stored with a single copy.
+     */
+
+    length = TclGetLine(filePtr, &line);
+    if (length == -2) {
+	Tcl_AppendResult(interp, "error reading \"", argv[1],
+		"\": ", Tcl_UnixError(interp), (char *) NULL);
+	return TCL_ERROR;
+    }
+    if (length == -1) {
+	line = "";
+    }
+    if (argc == 2) {
+	Tcl_SetResult(interp, line, TCL_VOLATILE);
+    } else {
+	if (Tcl_SetVar(interp, argv[2], line, TCL_LEAVE_ERR_MSG) == NULL) {
+	    return TCL_ERROR;
+	}
+	sprintf(interp->result, "%d", length);
     }
     return TCL_OK;
 }
@@ -896,6 +1232,19 @@ Tcl_OpenCmd(notUsed, interp, argc, argv)
     filePtr->numPids = 0;
     filePtr->pidPtr = NULL;
     filePtr->errorId = -1;
+    filePtr->readBuf = filePtr->readPtr = filePtr->readEnd = NULL;
+    filePtr->readSize = 0;
+    filePtr->readDirect = 0;
+    filePtr->readEof = 0;
+    filePtr->readPartial = 0;
+    filePtr->writeBuf = NULL;
+    filePtr->writeSize = BUFSIZ;
+    filePtr->writeCount = 0;
+    filePtr->buffering = FILE_BUFFER_FULL;
+    filePtr->writeDirect = 0;
+    filePtr->nextPtr = NULL;
+    filePtr->blocking = 1;
+    filePtr->readScript = filePtr->writeScript = NULL;
 
     /*
      * Verify the requested form of access.
@@ -999,6 +1348,28 @@ Tcl_OpenCmd(notUsed, interp, argc, argv)
 #endif
     }
 
+    /*
+     * If nothing else writes through the stream we read from, stdio's
+     * own input buffer can be turned off and TclGetLine left to do
+     * all the buffering with large reads from the file descriptor.
+     */
+
+    if (filePtr->readable
+	    && (!filePtr->writable || (filePtr->f2 != NULL))) {
+	setvbuf(filePtr->f, (char *) NULL, _IONBF, 0);
+	filePtr->readDirect = 1;
+    }
+
+    /*
+     * Likewise, output that can't be mixed with input on the same
+     * stream is buffered by Tcl itself (see TclWriteFile).
+     */
+
+    if (filePtr->writable
+	    && (!filePtr->readable || (filePtr->f2 != NULL))) {
+	TclDirectOutput(filePtr);
+    }
+
     /*
      * Enter this new OpenFile structure in the table for the
      * interpreter.  May have to expand the table to do this.
@@ -1117,7 +1488,6 @@ Tcl_PutsCmd(dummy, interp, argc, argv)
     char **argv;			/* Argument strings. */
 {
     OpenFile *filePtr;
-    FILE *f;
     int i, newline;
     char *fileId;
 
@@ -1161,19 +1531,10 @@ Tcl_PutsCmd(dummy, interp, argc, argv)
 		"\" wasn't opened for writing", (char *) NULL);
 	return TCL_ERROR;
     }
-    f = filePtr->f2;
-    if (f == NULL) {
-	f = filePtr->f;
-    }
-
-    fputs(argv[i], f);
-    if (newline) {
-	fputc('\n', f);
-    }
-    if (ferror(f)) {
+    if (TclWriteFile(filePtr, argv[i], (int) strlen(argv[i]), newline)
+	    != 0) {
 	Tcl_AppendResult(interp, "error writing \"", fileId,
 		"\": ", Tcl_UnixError(interp), (char *) NULL);
-	clearerr(f);
 	return TCL_ERROR;
     }
     return TCL_OK;
@@ -1205,22 +1566,33 @@ Tcl_ReadCmd(dummy, interp, argc, argv)
     char **argv;			/* Argument strings. */
 {
     OpenFile *filePtr;
-    int bytesLeft, bytesRead, count;
+    int bytesLeft, bytesRead, count, space;
 #define READ_BUF_SIZE 4096
-    char buffer[READ_BUF_SIZE+1];
+    char buffer[READ_BUF_SIZE];
+    char *value, *varName;
     int newline, i;
+    struct stat statBuf;
+    long position;
 
-    if ((argc != 2) && (argc != 3)) {
-	Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
-		" fileId ?numBytes?\" or \"", argv[0],
-		" ?-nonewline? fileId\"", (char *) NULL);
-	return TCL_ERROR;
-    }
     i = 1;
     newline = 1;
-    if ((argc == 3) && (strcmp(argv[1], "-nonewline") == 0)) {
-	newline = 0;
-	i++;
+    varName = NULL;
+    while ((i < argc) && (argv[i][0] == '-')) {
+	if (strcmp(argv[i], "-nonewline") == 0) {
+	    newline = 0;
+	    i++;
+	} else if ((strcmp(argv[i], "-variable") == 0) && (i < (argc-1))) {
+	    varName = argv[i+1];
+	    i += 2;
+	} else {
+	    break;
+	}
+    }
+    if ((i != (argc-1)) && (i != (argc-2))) {
+	Tcl_AppendResult(interp, "wrong # args: should be \"", argv[0],
+		" ?-variable varName? fileId ?numBytes?\" or \"", argv[0],
+		" ?-nonewline? ?-variable varName? fileId\"", (char *) NULL);
+	return TCL_ERROR;
     }
 
     if (TclGetOpenFile(interp, argv[i], &filePtr) != TCL_OK) {
@@ -1261,34 +1633,91 @@ Tcl_ReadCmd(dummy, interp, argc, argv)
     }
 
     /*
-     * Read the file in one or more chunks.
+     * For a regular file, the amount left to read is known, so the
+     * value can usually be read with one allocation and no copying.
+     * Otherwise start small and double the space as needed.
+     */
+
+    space = READ_BUF_SIZE;
+    if ((fstat(fileno(filePtr->f), &statBuf) == 0)
+	    && S_ISREG(statBuf.st_mode)) {
+	position = TclTellFile(filePtr);
+	if ((position >= 0) && (statBuf.st_size > position)) {
+	    if ((statBuf.st_size - position) < bytesLeft) {
+		space = statBuf.st_size - position;
+	    } else {
+		space = bytesLeft;
+	    }
+	}
+    }
+    if (space > bytesLeft) {
+	space = bytesLeft;
+    }
+    space++;
+    value = (char *) ckalloc((unsigned) space);
+
+    /*
+     * Read the file straight into the value.  When the value fills
+     * up, read a chunk into buffer to see whether anything is left
+     * before making the value larger.
      */
 
     bytesRead = 0;
     while (bytesLeft > 0) {
-	count = READ_BUF_SIZE;
-	if (bytesLeft < READ_BUF_SIZE) {
-	    count = bytesLeft;
+	if (bytesRead < (space-1)) {
+	    count = space - 1 - bytesRead;
+	    if (count > bytesLeft) {
+		count = bytesLeft;
+	    }
+	    count = TclReadFile(filePtr, value + bytesRead, count);
+	} else {
+	    count = READ_BUF_SIZE;
+	    if (count > bytesLeft) {
+		count = bytesLeft;
+	    }
+	    count = TclReadFile(filePtr, buffer, count);
+	    if (count > 0) {
+		space *= 2;
+		if (space < (bytesRead + count + 1)) {
+		    space = bytesRead + count + 1;
+		}
+		value = (char *) ckrealloc(value, (unsigned) space);
+		memcpy((VOID *) (value + bytesRead), (VOID *) buffer, count);
+	    }
 	}
-	count = fread(buffer, 1, count, filePtr->f);
-	if (ferror(filePtr->f)) {
-	    Tcl_ResetResult(interp);
+	if (count < 0) {
+	    ckfree(value);
 	    Tcl_AppendResult(interp, "error reading \"", argv[i],
 		    "\": ", Tcl_UnixError(interp), (char *) NULL);
-	    clearerr(filePtr->f);
 	    return TCL_ERROR;
 	}
 	if (count == 0) {
 	    break;
 	}
-	buffer[count] = 0;
-	Tcl_AppendResult(interp, buffer, (char *) NULL);
 	bytesLeft -= count;
 	bytesRead += count;
     }
     if ((newline == 0) && (bytesRead > 0)
-	    && (interp->result[bytesRead-1] == '\n')) {
-	interp->result[bytesRead-1] = 0;
+	    && (value[bytesRead-1] == '\n')) {
+	bytesRead--;
+    }
+    value[bytesRead] = 0;
+
+    /*
+     * Hand the value over to the variable or the result, so that it
+     * never has to be copied.
+     */
+
+    if (varName != NULL) {
+	if (Tcl_SetVar(interp, varName, value,
+		TCL_OWN_VALUE|TCL_LEAVE_ERR_MSG) == NULL) {
+	    return TCL_ERROR;
+	}
+	sprintf(interp->result, "%d", bytesRead);
+    } else {
+	Tcl_ResetResult(interp);
+	interp->result = value;
+	interp->freeProc = (Tcl_FreeProc *) free;
     }
     return TCL_OK;
 }
@@ -1351,7 +1780,7 @@ Tcl_SeekCmd(notUsed, interp, argc, argv)
 	    return TCL_ERROR;
 	}
     }
-    if (fseek(filePtr->f, (long) offset, mode) == -1) {
+    if (TclSeekFile(filePtr, (long) offset, mode) == -1) {
 	Tcl_AppendResult(interp, "error during seek: ",
 		Tcl_UnixError(interp), (char *) NULL);
 	clearerr(filePtr->f);
@@ -1429,7 +1858,7 @@ Tcl_TellCmd(notUsed, interp, argc, argv)
     if (TclGetOpenFile(interp, argv[1], &filePtr) != TCL_OK) {
 	return TCL_ERROR;
     }
-    sprintf(interp->result, "%d", ftell(filePtr->f));
+    sprintf(interp->result, "%ld", TclTellFile(filePtr));
     return TCL_OK;
 }
 
@@ -21,6 +21,35 @@
 #include "tclInt.h"
 #include "tclDos.h"
 
+/*
+ * Initial size of the buffer that TclGetLine allocates for an open
+ * file.  The buffer doubles whenever a line doesn't fit.
+ */
+
+#define READ_BUF_SIZE 1024
+
+/*
+ * Size of the output buffer that TclDirectOutput sets up for a file.
+ * It can be changed afterwards with the "fconfigure" command.
+ */
+
+#define WRITE_BUF_SIZE 1024
+
+/*
+ * List of all open files whose output is held in Tcl's own buffers
+ * rather than stdio's (linked through their nextPtr fields), so that
+ * the output can still be written if the process exits without
+ * closing them.
+ */
+
+static OpenFile *firstDirectPtr = NULL;
+static int exitHandlerSet = 0;	/* Non-zero means FlushOnExit has been
+				 * registered with atexit. */
+
+static void		FlushOnExit _ANSI_ARGS_((void));
+static int		WriteBytes _ANSI_ARGS_((int fd, char *buffer,
+			    int count));
+
 
 /*
  *----------------------------------------------------------------------
@@ -294,6 +323,19 @@ TclMakeFileTable(iPtr, index)
 	filePtr->numPids = 0;
 	filePtr->pidPtr = NULL;
 	filePtr->errorId = -1;
+	filePtr->readBuf = filePtr->readPtr = filePtr->readEnd = NULL;
+	filePtr->readSize = 0;
+	filePtr->readDirect = 0;
+	filePtr->readEof = 0;
+	filePtr->readPartial = 0;
+	filePtr->writeBuf = NULL;
+	filePtr->writeSize = BUFSIZ;
+	filePtr->writeCount = 0;
+	filePtr->buffering = FILE_BUFFER_FULL;
+	filePtr->writeDirect = 0;
+	filePtr->nextPtr = NULL;
+	filePtr->blocking = 1;
+	filePtr->readScript = filePtr->writeScript = NULL;
 	iPtr->filePtrArray[0] = filePtr;
 
 	filePtr = (OpenFile *) ckalloc(sizeof(OpenFile));
@@ -304,6 +346,23 @@ TclMakeFileTable(iPtr, index)
 	filePtr->numPids = 0;
 	filePtr->pidPtr = NULL;
 	filePtr->errorId = -1;
+	filePtr->readBuf = filePtr->readPtr = filePtr->readEnd = NULL;
+	filePtr->readSize = 0;
+	filePtr->readDirect = 0;
+	filePtr->readEof = 0;
+	filePtr->readPartial = 0;
+	filePtr->writeBuf = NULL;
+	filePtr->writeSize = BUFSIZ;
+	filePtr->writeCount = 0;
+	if (isatty(fileno(stdout))) {
+	    filePtr->buffering = FILE_BUFFER_LINE;
+	} else {
+	    filePtr->buffering = FILE_BUFFER_FULL;
+	}
+	filePtr->writeDirect = 0;
+	filePtr->nextPtr = NULL;
+	filePtr->blocking = 1;
+	filePtr->readScript = filePtr->writeScript = NULL;
 	iPtr->filePtrArray[1] = filePtr;
 
 	filePtr = (OpenFile *) ckalloc(sizeof(OpenFile));
@@ -314,6 +373,19 @@ TclMakeFileTable(iPtr, index)
 	filePtr->numPids = 0;
 	filePtr->pidPtr = NULL;
 	filePtr->errorId = -1;
+	filePtr->readBuf = filePtr->readPtr = filePtr->readEnd = NULL;
+	filePtr->readSize = 0;
+	filePtr->readDirect = 0;
+	filePtr->readEof = 0;
+	filePtr->readPartial = 0;
+	filePtr->writeBuf = NULL;
+	filePtr->writeSize = BUFSIZ;
+	filePtr->writeCount = 0;
+	filePtr->buffering = FILE_BUFFER_NONE;
+	filePtr->writeDirect = 0;
+	filePtr->nextPtr = NULL;
+	filePtr->blocking = 1;
+	filePtr->readScript = filePtr->writeScript = NULL;
 	iPtr->filePtrArray[2] = filePtr;
     } else if (index >= iPtr->numFiles) {
 	int newSize;
@@ -407,3 +479,757 @@ TclGetOpenFile(interp, string, filePtrPtr)
     *filePtrPtr = iPtr->filePtrArray[fd];
     return TCL_OK;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclGetLine --
+ *
+ *	Return the next line of input from an open file, using the
+ *	file's read buffer so that lines can be located with memchr
+ *	and returned whole instead of being read a character at a time.
+ *
+ * Results:
+ *	The return value is the number of characters in the line, not
+ *	counting its newline, or -1 if end of file was reached before
+ *	any characters were read, or -2 if an error occurred (errno
+ *	tells what went wrong).  *linePtr is set to point to the
+ *	null-terminated line, which stays valid until the next read
+ *	from filePtr.
+ *
+ * Side effects:
+ *	Input is read from the file and the read buffer may be grown.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclGetLine(filePtr, linePtr)
+    register OpenFile *filePtr;		/* File to read from. */
+    char **linePtr;			/* Where to store address of line. */
+{
+    char *scan, *newline;
+    int count, length;
+
+    scan = filePtr->readPtr;
+    while (1) {
+	if (scan != NULL) {
+	    newline = (char *) memchr((VOID *) scan, '\n',
+		    (size_t) (filePtr->readEnd - scan));
+	    if (newline != NULL) {
+		*newline = 0;
+		*linePtr = filePtr->readPtr;
+		filePtr->readPtr = newline + 1;
+		return newline - *linePtr;
+	    }
+	}
+
+	/*
+	 * No complete line is buffered.  Slide what there is to the
+	 * front of the buffer, grow it if it is full, then refill.
+	 */
+
+	length = filePtr->readEnd - filePtr->readPtr;
+	if (filePtr->readBuf == NULL) {
+	    filePtr->readSize = READ_BUF_SIZE;
+	    filePtr->readBuf = (char *) ckalloc((unsigned) filePtr->readSize);
+	} else if (length >= filePtr->readSize - 1) {
+	    char *new;
+
+	    new = (char *) ckalloc((unsigned) (2 * filePtr->readSize));
+	    memcpy((VOID *) new, (VOID *) filePtr->readPtr, length);
+	    ckfree(filePtr->readBuf);
+	    filePtr->readBuf = new;
+	    filePtr->readSize *= 2;
+	} else if ((length > 0) && (filePtr->readPtr != filePtr->readBuf)) {
+	    memmove((VOID *) filePtr->readBuf, (VOID *) filePtr->readPtr,
+		    length);
+	}
+	filePtr->readPtr = filePtr->readBuf;
+	filePtr->readEnd = filePtr->readBuf + length;
+	scan = filePtr->readEnd;
+
+	if (filePtr->readDirect) {
+	    do {
+		count = read(fileno(filePtr->f), filePtr->readEnd,
+			filePtr->readSize - 1 - length);
+#ifdef EINTR
+	    } while ((count < 0) && (errno == EINTR));
+#else
+	    } while (0);
+#endif
+	    if (count < 0) {
+		return -2;
+	    }
+	} else {
+	    count = 0;
+	    if (fgets(filePtr->readEnd, filePtr->readSize - length,
+		    filePtr->f) != NULL) {
+		count = strlen(filePtr->readEnd);
+	    } else if (ferror(filePtr->f)) {
+		clearerr(filePtr->f);
+		return -2;
+	    }
+	}
+	if (count == 0) {
+	    filePtr->readEof = 1;
+	    if (length == 0) {
+		return -1;
+	    }
+	    *filePtr->readEnd = 0;
+	    *linePtr = filePtr->readPtr;
+	    filePtr->readPtr = filePtr->readEnd;
+	    return length;
+	}
+	filePtr->readEnd += count;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclReadFile --
+ *
+ *	Read input from an open file for commands other than "gets".
+ *	Input that TclGetLine has buffered but not yet returned is
+ *	taken first, so that the two never disagree about where the
+ *	file is positioned.
+ *
+ * Results:
+ *	The return value is the number of bytes stored at buffer, at
+ *	most count.  Zero means end of file and -1 means an error
+ *	occurred (errno tells what went wrong).
+ *
+ * Side effects:
+ *	Input is consumed from the read buffer or the file.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclReadFile(filePtr, buffer, count)
+    register OpenFile *filePtr;		/* File to read from. */
+    char *buffer;			/* Where to store input. */
+    int count;				/* Maximum number of bytes to read. */
+{
+    int length;
+
+    length = filePtr->readEnd - filePtr->readPtr;
+    if (length > 0) {
+	if (length > count) {
+	    length = count;
+	}
+	memcpy((VOID *) buffer, (VOID *) filePtr->readPtr, length);
+	filePtr->readPtr += length;
+	return length;
+    }
+    if (filePtr->readDirect) {
+	do {
+	    length = read(fileno(filePtr->f), buffer, count);
+#ifdef EINTR
+	} while ((length < 0) && (errno == EINTR));
+#else
+	} while (0);
+#endif
+	if (length == 0) {
+	    filePtr->readEof = 1;
+	}
+	return length;
+    }
+    length = fread(buffer, 1, count, filePtr->f);
+    if (ferror(filePtr->f)) {
+	clearerr(filePtr->f);
+	return -1;
+    }
+    return length;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclSeekFile --
+ *
+ *	Reposition an open file, allowing for input held in its read
+ *	buffer.
+ *
+ * Results:
+ *	Zero if the file was repositioned, -1 if an error occurred
+ *	(errno tells what went wrong).
+ *
+ * Side effects:
+ *	On success the read buffer is emptied and the end-of-file
+ *	condition is cleared.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclSeekFile(filePtr, offset, mode)
+    register OpenFile *filePtr;		/* File to reposition. */
+    long offset;			/* New position, relative to mode. */
+    int mode;				/* SEEK_SET, SEEK_CUR, or SEEK_END. */
+{
+    if (filePtr->writeDirect && (TclFlushFile(filePtr) != 0)) {
+	return -1;
+    }
+    if (mode == SEEK_CUR) {
+	offset -= filePtr->readEnd - filePtr->readPtr;
+    }
+
+    /*
+     * Stdio never sees the reads and writes made for a direct file, so
+     * its idea of the file position can't be trusted;  go to the
+     * descriptor.
+     */
+
+    if (filePtr->readDirect || filePtr->writeDirect) {
+	if (lseek(fileno(filePtr->f), offset, mode) == -1) {
+	    return -1;
+	}
+	clearerr(filePtr->f);
+    } else if (fseek(filePtr->f, offset, mode) == -1) {
+	return -1;
+    }
+    filePtr->readPtr = filePtr->readEnd = filePtr->readBuf;
+    filePtr->readEof = 0;
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclTellFile --
+ *
+ *	Find the position of the next byte to be read from or written
+ *	to an open file, allowing for input held in its read buffer
+ *	and output held in its write buffer.
+ *
+ * Results:
+ *	The position, or -1 if it couldn't be determined (errno tells
+ *	why).
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+long
+TclTellFile(filePtr)
+    register OpenFile *filePtr;		/* File whose position is wanted. */
+{
+    long position;
+
+    if (filePtr->readDirect || filePtr->writeDirect) {
+	position = lseek(fileno(filePtr->f), 0L, SEEK_CUR);
+    } else {
+	position = ftell(filePtr->f);
+    }
+    if (position == -1) {
+	return -1;
+    }
+    if (filePtr->writeDirect && (filePtr->f2 == NULL)) {
+	position += filePtr->writeCount;
+    }
+    return position - (filePtr->readEnd - filePtr->readPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclDirectOutput --
+ *
+ *	Arrange for output to an open file to be collected in a buffer
+ *	managed by Tcl and written straight to the file descriptor,
+ *	bypassing stdio.  This is only safe when nothing else uses the
+ *	output stream, so it is done for files made by "open" but not
+ *	for the standard files.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The stream's stdio buffering is turned off, the file is given
+ *	full buffering with the default buffer size, and the file is
+ *	added to the list of files flushed when the process exits.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclDirectOutput(filePtr)
+    register OpenFile *filePtr;		/* File just opened for writing. */
+{
+    FILE *f;
+
+    f = filePtr->f2;
+    if (f == NULL) {
+	f = filePtr->f;
+    }
+    setvbuf(f, (char *) NULL, _IONBF, 0);
+    filePtr->writeDirect = 1;
+    filePtr->buffering = FILE_BUFFER_FULL;
+    filePtr->writeSize = WRITE_BUF_SIZE;
+    filePtr->nextPtr = firstDirectPtr;
+    firstDirectPtr = filePtr;
+    if (!exitHandlerSet) {
+	atexit(FlushOnExit);
+	exitHandlerSet = 1;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclWriteFile --
+ *
+ *	Write a string, optionally followed by a newline, to an open
+ *	file according to the file's buffering policy.  There is no
+ *	writev under DOS, so when output doesn't fit in the write
+ *	buffer the buffer is flushed first, and a string too big for
+ *	the buffer is written straight from where it is.
+ *
+ * Results:
+ *	Zero if all went well, -1 if an error occurred (errno tells
+ *	what went wrong).
+ *
+ * Side effects:
+ *	Output is buffered or written.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclWriteFile(filePtr, string, length, newline)
+    register OpenFile *filePtr;		/* File to write to. */
+    char *string;			/* Characters to write. */
+    int length;				/* Number of characters at string. */
+    int newline;			/* Non-zero means add a newline. */
+{
+    FILE *f;
+    int count;
+
+    f = filePtr->f2;
+    if (f == NULL) {
+	f = filePtr->f;
+    }
+    if (!filePtr->writeDirect) {
+	fwrite((VOID *) string, 1, (size_t) length, f);
+	if (newline) {
+	    putc('\n', f);
+	}
+	if (ferror(f)) {
+	    clearerr(f);
+	    return -1;
+	}
+	return 0;
+    }
+
+    count = length;
+    if (newline) {
+	count++;
+    }
+    if ((filePtr->buffering == FILE_BUFFER_NONE)
+	    || (filePtr->writeCount + count > filePtr->writeSize)) {
+	if (TclFlushFile(filePtr) != 0) {
+	    return -1;
+	}
+	if ((filePtr->buffering == FILE_BUFFER_NONE)
+		|| (count > filePtr->writeSize)) {
+	    if (WriteBytes(fileno(f), string, length) != 0) {
+		return -1;
+	    }
+	    if (newline) {
+		return WriteBytes(fileno(f), "\n", 1);
+	    }
+	    return 0;
+	}
+    }
+    if (filePtr->writeBuf == NULL) {
+	filePtr->writeBuf = (char *) ckalloc((unsigned) filePtr->writeSize);
+    }
+    memcpy((VOID *) (filePtr->writeBuf + filePtr->writeCount),
+	    (VOID *) string, length);
+    filePtr->writeCount += length;
+    if (newline) {
+	filePtr->writeBuf[filePtr->writeCount] = '\n';
+	filePtr->writeCount++;
+    }
+    if ((filePtr->buffering == FILE_BUFFER_LINE) && (newline
+	    || (memchr((VOID *) string, '\n', (size_t) length) != NULL))) {
+	return TclFlushFile(filePtr);
+    }
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclFlushFile --
+ *
+ *	Write out any output buffered for an open file.
+ *
+ * Results:
+ *	Zero if all went well, -1 if an error occurred (errno tells
+ *	what went wrong).
+ *
+ * Side effects:
+ *	The write buffer is emptied, even if an error occurs.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclFlushFile(filePtr)
+    register OpenFile *filePtr;		/* File to flush. */
+{
+    FILE *f;
+    int count;
+
+    f = filePtr->f2;
+    if (f == NULL) {
+	f = filePtr->f;
+    }
+    if (!filePtr->writeDirect) {
+	if (fflush(f) == EOF) {
+	    clearerr(f);
+	    return -1;
+	}
+	return 0;
+    }
+    count = filePtr->writeCount;
+    if (count == 0) {
+	return 0;
+    }
+    filePtr->writeCount = 0;
+    return WriteBytes(fileno(f), filePtr->writeBuf, count);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclSetBuffering --
+ *
+ *	Change the buffering policy and buffer size of an open file.
+ *	For a file whose output goes through stdio the policy is passed
+ *	on to setvbuf, and the size is only a hint.
+ *
+ * Results:
+ *	Zero if all went well, -1 if an error occurred (errno tells
+ *	what went wrong).
+ *
+ * Side effects:
+ *	Output already buffered is flushed first.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclSetBuffering(filePtr, buffering, size)
+    register OpenFile *filePtr;		/* File to change. */
+    int buffering;			/* FILE_BUFFER_NONE, FILE_BUFFER_LINE,
+					 * or FILE_BUFFER_FULL. */
+    int size;				/* Buffer size in bytes. */
+{
+    FILE *f;
+    int mode;
+
+    if (TclFlushFile(filePtr) != 0) {
+	return -1;
+    }
+    if (!filePtr->writeDirect) {
+	f = filePtr->f2;
+	if (f == NULL) {
+	    f = filePtr->f;
+	}
+	if (buffering == FILE_BUFFER_NONE) {
+	    mode = _IONBF;
+	} else if (buffering == FILE_BUFFER_LINE) {
+	    mode = _IOLBF;
+	} else {
+	    mode = _IOFBF;
+	}
+	if (setvbuf(f, (char *) NULL, mode, (size_t) size) != 0) {
+	    return -1;
+	}
+    } else if ((size != filePtr->writeSize) && (filePtr->writeBuf != NULL)) {
+	ckfree(filePtr->writeBuf);
+	filePtr->writeBuf = NULL;
+    }
+    filePtr->buffering = buffering;
+    filePtr->writeSize = size;
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclSetBlocking --
+ *
+ *	Put an open file into blocking or non-blocking mode.  DOS files
+ *	never make a reader wait for input that may arrive later, so
+ *	the mode is only recorded.
+ *
+ * Results:
+ *	Always zero.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclSetBlocking(filePtr, blocking)
+    register OpenFile *filePtr;		/* File to change. */
+    int blocking;			/* Zero means non-blocking. */
+{
+    filePtr->blocking = blocking;
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclReleaseFile --
+ *
+ *	Called when an open file is about to be closed, to write out
+ *	the output Tcl has buffered for it and free its buffers and
+ *	event handlers.
+ *
+ * Results:
+ *	Zero if all went well, -1 if buffered output couldn't be
+ *	written (errno tells what went wrong).
+ *
+ * Side effects:
+ *	The buffers and handler scripts are freed and the file is removed
+ *	from the list of files to flush at exit.  The stdio streams
+ *	are left for the caller to close.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclReleaseFile(filePtr)
+    register OpenFile *filePtr;		/* File that is being closed. */
+{
+    OpenFile **linkPtr;
+    int result = 0;
+
+    if (filePtr->writeDirect) {
+	result = TclFlushFile(filePtr);
+	for (linkPtr = &firstDirectPtr; *linkPtr != NULL;
+		linkPtr = &(*linkPtr)->nextPtr) {
+	    if (*linkPtr == filePtr) {
+		*linkPtr = filePtr->nextPtr;
+		break;
+	    }
+	}
+    }
+    if (filePtr->readBuf != NULL) {
+	ckfree(filePtr->readBuf);
+	filePtr->readBuf = filePtr->readPtr = filePtr->readEnd = NULL;
+    }
+    if (filePtr->writeBuf != NULL) {
+	ckfree(filePtr->writeBuf);
+	filePtr->writeBuf = NULL;
+    }
+    if (filePtr->readScript != NULL) {
+	ckfree(filePtr->readScript);
+	filePtr->readScript = NULL;
+    }
+    if (filePtr->writeScript != NULL) {
+	ckfree(filePtr->writeScript);
+	filePtr->writeScript = NULL;
+    }
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclWaitForFiles --
+ *
+ *	Invoke the "fileevent" handlers of all files that have them.
+ *	DOS files are always ready to be read or written, so there is
+ *	never anything to wait for.
+ *
+ * Results:
+ *	The number of handlers invoked, or -1 if no file has a handler.
+ *
+ * Side effects:
+ *	Depends on the handlers.  A handler that returns an error is
+ *	deleted, so that it can't fail over and over again.
+ *
+ *----------------------------------------------------------------------
+ */
+
+	/* ARGSUSED */
+int
+TclWaitForFiles(iPtr, timeout)
+    Interp *iPtr;			/* Interpreter whose files to watch. */
+    int timeout;			/* Not used. */
+{
+    register OpenFile *filePtr;
+    char *script;
+    int i, count, writable;
+
+    count = -1;
+    for (i = 0; i < iPtr->numFiles; i++) {
+	for (writable = 0; writable < 2; writable++) {
+	    filePtr = iPtr->filePtrArray[i];
+	    if (filePtr == NULL) {
+		break;
+	    }
+	    script = writable ? filePtr->writeScript : filePtr->readScript;
+	    if (script == NULL) {
+		continue;
+	    }
+	    if (count < 0) {
+		count = 0;
+	    }
+	    count++;
+	    if (TclEvalEvent((Tcl_Interp *) iPtr, script) != TCL_ERROR) {
+		continue;
+	    }
+	    filePtr = iPtr->filePtrArray[i];
+	    if (filePtr == NULL) {
+		break;
+	    }
+	    if (filePtr->readScript == script) {
+		ckfree(filePtr->readScript);
+		filePtr->readScript = NULL;
+	    } else if (filePtr->writeScript == script) {
+		ckfree(filePtr->writeScript);
+		filePtr->writeScript = NULL;
+	    }
+	}
+    }
+    return count;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclGetTime --
+ *
+ *	Read the clock used to schedule "after" handlers.  DOS has no
+ *	monotonic clock, so this uses the time since the program
+ *	started, which is only as fine as the 55 millisecond BIOS tick.
+ *
+ * Results:
+ *	The current time is stored at *timePtr.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclGetTime(timePtr)
+    TclTime *timePtr;			/* Where to store the time. */
+{
+    clock_t ticks;
+
+    ticks = clock();
+    timePtr->sec = (long) (ticks / CLK_TCK);
+    timePtr->usec = (long) ((ticks - timePtr->sec * CLK_TCK) * 1000000L
+	    / CLK_TCK);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclSleep --
+ *
+ *	Delay the process for a given number of milliseconds.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Time passes.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclSleep(ms)
+    int ms;				/* Number of milliseconds to sleep. */
+{
+    if (ms > 0) {
+	delay((unsigned) ms);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FlushOnExit --
+ *
+ *	This procedure is registered with atexit by TclDirectOutput.
+ *	It writes out output still buffered by Tcl when the process
+ *	exits without closing its files, as stdio does for its own.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Output is written.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FlushOnExit()
+{
+    OpenFile *filePtr;
+
+    for (filePtr = firstDirectPtr; filePtr != NULL;
+	    filePtr = filePtr->nextPtr) {
+	TclFlushFile(filePtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * WriteBytes --
+ *
+ *	Write a block of bytes to a file descriptor, retrying after
+ *	partial writes.
+ *
+ * Results:
+ *	Zero if all went well, -1 if an error occurred (errno tells
+ *	what went wrong).
+ *
+ * Side effects:
+ *	Output is written.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+WriteBytes(fd, buffer, count)
+    int fd;				/* File descriptor to write to. */
+    char *buffer;			/* Data to write. */
+    int count;				/* Number of bytes at buffer. */
+{
+    int written;
+
+    while (count > 0) {
+	written = write(fd, buffer, count);
+	if (written < 0) {
+#ifdef EINTR
+	    if (errno == EINTR) {
+		continue;
+	    }
+#endif
+	    return -1;
+	}
+	buffer += written;
+	count -= written;
+    }
+    return 0;
+}
@@ -24,6 +24,45 @@
 
 #include "tclInt.h"
 #include "tclUnix.h"
+#include <sys/uio.h>
+#include <poll.h>
+#include <time.h>
+
+/*
+ * Initial size of the buffer that TclGetLine allocates for an open
+ * file.  The buffer doubles whenever a line doesn't fit.
+ */
+
+#define READ_BUF_SIZE 4096
+
+/*
+ * Size of the output buffer that TclDirectOutput sets up for a file.
+ * It can be changed afterwards with the "fconfigure" command.
+ */
+
+#define WRITE_BUF_SIZE 4096
+
+/*
+ * The macro below tells whether an error from reading a non-blocking
+ * file just means that no input is available yet.
+ */
+
+#ifdef EWOULDBLOCK
+#   define WOULD_BLOCK(err) (((err) == EAGAIN) || ((err) == EWOULDBLOCK))
+#else
+#   define WOULD_BLOCK(err) ((err) == EAGAIN)
+#endif
+
+/*
+ * List of all open files whose output is held in Tcl's own buffers
+ * rather than stdio's (linked through their nextPtr fields), so that
+ * the output can still be written if the process exits without
+ * closing them.
+ */
+
+static OpenFile *firstDirectPtr = NULL;
+static int exitHandlerSet = 0;	/* Non-zero means FlushOnExit has been
+				 * registered with atexit. */
 
 /*
  * Data structures of the following type are used by Tcl_Fork and
@@ -61,6 +100,15 @@ static int waitTableUsed = 0;	/* Number of entries in waitTable that
 				 * entries are always at the beginning
 				 * of the table. */
 #define WAIT_TABLE_GROW_BY 4
+
+static void		FlushOnExit _ANSI_ARGS_((void));
+static WaitInfo *	NewWaitEntry _ANSI_ARGS_((void));
+#if TCL_POSIX_SPAWN
+static int		SpawnChild _ANSI_ARGS_((char *execName, char **argv,
+			    int inputId, int outputId, int errorId));
+#endif
+static int		WriteVector _ANSI_ARGS_((int fd, struct iovec *iov,
+			    int count));
 
 /*
  *----------------------------------------------------------------------
@@ -174,45 +222,12 @@ Tcl_Fork()
     WaitInfo *waitPtr;
     pid_t pid;
 
-    /*
-     * Disable SIGPIPE signals:  if they were allowed, this process
-     * might go away unexpectedly if children misbehave.  This code
-     * can potentially interfere with other application code that
-     * expects to handle SIGPIPEs;  what's really needed is an
-     * arbiter for signals to allow them to be "shared".
-     */
-
-    if (waitTable == NULL) {
-	(void) signal(SIGPIPE, SIG_IGN);
-    }
-
-    /*
-     * Enlarge the wait table if there isn't enough space for a new
-     * entry.
-     */
-
-    if (waitTableUsed == waitTableSize) {
-	int newSize;
-	WaitInfo *newWaitTable;
-
-	newSize = waitTableSize + WAIT_TABLE_GROW_BY;
-	newWaitTable = (WaitInfo *) ckalloc((unsigned)
-		(newSize * sizeof(WaitInfo)));
-	memcpy((VOID *) newWaitTable, (VOID *) waitTable,
-		(waitTableSize * sizeof(WaitInfo)));
-	if (waitTable != NULL) {
-	    ckfree((char *) waitTable);
-	}
-	waitTable = newWaitTable;
-	waitTableSize = newSize;
-    }
-
     /*
      * Make a new process and enter it into the table if the fork
      * is successful.
      */
 
-    waitPtr = &waitTable[waitTableUsed];
+    waitPtr = NewWaitEntry();
     pid = fork();
     if (pid > 0) {
 	waitPtr->pid = pid;
@@ -708,6 +723,19 @@ Tcl_CreatePipeline(interp, argc, argv, pidArrayPtr, inPipePtr,
 	    outputId = pipeIds[1];
 	}
 	execName = Tcl_TildeSubst(interp, argv[firstArg]);
+	if (execName == NULL) {
+	    goto error;
+	}
+#if TCL_POSIX_SPAWN
+	pid = SpawnChild(execName, &argv[firstArg], inputId, outputId,
+		errorId);
+	if (pid == -1) {
+	    Tcl_AppendResult(interp, "couldn't execute \"", argv[firstArg],
+		    "\": ", Tcl_UnixError(interp), (char *) NULL);
+	    goto error;
+	}
+	pidPtr[numPids] = pid;
+#else
 	pid = Tcl_Fork();
 	if (pid == -1) {
 	    Tcl_AppendResult(interp, "couldn't fork child process: ",
@@ -737,6 +765,7 @@ Tcl_CreatePipeline(interp, argc, argv, pidArrayPtr, inPipePtr,
 	} else {
 	    pidPtr[numPids] = pid;
 	}
+#endif
 
 	/*
 	 * Close off our copies of file descriptors that were set up for
@@ -894,6 +923,19 @@ TclMakeFileTable(iPtr, index)
 	filePtr->numPids = 0;
 	filePtr->pidPtr = NULL;
 	filePtr->errorId = -1;
+	filePtr->readBuf = filePtr->readPtr = filePtr->readEnd = NULL;
+	filePtr->readSize = 0;
+	filePtr->readDirect = 0;
+	filePtr->readEof = 0;
+	filePtr->readPartial = 0;
+	filePtr->writeBuf = NULL;
+	filePtr->writeSize = BUFSIZ;
+	filePtr->writeCount = 0;
+	filePtr->buffering = FILE_BUFFER_FULL;
+	filePtr->writeDirect = 0;
+	filePtr->nextPtr = NULL;
+	filePtr->blocking = 1;
+	filePtr->readScript = filePtr->writeScript = NULL;
 	iPtr->filePtrArray[0] = filePtr;
 
 	filePtr = (OpenFile *) ckalloc(sizeof(OpenFile));
@@ -904,6 +946,23 @@ TclMakeFileTable(iPtr, index)
 	filePtr->numPids = 0;
 	filePtr->pidPtr = NULL;
 	filePtr->errorId = -1;
+	filePtr->readBuf = filePtr->readPtr = filePtr->readEnd = NULL;
+	filePtr->readSize = 0;
+	filePtr->readDirect = 0;
+	filePtr->readEof = 0;
+	filePtr->readPartial = 0;
+	filePtr->writeBuf = NULL;
+	filePtr->writeSize = BUFSIZ;
+	filePtr->writeCount = 0;
+	if (isatty(fileno(stdout))) {
+	    filePtr->buffering = FILE_BUFFER_LINE;
+	} else {
+	    filePtr->buffering = FILE_BUFFER_FULL;
+	}
+	filePtr->writeDirect = 0;
+	filePtr->nextPtr = NULL;
+	filePtr->blocking = 1;
+	filePtr->readScript = filePtr->writeScript = NULL;
 	iPtr->filePtrArray[1] = filePtr;
 
 	filePtr = (OpenFile *) ckalloc(sizeof(OpenFile));
@@ -914,6 +973,19 @@ TclMakeFileTable(iPtr, index)
 	filePtr->numPids = 0;
 	filePtr->pidPtr = NULL;
 	filePtr->errorId = -1;
+	filePtr->readBuf = filePtr->readPtr = filePtr->readEnd = NULL;
+	filePtr->readSize = 0;
+	filePtr->readDirect = 0;
+	filePtr->readEof = 0;
+	filePtr->readPartial = 0;
+	filePtr->writeBuf = NULL;
+	filePtr->writeSize = BUFSIZ;
+	filePtr->writeCount = 0;
+	filePtr->buffering = FILE_BUFFER_NONE;
+	filePtr->writeDirect = 0;
+	filePtr->nextPtr = NULL;
+	filePtr->blocking = 1;
+	filePtr->readScript = filePtr->writeScript = NULL;
 	iPtr->filePtrArray[2] = filePtr;
     } else if (index >= iPtr->numFiles) {
 	int newSize;
@@ -1007,3 +1079,1066 @@ TclGetOpenFile(interp, string, filePtrPtr)
     *filePtrPtr = iPtr->filePtrArray[fd];
     return TCL_OK;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclGetLine --
+ *
+ *	Return the next line of input from an open file, using the
+ *	file's read buffer so that lines can be located with memchr
+ *	and returned whole instead of being read a character at a time.
+ *
+ * Results:
+ *	The return value is the number of characters in the line, not
+ *	counting its newline, or -1 if end of file was reached before
+ *	any characters were read or if the file is non-blocking and no
+ *	complete line is available yet, or -2 if an error occurred
+ *	(errno tells what went wrong).  *linePtr is set to point to the
+ *	null-terminated line, which stays valid until the next read
+ *	from filePtr.
+ *
+ * Side effects:
+ *	Input is read from the file and the read buffer may be grown.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclGetLine(filePtr, linePtr)
+    register OpenFile *filePtr;		/* File to read from. */
+    char **linePtr;			/* Where to store address of line. */
+{
+    char *scan, *newline;
+    int count, length;
+
+    scan = filePtr->readPtr;
+    while (1) {
+	if (scan != NULL) {
+	    newline = (char *) memchr((VOID *) scan, '\n',
+		    (size_t) (filePtr->readEnd - scan));
+	    if (newline != NULL) {
+		*newline = 0;
+		*linePtr = filePtr->readPtr;
+		filePtr->readPtr = newline + 1;
+		return newline - *linePtr;
+	    }
+	}
+
+	/*
+	 * No complete line is buffered.  Slide what there is to the
+	 * front of the buffer, grow it if it is full, then refill.
+	 */
+
+	length = filePtr->readEnd - filePtr->readPtr;
+	if (filePtr->readBuf == NULL) {
+	    filePtr->readSize = READ_BUF_SIZE;
+	    filePtr->readBuf = (char *) ckalloc((unsigned) filePtr->readSize);
+	} else if (length >= filePtr->readSize - 1) {
+	    char *new;
+
+	    new = (char *) ckalloc((unsigned) (2 * filePtr->readSize));
+	    memcpy((VOID *) new, (VOID *) filePtr->readPtr, length);
+	    ckfree(filePtr->readBuf);
+	    filePtr->readBuf = new;
+	    filePtr->readSize *= 2;
+	} else if ((length > 0) && (filePtr->readPtr != filePtr->readBuf)) {
+	    memmove((VOID *) filePtr->readBuf, (VOID *) filePtr->readPtr,
+		    length);
+	}
+	filePtr->readPtr = filePtr->readBuf;
+	filePtr->readEnd = filePtr->readBuf + length;
+	scan = filePtr->readEnd;
+
+	if (filePtr->readDirect) {
+	    do {
+		count = read(fileno(filePtr->f), filePtr->readEnd,
+			filePtr->readSize - 1 - length);
+#ifdef EINTR
+	    } while ((count < 0) && (errno == EINTR));
+#else
+	    } while (0);
+#endif
+	    if (count < 0) {
+		if (!filePtr->blocking && WOULD_BLOCK(errno)) {
+		    filePtr->readPartial = 1;
+		    return -1;
+		}
+		return -2;
+	    }
+	} else {
+	    count = 0;
+	    if (fgets(filePtr->readEnd, filePtr->readSize - length,
+		    filePtr->f) != NULL) {
+		count = strlen(filePtr->readEnd);
+	    } else if (ferror(filePtr->f)) {
+		clearerr(filePtr->f);
+		if (!filePtr->blocking && WOULD_BLOCK(errno)) {
+		    filePtr->readPartial = 1;
+		    return -1;
+		}
+		return -2;
+	    }
+	}
+	if (count == 0) {
+	    filePtr->readEof = 1;
+	    if (length == 0) {
+		return -1;
+	    }
+	    *filePtr->readEnd = 0;
+	    *linePtr = filePtr->readPtr;
+	    filePtr->readPtr = filePtr->readEnd;
+	    return length;
+	}
+	filePtr->readEnd += count;
+	filePtr->readPartial = 0;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclReadFile --
+ *
+ *	Read input from an open file for commands other than "gets".
+ *	Input that TclGetLine has buffered but not yet returned is
+ *	taken first, so that the two never disagree about where the
+ *	file is positioned.
+ *
+ * Results:
+ *	The return value is the number of bytes stored at buffer, at
+ *	most count.  Zero means end of file, or that no input is
+ *	available from a non-blocking file, and -1 means an error
+ *	occurred (errno tells what went wrong).
+ *
+ * Side effects:
+ *	Input is consumed from the read buffer or the file.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclReadFile(filePtr, buffer, count)
+    register OpenFile *filePtr;		/* File to read from. */
+    char *buffer;			/* Where to store input. */
+    int count;				/* Maximum number of bytes to read. */
+{
+    int length;
+
+    length = filePtr->readEnd - filePtr->readPtr;
+    if (length > 0) {
+	if (length > count) {
+	    length = count;
+	}
+	memcpy((VOID *) buffer, (VOID *) filePtr->readPtr, length);
+	filePtr->readPtr += length;
+	filePtr->readPartial = 0;
+	return length;
+    }
+    if (filePtr->readDirect) {
+	do {
+	    length = read(fileno(filePtr->f), buffer, count);
+#ifdef EINTR
+	} while ((length < 0) && (errno == EINTR));
+#else
+	} while (0);
+#endif
+	if (length == 0) {
+	    filePtr->readEof = 1;
+	} else if ((length < 0) && !filePtr->blocking && WOULD_BLOCK(errno)) {
+	    length = 0;
+	}
+	return length;
+    }
+    length = fread(buffer, 1, count, filePtr->f);
+    if (ferror(filePtr->f)) {
+	clearerr(filePtr->f);
+	if (!filePtr->blocking && WOULD_BLOCK(errno)) {
+	    return length;
+	}
+	return -1;
+    }
+    return length;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclSeekFile --
+ *
+ *	Reposition an open file, allowing for input held in its read
+ *	buffer.
+ *
+ * Results:
+ *	Zero if the file was repositioned, -1 if an error occurred
+ *	(errno tells what went wrong).
+ *
+ * Side effects:
+ *	On success the read buffer is emptied and the end-of-file
+ *	condition is cleared.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclSeekFile(filePtr, offset, mode)
+    register OpenFile *filePtr;		/* File to reposition. */
+    long offset;			/* New position, relative to mode. */
+    int mode;				/* SEEK_SET, SEEK_CUR, or SEEK_END. */
+{
+    if (filePtr->writeDirect && (TclFlushFile(filePtr) != 0)) {
+	return -1;
+    }
+    if (mode == SEEK_CUR) {
+	offset -= filePtr->readEnd - filePtr->readPtr;
+    }
+
+    /*
+     * Stdio never sees the reads and writes made for a direct file, so
+     * its idea of the file position can't be trusted;  go to the
+     * descriptor.
+     */
+
+    if (filePtr->readDirect || filePtr->writeDirect) {
+	if (lseek(fileno(filePtr->f), offset, mode) == -1) {
+	    return -1;
+	}
+	clearerr(filePtr->f);
+    } else if (fseek(filePtr->f, offset, mode) == -1) {
+	return -1;
+    }
+    filePtr->readPtr = filePtr->readEnd = filePtr->readBuf;
+    filePtr->readEof = 0;
+    filePtr->readPartial = 0;
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclTellFile --
+ *
+ *	Find the position of the next byte to be read from or written
+ *	to an open file, allowing for input held in its read buffer
+ *	and output held in its write buffer.
+ *
+ * Results:
+ *	The position, or -1 if it couldn't be determined (errno tells
+ *	why).
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+long
+TclTellFile(filePtr)
+    register OpenFile *filePtr;		/* File whose position is wanted. */
+{
+    long position;
+
+    if (filePtr->readDirect || filePtr->writeDirect) {
+	position = lseek(fileno(filePtr->f), 0L, SEEK_CUR);
+    } else {
+	position = ftell(filePtr->f);
+    }
+    if (position == -1) {
+	return -1;
+    }
+    if (filePtr->writeDirect && (filePtr->f2 == NULL)) {
+	position += filePtr->writeCount;
+    }
+    return position - (filePtr->readEnd - filePtr->readPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclDirectOutput --
+ *
+ *	Arrange for output to an open file to be collected in a buffer
+ *	managed by Tcl and written straight to the file descriptor,
+ *	bypassing stdio.  This is only safe when nothing else uses the
+ *	output stream, so it is done for files made by "open" but not
+ *	for the standard files.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The stream's stdio buffering is turned off, the file is given
+ *	full buffering with the default buffer size, and the file is
+ *	added to the list of files flushed when the process exits.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclDirectOutput(filePtr)
+    register OpenFile *filePtr;		/* File just opened for writing. */
+{
+    FILE *f;
+
+    f = filePtr->f2;
+    if (f == NULL) {
+	f = filePtr->f;
+    }
+    setvbuf(f, (char *) NULL, _IONBF, 0);
+    filePtr->writeDirect = 1;
+    filePtr->buffering = FILE_BUFFER_FULL;
+    filePtr->writeSize = WRITE_BUF_SIZE;
+    filePtr->nextPtr = firstDirectPtr;
+    firstDirectPtr = filePtr;
+    if (!exitHandlerSet) {
+	atexit(FlushOnExit);
+	exitHandlerSet = 1;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclWriteFile --
+ *
+ *	Write a string, optionally followed by a newline, to an open
+ *	file according to the file's buffering policy.  For a direct
+ *	file, output that doesn't fit in the write buffer is written
+ *	together with what the buffer already holds in a single writev
+ *	call, so that a stream of small writes costs one system call
+ *	per buffer-full.
+ *
+ * Results:
+ *	Zero if all went well, -1 if an error occurred (errno tells
+ *	what went wrong).
+ *
+ * Side effects:
+ *	Output is buffered or written.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclWriteFile(filePtr, string, length, newline)
+    register OpenFile *filePtr;		/* File to write to. */
+    char *string;			/* Characters to write. */
+    int length;				/* Number of characters at string. */
+    int newline;			/* Non-zero means add a newline. */
+{
+    struct iovec iov[3];
+    FILE *f;
+    int count;
+
+    f = filePtr->f2;
+    if (f == NULL) {
+	f = filePtr->f;
+    }
+    if (!filePtr->writeDirect) {
+	fwrite((VOID *) string, 1, (size_t) length, f);
+	if (newline) {
+	    putc('\n', f);
+	}
+	if (ferror(f)) {
+	    clearerr(f);
+	    return -1;
+	}
+	return 0;
+    }
+
+    count = length;
+    if (newline) {
+	count++;
+    }
+    if ((filePtr->buffering != FILE_BUFFER_NONE)
+	    && (filePtr->writeCount + count <= filePtr->writeSize)) {
+	if (filePtr->writeBuf == NULL) {
+	    filePtr->writeBuf = (char *) ckalloc((unsigned)
+		    filePtr->writeSize);
+	}
+	memcpy((VOID *) (filePtr->writeBuf + filePtr->writeCount),
+		(VOID *) string, length);
+	filePtr->writeCount += length;
+	if (newline) {
+	    filePtr->writeBuf[filePtr->writeCount] = '\n';
+	    filePtr->writeCount++;
+	}
+	if ((filePtr->buffering == FILE_BUFFER_LINE) && (newline
+		|| (memchr((VOID *) string, '\n', (size_t) length) != NULL))) {
+	    return TclFlushFile(filePtr);
+	}
+	return 0;
+    }
+
+    iov[0].iov_base = (VOID *) filePtr->writeBuf;
+    iov[0].iov_len = filePtr->writeCount;
+    iov[1].iov_base = (VOID *) string;
+    iov[1].iov_len = length;
+    iov[2].iov_base = (VOID *) "\n";
+    iov[2].iov_len = newline ? 1 : 0;
+    filePtr->writeCount = 0;
+    return WriteVector(fileno(f), iov, 3);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclFlushFile --
+ *
+ *	Write out any output buffered for an open file.
+ *
+ * Results:
+ *	Zero if all went well, -1 if an error occurred (errno tells
+ *	what went wrong).
+ *
+ * Side effects:
+ *	The write buffer is emptied, even if an error occurs.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclFlushFile(filePtr)
+    register OpenFile *filePtr;		/* File to flush. */
+{
+    struct iovec iov;
+    FILE *f;
+
+    f = filePtr->f2;
+    if (f == NULL) {
+	f = filePtr->f;
+    }
+    if (!filePtr->writeDirect) {
+	if (fflush(f) == EOF) {
+	    clearerr(f);
+	    return -1;
+	}
+	return 0;
+    }
+    if (filePtr->writeCount == 0) {
+	return 0;
+    }
+    iov.iov_base = (VOID *) filePtr->writeBuf;
+    iov.iov_len = filePtr->writeCount;
+    filePtr->writeCount = 0;
+    return WriteVector(fileno(f), &iov, 1);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclSetBuffering --
+ *
+ *	Change the buffering policy and buffer size of an open file.
+ *	For a file whose output goes through stdio the policy is passed
+ *	on to setvbuf, and the size is only a hint.
+ *
+ * Results:
+ *	Zero if all went well, -1 if an error occurred (errno tells
+ *	what went wrong).
+ *
+ * Side effects:
+ *	Output already buffered is flushed first.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclSetBuffering(filePtr, buffering, size)
+    register OpenFile *filePtr;		/* File to change. */
+    int buffering;			/* FILE_BUFFER_NONE, FILE_BUFFER_LINE,
+					 * or FILE_BUFFER_FULL. */
+    int size;				/* Buffer size in bytes. */
+{
+    FILE *f;
+    int mode;
+
+    if (TclFlushFile(filePtr) != 0) {
+	return -1;
+    }
+    if (!filePtr->writeDirect) {
+	f = filePtr->f2;
+	if (f == NULL) {
+	    f = filePtr->f;
+	}
+	if (buffering == FILE_BUFFER_NONE) {
+	    mode = _IONBF;
+	} else if (buffering == FILE_BUFFER_LINE) {
+	    mode = _IOLBF;
+	} else {
+	    mode = _IOFBF;
+	}
+	if (setvbuf(f, (char *) NULL, mode, (size_t) size) != 0) {
+	    return -1;
+	}
+    } else if ((size != filePtr->writeSize) && (filePtr->writeBuf != NULL)) {
+	ckfree(filePtr->writeBuf);
+	filePtr->writeBuf = NULL;
+    }
+    filePtr->buffering = buffering;
+    filePtr->writeSize = size;
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclSetBlocking --
+ *
+ *	Put an open file into blocking or non-blocking mode.  Only
+ *	input is affected:  output is always written in full.
+ *
+ * Results:
+ *	Zero if all went well, -1 if an error occurred (errno tells
+ *	what went wrong).
+ *
+ * Side effects:
+ *	The O_NONBLOCK flag of the input descriptor is changed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclSetBlocking(filePtr, blocking)
+    register OpenFile *filePtr;		/* File to change. */
+    int blocking;			/* Zero means non-blocking. */
+{
+    int fd, flags;
+
+    if (filePtr->readable) {
+	fd = fileno(filePtr->f);
+	flags = fcntl(fd, F_GETFL, 0);
+	if (flags == -1) {
+	    return -1;
+	}
+	if (blocking) {
+	    flags &= ~O_NONBLOCK;
+	} else {
+	    flags |= O_NONBLOCK;
+	}
+	if (fcntl(fd, F_SETFL, flags) == -1) {
+	    return -1;
+	}
+    }
+    filePtr->blocking = blocking;
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclReleaseFile --
+ *
+ *	Called when an open file is about to be closed, to write out
+ *	the output Tcl has buffered for it and free its buffers and
+ *	event handlers.
+ *
+ * Results:
+ *	Zero if all went well, -1 if buffered output couldn't be
+ *	written (errno tells what went wrong).
+ *
+ * Side effects:
+ *	The buffers and handler scripts are freed and the file is removed
+ *	from the list of files to flush at exit.  The stdio streams
+ *	are left for the caller to close.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclReleaseFile(filePtr)
+    register OpenFile *filePtr;		/* File that is being closed. */
+{
+    OpenFile **linkPtr;
+    int result = 0;
+
+    if (filePtr->writeDirect) {
+	result = TclFlushFile(filePtr);
+	for (linkPtr = &firstDirectPtr; *linkPtr != NULL;
+		linkPtr = &(*linkPtr)->nextPtr) {
+	    if (*linkPtr == filePtr) {
+		*linkPtr = filePtr->nextPtr;
+		break;
+	    }
+	}
+    }
+    if (filePtr->readBuf != NULL) {
+	ckfree(filePtr->readBuf);
+	filePtr->readBuf = filePtr->readPtr = filePtr->readEnd = NULL;
+    }
+    if (filePtr->writeBuf != NULL) {
+	ckfree(filePtr->writeBuf);
+	filePtr->writeBuf = NULL;
+    }
+    if (filePtr->readScript != NULL) {
+	ckfree(filePtr->readScript);
+	filePtr->readScript = NULL;
+    }
+    if (filePtr->writeScript != NULL) {
+	ckfree(filePtr->writeScript);
+	filePtr->writeScript = NULL;
+    }
+    return result;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclWaitForFiles --
+ *
+ *	Wait for files with "fileevent" handlers to become readable or
+ *	writable, then invoke the handlers of all that are ready.  A
+ *	file that still has input in its read buffer, or has reached
+ *	end of file, counts as readable without waiting.
+ *
+ * Results:
+ *	The number of handlers invoked, or -1 if no file has a handler.
+ *
+ * Side effects:
+ *	Depends on the handlers.  A handler that returns an error is
+ *	deleted, so that it can't fail over and over again.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclWaitForFiles(iPtr, timeout)
+    Interp *iPtr;			/* Interpreter whose files to watch. */
+    int timeout;			/* Milliseconds to wait for a file to
+					 * become ready;  -1 means wait as long
+					 * as it takes. */
+{
+    struct pollfd *pollArray, *pollPtr;
+    int *indexArray;
+    register OpenFile *filePtr;
+    FILE *f;
+    char *script;
+    int i, numPolled, count;
+
+    if (iPtr->numFiles == 0) {
+	return -1;
+    }
+
+    /*
+     * Make a list of the descriptors to watch:  one entry for each
+     * handler, with indexArray giving the file each entry is for.
+     */
+
+    pollArray = (struct pollfd *) ckalloc((unsigned)
+	    (2 * iPtr->numFiles * sizeof(struct pollfd)));
+    indexArray = (int *) ckalloc((unsigned) (2 * iPtr->numFiles * sizeof(int)));
+    numPolled = 0;
+    for (i = 0; i < iPtr->numFiles; i++) {
+	filePtr = iPtr->filePtrArray[i];
+	if (filePtr == NULL) {
+	    continue;
+	}
+	if (filePtr->readScript != NULL) {
+	    pollPtr = &pollArray[numPolled];
+	    pollPtr->fd = fileno(filePtr->f);
+	    pollPtr->events = POLLIN;
+	    indexArray[numPolled] = i;
+	    numPolled++;
+	    if (((filePtr->readPtr != filePtr->readEnd)
+		    && !filePtr->readPartial) || filePtr->readEof) {
+		timeout = 0;
+	    }
+	}
+	if (filePtr->writeScript != NULL) {
+	    f = filePtr->f2;
+	    if (f == NULL) {
+		f = filePtr->f;
+	    }
+	    pollPtr = &pollArray[numPolled];
+	    pollPtr->fd = fileno(f);
+	    pollPtr->events = POLLOUT;
+	    indexArray[numPolled] = i;
+	    numPolled++;
+	}
+    }
+    if (numPolled == 0) {
+	ckfree((char *) pollArray);
+	ckfree((char *) indexArray);
+	return -1;
+    }
+
+    if (poll(pollArray, (unsigned long) numPolled, timeout) < 0) {
+	numPolled = 0;
+    }
+
+    /*
+     * Note which handlers are ready before invoking any of them, since
+     * the handlers may open and close files.  Errors and hangups are
+     * treated as ready so that the handler can find out about them,
+     * and so is buffered input, unless it is a partial line that
+     * "gets" is still waiting to complete.
+     */
+
+    for (i = 0; i < numPolled; i++) {
+	pollPtr = &pollArray[i];
+	filePtr = iPtr->filePtrArray[indexArray[i]];
+	if ((pollPtr->events == POLLIN)
+		&& (((filePtr->readPtr != filePtr->readEnd)
+		&& !filePtr->readPartial) || filePtr->readEof)) {
+	    pollPtr->revents |= POLLIN;
+	}
+	if ((pollPtr->revents & (pollPtr->events|POLLERR|POLLHUP|POLLNVAL))
+		== 0) {
+	    indexArray[i] = -1;
+	}
+    }
+
+    count = 0;
+    for (i = 0; i < numPolled; i++) {
+	if (indexArray[i] < 0) {
+	    continue;
+	}
+	filePtr = iPtr->filePtrArray[indexArray[i]];
+	if (filePtr == NULL) {
+	    continue;
+	}
+	if (pollArray[i].events == POLLIN) {
+	    script = filePtr->readScript;
+	} else {
+	    script = filePtr->writeScript;
+	}
+	if (script == NULL) {
+	    continue;
+	}
+	count++;
+	if (TclEvalEvent((Tcl_Interp *) iPtr, script) != TCL_ERROR) {
+	    continue;
+	}
+	filePtr = iPtr->filePtrArray[indexArray[i]];
+	if (filePtr == NULL) {
+	    continue;
+	}
+	if (filePtr->readScript == script) {
+	    ckfree(filePtr->readScript);
+	    filePtr->readScript = NULL;
+	} else if (filePtr->writeScript == script) {
+	    ckfree(filePtr->writeScript);
+	    filePtr->writeScript = NULL;
+	}
+    }
+    ckfree((char *) pollArray);
+    ckfree((char *) indexArray);
+    return count;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclGetTime --
+ *
+ *	Read the clock used to schedule "after" handlers.  This is a
+ *	monotonic clock where there is one, so that timers aren't
+ *	upset when someone sets the time of day.
+ *
+ * Results:
+ *	The current time is stored at *timePtr.  It counts from an
+ *	arbitrary starting point, so it is only good for working out
+ *	intervals.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclGetTime(timePtr)
+    TclTime *timePtr;			/* Where to store the time. */
+{
+#ifdef CLOCK_MONOTONIC
+    struct timespec now;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &now) == 0) {
+	timePtr->sec = now.tv_sec;
+	timePtr->usec = now.tv_nsec / 1000;
+	return;
+    }
+#endif
+#if TCL_GETTOD
+    {
+	struct timeval now;
+	struct timezone tz;
+
+	gettimeofday(&now, &tz);
+	timePtr->sec = now.tv_sec;
+	timePtr->usec = now.tv_usec;
+    }
+#else
+    {
+	struct tms dummy;
+	clock_t ticks;
+
+	ticks = times(&dummy);
+	timePtr->sec = ticks / CLK_TCK;
+	timePtr->usec = ((ticks % CLK_TCK) * 1000000L) / CLK_TCK;
+    }
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclSleep --
+ *
+ *	Delay the process for a given number of milliseconds.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Time passes.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclSleep(ms)
+    int ms;				/* Number of milliseconds to sleep. */
+{
+    TclTime now, end;
+    long left;
+
+    TclGetTime(&end);
+    end.sec += ms / 1000;
+    end.usec += (ms % 1000) * 1000L;
+    if (end.usec >= 1000000L) {
+	end.sec++;
+	end.usec -= 1000000L;
+    }
+
+    /*
+     * A signal may cut the sleep short, so keep going until the clock
+     * says it's over.
+     */
+
+    left = ms;
+    while (left > 0) {
+	poll((struct pollfd *) NULL, 0, (int) left);
+	TclGetTime(&now);
+	left = (end.sec - now.sec) * 1000
+		+ (end.usec - now.usec + 999) / 1000;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FlushOnExit --
+ *
+ *	This procedure is registered with atexit by TclDirectOutput.
+ *	It writes out output still buffered by Tcl when the process
+ *	exits without closing its files, as stdio does for its own.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Output is written.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FlushOnExit()
+{
+    OpenFile *filePtr;
+
+    for (filePtr = firstDirectPtr; filePtr != NULL;
+	    filePtr = filePtr->nextPtr) {
+	TclFlushFile(filePtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NewWaitEntry --
+ *
+ *	Make room in the wait table for a child process about to be
+ *	created.
+ *
+ * Results:
+ *	The return value is the address of the next free entry.  The
+ *	caller fills it in and increments waitTableUsed once the child
+ *	exists.
+ *
+ * Side effects:
+ *	The wait table may be enlarged, and SIGPIPE is ignored from
+ *	the first call on.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static WaitInfo *
+NewWaitEntry()
+{
+    /*
+     * Disable SIGPIPE signals:  if they were allowed, this process
+     * might go away unexpectedly if children misbehave.  This code
+     * can potentially interfere with other application code that
+     * expects to handle SIGPIPEs;  what's really needed is an
+     * arbiter for signals to allow them to be "shared".
+     */
+
+    if (waitTable == NULL) {
+	(void) signal(SIGPIPE, SIG_IGN);
+    }
+
+    /*
+     * Enlarge the wait table if there isn't enough space for a new
+     * entry.
+     */
+
+    if (waitTableUsed == waitTableSize) {
+	int newSize;
+	WaitInfo *newWaitTable;
+
+	newSize = waitTableSize + WAIT_TABLE_GROW_BY;
+	newWaitTable = (WaitInfo *) ckalloc((unsigned)
+		(newSize * sizeof(WaitInfo)));
+	if (waitTable != NULL) {
+	    memcpy((VOID *) newWaitTable, (VOID *) waitTable,
+		    (waitTableSize * sizeof(WaitInfo)));
+	    ckfree((char *) waitTable);
+	}
+	waitTable = newWaitTable;
+	waitTableSize = newSize;
+    }
+    return &waitTable[waitTableUsed];
+}
+
+#if TCL_POSIX_SPAWN
+/*
+ *----------------------------------------------------------------------
+ *
+ * SpawnChild --
+ *
+ *	Start one process of a pipeline with posix_spawnp, which on
+ *	most systems avoids copying the page tables of this process
+ *	the way fork does.  The child gets the same descriptors that
+ *	Tcl_CreatePipeline's forked children set up for themselves.
+ *
+ * Results:
+ *	The return value is the process id of the child, or -1 if it
+ *	couldn't be started, in which case errno tells why.
+ *
+ * Side effects:
+ *	A new process is created and entered in the wait table.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+SpawnChild(execName, argv, inputId, outputId, errorId)
+    char *execName;		/* Name of program to run. */
+    char **argv;		/* Arguments for the program, terminated
+				 * by NULL. */
+    int inputId;		/* File id to use as standard input, or
+				 * -1 to share ours. */
+    int outputId;		/* File id to use as standard output, or
+				 * -1 to share ours. */
+    int errorId;		/* File id to use as standard error, or
+				 * -1 to share ours. */
+{
+    extern char **environ;
+    posix_spawn_file_actions_t actions;
+    WaitInfo *waitPtr;
+    pid_t pid;
+    int i, result;
+
+    waitPtr = NewWaitEntry();
+    result = posix_spawn_file_actions_init(&actions);
+    if (result != 0) {
+	errno = result;
+	return -1;
+    }
+    if (inputId != -1) {
+	result = posix_spawn_file_actions_adddup2(&actions, inputId, 0);
+    }
+    if ((result == 0) && (outputId != -1)) {
+	result = posix_spawn_file_actions_adddup2(&actions, outputId, 1);
+    }
+    if ((result == 0) && (errorId != -1)) {
+	result = posix_spawn_file_actions_adddup2(&actions, errorId, 2);
+    }
+
+    /*
+     * Close the same descriptors that a forked child would, but only
+     * those that are open:  closing one that isn't makes the spawn
+     * fail on some systems.
+     */
+
+    for (i = 3; (result == 0) && ((i <= outputId) || (i <= inputId)
+	    || (i <= errorId)); i++) {
+	if (fcntl(i, F_GETFD, 0) != -1) {
+	    result = posix_spawn_file_actions_addclose(&actions, i);
+	}
+    }
+    if (result == 0) {
+	result = posix_spawnp(&pid, execName, &actions,
+		(posix_spawnattr_t *) NULL, argv, environ);
+    }
+    posix_spawn_file_actions_destroy(&actions);
+    if (result != 0) {
+	errno = result;
+	return -1;
+    }
+    waitPtr->pid = pid;
+    waitPtr->flags = 0;
+    waitTableUsed++;
+    return pid;
+}
+#endif
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * WriteVector --
+ *
+ *	Write all of the data described by an array of iovecs to a
+ *	file descriptor, retrying after partial writes and interrupts.
+ *
+ * Results:
+ *	Zero if all went well, -1 if an error occurred (errno tells
+ *	what went wrong).
+ *
+ * Side effects:
+ *	The iovecs are modified.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+WriteVector(fd, iov, count)
+    int fd;				/* File descriptor to write to. */
+    struct iovec *iov;			/* Data to write. */
+    int count;				/* Number of entries in iov. */
+{
+    int written;
+
+    while (count > 0) {
+	written = writev(fd, iov, count);
+	if (written < 0) {
+#ifdef EINTR
+	    if (errno == EINTR) {
+		continue;
+	    }
+#endif
+	    return -1;
+	}
+	while ((count > 0) && (written >= (int) iov->iov_len)) {
+	    written -= iov->iov_len;
+	    iov++;
+	    count--;
+	}
+	if (count > 0) {
+	    iov->iov_base = (VOID *) ((char *) iov->iov_base + written);
+	    iov->iov_len -= written;
+	}
+    }
+    return 0;
+}
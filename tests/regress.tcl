@@ -0,0 +1,453 @@
+# regress.tcl --
+#
+#	Regression checks for bugs fixed in the interpreter.  Source
+#	this file from tcltest (or any application built on Tcl);  it
+#	returns an error describing the first check that fails.
+#
+# $Id$
+
+proc check {name script expected} {
+    set actual [uplevel $script]
+    if {"$actual" != "$expected"} {
+	error "$name failed: expected \"$expected\", got \"$actual\""
+    }
+}
+
+# Checks that need a file use this one, in the current directory.
+
+set regressFile regress.tmp
+
+proc regressRemove {name} {
+    if {[info commands unlink] != ""} {
+	unlink $name
+    } else {
+	exec rm -f $name
+    }
+}
+
+# Write 300 lines of assorted lengths, then one longer than the read
+# buffer, then an unterminated line.  Returns the number of lines and
+# characters written, not counting newlines.
+
+proc regressWriteLines {name} {
+    set f [open $name w]
+    set total 0
+    for {set i 0} {$i < 300} {incr i} {
+	set line [format %0[expr ($i*37)%200+1]d $i]
+	puts $f $line
+	incr total [string length $line]
+    }
+    puts $f [format %010000d 7]
+    puts $f x nonewline
+    close $f
+    list 302 [expr $total+10001]
+}
+
+# A procedure whose last command is "set" returns the value of a local
+# variable, which must be copied before the variable is deleted.
+
+proc regressSet1 {} {set x hello}
+proc regressSet2 {} {set x [format %0300d 7]}
+proc regressSet3 {a} {set a}
+check set-result-1 {regressSet1} hello
+check set-result-2 {string length [regressSet2]} 300
+check set-result-3 {regressSet3 arg} arg
+check set-result-4 {concat [regressSet1][regressSet3 1]} hello1
+rename regressSet1 {}
+rename regressSet2 {}
+rename regressSet3 {}
+
+# "^" matches only at the start of the string, not again where a
+# "regexp -all" or "regsub -all" search resumes.
+
+check regexp-all-bol-1 {regexp -all -indices {^a} aaa x; set x} {{0 0}}
+check regexp-all-bol-2 {regexp -all -indices {^a|b} abab} {{0 0} {1 1} {3 3}}
+check regsub-all-bol-1 {regsub -all {^a} aaa x r; set r} xaa
+check regsub-all-bol-2 {regsub -all {^a|b} abab x r; set r} xxax
+
+# Commands may write into their arguments (as "set" does to an array
+# element name), so the literal words of compiled code must be copied
+# for each command rather than shared by nested evaluations.
+
+proc regressUpd {v} {global regressA; set regressA(x) $v}
+proc regressTrace {args} {
+    global regressDepth
+    if {$regressDepth == 0} {
+	set regressDepth 1
+	regressUpd inner
+    }
+}
+set regressDepth 0
+trace var regressA w regressTrace
+check literal-copy-1 {regressUpd outer} inner
+check literal-copy-2 {set regressA(x)} inner
+trace vdelete regressA w regressTrace
+unset regressA regressDepth
+rename regressUpd {}
+rename regressTrace {}
+
+# "regexp -all" leaves its variables alone when nothing matches, sets
+# them to one list element per match otherwise, and finds an empty
+# match at the very end of the string;  "regsub -all" agrees.
+
+set regressM keep
+set regressS keep
+check regexp-all-nomatch-1 {regexp -all {(z)} abc regressM regressS} {}
+check regexp-all-nomatch-2 {list $regressM $regressS} {keep keep}
+check regexp-all-vars-1 {regexp -all {(a)(b)?} aba regressM regressS} {ab a}
+check regexp-all-vars-2 {list $regressM $regressS} {{ab a} {a a}}
+check regexp-all-empty-1 {regexp -all -indices {x*} ab} {{0 -1} {1 0} {2 1}}
+check regexp-all-empty-2 {regexp -all -indices {b*} abc} \
+	{{0 -1} {1 1} {2 1} {3 2}}
+check regexp-all-empty-3 {regexp -all {a*} a} a
+check regexp-all-empty-4 {regexp -all -indices {$} abc} {{3 2}}
+check regsub-all-empty-1 {regsub -all {x*} ab - r; set r} -a-b-
+check regsub-all-empty-2 {regsub -all {b*} abc - r; set r} -a--c-
+check regsub-all-empty-3 {regsub {x*} ab - r; set r} -ab
+unset regressM regressS r
+
+# Procedure locals live in frame slots;  upvar, uplevel and "info
+# locals" must see the same variables as the compiled code does.
+
+proc regressUpvar {} {upvar x y; set y 2}
+proc regressUpSet {} {uplevel {set z 5}}
+proc regressUpGet {} {uplevel {set z}}
+proc regressLocals1 {} {set x 1; regressUpvar; set x}
+proc regressLocals2 {} {regressUpvar; set x}
+proc regressLocals3 {} {regressUpSet; incr z; list $z [regressUpGet]}
+proc regressLocals4 {a} {set b 1; upvar #0 regressG c; set c $a; lsort [info locals]}
+proc regressLocals5 {} {set x 1; unset x; list [info exists x] [catch {set x}]}
+proc regressLocals6 {} {set x 1; regressUpvar; unset x; regressUpvar; set x}
+check local-slots-1 {regressLocals1} 2
+check local-slots-2 {regressLocals2} 2
+check local-slots-3 {regressLocals3} {6 6}
+check local-slots-4 {list [regressLocals4 3] $regressG} {{a b} 3}
+check local-slots-5 {regressLocals5} {0 1}
+check local-slots-6 {regressLocals6} 2
+unset regressG
+foreach regressName {regressUpvar regressUpSet regressUpGet regressLocals1
+	regressLocals2 regressLocals3 regressLocals4 regressLocals5
+	regressLocals6} {
+    rename $regressName {}
+}
+unset regressName
+
+# Array elements are kept in open-addressing hash tables, where deleted
+# entries leave markers behind.  Unset traces that run while an array
+# is being deleted, and searches over a table with many deletions, must
+# each see every remaining element exactly once.
+
+proc regressUnsetTrace {name el op} {
+    global regressSeen
+    lappend regressSeen $el
+    catch {uplevel unset ${name}(k[expr ([string range $el 1 end]+1)%50])}
+}
+set regressAll {}
+for {set i 0} {$i < 50} {incr i} {
+    set regressA(k$i) $i
+    trace var regressA(k$i) u regressUnsetTrace
+    lappend regressAll k$i
+}
+set regressSeen {}
+unset regressA
+check hash-delete-1 {llength $regressSeen} 50
+check hash-delete-2 {string compare [lsort $regressSeen] [lsort $regressAll]} 0
+check hash-delete-3 {info exists regressA} 0
+for {set i 0} {$i < 200} {incr i} {set regressA($i) $i}
+for {set i 0} {$i < 200} {incr i 2} {unset regressA($i)}
+proc regressCount {} {
+    global regressA
+    set s [array startsearch regressA]
+    set n 0
+    set sum 0
+    while {[array anymore regressA $s]} {
+	incr sum $regressA([array nextelement regressA $s])
+	incr n
+    }
+    array donesearch regressA $s
+    list $n $sum
+}
+check hash-delete-4 {regressCount} {100 10000}
+check hash-delete-5 {array size regressA} 100
+for {set i 0} {$i < 200} {incr i 2} {set regressA($i) 0}
+check hash-delete-6 {regressCount} {200 10000}
+unset regressA regressSeen regressAll i
+rename regressUnsetTrace {}
+rename regressCount {}
+
+# "info regexpcache" reports the cache's size, capacity and counters,
+# and sets a new capacity.  The cache evicts the least recently used
+# expression, so a hit moves an expression to the front.
+
+proc regressCacheStats {} {
+    set info [info regexpcache]
+    list [lindex $info 5] [lindex $info 7] [lindex $info 9]
+}
+proc regressCacheDelta {before} {
+    set after [regressCacheStats]
+    list [expr [lindex $after 0]-[lindex $before 0]] \
+	    [expr [lindex $after 1]-[lindex $before 1]] \
+	    [expr [lindex $after 2]-[lindex $before 2]]
+}
+set regressCapacity [lindex [info regexpcache] 3]
+check regexpcache-1 {lrange [info regexpcache 2] 2 3} {capacity 2}
+regexp regressA x
+regexp regressB x
+set regressBefore [regressCacheStats]
+regexp regressA x
+regexp regressC x
+regexp regressB x
+check regexpcache-2 {regressCacheDelta $regressBefore} {1 2 2}
+check regexpcache-3 {list [catch {info regexpcache 0} msg] $msg} \
+	{1 {bad regexp cache size 0: must be at least 1}}
+check regexpcache-4 {list [catch {info regexpcache 1 2} msg] $msg} \
+	{1 {wrong # args: should be "info regexpcache ?size?"}}
+check regexpcache-5 {lindex [info regexpcache $regressCapacity] 3} \
+	$regressCapacity
+unset regressCapacity regressBefore msg
+rename regressCacheStats {}
+rename regressCacheDelta {}
+
+# "gets" reads through a per-file buffer:  lines that straddle a
+# refill, lines longer than the buffer and an unterminated last line
+# must all come back whole, and "read", "tell" and "seek" must agree
+# with what "gets" has consumed.
+
+proc regressGets {} {
+    global regressFile
+    set f [open $regressFile]
+    set n 0
+    set len 0
+    while {[gets $f line] >= 0} {
+	incr n
+	incr len [string length $line]
+    }
+    close $f
+    list $n $len
+}
+set regressCounts [regressWriteLines $regressFile]
+check gets-buffer-1 {regressGets} $regressCounts
+set regressF [open $regressFile]
+gets $regressF
+gets $regressF
+check gets-buffer-2 {tell $regressF} 41
+check gets-buffer-3 {read $regressF 3} 000
+check gets-buffer-4 {tell $regressF} 44
+check gets-buffer-5 {string length [gets $regressF]} 72
+seek $regressF 0
+check gets-buffer-6 {gets $regressF} 0
+close $regressF
+regressRemove $regressFile
+unset regressCounts regressF
+rename regressGets {}
+
+# "foreach_line" shares the read buffer with "gets";  with -lines it
+# joins up to that many lines per iteration.  "break" and "continue"
+# work as in other loops.
+
+proc regressForeachLine {args} {
+    global regressFile
+    set f [open $regressFile]
+    set n 0
+    set len 0
+    eval foreach_line $args line $f {{
+	incr n
+	incr len [string length $line]
+    }}
+    close $f
+    list $n $len
+}
+proc regressForeachBreak {} {
+    global regressFile
+    set f [open $regressFile]
+    set n 0
+    foreach_line line $f {
+	incr n
+	if {$n < 3} {continue}
+	break
+    }
+    set rest [gets $f]
+    close $f
+    list $n [string length $rest] [string trimleft $rest 0]
+}
+set regressCounts [regressWriteLines $regressFile]
+check foreach-line-1 {regressForeachLine} $regressCounts
+check foreach-line-2 {regressForeachLine -lines 7} {44 40412}
+check foreach-line-3 {regressForeachLine -lines 1000} {1 40455}
+check foreach-line-4 {regressForeachBreak} {3 112 3}
+regressRemove $regressFile
+unset regressCounts
+rename regressForeachLine {}
+rename regressForeachBreak {}
+
+# Output is buffered by Tcl according to "fconfigure -buffering", and
+# whatever is still buffered when the process exits is written out.
+# The exit check runs only if regressShell names a Tcl shell that
+# reads a script from its standard input.
+
+proc regressContents {name} {
+    set f [open $name]
+    set data [read $f]
+    close $f
+    return $data
+}
+set regressF [open $regressFile w]
+check buffering-1 {fconfigure $regressF} \
+	{-blocking 1 -buffering full -buffersize 4096}
+puts $regressF abc nonewline
+check buffering-2 {regressContents $regressFile} {}
+fconfigure $regressF -buffering line
+check buffering-3 {regressContents $regressFile} abc
+puts $regressF de nonewline
+check buffering-4 {regressContents $regressFile} abc
+puts $regressF f
+check buffering-5 {regressContents $regressFile} "abcdef\n"
+fconfigure $regressF -buffering none
+puts $regressF g nonewline
+check buffering-6 {regressContents $regressFile} "abcdef\ng"
+fconfigure $regressF -buffering full -buffersize 8
+puts $regressF 0123 nonewline
+check buffering-7 {regressContents $regressFile} "abcdef\ng"
+flush $regressF
+check buffering-8 {regressContents $regressFile} "abcdef\ng0123"
+check buffering-9 {list [catch {fconfigure $regressF -buffering some} msg] $msg} \
+	{1 {bad buffering mode "some": should be full, line, or none}}
+check buffering-10 {list [catch {fconfigure stdin -buffering none} msg] $msg} \
+	{1 {"stdin" wasn't opened for writing}}
+check buffering-11 {fconfigure stderr -buffering} none
+close $regressF
+if [info exists regressShell] {
+    set regressF [open $regressFile w]
+    puts $regressF {set f [open regress2.tmp w]; puts $f hello; exit}
+    close $regressF
+    catch {exec $regressShell < $regressFile}
+    check buffering-12 {regressContents regress2.tmp} "hello\n"
+    regressRemove regress2.tmp
+}
+regressRemove $regressFile
+unset regressF msg
+rename regressContents {}
+
+# "fileevent" scripts run from "vwait" and "update";  a script that
+# fails is reported through bgerror and deleted.  A non-blocking
+# "gets" that has buffered part of a line must not make the file look
+# readable again until more input arrives (checked with a pipeline, so
+# only where "sh" can be run).
+
+proc regressReader {f} {
+    global regressLines regressCalls regressDone
+    incr regressCalls
+    if {[gets $f line] >= 0} {
+	lappend regressLines $line
+    } elseif [eof $f] {
+	close $f
+	set regressDone 1
+    }
+}
+proc bgerror {msg} {
+    global regressError
+    set regressError $msg
+}
+set regressF [open $regressFile w]
+puts $regressF "one\ntwo\nthree"
+close $regressF
+set regressCalls 0
+set regressLines {}
+set regressF [open $regressFile]
+fileevent $regressF readable "regressReader $regressF"
+check fileevent-1 {fileevent $regressF readable} "regressReader $regressF"
+vwait regressDone
+check fileevent-2 {set regressLines} {one two three}
+check fileevent-3 {list [catch {vwait regressDone} msg] $msg} \
+	{1 {can't wait for variable "regressDone":  would wait forever}}
+set regressF [open $regressFile]
+fileevent $regressF readable {error oops}
+update
+check fileevent-4 {list $regressError [fileevent $regressF readable]} {oops {}}
+fileevent $regressF readable {error oops}
+fileevent $regressF readable {}
+check fileevent-5 {fileevent $regressF readable} {}
+close $regressF
+check fileevent-6 {list [catch {fileevent stdout readable {}} msg] $msg} \
+	{1 {"stdout" wasn't opened for reading}}
+if ![catch {exec sh -c {exit 0}}] {
+    set regressCalls 0
+    set regressLines {}
+    set regressF [open "|sh -c {printf abc; sleep 1; printf 'def\\n'}"]
+    fconfigure $regressF -blocking 0
+    fileevent $regressF readable "regressReader $regressF"
+    vwait regressDone
+    check fileevent-7 {set regressLines} abcdef
+    check fileevent-8 {expr {$regressCalls < 10}} 1
+}
+regressRemove $regressFile
+unset regressF regressLines regressCalls regressDone regressError msg
+rename regressReader {}
+rename bgerror {}
+
+# "after" scripts run in order of their due times, and in order of
+# creation when due together;  idle scripts run once nothing else is
+# pending.  "after cancel" takes an identifier or the script itself,
+# and ignores scripts that don't exist.
+
+set regressOrder {}
+after 30 {lappend regressOrder t30}
+after 10 {lappend regressOrder t10a}
+after 10 {lappend regressOrder t10b}
+after idle {lappend regressOrder idle}
+set regressId [after 20 {lappend regressOrder cancelled}]
+after 20 lappend regressOrder t20
+after 5 {lappend regressOrder byscript}
+check after-1 {regexp {^after#[0-9]+$} $regressId} 1
+check after-2 {after cancel $regressId} {}
+check after-3 {after cancel lappend regressOrder byscript} {}
+check after-4 {after cancel after#999999} {}
+after 40 {set regressDone 1}
+vwait regressDone
+check after-5 {set regressOrder} {idle t10a t10b t20 t30}
+after idle {lappend regressOrder idle2}
+update idletasks
+check after-6 {lindex $regressOrder 5} idle2
+check after-7 {list [catch {after x} msg] $msg} \
+	{1 {bad argument "x": must be cancel, idle, or a number}}
+unset regressOrder regressId regressDone msg
+
+# "exec -stream" hands the output to a script piece by piece, and
+# "exec -variable" appends it to a variable;  the result holds only
+# standard error output.  "break" in the script stops reading and an
+# error is returned at once.  These need "sh".
+
+if ![catch {exec sh -c {exit 0}}] {
+    proc regressChunk {chunk} {
+	global regressPieces regressBytes
+	incr regressPieces
+	incr regressBytes [string length $chunk]
+    }
+    set regressPieces 0
+    set regressBytes 0
+    check exec-stream-1 {exec -stream regressChunk sh -c \
+	    {head -c 100000 /dev/zero | tr '\0' x}} {}
+    check exec-stream-2 {list [expr {$regressPieces > 1}] $regressBytes} \
+	    {1 100000}
+    set regressV pre:
+    check exec-stream-3 {exec -variable regressV sh -c {echo hello}} {}
+    check exec-stream-4 {set regressV} "pre:hello\n"
+    set regressPieces 0
+    check exec-stream-5 {exec -stream {incr regressPieces; break; list} \
+	    sh -c {yes | head -c 1000000}} {}
+    check exec-stream-6 {set regressPieces} 1
+    check exec-stream-7 {list [catch {exec -stream {error boom; list} \
+	    sh -c {echo hi}} msg] $msg} {1 boom}
+    check exec-stream-8 {exec -stream {continue; list} sh -c {echo z}} {}
+    set regressV {}
+    set regressBytes 0
+    check exec-stream-9 {exec -stream regressChunk -variable regressV \
+	    sh -c {echo both}} {}
+    check exec-stream-10 {list $regressV $regressBytes} "{both\n} 5"
+    check exec-stream-11 {exec -stream regressChunk \
+	    sh -c {echo out; echo err >&2}} err
+    check exec-stream-12 {list [catch {exec -stream x sleep 1 &} msg] $msg} \
+	    {1 {can't stream output of a background pipeline}}
+    unset regressPieces regressBytes regressV msg
+    rename regressChunk {}
+}
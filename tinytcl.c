@@ -90,7 +90,7 @@ main()
     int result, gotPartial;
 
     interp = Tcl_CreateInterp();
-#ifdef TCL_MEM_DEBUG
+#if defined(TCL_MEM_DEBUG) || defined(TCL_MEM_POOL)
     Tcl_InitMemory(interp);
 #endif
     Tcl_InitDebug (interp);